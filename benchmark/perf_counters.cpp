@@ -0,0 +1,160 @@
+#include "perf_counters.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace {
+
+struct CounterSpec {
+  const char* name;
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+#if defined(__linux__)
+
+constexpr CounterSpec counter_specs[] = {
+    // The first counter that opens is the group leader, so that all of the
+    // counters, e.g. instructions and cycles, are measured over the same
+    // interval even when the kernel multiplexes them.  Usually, that is
+    // `cycles`, but some virtual machines provide only some counters.
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+bool enabled_by_environment() {
+  const char* value = std::getenv("DD_BENCHMARK_PERF_COUNTERS");
+  return value == nullptr || std::strcmp(value, "0") != 0;
+}
+
+void warn_once(const char* name, int error) {
+  static bool warned = false;
+  if (warned) {
+    return;
+  }
+  warned = true;
+  std::fprintf(stderr,
+               "Hardware performance counter \"%s\" is unavailable (%s). "
+               "Unavailable counters will not be reported.\n",
+               name, std::strerror(error));
+}
+
+int open_counter(const CounterSpec& spec, int group_fd) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof attr);
+  attr.size = sizeof attr;
+  attr.type = spec.type;
+  attr.config = spec.config;
+  attr.disabled = group_fd == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  const long fd = ::syscall(SYS_perf_event_open, &attr, 0 /* this thread */,
+                            -1 /* any CPU */, group_fd, PERF_FLAG_FD_CLOEXEC);
+  if (fd == -1) {
+    warn_once(spec.name, errno);
+  }
+  return int(fd);
+}
+
+#endif
+
+}  // namespace
+
+#if defined(__linux__)
+
+static_assert(std::size(counter_specs) == 4,
+              "PerfCounters::fds_ has one element per counter");
+
+PerfCounters::PerfCounters(benchmark::State& state) : state_(state) {
+  static const bool enabled = enabled_by_environment();
+  int group_fd = -1;
+  for (std::size_t i = 0; i < std::size(counter_specs); ++i) {
+    fds_[i] = -1;
+    if (!enabled) {
+      continue;
+    }
+    fds_[i] = open_counter(counter_specs[i], group_fd);
+    if (group_fd == -1) {
+      group_fd = fds_[i];
+    }
+  }
+  if (group_fd != -1) {
+    ::ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ::ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  int group_fd = -1;
+  for (const int fd : fds_) {
+    if (fd != -1) {
+      group_fd = fd;
+      break;
+    }
+  }
+  if (group_fd != -1) {
+    ::ioctl(group_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // The group's values are read together: the number of values, the time
+    // enabled, the time running, and then one value per counter in the order
+    // the counters were added to the group.
+    std::uint64_t buffer[3 + std::size(counter_specs)] = {};
+    const ssize_t rc = ::read(group_fd, buffer, sizeof buffer);
+    const std::uint64_t time_enabled = buffer[1];
+    const std::uint64_t time_running = buffer[2];
+    const auto iterations = state_.iterations();
+    if (rc >= ssize_t(3 * sizeof(std::uint64_t)) && time_running != 0 &&
+        iterations != 0) {
+      // If the kernel multiplexed the counters, then extrapolate the counts
+      // to the whole interval.
+      const double scale = double(time_enabled) / double(time_running);
+      double values[std::size(counter_specs)] = {};
+      std::size_t next = 0;
+      for (std::size_t i = 0; i < std::size(counter_specs); ++i) {
+        if (fds_[i] == -1 || next >= buffer[0]) {
+          continue;
+        }
+        values[i] = double(buffer[3 + next++]) * scale;
+        state_.counters[counter_specs[i].name] = benchmark::Counter(
+            values[i], benchmark::Counter::kAvgIterations);
+      }
+      if (fds_[0] != -1 && fds_[1] != -1 && values[0] != 0) {
+        state_.counters["IPC"] = values[1] / values[0];
+      }
+    }
+  }
+
+  for (const int fd : fds_) {
+    if (fd != -1) {
+      ::close(fd);
+    }
+  }
+}
+
+#else
+
+PerfCounters::PerfCounters(benchmark::State& state) : state_(state) {
+  for (int& fd : fds_) {
+    fd = -1;
+  }
+}
+
+PerfCounters::~PerfCounters() {}
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+// This component provides a class, `PerfCounters`, that measures hardware
+// performance counters over the timed loop of a Google Benchmark benchmark,
+// and reports them as user counters of the benchmark.
+//
+// The counters are read using perf_event_open(2), counting only user-space
+// events of the calling thread.  The reported counters, each averaged per
+// iteration, are "instructions", "cycles", "cache_misses", and
+// "branch_misses", as well as "IPC" (instructions per cycle).
+//
+// Hardware counters are often unavailable, such as in virtual machines and
+// containers, or when the "kernel.perf_event_paranoid" sysctl forbids them.
+// Then the counters that could not be opened are not reported, and a message
+// saying so is printed to standard error once.  Counters can also be disabled
+// by setting the environment variable `DD_BENCHMARK_PERF_COUNTERS` to "0".
+//
+// Usage:
+//
+//     void BM_Something(benchmark::State& state) {
+//       // ... setup ...
+//       PerfCounters counters{state};
+//       for (auto _ : state) {
+//         // ... measured code ...
+//       }
+//     }
+
+#include <benchmark/benchmark.h>
+
+class PerfCounters {
+  benchmark::State& state_;
+  // The first file descriptor that is not -1 is the group leader.  A value of
+  // -1 means that the corresponding counter is unavailable.
+  int fds_[4];
+
+ public:
+  // Begin counting hardware events on behalf of the specified `state`.
+  explicit PerfCounters(benchmark::State& state);
+  // Stop counting and add the counts, averaged over the benchmark's
+  // iterations, to the counters of the `state` specified on construction.
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+};
@@ -0,0 +1,124 @@
+#include "replay.h"
+
+#include <datadog/dict_adapters.h>
+#include <datadog/span.h>
+#include <datadog/span_data.h>
+#include <datadog/tracer.h>
+
+#include <unordered_map>
+#include <variant>
+
+namespace dd = datadog::tracing;
+
+namespace {
+
+// Return whether the tag or metric having the specified `key` is one that the
+// tracer sets itself, and so is not replayed.
+bool set_by_tracer(const std::string& key) {
+  return key.empty() || key[0] == '_' || key == "language" ||
+         key == "runtime-id" || key == "process_id" || key == "env" ||
+         key == "version";
+}
+
+}  // namespace
+
+TraceReplayer::TraceReplayer(
+    const std::vector<dd::TraceCapture::Record>& records) {
+  // Headers are recorded when a trace is extracted, and so precede the
+  // trace's chunk.
+  std::unordered_map<std::uint64_t, const dd::TraceCapture::Headers*>
+      headers_by_trace;
+
+  for (const auto& record : records) {
+    if (const auto* headers = std::get_if<dd::TraceCapture::Headers>(&record)) {
+      headers_by_trace[headers->trace_id.low] = headers;
+      continue;
+    }
+    const auto& chunk = std::get<dd::TraceCapture::Chunk>(record);
+    if (chunk.empty()) {
+      continue;
+    }
+
+    ReplayTrace trace;
+    const auto found = headers_by_trace.find(chunk.front()->trace_id.low);
+    if (found != headers_by_trace.end()) {
+      trace.headers = found->second->headers;
+      trace.extracted = true;
+      headers_by_trace.erase(found);
+    }
+
+    // The local root is the first span of the chunk.  Any span whose parent
+    // is not in the chunk is replayed as a child of the local root.
+    std::unordered_map<std::uint64_t, std::size_t> index_by_id;
+    for (const auto& span_ptr : chunk) {
+      const dd::SpanData& data = *span_ptr;
+      index_by_id.emplace(data.span_id, trace.spans.size());
+      ReplaySpan span;
+      span.config.service = data.service;
+      span.config.service_type = data.service_type;
+      span.config.name = data.name;
+      span.config.resource = data.resource;
+      for (const auto& [key, value] : data.tags) {
+        if (!set_by_tracer(key)) {
+          span.tags.emplace_back(key, value);
+        }
+      }
+      for (const auto& [key, value] : data.numeric_tags) {
+        if (!set_by_tracer(key)) {
+          span.metrics.emplace_back(key, value);
+        }
+      }
+      span.error = data.error;
+      trace.spans.push_back(std::move(span));
+    }
+    for (std::size_t i = 1; i < chunk.size(); ++i) {
+      const auto parent = index_by_id.find(chunk[i]->parent_id);
+      const std::size_t parent_index =
+          parent == index_by_id.end() || parent->second == i ? 0
+                                                             : parent->second;
+      trace.spans[parent_index].children.push_back(i);
+    }
+
+    span_count_ += trace.spans.size();
+    traces_.push_back(std::move(trace));
+  }
+}
+
+void TraceReplayer::replay_children(const ReplayTrace& trace,
+                                    const ReplaySpan& parent,
+                                    const dd::Span& span) const {
+  for (const std::size_t index : parent.children) {
+    const ReplaySpan& child = trace.spans[index];
+    auto child_span = span.create_child(child.config);
+    for (const auto& [key, value] : child.tags) {
+      child_span.set_tag(key, value);
+    }
+    for (const auto& [key, value] : child.metrics) {
+      child_span.set_metric(key, value);
+    }
+    if (child.error) {
+      child_span.set_error(true);
+    }
+    replay_children(trace, child, child_span);
+  }
+}
+
+void TraceReplayer::replay(dd::Tracer& tracer) const {
+  for (const auto& trace : traces_) {
+    const ReplaySpan& root = trace.spans.front();
+    auto span = trace.extracted
+                    ? tracer.extract_or_create_span(
+                          dd::IndexedDictReader{trace.headers}, root.config)
+                    : tracer.create_span(root.config);
+    for (const auto& [key, value] : root.tags) {
+      span.set_tag(key, value);
+    }
+    for (const auto& [key, value] : root.metrics) {
+      span.set_metric(key, value);
+    }
+    if (root.error) {
+      span.set_error(true);
+    }
+    replay_children(trace, root, span);
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// This component provides a class, `TraceReplayer`, that replays the traces
+// recorded in a trace capture (see `datadog/trace_capture.h`) through a
+// `Tracer`.
+//
+// Replaying a trace creates its spans with the recorded names, services,
+// resources, tags, metrics, and error statuses, in the recorded parent/child
+// arrangement, and then finishes them, so that the trace is finalized and
+// sent to the tracer's collector.  If the trace was extracted from trace
+// context headers, then its local root span is extracted from the same
+// headers.  Tags and metrics that the tracer itself sets, such as sampling
+// decisions, are not replayed.  Timestamps are not replayed; spans are
+// created and finished as quickly as possible.
+
+#include <datadog/span_config.h>
+#include <datadog/trace_capture.h>
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+class Span;
+class Tracer;
+}  // namespace tracing
+}  // namespace datadog
+
+class TraceReplayer {
+  struct ReplaySpan {
+    datadog::tracing::SpanConfig config;
+    std::vector<std::pair<std::string, std::string>> tags;
+    std::vector<std::pair<std::string, double>> metrics;
+    bool error = false;
+    std::vector<std::size_t> children;
+  };
+
+  struct ReplayTrace {
+    // Trace context headers, if the trace was extracted.
+    std::vector<std::pair<std::string, std::string>> headers;
+    bool extracted = false;
+    // `spans.front()` is the local root.
+    std::vector<ReplaySpan> spans;
+  };
+
+  std::vector<ReplayTrace> traces_;
+  std::size_t span_count_ = 0;
+
+  void replay_children(const ReplayTrace& trace, const ReplaySpan& parent,
+                       const datadog::tracing::Span& span) const;
+
+ public:
+  // Prepare to replay the traces in the specified `records`.
+  explicit TraceReplayer(
+      const std::vector<datadog::tracing::TraceCapture::Record>& records);
+
+  // Return the number of traces and spans that `replay` creates.
+  std::size_t trace_count() const { return traces_.size(); }
+  std::size_t span_count() const { return span_count_; }
+
+  // Use the specified `tracer` to create and finish each of the traces.
+  void replay(datadog::tracing::Tracer& tracer) const;
+};
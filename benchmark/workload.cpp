@@ -0,0 +1,109 @@
+#include "workload.h"
+
+#include <datadog/dict_adapters.h>
+#include <datadog/span.h>
+#include <datadog/span_config.h>
+#include <datadog/tracer.h>
+
+#include <algorithm>
+
+namespace dd = datadog::tracing;
+
+namespace {
+
+// Return a vector of the specified `count` distinct strings, each beginning
+// with the specified `prefix` and padded to at least the specified `size`.
+std::vector<std::string> make_strings(const std::string& prefix, int count,
+                                      int size = 0) {
+  std::vector<std::string> result;
+  result.reserve(std::size_t(std::max(count, 1)));
+  for (int i = 0; i < std::max(count, 1); ++i) {
+    std::string value = prefix + std::to_string(i);
+    if (int(value.size()) < size) {
+      value.append(std::size_t(size) - value.size(), 'x');
+    }
+    result.push_back(std::move(value));
+  }
+  return result;
+}
+
+}  // namespace
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadShape& shape)
+    : shape_(shape),
+      random_state_(0x9e3779b97f4a7c15),
+      operation_names_(make_strings("operation.", shape.cardinality)),
+      resource_names_(make_strings("GET /api/v1/resource/", shape.cardinality)),
+      tag_names_(make_strings("tag.", shape.tags_per_span)),
+      tag_values_(make_strings("", shape.cardinality, shape.tag_value_size)),
+      error_messages_(make_strings("error: ", shape.cardinality)),
+      inbound_headers_{
+          {"x-datadog-trace-id", "7277407061855694839"},
+          {"x-datadog-parent-id", "5208512171318403364"},
+          {"x-datadog-sampling-priority", "1"},
+          {"x-datadog-tags", "_dd.p.dm=-4,_dd.p.tid=640cfd8d00000000"},
+          {"traceparent",
+           "00-640cfd8d0000000064fe8b2a57d3eff7-4848d2b6c27ab7a4-01"},
+          {"tracestate", "dd=s:1;p:4848d2b6c27ab7a4;t.dm:-4"},
+      } {}
+
+std::uint64_t WorkloadGenerator::next_random() {
+  // xorshift64
+  random_state_ ^= random_state_ << 13;
+  random_state_ ^= random_state_ >> 7;
+  random_state_ ^= random_state_ << 17;
+  return random_state_;
+}
+
+const std::string& WorkloadGenerator::pick(
+    const std::vector<std::string>& strings) {
+  return strings[next_random() % strings.size()];
+}
+
+void WorkloadGenerator::decorate(dd::Span& span) {
+  for (int i = 0; i < shape_.tags_per_span; ++i) {
+    span.set_tag(tag_names_[std::size_t(i)], pick(tag_values_));
+  }
+  if (shape_.error_percent > 0 &&
+      int(next_random() % 100) < shape_.error_percent) {
+    span.set_error_message(pick(error_messages_));
+  }
+}
+
+void WorkloadGenerator::create_children(const dd::Span& parent, int level) {
+  if (level > shape_.depth) {
+    return;
+  }
+  for (int i = 0; i < shape_.fan_out && spans_remaining_ > 0; ++i) {
+    --spans_remaining_;
+    dd::SpanConfig config;
+    config.name = pick(operation_names_);
+    config.resource = pick(resource_names_);
+    auto child = parent.create_child(config);
+    decorate(child);
+    if (level == shape_.depth && shape_.propagation) {
+      outbound_headers_.clear();
+      dd::VectorDictWriter writer{outbound_headers_};
+      child.inject(writer);
+    }
+    create_children(child, level + 1);
+  }
+}
+
+int WorkloadGenerator::generate_trace(dd::Tracer& tracer) {
+  spans_remaining_ = std::max(shape_.max_spans, 1) - 1;
+  dd::SpanConfig config;
+  config.name = "http.request";
+  config.resource = pick(resource_names_);
+  if (shape_.propagation) {
+    const dd::IndexedDictReader reader{inbound_headers_};
+    auto root = tracer.extract_or_create_span(reader, config);
+    decorate(root);
+    create_children(root, 1);
+  } else {
+    auto root = tracer.create_span(config);
+    decorate(root);
+    create_children(root, 1);
+  }
+  return std::max(shape_.max_spans, 1) - spans_remaining_;
+}
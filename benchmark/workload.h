@@ -0,0 +1,78 @@
+#pragma once
+
+// This component provides a synthetic trace workload generator for the
+// benchmarks.  A `WorkloadShape` describes the traces to generate: how deep
+// and how wide the span tree is, how many tags each span has and how large
+// they are, how many distinct strings appear, how often spans are errors, and
+// whether trace context is extracted from and injected into headers, as an
+// RPC server and its clients would.
+//
+// `WorkloadGenerator` prepares the strings that a shape calls for ahead of
+// time, so that a benchmark measures the tracer rather than the generation of
+// its inputs, and then creates one complete trace per call to
+// `generate_trace`.  Choices within a trace, such as which resource name a
+// span has and whether it's an error, are made by a pseudo-random number
+// generator with a fixed seed, so that runs are repeatable.
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+class Span;
+class Tracer;
+}  // namespace tracing
+}  // namespace datadog
+
+struct WorkloadShape {
+  // Number of levels of spans below the root span.  For example, a depth of
+  // zero is a trace having only a root span.
+  int depth = 2;
+  // Number of children of each span that is not at the bottom level.
+  int fan_out = 4;
+  // Maximum number of spans in a trace, including the root.  Span creation
+  // is depth-first, and stops once this many spans have been created.
+  int max_spans = 64;
+  // Number of string tags set on each span, in addition to those set by the
+  // tracer.
+  int tags_per_span = 4;
+  // Length of each tag value, in bytes.
+  int tag_value_size = 16;
+  // Number of distinct values that each tag, resource name, and operation
+  // name can have.
+  int cardinality = 100;
+  // Percentage, from 0 to 100, of spans that are marked as errors, with an
+  // error message.
+  int error_percent = 0;
+  // Whether the root span is extracted from the headers of an inbound
+  // request, and each span at the bottom level injects its context into the
+  // headers of an outbound request.
+  bool propagation = false;
+};
+
+class WorkloadGenerator {
+  WorkloadShape shape_;
+  std::uint64_t random_state_;
+  std::vector<std::string> operation_names_;
+  std::vector<std::string> resource_names_;
+  std::vector<std::string> tag_names_;
+  std::vector<std::string> tag_values_;
+  std::vector<std::string> error_messages_;
+  std::vector<std::pair<std::string, std::string>> inbound_headers_;
+  std::vector<std::pair<std::string, std::string>> outbound_headers_;
+  int spans_remaining_ = 0;
+
+  std::uint64_t next_random();
+  const std::string& pick(const std::vector<std::string>& strings);
+  void decorate(datadog::tracing::Span& span);
+  void create_children(const datadog::tracing::Span& parent, int level);
+
+ public:
+  explicit WorkloadGenerator(const WorkloadShape& shape);
+
+  // Use the specified `tracer` to create and finish one trace of this
+  // generator's shape.  Return the number of spans created.
+  int generate_trace(datadog::tracing::Tracer& tracer);
+};
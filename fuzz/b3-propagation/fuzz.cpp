@@ -0,0 +1,103 @@
+#include <datadog/b3_propagation.h>
+#include <datadog/dict_reader.h>
+#include <datadog/dict_writer.h>
+#include <datadog/extracted_data.h>
+#include <datadog/null_collector.h>
+#include <datadog/null_logger.h>
+#include <datadog/optional.h>
+#include <datadog/string_view.h>
+#include <datadog/tracer.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace dd = datadog::tracing;
+
+namespace {
+
+dd::Tracer& tracer_singleton() {
+  thread_local auto tracer = []() {
+    dd::TracerConfig config;
+    config.service = "fuzzer";
+    config.collector = std::make_shared<dd::NullCollector>();
+    config.extraction_styles = {dd::PropagationStyle::B3_SINGLE};
+    config.injection_styles = {dd::PropagationStyle::B3_SINGLE};
+
+    const auto finalized_config = dd::finalize_config(config);
+    if (!finalized_config) {
+      std::abort();
+    }
+
+    return dd::Tracer{*finalized_config};
+  }();
+
+  return tracer;
+}
+
+struct MockDictReader : public dd::DictReader {
+  dd::StringView b3;
+
+  dd::Optional<dd::StringView> lookup(dd::StringView key) const override {
+    if (key == "b3") {
+      return b3;
+    }
+    return dd::nullopt;
+  }
+
+  void visit(
+      const std::function<void(dd::StringView key, dd::StringView value)>&
+          visitor) const override {
+    visitor("b3", b3);
+  }
+};
+
+struct MockDictWriter : public dd::DictWriter {
+  void set(dd::StringView, dd::StringView) override {}
+};
+
+// Return the trace context extracted from the specified "b3" header `value`.
+dd::Expected<dd::ExtractedData> extract(dd::StringView value) {
+  MockDictReader reader;
+  reader.b3 = value;
+  std::unordered_map<std::string, std::string> span_tags;
+  dd::NullLogger logger;
+  return dd::extract_b3_single(reader, span_tags, logger);
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+  const dd::StringView value{reinterpret_cast<const char*>(data), size};
+
+  MockDictReader reader;
+  reader.b3 = value;
+  const auto span = tracer_singleton().extract_span(reader);
+  if (span) {
+    MockDictWriter writer;
+    span->inject(writer);
+  }
+
+  // Whatever trace context is extracted must survive encoding and extraction.
+  const auto extracted = extract(value);
+  if (!extracted || !extracted->trace_id || !extracted->parent_id) {
+    return 0;
+  }
+
+  const int sampling_priority = extracted->sampling_priority.value_or(1);
+  char buffer[dd::b3_single_max_size];
+  const auto encoded =
+      dd::encode_b3_single(*extracted->trace_id, *extracted->parent_id,
+                           sampling_priority, buffer);
+  const auto round_trip = extract(encoded);
+  if (!round_trip || round_trip->trace_id != extracted->trace_id ||
+      round_trip->parent_id != extracted->parent_id ||
+      round_trip->sampling_priority != int(sampling_priority > 0)) {
+    std::abort();
+  }
+
+  return 0;
+}
@@ -0,0 +1,20 @@
+// This fuzzer checks that extracting W3C baggage takes time linear in the
+// size of the "baggage" header.  See complexity.h.
+
+#include <datadog/baggage.h>
+
+#include <cstdint>
+
+#include "complexity.h"
+
+namespace dd = datadog::tracing;
+namespace fz = datadog::fuzz;
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+  fz::check_linear("Baggage::extract", fz::PumpedInput{data, size},
+                   [](dd::StringView input) {
+                     const fz::HeaderReader headers{{{"baggage", input}}};
+                     (void)dd::Baggage::extract(headers);
+                   });
+  return 0;
+}
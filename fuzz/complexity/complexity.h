@@ -0,0 +1,203 @@
+#pragma once
+
+// This file provides the function template `check_linear`, which the fuzzers
+// in this directory use to check that a parser does a bounded amount of work
+// per byte of input, i.e. that its running time grows linearly with the size
+// of its input.
+//
+// A fuzzer input is split into a prefix, a "pump," and a suffix.  The parser
+// is timed on the prefix followed by `small_copies` copies of the pump and
+// then the suffix, and then on the same with `scale` times as many copies of
+// the pump.  If the larger input takes more than `tolerance * scale` times as
+// long as the smaller input, then the parser's work per byte grows with the
+// size of its input, and the fuzzer prints the timings and aborts.  A
+// quadratic parser takes `scale * scale` times as long, so timing noise is
+// unlikely to be mistaken for a finding, or a finding for noise.
+
+#include <datadog/dict_reader.h>
+#include <datadog/logger.h>
+#include <datadog/optional.h>
+#include <datadog/string_view.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace datadog {
+namespace fuzz {
+
+using tracing::StringView;
+
+// The parser is timed with about this many bytes of pump, and with `scale`
+// times as many.
+constexpr std::size_t small_pump_bytes = 1024;
+constexpr std::size_t scale = 16;
+constexpr double tolerance = 4;
+
+// A fuzzer input, interpreted as a prefix, a pump, and a suffix.  The first
+// byte of the input is the length of the prefix, and the second is the length
+// of the pump.  The prefix, pump, and suffix follow, in that order.  If the
+// lengths are too large, then they are truncated to fit the input.
+struct PumpedInput {
+  StringView prefix;
+  StringView pump;
+  StringView suffix;
+
+  PumpedInput(const std::uint8_t* data, std::size_t size) {
+    const char* begin = reinterpret_cast<const char*>(data);
+    const char* const end = begin + size;
+    std::size_t prefix_size = 0;
+    std::size_t pump_size = 0;
+    if (begin != end) prefix_size = std::uint8_t(*begin++);
+    if (begin != end) pump_size = std::uint8_t(*begin++);
+    prefix_size = std::min<std::size_t>(prefix_size, end - begin);
+    prefix = StringView{begin, prefix_size};
+    begin += prefix_size;
+    pump_size = std::min<std::size_t>(pump_size, end - begin);
+    pump = StringView{begin, pump_size};
+    begin += pump_size;
+    suffix = StringView{begin, std::size_t(end - begin)};
+  }
+
+  // Return the number of copies of the pump that makes about
+  // `small_pump_bytes` bytes.
+  std::size_t small_copies() const {
+    return (small_pump_bytes + pump.size() - 1) / pump.size();
+  }
+
+  // Return the prefix, followed by the specified number of `copies` of the
+  // pump, followed by the suffix.
+  std::string with_copies(std::size_t copies) const {
+    std::string result;
+    result.reserve(prefix.size() + copies * pump.size() + suffix.size());
+    result.append(prefix.data(), prefix.size());
+    for (std::size_t i = 0; i < copies; ++i) {
+      result.append(pump.data(), pump.size());
+    }
+    result.append(suffix.data(), suffix.size());
+    return result;
+  }
+};
+
+// Return the least number of nanoseconds that one call to the specified `run`
+// took, over a few trials.  Each trial calls `run` repeatedly until at least
+// 100 microseconds have passed, so that the clock's resolution doesn't
+// matter.
+inline double nanoseconds_per_call(const std::function<void()>& run) {
+  using Clock = std::chrono::steady_clock;
+  constexpr int trials = 3;
+  constexpr auto min_trial_duration = std::chrono::microseconds(100);
+
+  double best = -1;
+  for (int trial = 0; trial < trials; ++trial) {
+    std::size_t calls = 0;
+    const auto before = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    do {
+      run();
+      ++calls;
+      elapsed = Clock::now() - before;
+    } while (elapsed < min_trial_duration);
+
+    const double nanoseconds =
+        double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                   .count()) /
+        calls;
+    if (best < 0 || nanoseconds < best) best = nanoseconds;
+  }
+  return best;
+}
+
+// Time the specified `run` with `copies` and with `scale * copies`, where
+// `run(n)` parses an input containing `n` copies of some pump, and where the
+// input sizes in bytes are the corresponding results of the specified `size`.
+// Abort if the work per byte of the larger input exceeds that of the smaller
+// input by more than a factor of `tolerance`.  The specified `name` is used in
+// the diagnostic.
+inline void check_linear(const char* name, std::size_t copies,
+                         const std::function<std::size_t(std::size_t)>& size,
+                         const std::function<void(std::size_t)>& run) {
+  const std::size_t small_size = size(copies);
+  const std::size_t large_size = size(scale * copies);
+  const double size_ratio = double(large_size) / double(small_size);
+
+  double small_time = 0;
+  double large_time = 0;
+  // A timing can be inflated by preemption, so a failure must be reproduced
+  // before it's reported.
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    small_time = nanoseconds_per_call([&]() { run(copies); });
+    large_time = nanoseconds_per_call([&]() { run(scale * copies); });
+    if (large_time <= tolerance * size_ratio * small_time) {
+      return;
+    }
+  }
+
+  std::fprintf(stderr,
+               "%s: parsing %zu bytes took %.0f ns (%.2f ns/byte), but "
+               "parsing %zu bytes took %.0f ns (%.2f ns/byte)\n",
+               name, small_size, small_time, small_time / small_size,
+               large_size, large_time, large_time / large_size);
+  std::abort();
+}
+
+// Check that the specified `parse` is linear in the size of inputs built by
+// pumping the specified `input`, as described at the top of this file.  Do
+// nothing if the pump is empty.
+inline void check_linear(const char* name, const PumpedInput& input,
+                         const std::function<void(StringView)>& parse) {
+  if (input.pump.empty()) {
+    return;
+  }
+
+  const std::size_t copies = input.small_copies();
+  const std::string small = input.with_copies(copies);
+  const std::string large = input.with_copies(scale * copies);
+  check_linear(
+      name, copies,
+      [&](std::size_t n) { return n == copies ? small.size() : large.size(); },
+      [&](std::size_t n) { parse(n == copies ? small : large); });
+}
+
+// `HeaderReader` is a `DictReader` over a fixed list of headers.
+class HeaderReader : public tracing::DictReader {
+  std::vector<std::pair<StringView, StringView>> headers_;
+
+ public:
+  explicit HeaderReader(
+      std::vector<std::pair<StringView, StringView>> headers)
+      : headers_(std::move(headers)) {}
+
+  tracing::Optional<StringView> lookup(StringView key) const override {
+    for (const auto& [name, value] : headers_) {
+      if (name == key) return value;
+    }
+    return tracing::nullopt;
+  }
+
+  void visit(const std::function<void(StringView key, StringView value)>&
+                 visitor) const override {
+    for (const auto& [name, value] : headers_) {
+      visitor(name, value);
+    }
+  }
+};
+
+// `NullLogger` is a `Logger` that discards everything, so that a parser's
+// diagnostics don't dominate its timing.
+struct NullLogger : public tracing::Logger {
+  void log_error(const LogFunc&) override {}
+  void log_startup(const LogFunc&) override {}
+  void log_error(const tracing::Error&) override {}
+  void log_error(StringView) override {}
+};
+
+}  // namespace fuzz
+}  // namespace datadog
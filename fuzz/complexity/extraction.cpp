@@ -0,0 +1,72 @@
+// This fuzzer checks that extracting trace context in the Datadog, B3, and B3
+// single-header propagation styles takes time linear in the size of each
+// header that the extraction examines.  See complexity.h.
+//
+// For each header, the pumped input is the value of that header, and the other
+// headers have valid values.
+
+#include <datadog/b3_propagation.h>
+#include <datadog/extracted_data.h>
+#include <datadog/extraction_util.h>
+#include <datadog/string_view.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "complexity.h"
+
+namespace dd = datadog::tracing;
+namespace fz = datadog::fuzz;
+
+namespace {
+
+using Headers = std::vector<std::pair<dd::StringView, dd::StringView>>;
+using Extract = dd::Expected<dd::ExtractedData> (*)(
+    const dd::DictReader&, std::unordered_map<std::string, std::string>&,
+    dd::Logger&);
+
+const Headers datadog_headers{{"x-datadog-trace-id", "48485a3953bb6124"},
+                              {"x-datadog-parent-id", "1234"},
+                              {"x-datadog-sampling-priority", "2"},
+                              {"x-datadog-origin", "synthetics"},
+                              {"x-datadog-tags", "_dd.p.dm=-4"}};
+
+const Headers b3_headers{{"x-b3-traceid", "48485a3953bb6124"},
+                         {"x-b3-spanid", "4d2"},
+                         {"x-b3-sampled", "1"}};
+
+const Headers b3_single_headers{{"b3", "48485a3953bb6124-00000000000004d2-1"}};
+
+// Check `extract` with the pumped `input` in place of each of the specified
+// `headers` in turn.
+void check_each_header(const char* name, Extract extract,
+                       const Headers& headers, const fz::PumpedInput& input) {
+  for (std::size_t i = 0; i < headers.size(); ++i) {
+    std::string description = name;
+    description += ' ';
+    description.append(headers[i].first.data(), headers[i].first.size());
+    fz::check_linear(description.c_str(), input, [&](dd::StringView value) {
+      Headers pumped = headers;
+      pumped[i].second = value;
+      const fz::HeaderReader reader{std::move(pumped)};
+      std::unordered_map<std::string, std::string> span_tags;
+      fz::NullLogger logger;
+      (void)extract(reader, span_tags, logger);
+    });
+  }
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+  const fz::PumpedInput input{data, size};
+  check_each_header("extract_datadog", &dd::extract_datadog, datadog_headers,
+                    input);
+  check_each_header("extract_b3", &dd::extract_b3, b3_headers, input);
+  check_each_header("extract_b3_single", &dd::extract_b3_single,
+                    b3_single_headers, input);
+  return 0;
+}
@@ -0,0 +1,24 @@
+// This fuzzer checks that `parse_list` and `parse_tags`, which parse
+// configuration from environment variables, take time linear in the size of
+// their input.  See complexity.h.
+
+#include <datadog/parse_util.h>
+#include <datadog/string_view.h>
+
+#include <cstdint>
+
+#include "complexity.h"
+
+namespace dd = datadog::tracing;
+namespace fz = datadog::fuzz;
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+  const fz::PumpedInput input{data, size};
+  fz::check_linear("parse_list", input, [](dd::StringView input) {
+    (void)dd::parse_list(input);
+  });
+  fz::check_linear("parse_tags", input, [](dd::StringView input) {
+    (void)dd::parse_tags(input);
+  });
+  return 0;
+}
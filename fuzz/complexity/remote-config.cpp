@@ -0,0 +1,130 @@
+// This fuzzer checks that processing a Remote Configuration response takes
+// time linear in the size of the response.  See complexity.h.
+//
+// Two kinds of responses are checked:
+//
+// - responses having one configuration for each copy of the pump, where the
+//   pump determines the name and content of each configuration, and
+// - responses having one configuration whose path is the pumped input.
+
+#include <datadog/base64.h>
+#include <datadog/json.hpp>
+#include <datadog/remote_config/listener.h>
+#include <datadog/remote_config/remote_config.h>
+#include <datadog/runtime_id.h>
+#include <datadog/string_view.h>
+#include <datadog/tracer_signature.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "complexity.h"
+
+namespace dd = datadog::tracing;
+namespace fz = datadog::fuzz;
+namespace rc = datadog::remote_config;
+
+namespace {
+
+struct Listener : public rc::Listener {
+  rc::Products get_products() override { return rc::product::APM_TRACING; }
+  rc::Capabilities get_capabilities() override { return 0; }
+  void on_revert(const Configuration&) override {}
+  dd::Optional<std::string> on_update(const Configuration&) override {
+    return dd::nullopt;
+  }
+  void on_post_process() override {}
+};
+
+// Return a Remote Configuration response that has a configuration at each of
+// the specified `paths`, with the specified `content`.
+nlohmann::json make_response(const std::vector<std::string>& paths,
+                             dd::StringView content) {
+  auto targets = nlohmann::json::object();
+  auto target_files = nlohmann::json::array();
+  const std::string raw = dd::base64_encode(content);
+  for (const auto& path : paths) {
+    targets[path] = {{"custom", {{"v", 1}}},
+                     {"hashes", {{"sha256", std::to_string(targets.size())}}},
+                     {"length", content.size()}};
+    target_files.push_back({{"path", path}, {"raw", raw}});
+  }
+
+  const nlohmann::json signed_targets = {
+      {"signed",
+       {{"custom", {{"opaque_backend_state", "fuzz"}}},
+        {"targets", std::move(targets)},
+        {"version", 1}}}};
+
+  // The paths might not be valid UTF-8, which `dump` would otherwise reject.
+  const std::string encoded_targets = signed_targets.dump(
+      -1, ' ', false, nlohmann::json::error_handler_t::replace);
+  return {{"targets", dd::base64_encode(encoded_targets)},
+          {"client_configs", paths},
+          {"target_files", std::move(target_files)}};
+}
+
+void process(const nlohmann::json& response) {
+  static const auto logger = std::make_shared<fz::NullLogger>();
+  static const auto listener = std::make_shared<Listener>();
+  const dd::TracerSignature signature{dd::RuntimeID::generate(), "fuzz",
+                                      "fuzz"};
+  rc::Manager manager{signature, {listener}, logger};
+  manager.process_response(response);
+}
+
+// Return a string of hexadecimal digits that encodes the specified `bytes`, so
+// that `bytes` can be used as a path component.
+std::string hex(dd::StringView bytes) {
+  static const char digits[] = "0123456789abcdef";
+  std::string result;
+  for (const char byte : bytes) {
+    result += digits[(unsigned char)byte >> 4];
+    result += digits[(unsigned char)byte & 0xF];
+  }
+  return result;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+  const fz::PumpedInput input{data, size};
+  if (input.pump.empty()) {
+    return 0;
+  }
+
+  // Each configuration is a few hundred bytes of response, so fewer copies of
+  // the pump are needed than for the other fuzzers.
+  const std::size_t copies = 64;
+  const auto make_many = [&](std::size_t count) {
+    std::vector<std::string> paths;
+    const std::string id = hex(input.pump);
+    for (std::size_t i = 0; i < count; ++i) {
+      paths.push_back("datadog/2/APM_TRACING/" + id + std::to_string(i) +
+                      "/config");
+    }
+    return make_response(paths, input.suffix);
+  };
+  const nlohmann::json small = make_many(copies);
+  const nlohmann::json large = make_many(fz::scale * copies);
+  fz::check_linear(
+      "Manager::process_response with many configurations", copies,
+      [&](std::size_t n) {
+        return (n == copies ? small : large)
+            .dump(-1, ' ', false, nlohmann::json::error_handler_t::replace)
+            .size();
+      },
+      [&](std::size_t n) { process(n == copies ? small : large); });
+
+  fz::check_linear("Manager::process_response with a long path", input,
+                   [](dd::StringView path) {
+                     // Building the response is part of the timing, but it's
+                     // linear.
+                     process(make_response({std::string(path)}, path));
+                   });
+
+  return 0;
+}
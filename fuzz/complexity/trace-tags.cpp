@@ -0,0 +1,19 @@
+// This fuzzer checks that `decode_tags` takes time linear in the size of the
+// "x-datadog-tags" header.  See complexity.h.
+
+#include <datadog/string_view.h>
+#include <datadog/tag_propagation.h>
+
+#include <cstdint>
+
+#include "complexity.h"
+
+namespace dd = datadog::tracing;
+namespace fz = datadog::fuzz;
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+  fz::check_linear(
+      "decode_tags", fz::PumpedInput{data, size},
+      [](dd::StringView input) { (void)dd::decode_tags(input); });
+  return 0;
+}
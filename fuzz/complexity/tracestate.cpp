@@ -0,0 +1,28 @@
+// This fuzzer checks that extracting W3C trace context takes time linear in
+// the size of the "tracestate" header.  See complexity.h.
+
+#include <datadog/string_view.h>
+#include <datadog/w3c_propagation.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "complexity.h"
+
+namespace dd = datadog::tracing;
+namespace fz = datadog::fuzz;
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+  fz::check_linear(
+      "extract_w3c", fz::PumpedInput{data, size}, [](dd::StringView input) {
+        const fz::HeaderReader headers{
+            {{"traceparent",
+              "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"},
+             {"tracestate", input}}};
+        std::unordered_map<std::string, std::string> span_tags;
+        fz::NullLogger logger;
+        (void)dd::extract_w3c(headers, span_tags, logger);
+      });
+  return 0;
+}
@@ -0,0 +1,94 @@
+// This fuzzer checks that `glob_match` agrees with the backtracking matcher
+// that it replaced, and that it stays within its documented step budget.
+//
+// The first byte of the input is the length of the pattern, which is the
+// bytes that follow.  The remaining bytes are the subject.
+
+#include <datadog/glob.h>
+#include <datadog/string_view.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace dd = datadog::tracing;
+
+namespace {
+
+// This is the backtracking implementation that `glob_match` used to have.
+// Its worst case time is proportional to the product of the lengths of the
+// pattern and the subject, but its results are the reference.
+bool backtracking_glob_match(dd::StringView pattern, dd::StringView subject) {
+  std::size_t p = 0;
+  std::size_t s = 0;
+  std::size_t next_p = 0;
+  std::size_t next_s = 0;
+
+  while (p < pattern.size() || s < subject.size()) {
+    if (p < pattern.size()) {
+      const char pattern_char = pattern[p];
+      switch (pattern_char) {
+        case '*':
+          next_p = p;
+          next_s = s + 1;
+          ++p;
+          continue;
+        case '?':
+          if (s < subject.size()) {
+            ++p;
+            ++s;
+            continue;
+          }
+          break;
+        default:
+          if (s < subject.size() &&
+              tolower(subject[s]) == tolower(pattern_char)) {
+            ++p;
+            ++s;
+            continue;
+          }
+      }
+    }
+    if (0 < next_s && next_s <= subject.size()) {
+      p = next_p;
+      s = next_s;
+      continue;
+    }
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  const std::size_t pattern_size = std::min<std::size_t>(data[0], size - 1);
+  const dd::StringView pattern{(const char*)data + 1, pattern_size};
+  const dd::StringView subject{(const char*)data + 1 + pattern_size,
+                               size - 1 - pattern_size};
+
+  std::size_t steps = 0;
+  const bool matched = dd::glob_match(pattern, subject, steps);
+
+  const std::size_t budget = 2 * (pattern.size() + subject.size() + 131) *
+                             (pattern.size() / 64 + 2);
+  if (steps > budget) {
+    std::fprintf(stderr,
+                 "glob_match took %zu steps, exceeding its budget of %zu\n",
+                 steps, budget);
+    std::abort();
+  }
+
+  if (matched != backtracking_glob_match(pattern, subject)) {
+    std::fprintf(stderr, "glob_match disagrees with the reference matcher\n");
+    std::abort();
+  }
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+// This component provides a way to publish the span that a thread is
+// currently working on, so that a sampling profiler can attribute its samples
+// to a trace and to the endpoint being served.
+//
+// Each thread has an `ActiveSpanSlot`.  An `ActiveSpanScope` writes a span's
+// trace ID, span ID, local root span ID, and endpoint into the calling
+// thread's slot for the lifetime of the scope, and restores the slot's
+// previous contents when it's destroyed.  Use of `ActiveSpanScope` is opt-in;
+// the tracer does not otherwise write to the slot.
+//
+// The slot is written using a sequence lock: the writer makes the slot's
+// sequence number odd, writes the fields, and then makes the sequence number
+// even again.  A reader copies the fields between two reads of the sequence
+// number, and retries if the number changed or was odd.  Neither side locks
+// or allocates, so `read_active_span` is safe to call from a signal handler,
+// including one that interrupted a write on the same thread (in which case
+// the read fails rather than waiting).
+//
+// A profiler running in another process can find the calling thread's slot
+// via the thread-local symbol `dd_trace_cpp_active_span_slot`, and read it
+// using the same protocol.  The layout of `ActiveSpanSlot` is: the sequence
+// number, the low and high 64 bits of the trace ID, the span ID, the local
+// root span ID, the length of the endpoint, and then the first
+// `ActiveSpanSlot::endpoint_capacity` bytes of the endpoint, all stored as
+// native-endian unsigned 64-bit words.  A span ID of zero means that there is
+// no active span.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "string_view.h"
+#include "trace_id.h"
+
+namespace datadog {
+namespace tracing {
+
+class Span;
+
+struct ActiveSpanSlot {
+  static constexpr std::size_t endpoint_capacity = 64;
+
+  std::atomic<std::uint64_t> sequence{0};
+  std::atomic<std::uint64_t> trace_id_low{0};
+  std::atomic<std::uint64_t> trace_id_high{0};
+  std::atomic<std::uint64_t> span_id{0};
+  std::atomic<std::uint64_t> local_root_span_id{0};
+  std::atomic<std::uint64_t> endpoint_size{0};
+  std::atomic<std::uint64_t> endpoint[endpoint_capacity / 8] = {};
+};
+
+// `ActiveSpanContext` is a copy of the contents of an `ActiveSpanSlot`.
+struct ActiveSpanContext {
+  TraceID trace_id;
+  std::uint64_t span_id = 0;
+  std::uint64_t local_root_span_id = 0;
+  std::size_t endpoint_size = 0;
+  char endpoint_buffer[ActiveSpanSlot::endpoint_capacity] = {};
+
+  StringView endpoint() const { return {endpoint_buffer, endpoint_size}; }
+};
+
+// Return the calling thread's slot.
+ActiveSpanSlot& active_span_slot() noexcept;
+
+// Write the specified `context` into the specified `slot`.  The endpoint is
+// truncated to `ActiveSpanSlot::endpoint_capacity` bytes.  Only one thread may
+// write to a given slot, typically the thread that owns it.
+void write_active_span(ActiveSpanSlot& slot,
+                       const ActiveSpanContext& context) noexcept;
+
+// Copy the contents of the specified `slot` into the specified `context`.
+// Return `true` if a consistent copy was made, or `false` if the slot was
+// being written throughout several attempts.  This function is
+// async-signal-safe.
+bool read_active_span(const ActiveSpanSlot& slot,
+                      ActiveSpanContext& context) noexcept;
+
+class ActiveSpanScope {
+  ActiveSpanSlot* slot_;
+  ActiveSpanContext previous_;
+
+  void publish(const Span& span, StringView endpoint);
+
+ public:
+  // Publish the specified `span` in the calling thread's slot.  If `span` is
+  // its trace segment's local root, then the endpoint is its resource name.
+  // Otherwise, if the span currently published is from the same trace segment,
+  // then its endpoint is kept; if not, the endpoint is empty.
+  explicit ActiveSpanScope(const Span& span);
+  // Publish the specified `span` in the calling thread's slot with the
+  // specified `endpoint`.
+  ActiveSpanScope(const Span& span, StringView endpoint);
+  // Restore the calling thread's slot to what it was before this object was
+  // constructed.
+  ~ActiveSpanScope();
+
+  ActiveSpanScope(const ActiveSpanScope&) = delete;
+  ActiveSpanScope& operator=(const ActiveSpanScope&) = delete;
+};
+
+}  // namespace tracing
+}  // namespace datadog
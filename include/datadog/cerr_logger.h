@@ -5,6 +5,7 @@
 // typically an unbuffered stream to the standard error file.
 
 #include <datadog/logger.h>
+#include <datadog/mutex.h>
 
 #include <mutex>
 #include <sstream>
@@ -13,7 +14,7 @@ namespace datadog {
 namespace tracing {
 
 class CerrLogger : public Logger {
-  std::mutex mutex_;
+  Mutex mutex_{LockSite::CERR_LOGGER};
   std::ostringstream stream_;
 
  public:
@@ -9,6 +9,14 @@
 // As a result of `send`ing spans to a `Collector`, the `TraceSampler` might be
 // adjusted to increase or decrease the rate at which traces are kept.  See the
 // `response_handler` parameter to `Collector::send`.
+//
+// A span whose error stack was captured by `Span::capture_error_stack` is sent
+// with the stack's return addresses in `SpanData::error_stack`, rather than
+// with an "error.stack" tag, so that the expensive symbolization happens only
+// for spans that are kept, and off of the thread that finished the trace.
+// `DatadogAgent` describes such stacks in the "error.stack" tag when it
+// flushes.  Other implementations of `Collector` must do likewise, e.g. using
+// `StackSymbolizer` from `stack_trace.h`, or the stacks are not reported.
 
 #include <memory>
 #include <vector>
@@ -66,6 +66,13 @@ struct DatadogAgentConfig {
   // How often, in seconds, to query the Datadog Agent for remote configuration
   // updates.
   Optional<double> remote_configuration_poll_interval_seconds;
+  // Query the Datadog Agent's "/info" endpoint for the features it supports,
+  // and use the best supported payload format, request size limit, and
+  // connection method.  See `agent_info.h`.
+  Optional<bool> agent_discovery_enabled;
+  // How often, in seconds, to query the Datadog Agent's "/info" endpoint after
+  // the first query, which is made on startup.
+  Optional<double> agent_info_poll_interval_seconds;
 
   static Expected<HTTPClient::URL> parse(StringView);
 };
@@ -88,6 +95,11 @@ class FinalizedDatadogAgentConfig {
   std::chrono::steady_clock::duration request_timeout;
   std::chrono::steady_clock::duration shutdown_timeout;
   std::chrono::steady_clock::duration remote_configuration_poll_interval;
+  bool agent_discovery_enabled;
+  std::chrono::steady_clock::duration agent_info_poll_interval;
+  // Whether `url` is the default rather than configured, in which case the
+  // Agent's Unix domain socket, if it has one, is preferred.
+  bool url_is_default;
   std::unordered_map<ConfigName, ConfigMetadata> metadata;
 };
 
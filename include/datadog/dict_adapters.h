@@ -0,0 +1,138 @@
+#pragma once
+
+// This component provides ready-made implementations of `DictReader` and
+// `DictWriter` for common header containers, so that integrations need not
+// write their own.
+//
+// `IndexedDictReader` adapts any sequence of key/value pairs, e.g.
+// `std::vector<std::pair<std::string, std::string>>`, `std::map`, or
+// `std::unordered_map`. It builds a small case-insensitive hash index over the
+// headers once, when it's constructed, so that each of the dozen or so
+// `lookup` calls made during trace context extraction is a constant time probe
+// rather than a linear, case-insensitive scan of the headers.
+//
+// `HTTPHeaderBlockReader` is an `IndexedDictReader` that parses a raw HTTP/1
+// header block, e.g. "Host: example.com\r\nX-Datadog-Trace-ID: 123\r\n\r\n".
+//
+// `VectorDictWriter` and `MapDictWriter` append to a vector of pairs or assign
+// into a map, respectively.
+//
+// The readers do not copy keys or values. The headers from which a reader is
+// constructed must outlive the reader.
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dict_reader.h"
+#include "dict_writer.h"
+#include "optional.h"
+#include "string_view.h"
+
+namespace datadog {
+namespace tracing {
+
+class IndexedDictReader : public DictReader {
+  struct Entry {
+    StringView key;
+    StringView value;
+    std::uint32_t hash;
+  };
+
+  std::vector<Entry> entries_;
+  // Open addressing table of indices into `entries_`, offset by one so that
+  // zero denotes an empty slot. Its size is a power of two.
+  std::vector<std::uint32_t> slots_;
+  // Storage for the values of keys that appear more than once. Such values are
+  // joined with commas, as HTTP specifies for repeated header fields.
+  std::deque<std::string> joined_values_;
+
+ public:
+  // Index the key/value pairs of the specified `headers`. `Container` is any
+  // iterable whose elements have `first` and `second` members convertible to
+  // `StringView`. Keys are compared case-insensitively.
+  template <typename Container>
+  explicit IndexedDictReader(const Container& headers) {
+    entries_.reserve(headers.size());
+    for (const auto& [key, value] : headers) {
+      add(key, value);
+    }
+    build_index();
+  }
+
+  IndexedDictReader(const IndexedDictReader&) = delete;
+  IndexedDictReader& operator=(const IndexedDictReader&) = delete;
+
+  // Return the value of the header whose name is a case-insensitive match for
+  // the specified `key`, or return `nullopt` if there is no such header. If
+  // there are multiple such headers, then return their values joined by
+  // commas.
+  Optional<StringView> lookup(StringView key) const override;
+
+  // Invoke the specified `visitor` once for each distinct header, in the order
+  // in which the headers first appeared.
+  void visit(const std::function<void(StringView key, StringView value)>&
+                 visitor) const override;
+
+ protected:
+  IndexedDictReader() = default;
+
+  // Append the specified `key` and `value` to the headers to be indexed.
+  void add(StringView key, StringView value);
+  // Build the lookup index over the headers added so far, merging duplicates.
+  void build_index();
+};
+
+class HTTPHeaderBlockReader : public IndexedDictReader {
+ public:
+  // Parse and index the header fields in the specified `block`. Lines are
+  // terminated by CRLF or LF, and parsing stops at the first empty line. Lines
+  // that are not well-formed header fields, such as a leading request line or
+  // status line, are ignored. Optional whitespace around values is removed.
+  explicit HTTPHeaderBlockReader(StringView block);
+};
+
+class VectorDictWriter : public DictWriter {
+  std::vector<std::pair<std::string, std::string>>& headers_;
+
+ public:
+  explicit VectorDictWriter(
+      std::vector<std::pair<std::string, std::string>>& headers)
+      : headers_(headers) {}
+
+  // Append the specified `key` and `value` to the headers.
+  void set(StringView key, StringView value) override {
+    headers_.emplace_back(std::string(key), std::string(value));
+  }
+
+  // Append the specified `count` `entries` to the headers, reserving space for
+  // all of them up front.
+  void set_all(const std::pair<StringView, StringView>* entries,
+               std::size_t count) override {
+    headers_.reserve(headers_.size() + count);
+    for (std::size_t i = 0; i < count; ++i) {
+      headers_.emplace_back(std::string(entries[i].first),
+                            std::string(entries[i].second));
+    }
+  }
+};
+
+template <typename Map>
+class MapDictWriter : public DictWriter {
+  Map& headers_;
+
+ public:
+  explicit MapDictWriter(Map& headers) : headers_(headers) {}
+
+  // Overwrite any previous value at the specified `key` with the specified
+  // `value`.
+  void set(StringView key, StringView value) override {
+    headers_.insert_or_assign(std::string(key), std::string(value));
+  }
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -7,6 +7,14 @@
 // Note that while the data structure modeled is a mapping, duplicate keys are
 // permitted to result from repeated invocations of `DictWriter::set` with the
 // same key.
+//
+// When a trace context is injected, all of its headers are delivered in a
+// single call to `DictWriter::set_all`. By default, `set_all` calls `set` once
+// for each header. An implementation may override `set_all` to reserve space
+// and insert all of the headers in bulk.
+
+#include <cstddef>
+#include <utility>
 
 #include "string_view.h"
 
@@ -21,6 +29,16 @@ class DictWriter {
   // implementation may, but is not required to, overwrite any previous value at
   // `key`.
   virtual void set(StringView key, StringView value) = 0;
+
+  // Associate each of the specified `count` `entries` (key/value pairs), in
+  // order, as if by `set`. The views are valid only for the duration of the
+  // call. The default implementation invokes `set` for each entry.
+  virtual void set_all(const std::pair<StringView, StringView>* entries,
+                       std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      set(entries[i].first, entries[i].second);
+    }
+  }
 };
 
 }  // namespace tracing
@@ -0,0 +1,95 @@
+#pragma once
+
+// This component provides facilities for configuring the tracer's DogStatsD
+// client, which reports runtime and health metrics of the tracer, such as the
+// number of open trace segments and the depth of the outgoing trace queue, to
+// the Datadog Agent's DogStatsD server.
+//
+// `struct DogStatsDConfig` contains fields that are used to configure the
+// client.  The function `finalize_config` produces either an error or a
+// `FinalizedDogStatsDConfig`.
+//
+// Typical usage of `DogStatsDConfig` is implicit as part of `TracerConfig`.
+// See `tracer_config.h`.
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "expected.h"
+#include "optional.h"
+#include "string_view.h"
+
+namespace datadog {
+namespace tracing {
+
+class EventScheduler;
+
+struct DogStatsDConfig {
+  // Whether to report tracer metrics to DogStatsD.  Metrics are not reported
+  // by default.
+  //
+  // Overridden by the `DD_RUNTIME_METRICS_ENABLED` environment variable.
+  Optional<bool> enabled;
+  // The address of the DogStatsD server.  The following formats are
+  // supported:
+  //
+  // - udp://<domain or IP>:<port>
+  // - udp://<domain or IP>
+  // - unix://<path to datagram socket>
+  //
+  // The port defaults to 8125 if it is not specified.
+  //
+  // Overridden by the `DD_DOGSTATSD_URL` environment variable, or by the
+  // combination of the `DD_AGENT_HOST` and `DD_DOGSTATSD_PORT` environment
+  // variables.
+  Optional<std::string> url;
+  // How often, in milliseconds, to send aggregated metrics to DogStatsD.
+  Optional<int> flush_interval_milliseconds;
+  // The maximum size, in bytes, of a datagram sent to DogStatsD.  The default
+  // is chosen to fit within a typical Ethernet MTU when sending over UDP, and
+  // is larger when sending over a Unix domain socket.
+  Optional<std::size_t> max_datagram_size;
+  // The `EventScheduler` used to periodically flush metrics.  If
+  // `event_scheduler` is null, then a `ThreadedEventScheduler` instance will
+  // be used instead.
+  std::shared_ptr<EventScheduler> event_scheduler = nullptr;
+};
+
+class FinalizedDogStatsDConfig {
+  friend Expected<FinalizedDogStatsDConfig> finalize_config(
+      const DogStatsDConfig&);
+
+  friend class FinalizedTracerConfig;
+
+  FinalizedDogStatsDConfig() = default;
+
+ public:
+  struct Address {
+    enum class Kind { UDP, UNIX };
+    Kind kind;
+    // For `Kind::UDP`, the host name or IP address.  For `Kind::UNIX`, the
+    // path to the socket.
+    std::string host;
+    // For `Kind::UDP`, the port.
+    std::string port;
+
+    static Expected<Address> parse(StringView url);
+  };
+
+  bool enabled;
+  Address address;
+  std::chrono::steady_clock::duration flush_interval;
+  std::size_t max_datagram_size;
+  std::shared_ptr<EventScheduler> event_scheduler;
+  // Tags that are attached to every metric, e.g. "service:foo".
+  std::vector<std::string> tags;
+};
+
+Expected<FinalizedDogStatsDConfig> finalize_config(
+    const DogStatsDConfig& config);
+
+}  // namespace tracing
+}  // namespace datadog
@@ -25,12 +25,15 @@ namespace environment {
 // preprocessor is used so that the DD_* symbols are listed exactly once.
 #define LIST_ENVIRONMENT_VARIABLES(MACRO)            \
   MACRO(DD_AGENT_HOST)                               \
+  MACRO(DD_DOGSTATSD_PORT)                           \
+  MACRO(DD_DOGSTATSD_URL)                            \
   MACRO(DD_ENV)                                      \
   MACRO(DD_INSTRUMENTATION_TELEMETRY_ENABLED)        \
   MACRO(DD_PROPAGATION_STYLE_EXTRACT)                \
   MACRO(DD_PROPAGATION_STYLE_INJECT)                 \
   MACRO(DD_REMOTE_CONFIGURATION_ENABLED)             \
   MACRO(DD_REMOTE_CONFIG_POLL_INTERVAL_SECONDS)      \
+  MACRO(DD_RUNTIME_METRICS_ENABLED)                  \
   MACRO(DD_SERVICE)                                  \
   MACRO(DD_SPAN_SAMPLING_RULES)                      \
   MACRO(DD_SPAN_SAMPLING_RULES_FILE)                 \
@@ -38,12 +41,16 @@ namespace environment {
   MACRO(DD_TRACE_PROPAGATION_STYLE_INJECT)           \
   MACRO(DD_TRACE_PROPAGATION_STYLE)                  \
   MACRO(DD_TAGS)                                     \
+  MACRO(DD_TRACE_AGENT_DISCOVERY_ENABLED)            \
   MACRO(DD_TRACE_AGENT_PORT)                         \
   MACRO(DD_TRACE_AGENT_URL)                          \
   MACRO(DD_TRACE_DEBUG)                              \
   MACRO(DD_TRACE_ENABLED)                            \
+  MACRO(DD_TRACE_FILTER_RULES)                       \
   MACRO(DD_TRACE_RATE_LIMIT)                         \
   MACRO(DD_TRACE_REPORT_HOSTNAME)                    \
+  MACRO(DD_TRACE_RESOURCE_CARDINALITY_LIMIT)         \
+  MACRO(DD_TRACE_RESOURCE_QUANTIZATION_ENABLED)      \
   MACRO(DD_TRACE_SAMPLE_RATE)                        \
   MACRO(DD_TRACE_SAMPLING_RULES)                     \
   MACRO(DD_TRACE_STARTUP_LOGS)                       \
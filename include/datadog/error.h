@@ -78,6 +78,21 @@ struct Error {
     REMOTE_CONFIGURATION_INVALID_INPUT = 53,
     BAGGAGE_MAXIMUM_BYTES_REACHED = 54,
     BAGGAGE_MAXIMUM_ITEMS_REACHED = 55,
+    DOGSTATSD_INVALID_FLUSH_INTERVAL = 56,
+    DOGSTATSD_INVALID_MAX_DATAGRAM_SIZE = 57,
+    RUNTIME_METRICS_INVALID_SAMPLE_INTERVAL = 58,
+    TRACE_CAPTURE_IO_ERROR = 59,
+    TRACE_CAPTURE_MALFORMED = 60,
+    DATADOG_AGENT_INVALID_INFO_RESPONSE = 61,
+    DATADOG_AGENT_INVALID_INFO_POLL_INTERVAL = 62,
+    DATADOG_AGENT_REQUEST_TOO_LARGE = 63,
+    INVALID_SHARD_COUNT = 64,
+    TRACE_FILTER_RULES_INVALID_JSON = 65,
+    TRACE_FILTER_RULES_WRONG_TYPE = 66,
+    TRACE_FILTER_RULES_UNKNOWN_PROPERTY = 67,
+    MALFORMED_B3_HEADER = 68,
+    RUNTIME_METRICS_WITHOUT_DOGSTATSD = 69,
+    RESOURCE_QUANTIZATION_INVALID_RESET_INTERVAL = 70,
   };
 
   Code code;
@@ -50,6 +50,14 @@ class HTTPClient {
       ResponseHandler on_response, ErrorHandler on_error,
       std::chrono::steady_clock::time_point deadline) = 0;
 
+  // Send a GET request to the specified `url`.  Set request headers, and
+  // handle the response or error, as described for `post`.  The default
+  // implementation returns an error having the code `Error::NOT_IMPLEMENTED`,
+  // so that implementations written before `get` was added continue to work.
+  virtual Expected<void> get(const URL& url, HeadersSetter set_headers,
+                             ResponseHandler on_response, ErrorHandler on_error,
+                             std::chrono::steady_clock::time_point deadline);
+
   // Wait until there are no more outstanding requests, or until the specified
   // `deadline`.
   virtual void drain(std::chrono::steady_clock::time_point deadline) = 0;
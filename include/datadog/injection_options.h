@@ -3,11 +3,48 @@
 // This component provides a `struct InjectionOptions` containing optional
 // parameters to `Span::inject` that alter the behavior of trace context
 // propagation.
+//
+// The options apply to a single injection. For example, a request to an
+// internal service that is instrumented by Datadog might inject only the
+// `PropagationStyle::DATADOG` headers, while a request to a third party might
+// inject only the `PropagationStyle::W3C` headers.
+
+#include <cstddef>
+#include <vector>
+
+#include "optional.h"
+#include "propagation_style.h"
 
 namespace datadog {
 namespace tracing {
 
-struct InjectionOptions {};
+struct InjectionOptions {
+  // If set, inject only those of the tracer's configured injection styles that
+  // also appear in `styles`. Styles in `styles` that are not configured for
+  // injection are ignored. If `PropagationStyle::BAGGAGE` does not appear in
+  // `styles`, then `Tracer::inject` does not inject baggage.
+  Optional<std::vector<PropagationStyle>> styles;
+  // If set, the maximum size, in bytes, of the injected "tracestate" header.
+  // Other vendors' entries are dropped from the end of the header, and then
+  // optional fields are dropped from the end of the Datadog entry, until the
+  // header fits. The Datadog sampling priority and parent ID are always kept.
+  Optional<std::size_t> max_tracestate_size;
+};
+
+// Return whether the specified `style` is to be injected according to the
+// specified `options`.
+inline bool should_inject(const InjectionOptions& options,
+                          PropagationStyle style) {
+  if (!options.styles) {
+    return true;
+  }
+  for (const auto selected : *options.styles) {
+    if (selected == style) {
+      return true;
+    }
+  }
+  return false;
+}
 
 }  // namespace tracing
 }  // namespace datadog
@@ -0,0 +1,59 @@
+#pragma once
+
+// This component provides facilities for correlating log lines with traces.
+//
+// A logging library that is aware of the current span can include the span's
+// trace ID, span ID, service, environment, and version in each log line, so
+// that Datadog can link the log line to the trace.  `Span::log_correlation`
+// returns this information as a fragment of text to include in a log line.
+//
+// Two formats are supported:
+//
+// - `LogCorrelationFormat::JSON` produces a comma-separated sequence of JSON
+//   object members, without the enclosing braces, e.g.
+//
+//       "dd.trace_id":"1234","dd.span_id":"5678","dd.service":"shop",
+//       "dd.env":"prod","dd.version":"1.2.3"
+//
+//   (shown here across two lines).
+//
+// - `LogCorrelationFormat::KEY_VALUE` produces space-separated key=value
+//   pairs, e.g.
+//
+//       dd.trace_id=1234 dd.span_id=5678 dd.service=shop dd.env=prod
+//       dd.version=1.2.3
+//
+//   Values that contain spaces, double quotes, or equal signs are enclosed
+//   in double quotes.
+//
+// The trace ID is formatted in decimal if it fits in 64 bits, and otherwise
+// as 32 hexadecimal digits.  The span ID is formatted in decimal.  The
+// environment and version are omitted if they are absent.
+
+#include <cstdint>
+#include <string>
+
+#include "optional.h"
+#include "string_view.h"
+#include "trace_id.h"
+
+namespace datadog {
+namespace tracing {
+
+enum class LogCorrelationFormat {
+  JSON,
+  KEY_VALUE,
+};
+
+// Append to the specified `destination` the log correlation fragment having
+// the specified `format` for a span having the specified `trace_id`,
+// `span_id`, `service`, and the optionally specified `environment` and
+// `version`.
+void append_log_correlation(std::string& destination,
+                            LogCorrelationFormat format, TraceID trace_id,
+                            std::uint64_t span_id, StringView service,
+                            Optional<StringView> environment,
+                            Optional<StringView> version);
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,186 @@
+#pragma once
+
+// This component provides a class, `Mutex`, that is the type of the mutexes
+// that guard this library's internal state, a class, `OptionalMutex`, that is
+// a `Mutex` that can be disabled, and functions for inspecting lock
+// contention.
+//
+// Each `Mutex` is constructed with a `LockSite`, which identifies the
+// component that owns the lock, e.g. `LockSite::TRACE_SEGMENT` for the mutex
+// of each `TraceSegment`.
+//
+// Ordinarily, `Mutex` is a `std::mutex` and the `LockSite` is ignored.  If
+// the library is built with the CMake option `DD_TRACE_PROFILE_LOCKS`, then
+// every acquisition of a `Mutex` is instead counted against its `LockSite`:
+// the number of acquisitions, the number of acquisitions that had to wait for
+// another thread to release the lock, and histograms of the time spent
+// waiting for the lock and of the time the lock was held.  `lock_profile`
+// returns the counts, and `lock_profile_report` formats them for people.
+//
+// Profiling adds two reads of the steady clock to each acquisition, and so it
+// is meant for benchmarks and load tests, not for production.  The option
+// changes the layout of classes in this library's public headers, and so it
+// must be defined consistently for the library and for code that includes its
+// headers.  The CMake build does this automatically.
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef DD_TRACE_PROFILE_LOCKS
+#include <chrono>
+#endif
+
+#include "string_view.h"
+
+namespace datadog {
+namespace tracing {
+
+enum class LockSite {
+  CERR_LOGGER,
+  CONFIG_MANAGER,
+  CURL,
+  DATADOG_AGENT,
+  DATADOG_AGENT_SHARD,
+  DOGSTATSD_CLIENT,
+  DOGSTATSD_CLIENT_FLUSH,
+  EVENT_SCHEDULER,
+  RESOURCE_QUANTIZER,
+  SPAN_SAMPLER_LIMITER,
+  TRACE_CAPTURE,
+  TRACE_SAMPLER,
+  TRACE_SAMPLER_SHARD,
+  TRACE_SEGMENT,
+};
+
+// The number of enumerators in `LockSite`.
+constexpr std::size_t lock_site_count =
+    std::size_t(LockSite::TRACE_SEGMENT) + 1;
+
+// Return the name of the member that is the lock, e.g.
+// "TraceSegment::mutex_".
+StringView to_string_view(LockSite site);
+
+// Bucket `i` of a `LockSiteProfile` histogram counts durations of at least
+// 2^i nanoseconds and less than 2^(i+1) nanoseconds, except that bucket zero
+// also counts durations of zero, and the last bucket also counts all longer
+// durations.
+constexpr std::size_t lock_histogram_buckets = 32;
+
+struct LockSiteProfile {
+  LockSite site;
+  std::uint64_t acquisitions = 0;
+  // The number of acquisitions that found the lock held by another thread.
+  std::uint64_t contended_acquisitions = 0;
+  std::uint64_t wait_nanoseconds = 0;
+  std::uint64_t hold_nanoseconds = 0;
+  std::array<std::uint64_t, lock_histogram_buckets> wait_histogram{};
+  std::array<std::uint64_t, lock_histogram_buckets> hold_histogram{};
+};
+
+// Return whether the library was built with `DD_TRACE_PROFILE_LOCKS`.
+bool lock_profiling_enabled();
+
+// Return the profile of each `LockSite` that has been acquired at least once
+// since the program began or since the last call to `reset_lock_profile`.  If
+// lock profiling is not enabled, return an empty vector.
+std::vector<LockSiteProfile> lock_profile();
+
+// Set all of the counts returned by `lock_profile` to zero.
+void reset_lock_profile();
+
+// Return a table of the specified `profile`, having one line per lock site,
+// showing acquisitions, the contended percentage, and the mean and
+// approximate 50th and 99th percentiles of wait and hold times.
+std::string lock_profile_report(const std::vector<LockSiteProfile>& profile);
+
+#ifdef DD_TRACE_PROFILE_LOCKS
+
+class Mutex {
+  std::mutex mutex_;
+  const LockSite site_;
+  // When the lock was acquired.  It's guarded by `mutex_`.
+  std::chrono::steady_clock::time_point acquired_;
+
+ public:
+  explicit Mutex(LockSite site) noexcept : site_(site) {}
+
+  Mutex(const Mutex&) = delete;
+  Mutex& operator=(const Mutex&) = delete;
+
+  void lock();
+  bool try_lock();
+  void unlock();
+};
+
+#else
+
+class Mutex : public std::mutex {
+ public:
+  explicit Mutex(LockSite) noexcept {}
+};
+
+#endif
+
+// `OptionalMutex` is a `Mutex` that can be disabled when it's constructed, for
+// state that the application promises to access from only one thread, such as
+// that of a `TraceSegment` when `TracerConfig::single_threaded` is true.
+// Locking and unlocking a disabled `OptionalMutex` does nothing, except that
+// debug builds (without `NDEBUG`) assert that it's always locked by the thread
+// that locked it first.
+class OptionalMutex {
+  Mutex mutex_;
+  const bool enabled_;
+  // The thread that first locked this mutex while it's disabled.  It's used
+  // only by debug builds, but is always present so that the layout of this
+  // class doesn't depend on `NDEBUG`.
+  std::thread::id owner_;
+
+  void assert_owner() {
+#ifndef NDEBUG
+    const auto current = std::this_thread::get_id();
+    if (owner_ == std::thread::id{}) {
+      owner_ = current;
+    }
+    assert(owner_ == current &&
+           "A single-threaded tracer was used from more than one thread.");
+#endif
+  }
+
+ public:
+  OptionalMutex(LockSite site, bool enabled) noexcept
+      : mutex_(site), enabled_(enabled) {}
+
+  OptionalMutex(const OptionalMutex&) = delete;
+  OptionalMutex& operator=(const OptionalMutex&) = delete;
+
+  void lock() {
+    if (enabled_) {
+      mutex_.lock();
+    } else {
+      assert_owner();
+    }
+  }
+
+  bool try_lock() {
+    if (enabled_) {
+      return mutex_.try_lock();
+    }
+    assert_owner();
+    return true;
+  }
+
+  void unlock() {
+    if (enabled_) {
+      mutex_.unlock();
+    }
+  }
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -16,6 +16,8 @@ enum class PropagationStyle {
   DATADOG,
   // B3 multi-header style, e.g. X-B3-TraceID
   B3,
+  // B3 single-header style, i.e. b3
+  B3_SINGLE,
   // W3C headers style, i.e. traceparent and tracestate
   W3C,
   // The absence of propagation.  If this is the only style set, then
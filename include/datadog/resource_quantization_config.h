@@ -0,0 +1,88 @@
+#pragma once
+
+// This component provides facilities for configuring the quantization of span
+// resource names.
+//
+// A resource name that contains an identifier, such as the "123" in
+// "GET /users/123", or a literal, such as the "42" in
+// "SELECT * FROM users WHERE id = 42", makes a distinct resource for each
+// value.  Each distinct resource costs an entry in the sampler's and the
+// agent's per-resource state and in the payload's string tables.  When
+// quantization is enabled, the tracer replaces such identifiers and literals
+// with "?" when each trace segment finishes, before it is sampled and encoded.
+// Additionally, the tracer limits the number of distinct resources per
+// service, and the number of distinct services, replacing resources in excess
+// of the limits with `overflow_resource`.  The limits apply to the resources
+// seen within each `reset_interval_seconds`.
+//
+// A sampling decision made before the trace segment finishes, e.g. when trace
+// context is injected into an outgoing request, sees resources as they were
+// then, before quantization.
+//
+// `struct ResourceQuantizationConfig` contains fields that are used to
+// configure quantization.  The function `finalize_config` produces either an
+// error or a `FinalizedResourceQuantizationConfig`.
+//
+// Typical usage of `ResourceQuantizationConfig` is implicit as part of
+// `TracerConfig`.  See `tracer_config.h`.
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "expected.h"
+#include "optional.h"
+
+namespace datadog {
+namespace tracing {
+
+struct ResourceQuantizationConfig {
+  // Whether to quantize resource names.  Resource names are not quantized by
+  // default.
+  //
+  // Overridden by the `DD_TRACE_RESOURCE_QUANTIZATION_ENABLED` environment
+  // variable.
+  Optional<bool> enabled;
+  // The maximum number of distinct resources per service.  A span whose
+  // resource would exceed the limit instead has the resource
+  // `overflow_resource`.  Zero means no limit.  The default is 1000.
+  //
+  // Overridden by the `DD_TRACE_RESOURCE_CARDINALITY_LIMIT` environment
+  // variable.
+  Optional<std::size_t> max_resources_per_service;
+  // The maximum number of distinct services whose resources are remembered.
+  // A span whose service would exceed the limit instead has the resource
+  // `overflow_resource`.  Zero means no limit.  The default is 100.
+  Optional<std::size_t> max_services;
+  // The interval, in seconds, after which the remembered services and
+  // resources are forgotten, so that resources that are new, e.g. after a
+  // deployment, are not replaced forever.  Zero means never.  The default is
+  // 60.
+  Optional<int> reset_interval_seconds;
+  // The resource of spans whose resource exceeds the limit.  The default is
+  // "<overflow>".
+  Optional<std::string> overflow_resource;
+};
+
+class FinalizedResourceQuantizationConfig {
+  friend Expected<FinalizedResourceQuantizationConfig> finalize_config(
+      const ResourceQuantizationConfig&);
+
+  friend class FinalizedTracerConfig;
+
+  FinalizedResourceQuantizationConfig() = default;
+
+ public:
+  bool enabled;
+  std::size_t max_resources_per_service;
+  std::size_t max_services;
+  // Zero means never.
+  std::chrono::steady_clock::duration reset_interval;
+  std::string overflow_resource;
+};
+
+Expected<FinalizedResourceQuantizationConfig> finalize_config(
+    const ResourceQuantizationConfig& config);
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,64 @@
+#pragma once
+
+// This component provides facilities for configuring the tracer's sampling of
+// process runtime metrics, such as CPU time, resident memory, and the number
+// of threads and open file descriptors.
+//
+// `struct RuntimeMetricsConfig` contains fields that are used to configure the
+// sampler.  The function `finalize_config` produces either an error or a
+// `FinalizedRuntimeMetricsConfig`.
+//
+// Sampled values are reported to DogStatsD, so sampling requires that the
+// tracer's DogStatsD client be enabled as well.  See `dogstatsd_config.h`.
+//
+// Typical usage of `RuntimeMetricsConfig` is implicit as part of
+// `TracerConfig`.  See `tracer_config.h`.
+
+#include <chrono>
+#include <memory>
+
+#include "expected.h"
+#include "optional.h"
+
+namespace datadog {
+namespace tracing {
+
+class EventScheduler;
+
+struct RuntimeMetricsConfig {
+  // Whether to sample runtime metrics.  Runtime metrics are not sampled by
+  // default.  Sampling is supported only on Linux, where the metrics are read
+  // from the "/proc" file system.  If sampling is enabled, then
+  // `DogStatsDConfig::enabled` must be too, or `finalize_config` for the
+  // enclosing `TracerConfig` fails.
+  //
+  // Overridden by the `DD_RUNTIME_METRICS_ENABLED` environment variable.
+  Optional<bool> enabled;
+  // How often, in milliseconds, to sample runtime metrics.
+  Optional<int> sample_interval_milliseconds;
+  // The `EventScheduler` used to periodically sample runtime metrics.  If
+  // `event_scheduler` is null, then the event scheduler of the tracer's
+  // DogStatsD client is used, so that sampling does not require another
+  // thread.
+  std::shared_ptr<EventScheduler> event_scheduler = nullptr;
+};
+
+class FinalizedRuntimeMetricsConfig {
+  friend Expected<FinalizedRuntimeMetricsConfig> finalize_config(
+      const RuntimeMetricsConfig&);
+
+  friend class FinalizedTracerConfig;
+
+  FinalizedRuntimeMetricsConfig() = default;
+
+ public:
+  bool enabled;
+  std::chrono::steady_clock::duration sample_interval;
+  std::shared_ptr<EventScheduler> event_scheduler;
+};
+
+Expected<FinalizedRuntimeMetricsConfig> finalize_config(
+    const RuntimeMetricsConfig& config);
+
+}  // namespace tracing
+}  // namespace datadog
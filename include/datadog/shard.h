@@ -0,0 +1,36 @@
+#pragma once
+
+// This component provides functions that assign threads to the shards of a
+// sharded `Tracer`.  See `TracerConfig::shards`.
+//
+// A thread-per-core application, such as one built on Seastar, runs one thread
+// on each core and avoids state that is modified by more than one core.  Such
+// an application can configure its `Tracer` to have one shard per core.  Then
+// the tracer keeps a separate copy of its frequently modified state, such as
+// the trace sampler's rate limiter, the trace chunks waiting to be sent to the
+// Datadog Agent, and counts of spans and traces, for each shard, and each
+// thread uses the copy of its own shard.  A background thread merges the
+// shards periodically.
+//
+// Each thread should call `set_current_shard` with the index of its core
+// before it uses the tracer.  A thread that doesn't is assigned a shard the
+// first time that it needs one, in round-robin order.
+//
+// A thread's shard index is shared by all tracers.  A tracer having `n` shards
+// uses the shard index modulo `n`.
+
+#include <cstddef>
+
+namespace datadog {
+namespace tracing {
+
+// Assign the calling thread to the shard having the specified `index`.
+void set_current_shard(std::size_t index);
+
+// Return the index of the calling thread's shard.  If `set_current_shard` has
+// not been called on this thread, then assign the thread the next shard index
+// in round-robin order, and return it.
+std::size_t current_shard();
+
+}  // namespace tracing
+}  // namespace datadog
@@ -40,12 +40,15 @@
 // A `Span` is finished when it is destroyed.  The end time can be overridden
 // via the `set_end_time` member function prior to the span's destruction.
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
 
 #include "clock.h"
+#include "log_correlation.h"
 #include "optional.h"
 #include "string_view.h"
 #include "trace_id.h"
@@ -58,14 +61,31 @@ class DictReader;
 class DictWriter;
 struct SpanConfig;
 struct SpanData;
+class SpanPrototype;
 class TraceSegment;
 
 class Span {
+  // The spans of a trace segment share ownership of it.  In single-threaded
+  // mode, `trace_segment_` does not own the segment.  Instead, the spans own it
+  // jointly, and the last of them to finish destroys it.  See
+  // `TraceSegment::span_finished`.
   std::shared_ptr<TraceSegment> trace_segment_;
   SpanData* data_;
   std::function<std::uint64_t()> generate_span_id_;
   Clock clock_;
   Optional<std::chrono::steady_clock::time_point> end_time_;
+  // Log correlation fragments, formatted when first requested and published
+  // atomically, so that concurrent calls to the `const` member function
+  // `log_correlation` are safe.  Null until first requested.
+  struct LogCorrelation;
+  mutable std::atomic<LogCorrelation*> log_correlation_;
+
+  // Discard the stored log correlation fragments, if any.
+  void forget_log_correlation();
+
+  // Return a child of this span having the specified `span_data`, whose IDs
+  // are yet to be set.
+  Span make_child(std::unique_ptr<SpanData> span_data) const;
 
  public:
   // Create a span whose properties are stored in the specified `data`, that is
@@ -76,7 +96,7 @@ class Span {
        const std::function<std::uint64_t()>& generate_span_id,
        const Clock& clock);
   Span(const Span&) = delete;
-  Span(Span&&) = default;
+  Span(Span&&);
   Span& operator=(Span&&) = delete;
   Span& operator=(const Span&) = delete;
 
@@ -95,6 +115,10 @@ class Span {
   // overridden in `config`.
   Span create_child(const SpanConfig& config) const;
   Span create_child() const;
+  // Return a span that is a child of this span, and whose properties are
+  // those of the specified `prototype`.  See `span_prototype.h`.  The child
+  // span's start time is the current time.
+  Span create_child(const SpanPrototype& prototype) const;
 
   // Return this span's ID (span ID).
   std::uint64_t id() const;
@@ -127,10 +151,12 @@ class Span {
   // if there is no such metric.
   Optional<double> lookup_metric(StringView name) const;
   // Overwrite the tag having the specified `name` so that it has the specified
-  // `value`, or create a new tag.
+  // `value`, or create a new tag.  Do nothing if the span's trace is filtered
+  // (see `trace_filter_config.h`).
   void set_tag(StringView name, StringView value);
   // Overwrite the metric having the specified `name` so that it has the
-  // specified `value`, or create a new metric.
+  // specified `value`, or create a new metric.  Do nothing if the span's trace
+  // is filtered.
   void set_metric(StringView name, double value);
   // Delete the tag having the specified `name` if it exists.
   void remove_tag(StringView name);
@@ -148,7 +174,9 @@ class Span {
   // represents, e.g. "/api/v1/info" or "select count(*) from users".
   void set_resource_name(StringView);
   // Set whether an error occurred during the extent of this span.  If `false`,
-  // then error-related tags will be removed from this span as well.
+  // then error-related tags will be removed from this span as well.  This and
+  // the other `set_error` family of member functions below do nothing if the
+  // span's trace is filtered.
   void set_error(bool);
   // Associate a message with the error that occurred during the extent of this
   // span.  This also has the effect of calling `set_error(true)`.
@@ -159,15 +187,37 @@ class Span {
   // Associate a call stack with the error that occurred during the extent of
   // this span.  This also has the effect of calling `set_error(true)`.
   void set_error_stack(StringView);
+  // Capture the call stack of the caller, to be associated with the error
+  // that occurred during the extent of this span.  This also has the effect of
+  // calling `set_error(true)`.  Unlike `set_error_stack`, this records only
+  // the stack's return addresses, which is cheap.  The default collector,
+  // `DatadogAgent`, describes the stack in the "error.stack" tag when it sends
+  // the trace, and only if the span is kept.  A `Collector` provided by the
+  // application instead receives the return addresses in
+  // `SpanData::error_stack`, and no "error.stack" tag, and must describe them
+  // itself if the stack is to be reported (see `collector.h`).  This
+  // overrides any previous `set_error_stack`, and vice versa.
+  void capture_error_stack();
   // Set end time of this span.  Doing so will override the default behavior of
   // using the current time in the destructor.
   void set_end_time(std::chrono::steady_clock::time_point);
 
   // Write information about this span and its trace into the specified `writer`
-  // using all of the configured injection propagation styles.
+  // using all of the configured injection propagation styles, or, if the
+  // optionally specified `options` select a subset of styles, using only those
+  // styles.
   void inject(DictWriter& writer) const;
   void inject(DictWriter& writer, const InjectionOptions& options) const;
 
+  // Return the fragment of text having the specified `format` that correlates
+  // log lines with this span.  See `log_correlation.h`.  Both formats are
+  // computed when a fragment is first requested and then stored in this span,
+  // so that subsequent calls are cheap.  This function may be called
+  // concurrently from multiple threads.  Changing this span's service,
+  // environment, or version discards the stored fragments.  The returned view
+  // is valid until this span is next modified or is destroyed.
+  StringView log_correlation(LogCorrelationFormat format) const;
+
   // Return a reference to this span's trace segment.  The trace segment has
   // member functions that affect the trace as a whole, such as
   // `TraceSegment::override_sampling_priority`.
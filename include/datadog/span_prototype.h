@@ -0,0 +1,54 @@
+#pragma once
+
+// This component provides a class, `SpanPrototype`, that describes spans that
+// are created repeatedly with the same properties, such as the client spans of
+// an RPC library, which all have the same name, service, type, and tags.
+//
+// Creating a span from a `SpanConfig` combines the `SpanConfig` with the
+// tracer's `SpanDefaults` each time.  A `SpanPrototype` is obtained once from
+// `Tracer::create_span_prototype`, which does that combination up front, and
+// then each span created from the prototype by `Tracer::create_span` or
+// `Span::create_child` is a copy of the combined properties.
+//
+// If the tracer's `SpanDefaults` change after a prototype is created, e.g.
+// because of remote configuration, then spans created from the prototype are
+// instead configured from its `SpanConfig` and the current defaults, as if the
+// `SpanConfig` had been passed to `create_span` or `create_child`.
+//
+// A `SpanPrototype` is immutable, and it is cheap to copy.  It can be used by
+// multiple threads at once.
+
+#include <memory>
+
+#include "clock.h"
+
+namespace datadog {
+namespace tracing {
+
+struct SpanConfig;
+struct SpanData;
+struct SpanDefaults;
+
+class SpanPrototype {
+  friend class Span;
+  friend class Tracer;
+
+  std::shared_ptr<const SpanDefaults> defaults_;
+  std::shared_ptr<const SpanConfig> config_;
+  std::shared_ptr<const SpanData> data_;
+
+  // Create a prototype of spans configured by the specified `config` and
+  // `defaults`.  The `start` of `config` is ignored.
+  SpanPrototype(const std::shared_ptr<const SpanDefaults>& defaults,
+                const SpanConfig& config);
+
+  // Return the data of a new span having the properties of this prototype,
+  // using the specified `defaults` for properties not in the prototype's
+  // `SpanConfig`, and starting at the current time according to the specified
+  // `clock`.  The span's IDs are not set.
+  std::unique_ptr<SpanData> instantiate(const SpanDefaults& defaults,
+                                        const Clock& clock) const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
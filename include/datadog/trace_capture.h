@@ -0,0 +1,151 @@
+#pragma once
+
+// This component provides a class, `TraceCapture`, that records the traces
+// produced by a `Tracer` to a file, so that they can later be replayed, e.g.
+// by the benchmarks in `benchmark/`, in order to measure changes to the tracer
+// against realistic traffic.
+//
+// A capture is enabled by setting `TracerConfig::trace_capture`.  Then the
+// tracer records:
+//
+// - for each span extracted by `Tracer::extract_span`, the trace context
+//   headers that were read during extraction, together with the extracted
+//   trace ID, and
+// - each chunk of spans sent to the tracer's `Collector`, by way of a
+//   `RecordingCollector` that wraps the collector.
+//
+// Note that a capture contains the spans' tags and the propagation headers
+// verbatim.  Anonymize or otherwise vet a capture before sharing it.
+//
+// The file format is compact: integers are variable-length encoded, and each
+// distinct string is written once and referred to by index thereafter.  So
+// that a long-running capture does not accumulate strings without bound, the
+// table of written strings is discarded, and a record noting this is written,
+// whenever the table exceeds `TraceCapture::max_strings` entries or
+// `TraceCapture::max_string_bytes` bytes.  The format is specific to the
+// version of this library that wrote it.
+//
+// If writing to the file fails, then the capture stops: the error is returned
+// by the call that encountered it, and later records are discarded.
+//
+// `TraceCapture::read` reads a capture file back into memory.
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "collector.h"
+#include "error.h"
+#include "expected.h"
+#include "mutex.h"
+#include "optional.h"
+#include "trace_id.h"
+
+namespace datadog {
+namespace tracing {
+
+class Logger;
+struct SpanData;
+
+class TraceCapture {
+ public:
+  // `Headers` are the trace context headers from which a span of the trace
+  // having `trace_id` was extracted.
+  struct Headers {
+    TraceID trace_id;
+    std::vector<std::pair<std::string, std::string>> headers;
+  };
+  // `Chunk` is the spans of a trace segment, as sent to a `Collector`.
+  using Chunk = std::vector<std::unique_ptr<SpanData>>;
+  using Record = std::variant<Headers, Chunk>;
+
+  // The limits beyond which the table of written strings is discarded.
+  static constexpr std::size_t max_strings = 1 << 16;
+  static constexpr std::size_t max_string_bytes = 16 << 20;
+
+ private:
+  mutable Mutex mutex_{LockSite::TRACE_CAPTURE};
+  std::string path_;
+  std::FILE* file_;
+  std::string buffer_;
+  // Index, starting at one, of each string written since the table was last
+  // reset, and the total size of those strings.
+  std::unordered_map<std::string, std::uint64_t> strings_;
+  std::size_t string_bytes_ = 0;
+  // The error that stopped the capture, if any.
+  Optional<Error> error_;
+
+  TraceCapture(const std::string& path, std::FILE* file);
+
+  void begin_record(char type);
+  void write_string(const std::string& value);
+  Expected<void> end_record();
+  Expected<void> write_buffer();
+
+ public:
+  // Return a capture that writes to a new file at the specified `path`,
+  // replacing any existing file, or return an error if the file cannot be
+  // opened.
+  static Expected<std::shared_ptr<TraceCapture>> create(
+      const std::string& path);
+
+  // Return the records in the capture file at the specified `path`, in the
+  // order in which they were written, or return an error if the file cannot
+  // be read or is not a valid capture.
+  static Expected<std::vector<Record>> read(const std::string& path);
+
+  // Flush and close the file.
+  ~TraceCapture();
+
+  TraceCapture(const TraceCapture&) = delete;
+  TraceCapture& operator=(const TraceCapture&) = delete;
+
+  // Append to the capture the specified `headers`, from which a span of the
+  // trace having the specified `trace_id` was extracted.  Return an error if
+  // this call stopped the capture.
+  Expected<void> record_headers(
+      TraceID trace_id,
+      const std::vector<std::pair<std::string, std::string>>& headers);
+
+  // Append the specified `chunk` to the capture.  Return an error if this
+  // call stopped the capture.
+  Expected<void> record_chunk(const Chunk& chunk);
+
+  // Write any buffered records to the file.  Return an error if this call
+  // stopped the capture.
+  Expected<void> flush();
+
+  // Return the error that stopped the capture, or return `nullopt` if the
+  // capture has not stopped.
+  Optional<Error> error() const;
+};
+
+// `RecordingCollector` is a `Collector` that records each chunk of spans sent
+// to it in a `TraceCapture`, and then forwards the chunk to another
+// `Collector`.  An error that stops the capture is logged, and does not
+// prevent the chunk from being forwarded.
+class RecordingCollector : public Collector {
+  std::shared_ptr<Collector> collector_;
+  std::shared_ptr<TraceCapture> capture_;
+  std::shared_ptr<Logger> logger_;
+
+ public:
+  RecordingCollector(const std::shared_ptr<Collector>& collector,
+                     const std::shared_ptr<TraceCapture>& capture,
+                     const std::shared_ptr<Logger>& logger);
+
+  Expected<void> send(
+      std::vector<std::unique_ptr<SpanData>>&& spans,
+      const std::shared_ptr<TraceSampler>& response_handler) override;
+
+  std::string config() const override;
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,76 @@
+#pragma once
+
+// This component provides facilities for configuring trace filtering.
+//
+// Some traces are noise that is never worth sending, such as those of health
+// checks, readiness probes, and metrics scrapes.  Sampling drops such traces
+// too, but only after their spans have recorded their tags and been finalized.
+// A trace filter rule is a `SpanMatcher`, i.e. the same pattern language as
+// sampling rules, that is matched against each new root span created by
+// `Tracer::create_span` or `Tracer::extract_span`, considering the service,
+// operation name, resource name, and tags that the span has when it is
+// created.  If any rule matches, then the trace is "filtered":
+//
+// - The trace is not sent to the collector, and its spans are not finalized.
+// - Spans of the trace do not record tags, metrics, or errors set on them
+//   after creation, e.g. by `Span::set_tag` or `Span::set_error`.
+// - The trace's sampling decision is "user drop," which is propagated to
+//   downstream services.  For an extracted trace, this overrides the decision
+//   received from upstream.
+//
+// Rules are matched against the resource name as it is when the span is
+// created, before any resource quantization (see
+// `resource_quantization_config.h`), whereas sampling rules see the quantized
+// resource name.  So, a filter rule for "GET /users/123" matches that
+// resource, not "GET /users/?".
+//
+// The rules can be replaced by Remote Configuration, using the
+// "tracing_filter_rules" property of the "lib_config" object, which has the
+// same format as the `DD_TRACE_FILTER_RULES` environment variable.
+//
+// `struct TraceFilterConfig` contains fields that are used to configure trace
+// filtering.  The function `finalize_config` produces either an error or a
+// `FinalizedTraceFilterConfig`.
+//
+// Typical usage of `TraceFilterConfig` is implicit as part of `TracerConfig`.
+// See `tracer_config.h`.
+
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+#include "expected.h"
+#include "span_matcher.h"
+
+namespace datadog {
+namespace tracing {
+
+struct TraceFilterConfig {
+  // A new trace whose root span matches any of `rules` is filtered.  There
+  // are no rules by default.
+  //
+  // Overridden by the `DD_TRACE_FILTER_RULES` environment variable, whose
+  // value is a JSON array of objects, each having any of the properties
+  // "service", "name", "resource", and "tags", e.g.
+  //
+  //     [{"resource": "GET /health*"}, {"tags": {"http.url": "*/metrics"}}]
+  std::vector<SpanMatcher> rules;
+};
+
+class FinalizedTraceFilterConfig {
+  friend Expected<FinalizedTraceFilterConfig> finalize_config(
+      const TraceFilterConfig&);
+  friend class FinalizedTracerConfig;
+
+  FinalizedTraceFilterConfig() = default;
+
+ public:
+  std::vector<SpanMatcher> rules;
+  std::unordered_map<ConfigName, ConfigMetadata> metadata;
+};
+
+Expected<FinalizedTraceFilterConfig> finalize_config(
+    const TraceFilterConfig& config);
+
+}  // namespace tracing
+}  // namespace datadog
@@ -24,15 +24,20 @@
 // same `TraceSegment`.
 //
 // When all of the `Span`s associated with `TraceSegment` have been destroyed,
-// the `TraceSegment` submits them in a payload to a `Collector`.
+// the `TraceSegment` submits them in a payload to a `Collector`.  The `Span`s
+// share ownership of the `TraceSegment`, except in single-threaded mode (see
+// `TracerConfig::single_threaded`), where the last `Span` to finish destroys
+// it.
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <utility>
 #include <vector>
 
 #include "expected.h"
+#include "mutex.h"
 #include "optional.h"
 #include "propagation_style.h"
 #include "runtime_id.h"
@@ -45,8 +50,10 @@ namespace tracing {
 class Collector;
 class DictReader;
 class DictWriter;
+class IDGenerator;
 struct InjectionOptions;
 class Logger;
+class ResourceQuantizer;
 struct SpanData;
 struct SpanDefaults;
 class SpanSampler;
@@ -55,19 +62,32 @@ class ConfigManager;
 class TracerTelemetry;
 
 class TraceSegment {
-  mutable std::mutex mutex_;
+  // `mutex_` is disabled if the tracer is single-threaded.
+  mutable OptionalMutex mutex_;
+  // Whether this segment is used from only one thread, in which case its spans
+  // own it jointly.  See `span_finished`.
+  const bool single_threaded_;
+  // Whether spans are counted in telemetry when this segment closes, rather
+  // than as they're created and finished.  See `TracerTelemetry`.
+  const bool count_spans_on_close_;
+  // Whether a trace filter rule matched the local root span, in which case the
+  // spans don't record tags and are not sent.  See `trace_filter_config.h`.
+  const bool filtered_;
 
   std::shared_ptr<Logger> logger_;
   std::shared_ptr<Collector> collector_;
   std::shared_ptr<TracerTelemetry> tracer_telemetry_;
   std::shared_ptr<TraceSampler> trace_sampler_;
   std::shared_ptr<SpanSampler> span_sampler_;
+  std::shared_ptr<ResourceQuantizer> resource_quantizer_;
+  std::shared_ptr<const IDGenerator> generator_;
 
   std::shared_ptr<const SpanDefaults> defaults_;
   RuntimeID runtime_id_;
   const std::vector<PropagationStyle> injection_styles_;
   const Optional<std::string> hostname_;
   const Optional<std::string> origin_;
+  const std::uint64_t local_root_id_;
   const std::size_t tags_header_max_size_;
   std::vector<std::pair<std::string, std::string>> trace_tags_;
 
@@ -85,8 +105,10 @@ class TraceSegment {
                const std::shared_ptr<TracerTelemetry>& tracer_telemetry,
                const std::shared_ptr<TraceSampler>& trace_sampler,
                const std::shared_ptr<SpanSampler>& span_sampler,
+               const std::shared_ptr<ResourceQuantizer>& resource_quantizer,
                const std::shared_ptr<const SpanDefaults>& defaults,
                const std::shared_ptr<ConfigManager>& config_manager,
+               const std::shared_ptr<const IDGenerator>& generator,
                const RuntimeID& runtime_id,
                const std::vector<PropagationStyle>& injection_styles,
                const Optional<std::string>& hostname,
@@ -95,12 +117,19 @@ class TraceSegment {
                Optional<SamplingDecision> sampling_decision,
                Optional<std::string> additional_w3c_tracestate,
                Optional<std::string> additional_datadog_w3c_tracestate,
+               bool single_threaded, bool filtered,
                std::unique_ptr<SpanData> local_root);
 
   const SpanDefaults& defaults() const;
   const Optional<std::string>& hostname() const;
   const Optional<std::string>& origin() const;
+  // Return the span ID of the first span in this trace segment, i.e. the
+  // local root span.
+  std::uint64_t local_root_id() const;
   Optional<SamplingDecision> sampling_decision() const;
+  // Return whether this trace segment was filtered by a trace filter rule.
+  // See `trace_filter_config.h`.
+  bool filtered() const;
 
   Logger& logger() const;
 
@@ -111,11 +140,18 @@ class TraceSegment {
   bool inject(DictWriter& writer, const SpanData& span,
               const InjectionOptions& options);
 
+  // Return a new span ID for a span in this trace segment.
+  std::uint64_t generate_span_id() const;
+
   // Take ownership of the specified `span`.
   void register_span(std::unique_ptr<SpanData> span);
   // Increment the number of finished spans.  If that number is equal to the
-  // number of registered spans, send all of the spans to the `Collector`.
-  void span_finished();
+  // number of registered spans, send all of the spans to the `Collector`,
+  // unless this segment is filtered.  Return whether the caller must now
+  // destroy this object, which is the case only for the last span of a
+  // single-threaded segment, since such a segment is owned jointly by its
+  // `Span` objects rather than through their `std::shared_ptr`s.
+  bool span_finished();
 
   // Set the sampling decision to be a local, manual decision with the specified
   // sampling `priority`.  Overwrite any previous sampling decision.
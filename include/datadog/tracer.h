@@ -17,9 +17,11 @@
 #include "clock.h"
 #include "expected.h"
 #include "id_generator.h"
+#include "injection_options.h"
 #include "optional.h"
 #include "span.h"
 #include "span_config.h"
+#include "span_prototype.h"
 #include "tracer_config.h"
 #include "tracer_signature.h"
 
@@ -28,8 +30,14 @@ namespace tracing {
 
 class TracerTelemetry;
 class ConfigManager;
+class DogStatsDClient;
+class ResourceQuantizer;
+class RuntimeMetricsSampler;
+class TraceCapture;
 class DictReader;
 struct SpanConfig;
+struct SpanData;
+struct SpanDefaults;
 class TraceSampler;
 class SpanSampler;
 class IDGenerator;
@@ -43,6 +51,8 @@ class Tracer {
   std::shared_ptr<ConfigManager> config_manager_;
   std::shared_ptr<Collector> collector_;
   std::shared_ptr<SpanSampler> span_sampler_;
+  // Null unless resource quantization is enabled.
+  std::shared_ptr<ResourceQuantizer> resource_quantizer_;
   std::shared_ptr<const IDGenerator> generator_;
   Clock clock_;
   std::vector<PropagationStyle> injection_styles_;
@@ -56,6 +66,15 @@ class Tracer {
   Baggage::Options baggage_opts_;
   bool baggage_injection_enabled_;
   bool baggage_extraction_enabled_;
+  // See `TracerConfig::single_threaded`.
+  bool single_threaded_;
+  // See `TracerConfig::shards`.
+  std::size_t shards_;
+  std::shared_ptr<TraceCapture> trace_capture_;
+  std::shared_ptr<RuntimeMetricsSampler> runtime_metrics_;
+  // Reports the tracer's runtime and health metrics, if enabled.  It's
+  // declared last so that it's destroyed, and its final flush done, first.
+  std::shared_ptr<DogStatsDClient> dogstatsd_;
 
  public:
   // Create a tracer configured using the specified `config`, and optionally:
@@ -69,6 +88,15 @@ class Tracer {
   // specify a `config` indicating the attributes of the root span.
   Span create_span();
   Span create_span(const SpanConfig& config);
+  // Create a new trace and return the root span of the trace, whose
+  // properties are those of the specified `prototype`.  See
+  // `span_prototype.h`.
+  Span create_span(const SpanPrototype& prototype);
+
+  // Return a prototype of spans configured by the specified `config`, for use
+  // with `create_span` and `Span::create_child`.  See `span_prototype.h`.
+  // The `start` of `config` is ignored.
+  SpanPrototype create_span_prototype(const SpanConfig& config);
 
   // Return a span whose parent and other context is parsed from the specified
   // `reader`, and whose attributes are determined by the optionally specified
@@ -99,8 +127,12 @@ class Tracer {
   // extraction.
   Baggage extract_or_create_baggage(const DictReader& reader);
 
-  // Inject baggage into the specified `reader`.
+  // Inject baggage into the specified `writer`. If the optionally specified
+  // `options` select a subset of propagation styles that does not include
+  // `PropagationStyle::BAGGAGE`, then do nothing.
   Expected<void> inject(const Baggage& baggage, DictWriter& writer);
+  Expected<void> inject(const Baggage& baggage, DictWriter& writer,
+                        const InjectionOptions& options);
 
   // Return a JSON object describing this Tracer's configuration. It is the
   // same JSON object that was logged when this Tracer was created.
@@ -108,6 +140,10 @@ class Tracer {
 
  private:
   void store_config();
+  // Return the root span of a new trace segment having the specified
+  // `span_data`, whose IDs are yet to be set.
+  Span make_root_span(std::unique_ptr<SpanData> span_data,
+                      const std::shared_ptr<const SpanDefaults>& defaults);
 };
 
 }  // namespace tracing
@@ -14,11 +14,15 @@
 #include "baggage.h"
 #include "clock.h"
 #include "datadog_agent_config.h"
+#include "dogstatsd_config.h"
 #include "expected.h"
 #include "propagation_style.h"
+#include "resource_quantization_config.h"
 #include "runtime_id.h"
+#include "runtime_metrics_config.h"
 #include "span_defaults.h"
 #include "span_sampler_config.h"
+#include "trace_filter_config.h"
 #include "trace_sampler_config.h"
 
 namespace datadog {
@@ -26,6 +30,7 @@ namespace tracing {
 
 class Collector;
 class Logger;
+class TraceCapture;
 class SpanSampler;
 class TraceSampler;
 
@@ -76,6 +81,22 @@ struct TracerConfig {
   // variable.
   Optional<bool> report_traces;
 
+  // `dogstatsd` configures the reporting of the tracer's runtime and health
+  // metrics, such as the number of open trace segments, to DogStatsD.  See
+  // `dogstatsd_config.h`.  By default, these metrics are not reported.
+  DogStatsDConfig dogstatsd;
+
+  // `runtime_metrics` configures sampling of the process's runtime metrics,
+  // such as CPU time and resident memory.  See `runtime_metrics_config.h`.  By
+  // default, runtime metrics are not sampled.
+  RuntimeMetricsConfig runtime_metrics;
+
+  // `trace_capture`, if not null, is where the tracer records the trace
+  // context headers that it extracts and the spans that it sends to its
+  // collector, for later replay.  See `trace_capture.h`.  By default, traces
+  // are not captured.
+  std::shared_ptr<TraceCapture> trace_capture;
+
   // `telemetry` configures the telemetry module. See
   // `telemetry/configuration.h` By default, the telemetry module is enabled.
   telemetry::Configuration telemetry;
@@ -89,6 +110,17 @@ struct TracerConfig {
   // the trace sampler.  See `span_sampler_config.h`.
   SpanSamplerConfig span_sampler;
 
+  // `resource_quantization` configures the replacement of identifiers and
+  // literals in span resource names, and the limit on the number of distinct
+  // resource names per service.  See `resource_quantization_config.h`.  By
+  // default, resource names are not modified.
+  ResourceQuantizationConfig resource_quantization;
+
+  // `trace_filter` configures rules that match the root spans of traces, such
+  // as those of health checks, that are never sent nor finalized.  See
+  // `trace_filter_config.h`.  By default, no traces are filtered.
+  TraceFilterConfig trace_filter;
+
   // `injection_styles` indicates with which tracing systems trace propagation
   // will be compatible when injecting (sending) trace context.
   // All styles indicated by `injection_styles` are used for injection.
@@ -161,6 +193,28 @@ struct TracerConfig {
   /// The maximum amount of bytes allowed to be written during tracing context
   /// injection.
   Optional<std::size_t> baggage_max_bytes;
+
+  // `single_threaded` indicates whether the application promises to use the
+  // tracer, and all of the spans that it produces, from only one thread, as do
+  // the worker processes of nginx and other event loop servers.  If true, then
+  // the tracer does not lock the state of a trace as its spans are created and
+  // finished, does not reference count the state of a trace for each of its
+  // spans, and counts spans in telemetry once per trace instead of once per
+  // span.  Components shared with the tracer's background threads, such as the
+  // trace sampler and Remote Configuration, are still locked.  Debug builds
+  // assert that the promise is kept.  `single_threaded` is false by default,
+  // and has no corresponding environment variable, because it is a property of
+  // the application rather than of its deployment.
+  Optional<bool> single_threaded;
+
+  // `shards` is the number of shards into which the tracer divides its
+  // frequently modified state, for applications that run one thread per core
+  // and that avoid sharing state among cores.  Each thread uses the state of
+  // its own shard, and a background thread merges the shards periodically.
+  // See `shard.h`.  `shards` is one by default, meaning that the tracer isn't
+  // sharded.  It must be at least one.  Like `single_threaded`, it has no
+  // corresponding environment variable.
+  Optional<std::size_t> shards;
 };
 
 // `FinalizedTracerConfig` contains `Tracer` implementation details derived from
@@ -180,7 +234,12 @@ class FinalizedTracerConfig final {
 
   FinalizedTraceSamplerConfig trace_sampler;
   FinalizedSpanSamplerConfig span_sampler;
+  FinalizedResourceQuantizationConfig resource_quantization;
+  FinalizedTraceFilterConfig trace_filter;
   telemetry::FinalizedConfiguration telemetry;
+  FinalizedDogStatsDConfig dogstatsd;
+  FinalizedRuntimeMetricsConfig runtime_metrics;
+  std::shared_ptr<TraceCapture> trace_capture;
 
   std::vector<PropagationStyle> injection_styles;
   std::vector<PropagationStyle> extraction_styles;
@@ -197,6 +256,8 @@ class FinalizedTracerConfig final {
   bool report_traces;
   std::unordered_map<ConfigName, ConfigMetadata> metadata;
   Baggage::Options baggage_opts;
+  bool single_threaded;
+  std::size_t shards;
 };
 
 // Return a `FinalizedTracerConfig` from the specified `config` and from any
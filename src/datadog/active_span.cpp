@@ -0,0 +1,123 @@
+#include <datadog/active_span.h>
+#include <datadog/span.h>
+#include <datadog/trace_segment.h>
+
+#include <algorithm>
+#include <cstring>
+
+// The slot has a well-known, unmangled name so that profilers outside of this
+// process can find it.  It is constant-initialized, so accessing it does not
+// require a thread-local initialization guard.
+extern "C" {
+thread_local datadog::tracing::ActiveSpanSlot dd_trace_cpp_active_span_slot;
+}
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+constexpr int max_read_attempts = 8;
+constexpr std::size_t endpoint_words = ActiveSpanSlot::endpoint_capacity / 8;
+
+}  // namespace
+
+ActiveSpanSlot& active_span_slot() noexcept {
+  return dd_trace_cpp_active_span_slot;
+}
+
+void write_active_span(ActiveSpanSlot& slot,
+                       const ActiveSpanContext& context) noexcept {
+  const std::size_t endpoint_size =
+      std::min(context.endpoint_size, ActiveSpanSlot::endpoint_capacity);
+  std::uint64_t words[endpoint_words];
+  const std::size_t used_words = (endpoint_size + 7) / 8;
+  std::memcpy(words, context.endpoint_buffer, used_words * 8);
+
+  const auto sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  // Order the odd sequence number before the field writes.
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.trace_id_low.store(context.trace_id.low, std::memory_order_relaxed);
+  slot.trace_id_high.store(context.trace_id.high, std::memory_order_relaxed);
+  slot.span_id.store(context.span_id, std::memory_order_relaxed);
+  slot.local_root_span_id.store(context.local_root_span_id,
+                                std::memory_order_relaxed);
+  slot.endpoint_size.store(endpoint_size, std::memory_order_relaxed);
+  for (std::size_t i = 0; i < used_words; ++i) {
+    slot.endpoint[i].store(words[i], std::memory_order_relaxed);
+  }
+
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool read_active_span(const ActiveSpanSlot& slot,
+                      ActiveSpanContext& context) noexcept {
+  for (int attempt = 0; attempt < max_read_attempts; ++attempt) {
+    const auto before = slot.sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      continue;
+    }
+
+    context.trace_id.low = slot.trace_id_low.load(std::memory_order_relaxed);
+    context.trace_id.high = slot.trace_id_high.load(std::memory_order_relaxed);
+    context.span_id = slot.span_id.load(std::memory_order_relaxed);
+    context.local_root_span_id =
+        slot.local_root_span_id.load(std::memory_order_relaxed);
+    const std::size_t endpoint_size = std::min<std::size_t>(
+        slot.endpoint_size.load(std::memory_order_relaxed),
+        ActiveSpanSlot::endpoint_capacity);
+    std::uint64_t words[endpoint_words];
+    const std::size_t used_words = (endpoint_size + 7) / 8;
+    for (std::size_t i = 0; i < used_words; ++i) {
+      words[i] = slot.endpoint[i].load(std::memory_order_relaxed);
+    }
+
+    // Order the field reads before the second read of the sequence number.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) == before) {
+      context.endpoint_size = endpoint_size;
+      std::memcpy(context.endpoint_buffer, words, endpoint_size);
+      return true;
+    }
+  }
+  return false;
+}
+
+ActiveSpanScope::ActiveSpanScope(const Span& span)
+    : slot_(&active_span_slot()) {
+  // This thread is the only writer of its slot, so the read can't fail.
+  read_active_span(*slot_, previous_);
+
+  StringView endpoint;
+  if (span.id() == span.trace_segment().local_root_id()) {
+    endpoint = span.resource_name();
+  } else if (previous_.span_id != 0 && previous_.trace_id == span.trace_id() &&
+             previous_.local_root_span_id ==
+                 span.trace_segment().local_root_id()) {
+    endpoint = previous_.endpoint();
+  }
+  publish(span, endpoint);
+}
+
+ActiveSpanScope::ActiveSpanScope(const Span& span, StringView endpoint)
+    : slot_(&active_span_slot()) {
+  read_active_span(*slot_, previous_);
+  publish(span, endpoint);
+}
+
+ActiveSpanScope::~ActiveSpanScope() { write_active_span(*slot_, previous_); }
+
+void ActiveSpanScope::publish(const Span& span, StringView endpoint) {
+  ActiveSpanContext context;
+  context.trace_id = span.trace_id();
+  context.span_id = span.id();
+  context.local_root_span_id = span.trace_segment().local_root_id();
+  context.endpoint_size =
+      std::min(endpoint.size(), ActiveSpanSlot::endpoint_capacity);
+  std::copy_n(endpoint.data(), context.endpoint_size, context.endpoint_buffer);
+  write_active_span(*slot_, context);
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,118 @@
+#include "agent_info.h"
+
+#include <datadog/error.h>
+
+#include <algorithm>
+
+#include "json.hpp"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+Error wrong_type(StringView field, StringView expected,
+                 const nlohmann::json& actual) {
+  std::string message;
+  message += "Datadog Agent /info response property \"";
+  append(message, field);
+  message += "\" should be ";
+  append(message, expected);
+  message += ", but it's a JSON value with type \"";
+  message += actual.type_name();
+  message += "\".";
+  return Error{Error::DATADOG_AGENT_INVALID_INFO_RESPONSE, std::move(message)};
+}
+
+Expected<void> parse_strings(std::vector<std::string>& destination,
+                             const nlohmann::json& object, StringView field) {
+  const auto found = object.find(std::string(field));
+  if (found == object.end() || found->is_null()) {
+    return {};
+  }
+  if (!found->is_array()) {
+    return wrong_type(field, "an array of strings", *found);
+  }
+  for (const auto& element : *found) {
+    if (!element.is_string()) {
+      return wrong_type(field, "an array of strings", element);
+    }
+    destination.push_back(element.get<std::string>());
+  }
+  return {};
+}
+
+}  // namespace
+
+bool AgentInfo::has_endpoint(StringView path) const {
+  return std::find(endpoints.begin(), endpoints.end(), path) !=
+         endpoints.end();
+}
+
+Expected<AgentInfo> parse_agent_info(StringView body) {
+  const auto response = nlohmann::json::parse(body, nullptr, false);
+  if (response.is_discarded()) {
+    return Error{Error::DATADOG_AGENT_INVALID_INFO_RESPONSE,
+                 "Datadog Agent /info response is not valid JSON."};
+  }
+  if (!response.is_object()) {
+    return wrong_type("", "an object", response);
+  }
+
+  AgentInfo info;
+  if (const auto found = response.find("version");
+      found != response.end() && !found->is_null()) {
+    if (!found->is_string()) {
+      return wrong_type("version", "a string", *found);
+    }
+    info.version = found->get<std::string>();
+  }
+
+  auto result = parse_strings(info.endpoints, response, "endpoints");
+  if (auto* error = result.if_error()) {
+    return std::move(*error);
+  }
+  result = parse_strings(info.feature_flags, response, "feature_flags");
+  if (auto* error = result.if_error()) {
+    return std::move(*error);
+  }
+
+  if (const auto found = response.find("client_drop_p0s");
+      found != response.end() && !found->is_null()) {
+    if (!found->is_boolean()) {
+      return wrong_type("client_drop_p0s", "a boolean", *found);
+    }
+    info.client_drop_p0s = found->get<bool>();
+  }
+
+  const auto config = response.find("config");
+  if (config == response.end() || config->is_null()) {
+    return info;
+  }
+  if (!config->is_object()) {
+    return wrong_type("config", "an object", *config);
+  }
+
+  if (const auto found = config->find("max_request_bytes");
+      found != config->end() && !found->is_null()) {
+    if (!found->is_number_unsigned()) {
+      return wrong_type("config.max_request_bytes", "a non-negative integer",
+                        *found);
+    }
+    info.max_request_bytes = found->get<std::uint64_t>();
+  }
+
+  if (const auto found = config->find("receiver_socket");
+      found != config->end() && !found->is_null()) {
+    if (!found->is_string()) {
+      return wrong_type("config.receiver_socket", "a string", *found);
+    }
+    if (!found->get_ref<const std::string&>().empty()) {
+      info.receiver_socket = found->get<std::string>();
+    }
+  }
+
+  return info;
+}
+
+}  // namespace tracing
+}  // namespace datadog
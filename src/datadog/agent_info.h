@@ -0,0 +1,67 @@
+#pragma once
+
+// This component provides a `struct`, `AgentInfo`, that contains what the
+// Datadog Agent reports about itself at its "/info" endpoint, and a function,
+// `parse_agent_info`, that produces an `AgentInfo` from the body of the
+// Agent's response.
+//
+// `DatadogAgent` queries "/info" when it starts and periodically thereafter,
+// and uses the result to choose the traces endpoint and payload format, the
+// maximum size of a request, and whether to connect via the Agent's Unix
+// domain socket.  See `datadog_agent.h`.
+//
+// An Agent response looks like the following, with irrelevant fields omitted:
+//
+//     {
+//       "version": "7.52.0",
+//       "endpoints": ["/v0.4/traces", "/v0.5/traces", "/v0.6/stats", ...],
+//       "feature_flags": ["..."],
+//       "client_drop_p0s": true,
+//       "config": {
+//         "receiver_socket": "/var/run/datadog/apm.socket",
+//         "max_request_bytes": 26214400,
+//         ...
+//       },
+//       ...
+//     }
+
+#include <datadog/expected.h>
+#include <datadog/optional.h>
+#include <datadog/string_view.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+struct AgentInfo {
+  // the Agent's version, e.g. "7.52.0"
+  std::string version;
+  // the paths of the HTTP endpoints that the Agent supports, e.g.
+  // "/v0.4/traces"
+  std::vector<std::string> endpoints;
+  // names of experimental features enabled in the Agent
+  std::vector<std::string> feature_flags;
+  // whether the Agent accepts traces that were dropped by sampling being
+  // omitted, provided that the tracer computes trace statistics itself
+  bool client_drop_p0s = false;
+  // the largest request body that the Agent accepts
+  Optional<std::uint64_t> max_request_bytes;
+  // the path to the Unix domain socket on which the Agent accepts requests
+  Optional<std::string> receiver_socket;
+
+  // Return whether the Agent supports the endpoint having the specified
+  // `path`.
+  bool has_endpoint(StringView path) const;
+};
+
+// Return the `AgentInfo` in the specified Agent response `body`, or return an
+// error if `body` is not a JSON object or if any of the fields above has the
+// wrong type.  Fields that are missing, including "endpoints", are left
+// empty.
+Expected<AgentInfo> parse_agent_info(StringView body);
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,132 @@
+#include "b3_propagation.h"
+
+#include <datadog/error.h>
+#include <datadog/optional.h>
+#include <datadog/propagation_style.h>
+
+#include <cassert>
+#include <iterator>
+#include <utility>
+
+#include "hex.h"
+#include "parse_util.h"
+#include "string_util.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Return an error describing the specified malformed "b3" header `value` for
+// the specified `reason`.
+Error malformed(StringView value, StringView reason) {
+  std::string message;
+  message += "Malformed B3 single header \"";
+  append(message, value);
+  message += "\": ";
+  append(message, reason);
+  return Error{Error::MALFORMED_B3_HEADER, std::move(message)};
+}
+
+// Return the sampling priority indicated by the specified B3 sampling `state`,
+// or return `nullopt` if `state` is not one of "0", "1", or "d".
+Optional<int> parse_sampling_state(StringView state) {
+  if (state == "1") {
+    return 1;
+  } else if (state == "0") {
+    return 0;
+  } else if (state == "d") {
+    return 2;  // debug means "keep," like a user keep
+  }
+  return nullopt;
+}
+
+}  // namespace
+
+Expected<ExtractedData> extract_b3_single(
+    const DictReader& headers, std::unordered_map<std::string, std::string>&,
+    Logger&) {
+  ExtractedData result;
+  result.style = PropagationStyle::B3_SINGLE;
+
+  const auto found = headers.lookup("b3");
+  if (!found) {
+    return result;
+  }
+  const StringView value = trim(*found);
+
+  // A sampling state alone, e.g. "0", carries no trace context.
+  if (value.find('-') == StringView::npos) {
+    const auto sampling_priority = parse_sampling_state(value);
+    if (!sampling_priority) {
+      return malformed(value,
+                       "Expected a trace ID and span ID, or a sampling state "
+                       "alone.");
+    }
+    result.sampling_priority = *sampling_priority;
+    return result;
+  }
+
+  // trace ID, span ID, sampling state, parent span ID
+  StringView fields[4];
+  std::size_t num_fields = 0;
+  for (std::size_t begin = 0;;) {
+    if (num_fields == 4) {
+      return malformed(value, "Expected at most four fields.");
+    }
+    const std::size_t end = value.find('-', begin);
+    fields[num_fields++] = value.substr(begin, end - begin);
+    if (end == StringView::npos) {
+      break;
+    }
+    begin = end + 1;
+  }
+
+  auto trace_id = TraceID::parse_hex(fields[0]);
+  if (auto* error = trace_id.if_error()) {
+    std::string prefix = "Could not extract B3-style trace ID from \"";
+    append(prefix, value);
+    prefix += "\": ";
+    return error->with_prefix(prefix);
+  }
+  result.trace_id = *trace_id;
+
+  auto parent_id = parse_uint64(fields[1], 16);
+  if (auto* error = parent_id.if_error()) {
+    std::string prefix = "Could not extract B3-style parent span ID from \"";
+    append(prefix, value);
+    prefix += "\": ";
+    return error->with_prefix(prefix);
+  }
+  result.parent_id = *parent_id;
+
+  // The fourth field, the parent of the parent span, is not used.
+  if (num_fields >= 3) {
+    const auto sampling_priority = parse_sampling_state(fields[2]);
+    if (!sampling_priority) {
+      return malformed(value, "Expected a sampling state of 0, 1, or d.");
+    }
+    result.sampling_priority = *sampling_priority;
+  }
+
+  return result;
+}
+
+StringView encode_b3_single(TraceID trace_id, std::uint64_t span_id,
+                            int sampling_priority,
+                            char (&buffer)[b3_single_max_size]) {
+  char* out = buffer;
+  if (trace_id.high) {
+    out = write_hex_padded(out, trace_id.high);
+  }
+  out = write_hex_padded(out, trace_id.low);
+  *out++ = '-';
+  out = write_hex_padded(out, span_id);
+  *out++ = '-';
+  *out++ = sampling_priority > 0 ? '1' : '0';
+
+  assert(out <= std::end(buffer));
+  return StringView(buffer, out - buffer);
+}
+
+}  // namespace tracing
+}  // namespace datadog
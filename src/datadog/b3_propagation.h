@@ -0,0 +1,53 @@
+#pragma once
+
+// This component provides functions for extracting and injecting trace context
+// in the `PropagationStyle::B3_SINGLE` style. These functions decode and encode
+// the "b3" HTTP request header, whose value has the form
+//
+//     {TraceId}-{SpanId}-{SamplingState}-{ParentSpanId}
+//
+// where the last two fields are optional, or else consists of a sampling state
+// alone. See <https://github.com/openzipkin/b3-propagation>.
+//
+// Neither function allocates, except to describe an error.
+
+#include <datadog/dict_reader.h>
+#include <datadog/expected.h>
+#include <datadog/string_view.h>
+#include <datadog/trace_id.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "extracted_data.h"
+
+namespace datadog {
+namespace tracing {
+
+class Logger;
+
+// `b3_single_max_size` is the length of the longest "b3" header value that
+// `encode_b3_single` produces: a 128-bit trace ID, a span ID, and a sampling
+// state.
+constexpr std::size_t b3_single_max_size = 32 + 1 + 16 + 1 + 1;
+
+// Return trace information parsed from the "b3" entry of the specified
+// `headers`. The sampling state "d" (debug) is extracted as the sampling
+// priority 2 (user keep). If an error occurs, return an `Error`.
+Expected<ExtractedData> extract_b3_single(
+    const DictReader& headers, std::unordered_map<std::string, std::string>&,
+    Logger&);
+
+// Write a value for the "b3" header consisting of the specified `trace_id`,
+// the specified `span_id`, and a sampling state deduced from the specified
+// `sampling_priority` into the specified `buffer`, and return a view of the
+// written characters. The trace ID is written as 16 hex digits if its higher
+// 64 bits are zero, or as 32 hex digits otherwise.
+StringView encode_b3_single(TraceID trace_id, std::uint64_t span_id,
+                            int sampling_priority,
+                            char (&buffer)[b3_single_max_size]);
+
+}  // namespace tracing
+}  // namespace datadog
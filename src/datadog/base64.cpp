@@ -28,6 +28,41 @@ constexpr uint8_t k_base64_table[] = {
     _,  _,  _,  _,  _,  _,  _,  _,     _,  _,  _,  _,  _,  _,  _,  _,  _,  _,
     _,  _,  _,  _};
 
+std::string base64_encode(StringView input) {
+  static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  const auto byte = [&](std::size_t index) {
+    return uint32_t(static_cast<unsigned char>(input[index]));
+  };
+
+  std::string output;
+  output.reserve((input.size() + 2) / 3 * 4);
+
+  std::size_t i = 0;
+  for (; i + 3 <= input.size(); i += 3) {
+    const uint32_t bits = byte(i) << 16 | byte(i + 1) << 8 | byte(i + 2);
+    output.push_back(alphabet[bits >> 18]);
+    output.push_back(alphabet[(bits >> 12) & 0x3F]);
+    output.push_back(alphabet[(bits >> 6) & 0x3F]);
+    output.push_back(alphabet[bits & 0x3F]);
+  }
+
+  const std::size_t remaining = input.size() - i;
+  if (remaining == 0) return output;
+
+  uint32_t bits = byte(i) << 16;
+  if (remaining == 2) {
+    bits |= byte(i + 1) << 8;
+  }
+  output.push_back(alphabet[bits >> 18]);
+  output.push_back(alphabet[(bits >> 12) & 0x3F]);
+  output.push_back(remaining == 2 ? alphabet[(bits >> 6) & 0x3F] : '=');
+  output.push_back('=');
+
+  return output;
+}
+
 std::string base64_decode(StringView input) {
   const size_t in_size = input.size();
 
@@ -37,10 +72,10 @@ std::string base64_decode(StringView input) {
   size_t i = 0;
 
   for (; i + 4 < in_size;) {
-    uint32_t c0 = k_base64_table[static_cast<size_t>(input[i++])];
-    uint32_t c1 = k_base64_table[static_cast<size_t>(input[i++])];
-    uint32_t c2 = k_base64_table[static_cast<size_t>(input[i++])];
-    uint32_t c3 = k_base64_table[static_cast<size_t>(input[i++])];
+    uint32_t c0 = k_base64_table[static_cast<unsigned char>(input[i++])];
+    uint32_t c1 = k_base64_table[static_cast<unsigned char>(input[i++])];
+    uint32_t c2 = k_base64_table[static_cast<unsigned char>(input[i++])];
+    uint32_t c3 = k_base64_table[static_cast<unsigned char>(input[i++])];
 
     if (c0 == k_sentinel || c1 == k_sentinel || c2 == k_sentinel ||
         c3 == k_sentinel) {
@@ -55,10 +90,10 @@ std::string base64_decode(StringView input) {
   // If padding is missing, return the empty string in lieu of an Error.
   if ((in_size - i) < 4) return "";
 
-  uint32_t c0 = k_base64_table[static_cast<size_t>(input[i++])];
-  uint32_t c1 = k_base64_table[static_cast<size_t>(input[i++])];
-  uint32_t c2 = k_base64_table[static_cast<size_t>(input[i++])];
-  uint32_t c3 = k_base64_table[static_cast<size_t>(input[i++])];
+  uint32_t c0 = k_base64_table[static_cast<unsigned char>(input[i++])];
+  uint32_t c1 = k_base64_table[static_cast<unsigned char>(input[i++])];
+  uint32_t c2 = k_base64_table[static_cast<unsigned char>(input[i++])];
+  uint32_t c3 = k_base64_table[static_cast<unsigned char>(input[i++])];
 
   if (c0 == k_sentinel || c1 == k_sentinel || c2 == k_sentinel ||
       c3 == k_sentinel) {
@@ -10,7 +10,7 @@ void CerrLogger::log_error(const LogFunc& write) { log(write); }
 void CerrLogger::log_startup(const LogFunc& write) { log(write); }
 
 void CerrLogger::log(const LogFunc& write) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<Mutex> lock(mutex_);
 
   stream_.clear();
   // Copy an empty string in, don't move it.
@@ -116,6 +116,11 @@ ConfigManager::Update parse_dynamic_config(const nlohmann::json& j) {
     config_update.trace_sampling_rules = &(*tracing_sampling_rules_it);
   }
 
+  if (auto tracing_filter_rules_it = j.find("tracing_filter_rules");
+      tracing_filter_rules_it != j.cend()) {
+    config_update.trace_filter_rules = &(*tracing_filter_rules_it);
+  }
+
   return config_update;
 }
 
@@ -128,10 +133,13 @@ ConfigManager::ConfigManager(const FinalizedTracerConfig& config,
     : clock_(config.clock),
       default_metadata_(config.metadata),
       trace_sampler_(
-          std::make_shared<TraceSampler>(config.trace_sampler, clock_)),
+          std::make_shared<TraceSampler>(config.trace_sampler, clock_,
+                                         config.shards)),
       rules_(config.trace_sampler.rules),
       span_defaults_(std::make_shared<SpanDefaults>(config.defaults)),
       report_traces_(config.report_traces),
+      trace_filter_(
+          std::make_shared<const TraceFilter>(config.trace_filter.rules)),
       telemetry_(telemetry) {}
 
 rc::Products ConfigManager::get_products() { return rc::product::APM_TRACING; }
@@ -164,25 +172,30 @@ void ConfigManager::on_revert(const Configuration&) {
 }
 
 std::shared_ptr<TraceSampler> ConfigManager::trace_sampler() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<Mutex> lock(mutex_);
   return trace_sampler_;
 }
 
 std::shared_ptr<const SpanDefaults> ConfigManager::span_defaults() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<Mutex> lock(mutex_);
   return span_defaults_.value();
 }
 
 bool ConfigManager::report_traces() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<Mutex> lock(mutex_);
   return report_traces_.value();
 }
 
+std::shared_ptr<const TraceFilter> ConfigManager::trace_filter() {
+  std::lock_guard<Mutex> lock(mutex_);
+  return trace_filter_.value();
+}
+
 std::vector<ConfigMetadata> ConfigManager::apply_update(
     const ConfigManager::Update& conf) {
   std::vector<ConfigMetadata> metadata;
 
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<Mutex> lock(mutex_);
 
   // NOTE(@dmehala): Sampling rules are generally not well specified.
   //
@@ -274,6 +287,24 @@ std::vector<ConfigMetadata> ConfigManager::apply_update(
     }
   }
 
+  if (!conf.trace_filter_rules) {
+    reset_config(ConfigName::TRACE_FILTER_RULES, trace_filter_, metadata);
+  } else {
+    ConfigMetadata trace_filter_metadata(ConfigName::TRACE_FILTER_RULES,
+                                         conf.trace_filter_rules->dump(),
+                                         ConfigMetadata::Origin::REMOTE_CONFIG);
+
+    auto maybe_rules = parse_trace_filter_rules(*conf.trace_filter_rules);
+    if (auto* error = maybe_rules.if_error()) {
+      trace_filter_metadata.error = std::move(*error);
+    } else {
+      trace_filter_ =
+          std::make_shared<const TraceFilter>(std::move(*maybe_rules));
+    }
+
+    metadata.emplace_back(std::move(trace_filter_metadata));
+  }
+
   return metadata;
 }
 
@@ -287,10 +318,11 @@ void ConfigManager::reset_config(ConfigName name, T& conf,
 }
 
 nlohmann::json ConfigManager::config_json() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<Mutex> lock(mutex_);
   return nlohmann::json{{"defaults", to_json(*span_defaults_.value())},
                         {"trace_sampler", trace_sampler_->config_json()},
-                        {"report_traces", report_traces_.value()}};
+                        {"report_traces", report_traces_.value()},
+                        {"trace_filter", trace_filter_.value()->config_json()}};
 }
 
 }  // namespace tracing
@@ -6,6 +6,7 @@
 // the configuration.
 
 #include <datadog/clock.h>
+#include <datadog/mutex.h>
 #include <datadog/optional.h>
 #include <datadog/remote_config/listener.h>
 #include <datadog/span_defaults.h>
@@ -14,6 +15,7 @@
 #include <mutex>
 
 #include "json.hpp"
+#include "trace_filter.h"
 #include "tracer_telemetry.h"
 
 namespace datadog {
@@ -31,6 +33,7 @@ class ConfigManager : public remote_config::Listener {
     Optional<double> trace_sampling_rate;
     Optional<std::vector<StringView>> tags;
     const nlohmann::json* trace_sampling_rules = nullptr;
+    const nlohmann::json* trace_filter_rules = nullptr;
   };
 
  private:
@@ -66,7 +69,7 @@ class ConfigManager : public remote_config::Listener {
     void operator=(const Value& rhs) { current_value_ = rhs; }
   };
 
-  mutable std::mutex mutex_;
+  mutable Mutex mutex_{LockSite::CONFIG_MANAGER};
   Clock clock_;
   std::unordered_map<ConfigName, ConfigMetadata> default_metadata_;
 
@@ -75,6 +78,7 @@ class ConfigManager : public remote_config::Listener {
 
   DynamicConfig<std::shared_ptr<const SpanDefaults>> span_defaults_;
   DynamicConfig<bool> report_traces_;
+  DynamicConfig<std::shared_ptr<const TraceFilter>> trace_filter_;
 
   std::shared_ptr<TracerTelemetry> telemetry_;
 
@@ -105,6 +109,9 @@ class ConfigManager : public remote_config::Listener {
   // Return whether traces should be sent to the collector.
   bool report_traces();
 
+  // Return the `TraceFilter` consistent with the most recent configuration.
+  std::shared_ptr<const TraceFilter> trace_filter();
+
   // Return a JSON representation of the current configuration managed by this
   // object.
   nlohmann::json config_json() const;
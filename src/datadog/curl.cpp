@@ -4,6 +4,8 @@
 #include <datadog/dict_writer.h>
 #include <datadog/http_client.h>
 #include <datadog/logger.h>
+#include <datadog/mutex.h>
+#include <datadog/optional.h>
 #include <datadog/string_view.h>
 
 #include <algorithm>
@@ -20,6 +22,7 @@
 #include <unordered_set>
 
 #include "string_util.h"
+#include "usdt.h"
 
 namespace datadog {
 namespace tracing {
@@ -56,6 +59,10 @@ CURLcode CurlLibrary::easy_setopt_headerfunction(CURL *handle,
   return curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, on_header);
 }
 
+CURLcode CurlLibrary::easy_setopt_httpget(CURL *handle, long get) {
+  return curl_easy_setopt(handle, CURLOPT_HTTPGET, get);
+}
+
 CURLcode CurlLibrary::easy_setopt_httpheader(CURL *handle,
                                              curl_slist *headers) {
   return curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
@@ -163,7 +170,7 @@ using ResponseHandler = HTTPClient::ResponseHandler;
 using URL = HTTPClient::URL;
 
 class CurlImpl {
-  std::mutex mutex_;
+  Mutex mutex_{LockSite::CURL};
   CurlLibrary &curl_;
   const std::shared_ptr<Logger> logger_;
   Clock clock_;
@@ -172,7 +179,7 @@ class CurlImpl {
   std::list<CURL *> new_handles_;
   bool shutting_down_;
   int num_active_handles_;
-  std::condition_variable no_requests_;
+  std::condition_variable_any no_requests_;
   std::thread event_loop_;
 
   struct Request {
@@ -214,7 +221,7 @@ class CurlImpl {
   };
 
   void run();
-  void handle_message(const CURLMsg &, std::unique_lock<std::mutex> &);
+  void handle_message(const CURLMsg &, std::unique_lock<Mutex> &);
   CURLcode log_on_error(CURLcode result);
   CURLMcode log_on_error(CURLMcode result);
 
@@ -228,8 +235,10 @@ class CurlImpl {
                     CurlLibrary &, const Curl::ThreadGenerator &);
   ~CurlImpl();
 
-  Expected<void> post(const URL &url, HeadersSetter set_headers,
-                      std::string body, ResponseHandler on_response,
+  // Send a POST request having the specified `body`, or a GET request if
+  // `body` is null.
+  Expected<void> send(const URL &url, HeadersSetter set_headers,
+                      Optional<std::string> body, ResponseHandler on_response,
                       ErrorHandler on_error,
                       std::chrono::steady_clock::time_point deadline);
 
@@ -264,7 +273,15 @@ Expected<void> Curl::post(const URL &url, HeadersSetter set_headers,
                           std::string body, ResponseHandler on_response,
                           ErrorHandler on_error,
                           std::chrono::steady_clock::time_point deadline) {
-  return impl_->post(url, set_headers, body, on_response, on_error, deadline);
+  return impl_->send(url, set_headers, std::move(body), on_response, on_error,
+                     deadline);
+}
+
+Expected<void> Curl::get(const URL &url, HeadersSetter set_headers,
+                         ResponseHandler on_response, ErrorHandler on_error,
+                         std::chrono::steady_clock::time_point deadline) {
+  return impl_->send(url, set_headers, nullopt, on_response, on_error,
+                     deadline);
 }
 
 void Curl::drain(std::chrono::steady_clock::time_point deadline) {
@@ -314,7 +331,7 @@ CurlImpl::~CurlImpl() {
   }
 
   {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<Mutex> lock(mutex_);
     shutting_down_ = true;
   }
   log_on_error(curl_.multi_wakeup(multi_handle_));
@@ -324,9 +341,10 @@ CurlImpl::~CurlImpl() {
   curl_.global_cleanup();
 }
 
-Expected<void> CurlImpl::post(
-    const HTTPClient::URL &url, HeadersSetter set_headers, std::string body,
-    ResponseHandler on_response, ErrorHandler on_error,
+Expected<void> CurlImpl::send(
+    const HTTPClient::URL &url, HeadersSetter set_headers,
+    Optional<std::string> body, ResponseHandler on_response,
+    ErrorHandler on_error,
     std::chrono::steady_clock::time_point deadline) try {
   if (multi_handle_ == nullptr) {
     return Error{Error::CURL_HTTP_CLIENT_NOT_RUNNING,
@@ -344,7 +362,9 @@ Expected<void> CurlImpl::post(
 
   request->curl = &curl_;
   request->request_headers = headers.get();
-  request->request_body = std::move(body);
+  if (body) {
+    request->request_body = std::move(*body);
+  }
   request->on_response = std::move(on_response);
   request->on_error = std::move(on_error);
   request->deadline = std::move(deadline);
@@ -363,11 +383,15 @@ Expected<void> CurlImpl::post(
   throw_on_error(curl_.easy_setopt_private(handle.get(), request.get()));
   throw_on_error(
       curl_.easy_setopt_errorbuffer(handle.get(), request->error_buffer));
-  throw_on_error(curl_.easy_setopt_post(handle.get(), 1));
-  throw_on_error(curl_.easy_setopt_postfieldsize(
-      handle.get(), static_cast<long>(request->request_body.size())));
-  throw_on_error(
-      curl_.easy_setopt_postfields(handle.get(), request->request_body.data()));
+  if (body) {
+    throw_on_error(curl_.easy_setopt_post(handle.get(), 1));
+    throw_on_error(curl_.easy_setopt_postfieldsize(
+        handle.get(), static_cast<long>(request->request_body.size())));
+    throw_on_error(curl_.easy_setopt_postfields(
+        handle.get(), request->request_body.data()));
+  } else {
+    throw_on_error(curl_.easy_setopt_httpget(handle.get(), 1));
+  }
   throw_on_error(
       curl_.easy_setopt_headerfunction(handle.get(), &on_read_header));
   throw_on_error(curl_.easy_setopt_headerdata(handle.get(), request.get()));
@@ -389,7 +413,7 @@ Expected<void> CurlImpl::post(
   std::list<CURL *> node;
   node.push_back(handle.get());
   {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<Mutex> lock(mutex_);
     new_handles_.splice(new_handles_.end(), node);
 
     (void)headers.release();
@@ -405,9 +429,9 @@ Expected<void> CurlImpl::post(
 }
 
 void CurlImpl::drain(std::chrono::steady_clock::time_point deadline) {
-  std::unique_lock<std::mutex> lock(mutex_);
+  std::unique_lock<Mutex> lock(mutex_);
   no_requests_.wait_until(lock, deadline, [this]() {
-    return num_active_handles_ == 0 && new_handles_.empty();
+    return request_handles_.empty() && new_handles_.empty();
   });
 }
 
@@ -468,13 +492,10 @@ void CurlImpl::run() {
   int num_messages_remaining;
   CURLMsg *message;
   constexpr int max_wait_milliseconds = 10000;
-  std::unique_lock<std::mutex> lock(mutex_);
+  std::unique_lock<Mutex> lock(mutex_);
 
   for (;;) {
     log_on_error(curl_.multi_perform(multi_handle_, &num_active_handles_));
-    if (num_active_handles_ == 0) {
-      no_requests_.notify_all();
-    }
 
     // If a request is done or errored out, curl will enqueue a "message" for
     // us to handle.  Handle any pending messages.
@@ -482,6 +503,11 @@ void CurlImpl::run() {
                                             &num_messages_remaining))) {
       handle_message(*message, lock);
     }
+    // A request is finished once its response or error handler has returned,
+    // which is after libcurl stops counting it as active.
+    if (request_handles_.empty() && new_handles_.empty()) {
+      no_requests_.notify_all();
+    }
     lock.unlock();
     log_on_error(curl_.multi_poll(multi_handle_, nullptr, 0,
                                   max_wait_milliseconds, nullptr));
@@ -549,7 +575,7 @@ void CurlImpl::run() {
 }
 
 void CurlImpl::handle_message(const CURLMsg &message,
-                              std::unique_lock<std::mutex> &lock) {
+                              std::unique_lock<Mutex> &lock) {
   if (message.msg != CURLMSG_DONE) {
     return;
   }
@@ -566,6 +592,7 @@ void CurlImpl::handle_message(const CURLMsg &message,
   // handler.  If an error occurred, then call the error handler.
   const auto result = message.data.result;
   if (result != CURLE_OK) {
+    DD_TRACE_PROBE3(http_complete, int(result), -1, 0);
     std::string error_message;
     error_message += "Error sending request with libcurl (";
     error_message += curl_.easy_strerror(result);
@@ -581,6 +608,8 @@ void CurlImpl::handle_message(const CURLMsg &message,
                                                       &status)) != CURLE_OK) {
       status = -1;
     }
+    DD_TRACE_PROBE3(http_complete, int(result), int(status),
+                    request.response_body.size());
     HeaderReader reader(&request.response_headers_lower);
     lock.unlock();
     request.on_response(static_cast<int>(status), reader,
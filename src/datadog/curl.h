@@ -51,6 +51,7 @@ class CurlLibrary {
   virtual CURLcode easy_setopt_errorbuffer(CURL *handle, char *buffer);
   virtual CURLcode easy_setopt_headerdata(CURL *handle, void *data);
   virtual CURLcode easy_setopt_headerfunction(CURL *handle, HeaderCallback);
+  virtual CURLcode easy_setopt_httpget(CURL *handle, long get);
   virtual CURLcode easy_setopt_httpheader(CURL *handle, curl_slist *headers);
   virtual CURLcode easy_setopt_post(CURL *handle, long post);
   virtual CURLcode easy_setopt_postfields(CURL *handle, const char *data);
@@ -101,6 +102,10 @@ class Curl : public HTTPClient {
                       ErrorHandler on_error,
                       std::chrono::steady_clock::time_point deadline) override;
 
+  Expected<void> get(const URL &url, HeadersSetter set_headers,
+                     ResponseHandler on_response, ErrorHandler on_error,
+                     std::chrono::steady_clock::time_point deadline) override;
+
   void drain(std::chrono::steady_clock::time_point deadline) override;
 
   std::string config() const override;
@@ -7,34 +7,49 @@
 #include <datadog/string_view.h>
 #include <datadog/tracer.h>
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <iterator>
 #include <string>
 #include <typeinfo>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "agent_info.h"
 #include "collector_response.h"
 #include "json.hpp"
 #include "msgpack.h"
+#include "platform_util.h"
+#include "span_columns.h"
 #include "span_data.h"
 #include "trace_sampler.h"
+#include "usdt.h"
 
 namespace datadog {
 namespace tracing {
 namespace {
 
 constexpr StringView traces_api_path = "/v0.4/traces";
+constexpr StringView traces_v05_api_path = "/v0.5/traces";
 constexpr StringView telemetry_v2_path = "/telemetry/proxy/api/v2/apmtelemetry";
 constexpr StringView remote_configuration_path = "/v0.7/config";
+constexpr StringView info_path = "/info";
+
+// The Datadog Agent's default limit on the size of a request, which is used
+// until the Agent reports its actual limit.
+constexpr std::size_t default_max_request_bytes = 25 * 1024 * 1024;
 
 void set_content_type_json(DictWriter& headers) {
   headers.set("Content-Type", "application/json");
 }
 
-HTTPClient::URL traces_endpoint(const HTTPClient::URL& agent_url) {
+HTTPClient::URL traces_endpoint(const HTTPClient::URL& agent_url,
+                                DatadogAgent::TraceFormat format) {
   auto traces_url = agent_url;
-  append(traces_url.path, traces_api_path);
+  append(traces_url.path, format == DatadogAgent::TraceFormat::V0_5
+                              ? traces_v05_api_path
+                              : traces_api_path);
   return traces_url;
 }
 
@@ -51,13 +66,34 @@ HTTPClient::URL remote_configuration_endpoint(
   return remote_configuration;
 }
 
-Expected<void> msgpack_encode(
-    std::string& destination,
-    const std::vector<DatadogAgent::TraceChunk>& trace_chunks) {
-  return msgpack::pack_array(destination, trace_chunks,
-                             [](auto& destination, const auto& chunk) {
-                               return msgpack_encode(destination, chunk.spans);
-                             });
+HTTPClient::URL info_endpoint(const HTTPClient::URL& agent_url) {
+  auto info_url = agent_url;
+  append(info_url.path, info_path);
+  return info_url;
+}
+
+Expected<void> msgpack_encode(std::string& destination,
+                              DatadogAgent::TraceFormat format,
+                              const DatadogAgent::TraceChunk* begin,
+                              const DatadogAgent::TraceChunk* end) {
+  if (format == DatadogAgent::TraceFormat::V0_5) {
+    SpanColumns columns;
+    // The Agent expects the first string in the table to be empty.
+    columns.intern("");
+    for (auto* chunk = begin; chunk != end; ++chunk) {
+      columns.append_chunk(chunk->spans);
+    }
+    return msgpack_encode_v05(destination, columns);
+  }
+
+  (void)msgpack::pack_array(destination, end - begin);
+  for (auto* chunk = begin; chunk != end; ++chunk) {
+    auto result = msgpack_encode(destination, chunk->spans);
+    if (auto* error = result.if_error()) {
+      return std::move(*error);
+    }
+  }
+  return nullopt;
 }
 
 std::variant<CollectorResponse, std::string> parse_agent_traces_response(
@@ -153,13 +189,20 @@ DatadogAgent::DatadogAgent(
     const std::shared_ptr<TracerTelemetry>& tracer_telemetry,
     const std::shared_ptr<Logger>& logger,
     const TracerSignature& tracer_signature,
-    const std::vector<std::shared_ptr<rc::Listener>>& rc_listeners)
+    const std::vector<std::shared_ptr<rc::Listener>>& rc_listeners,
+    std::size_t shards)
     : tracer_telemetry_(tracer_telemetry),
       clock_(config.clock),
       logger_(logger),
-      traces_endpoint_(traces_endpoint(config.url)),
+      pending_(shards),
+      configured_url_(config.url),
+      url_is_default_(config.url_is_default),
+      traces_endpoint_(traces_endpoint(config.url, TraceFormat::V0_4)),
       telemetry_endpoint_(telemetry_endpoint(config.url)),
       remote_configuration_endpoint_(remote_configuration_endpoint(config.url)),
+      info_endpoint_(info_endpoint(config.url)),
+      trace_format_(TraceFormat::V0_4),
+      max_request_bytes_(default_max_request_bytes),
       http_client_(config.http_client),
       event_scheduler_(config.event_scheduler),
       flush_interval_(config.flush_interval),
@@ -214,6 +257,12 @@ DatadogAgent::DatadogAgent(
         config.remote_configuration_poll_interval,
         [this] { get_and_apply_remote_configuration_updates(); }));
   }
+
+  if (config.agent_discovery_enabled) {
+    query_agent_info();
+    tasks_.emplace_back(event_scheduler_->schedule_recurring_event(
+        config.agent_info_poll_interval, [this] { query_agent_info(); }));
+  }
 }
 
 DatadogAgent::~DatadogAgent() {
@@ -238,19 +287,39 @@ DatadogAgent::~DatadogAgent() {
 Expected<void> DatadogAgent::send(
     std::vector<std::unique_ptr<SpanData>>&& spans,
     const std::shared_ptr<TraceSampler>& response_handler) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  trace_chunks_.push_back(TraceChunk{std::move(spans), response_handler});
+  auto& pending = pending_.local();
+  std::lock_guard<Mutex> lock(pending.mutex);
+  pending.trace_chunks.push_back(
+      TraceChunk{std::move(spans), response_handler});
+  DD_TRACE_PROBE2(agent_send, pending.trace_chunks.back().spans.size(),
+                  pending.trace_chunks.size());
   return nullopt;
 }
 
+std::size_t DatadogAgent::pending_trace_chunks() {
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < pending_.size(); ++i) {
+    auto& pending = pending_[i];
+    std::lock_guard<Mutex> lock(pending.mutex);
+    count += pending.trace_chunks.size();
+  }
+  return count;
+}
+
 std::string DatadogAgent::config() const {
+  std::unique_lock<Mutex> lock(mutex_);
+  const auto traces_endpoint = traces_endpoint_;
+  const auto telemetry_endpoint = telemetry_endpoint_;
+  const auto remote_configuration_endpoint = remote_configuration_endpoint_;
+  lock.unlock();
+
   // clang-format off
   return nlohmann::json::object({
     {"type", "datadog::tracing::DatadogAgent"},
     {"config", nlohmann::json::object({
-      {"traces_url", (traces_endpoint_.scheme + "://" + traces_endpoint_.authority + traces_endpoint_.path)},
-      {"telemetry_url", (telemetry_endpoint_.scheme + "://" + telemetry_endpoint_.authority + telemetry_endpoint_.path)},
-      {"remote_configuration_url", (remote_configuration_endpoint_.scheme + "://" + remote_configuration_endpoint_.authority + remote_configuration_endpoint_.path)},
+      {"traces_url", (traces_endpoint.scheme + "://" + traces_endpoint.authority + traces_endpoint.path)},
+      {"telemetry_url", (telemetry_endpoint.scheme + "://" + telemetry_endpoint.authority + telemetry_endpoint.path)},
+      {"remote_configuration_url", (remote_configuration_endpoint.scheme + "://" + remote_configuration_endpoint.authority + remote_configuration_endpoint.path)},
       {"flush_interval_milliseconds", std::chrono::duration_cast<std::chrono::milliseconds>(flush_interval_).count() },
       {"request_timeout_milliseconds", std::chrono::duration_cast<std::chrono::milliseconds>(request_timeout_).count() },
       {"shutdown_timeout_milliseconds", std::chrono::duration_cast<std::chrono::milliseconds>(shutdown_timeout_).count() },
@@ -263,29 +332,88 @@ std::string DatadogAgent::config() const {
 
 void DatadogAgent::flush() {
   std::vector<TraceChunk> trace_chunks;
+  for (std::size_t i = 0; i < pending_.size(); ++i) {
+    auto& pending = pending_[i];
+    std::lock_guard<Mutex> lock(pending.mutex);
+    if (trace_chunks.empty()) {
+      using std::swap;
+      swap(trace_chunks, pending.trace_chunks);
+    } else {
+      std::move(pending.trace_chunks.begin(), pending.trace_chunks.end(),
+                std::back_inserter(trace_chunks));
+      pending.trace_chunks.clear();
+    }
+  }
+
+  // The trace segment has already discarded the stacks of spans that are not
+  // kept.
+  for (auto& chunk : trace_chunks) {
+    for (auto& span : chunk.spans) {
+      if (span->error_stack) {
+        span->tags.insert_or_assign("error.stack",
+                                    symbolizer_.symbolize(*span->error_stack));
+        span->error_stack.reset();
+      }
+    }
+  }
+
+  TraceSubmission submission;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    using std::swap;
-    swap(trace_chunks, trace_chunks_);
+    std::lock_guard<Mutex> lock(mutex_);
+    submission.endpoint = traces_endpoint_;
+    submission.format = trace_format_;
+    submission.max_request_bytes = max_request_bytes_;
   }
 
   if (trace_chunks.empty()) {
     return;
   }
+  DD_TRACE_PROBE1(flush_start, trace_chunks.size());
 
+  post_traces(trace_chunks.data(), trace_chunks.data() + trace_chunks.size(),
+              submission);
+}
+
+void DatadogAgent::post_traces(TraceChunk* begin, TraceChunk* end,
+                               const TraceSubmission& submission) {
+  const std::size_t chunk_count = end - begin;
   std::string body;
-  auto encode_result = msgpack_encode(body, trace_chunks);
+  auto encode_result = msgpack_encode(body, submission.format, begin, end);
   if (auto* error = encode_result.if_error()) {
     logger_->log_error(*error);
     return;
   }
 
+  if (body.size() > submission.max_request_bytes) {
+    if (chunk_count > 1) {
+      // Split the chunks in half and try again.
+      body = std::string();
+      TraceChunk* const middle = begin + chunk_count / 2;
+      post_traces(begin, middle, submission);
+      post_traces(middle, end, submission);
+      return;
+    }
+    std::string message;
+    message += "Dropping a trace chunk of ";
+    message += std::to_string(begin->spans.size());
+    message += " spans, because it is ";
+    message += std::to_string(body.size());
+    message +=
+        " bytes when encoded, which exceeds the Datadog Agent's maximum "
+        "request size of ";
+    message += std::to_string(submission.max_request_bytes);
+    message += " bytes.";
+    logger_->log_error(
+        Error{Error::DATADOG_AGENT_REQUEST_TOO_LARGE, std::move(message)});
+    return;
+  }
+
   // One HTTP request to the Agent could possibly involve trace chunks from
   // multiple tracers, and thus multiple trace samplers might need to have
   // their rates updated. Unlikely, but possible.
   std::unordered_set<std::shared_ptr<TraceSampler>> response_handlers;
-  for (auto& chunk : trace_chunks) {
-    response_handlers.insert(std::move(chunk.response_handler));
+  for (auto* chunk = begin; chunk != end; ++chunk) {
+    response_handlers.insert(std::move(chunk->response_handler));
   }
 
   // This is the callback for setting request headers.
@@ -297,7 +425,7 @@ void DatadogAgent::flush() {
                 tracer_signature_.library_language_version);
     headers.set("Datadog-Meta-Tracer-Version",
                 tracer_signature_.library_version);
-    headers.set("X-Datadog-Trace-Count", std::to_string(trace_chunks.size()));
+    headers.set("X-Datadog-Trace-Count", std::to_string(chunk_count));
   };
 
   // This is the callback for the HTTP response.  It's invoked
@@ -361,14 +489,16 @@ void DatadogAgent::flush() {
   };
 
   tracer_telemetry_->metrics().trace_api.requests.inc();
+  [[maybe_unused]] const std::size_t body_size = body.size();
   auto post_result =
-      http_client_->post(traces_endpoint_, std::move(set_request_headers),
+      http_client_->post(submission.endpoint, std::move(set_request_headers),
                          std::move(body), std::move(on_response),
                          std::move(on_error), clock_().tick + request_timeout_);
   if (auto* error = post_result.if_error()) {
     logger_->log_error(
         error->with_prefix("Unexpected error submitting traces: "));
   }
+  DD_TRACE_PROBE2(flush_end, chunk_count, body_size);
 }
 
 void DatadogAgent::send_telemetry(StringView request_type,
@@ -393,8 +523,13 @@ void DatadogAgent::send_telemetry(StringView request_type,
     }
   };
 
+  HTTPClient::URL endpoint;
+  {
+    std::lock_guard<Mutex> lock(mutex_);
+    endpoint = telemetry_endpoint_;
+  }
   auto post_result =
-      http_client_->post(telemetry_endpoint_, set_telemetry_headers,
+      http_client_->post(endpoint, set_telemetry_headers,
                          std::move(payload), telemetry_on_response_,
                          telemetry_on_error_, clock_().tick + request_timeout_);
   if (auto* error = post_result.if_error()) {
@@ -475,8 +610,13 @@ void DatadogAgent::get_and_apply_remote_configuration_updates() {
         "Error occurred during HTTP request for Remote Configuration: "));
   };
 
+  HTTPClient::URL endpoint;
+  {
+    std::lock_guard<Mutex> lock(mutex_);
+    endpoint = remote_configuration_endpoint_;
+  }
   auto post_result = http_client_->post(
-      remote_configuration_endpoint_, set_content_type_json,
+      endpoint, set_content_type_json,
       remote_config_.make_request_payload().dump(),
       remote_configuration_on_response, remote_configuration_on_error,
       clock_().tick + request_timeout_);
@@ -487,5 +627,84 @@ void DatadogAgent::get_and_apply_remote_configuration_updates() {
   }
 }
 
+void DatadogAgent::query_agent_info() {
+  HTTPClient::URL endpoint;
+  {
+    std::lock_guard<Mutex> lock(mutex_);
+    endpoint = info_endpoint_;
+  }
+
+  auto on_response = [this](int response_status,
+                            const DictReader& /*response_headers*/,
+                            std::string response_body) {
+    if (response_status == 404) {
+      // Agents older than version 7.28 don't have an "/info" endpoint.  Use
+      // the defaults.
+      apply_agent_info(AgentInfo{});
+      return;
+    }
+    if (response_status < 200 || response_status >= 300) {
+      logger_->log_error([&](auto& stream) {
+        stream << "Unexpected Datadog Agent /info response status "
+               << response_status
+               << " with body (if any, starts on next line):\n"
+               << response_body;
+      });
+      return;
+    }
+
+    auto info = parse_agent_info(response_body);
+    if (auto* error = info.if_error()) {
+      logger_->log_error(*error);
+      return;
+    }
+    apply_agent_info(*info);
+  };
+
+  // The Agent might not be running yet.  If it isn't, submitting traces will
+  // report the connection error, so it's not reported here.
+  auto on_error = [](Error) {};
+
+  auto get_result =
+      http_client_->get(endpoint, [](DictWriter&) {}, std::move(on_response),
+                        std::move(on_error), clock_().tick + request_timeout_);
+  if (auto* error = get_result.if_error()) {
+    // An `HTTPClient` that doesn't support GET requests means that the
+    // defaults are used.
+    if (error->code != Error::NOT_IMPLEMENTED) {
+      logger_->log_error(error->with_prefix(
+          "Unexpected error requesting Datadog Agent /info: "));
+    }
+  }
+}
+
+void DatadogAgent::apply_agent_info(const AgentInfo& info) {
+  // Prefer the Agent's Unix domain socket, unless the user configured a URL
+  // or the socket isn't visible to this process, e.g. because the Agent runs
+  // in another container.
+  HTTPClient::URL agent_url = configured_url_;
+  if (url_is_default_ && info.receiver_socket &&
+      is_unix_socket(*info.receiver_socket)) {
+    agent_url = HTTPClient::URL{"unix", *info.receiver_socket, ""};
+  }
+
+  const TraceFormat format = info.has_endpoint(traces_v05_api_path)
+                                 ? TraceFormat::V0_5
+                                 : TraceFormat::V0_4;
+
+  std::size_t max_request_bytes = default_max_request_bytes;
+  if (info.max_request_bytes && *info.max_request_bytes > 0) {
+    max_request_bytes = static_cast<std::size_t>(*info.max_request_bytes);
+  }
+
+  std::lock_guard<Mutex> lock(mutex_);
+  traces_endpoint_ = traces_endpoint(agent_url, format);
+  telemetry_endpoint_ = telemetry_endpoint(agent_url);
+  remote_configuration_endpoint_ = remote_configuration_endpoint(agent_url);
+  info_endpoint_ = info_endpoint(agent_url);
+  trace_format_ = format;
+  max_request_bytes_ = max_request_bytes;
+}
+
 }  // namespace tracing
 }  // namespace datadog
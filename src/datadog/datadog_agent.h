@@ -10,20 +10,25 @@
 #include <datadog/collector.h>
 #include <datadog/event_scheduler.h>
 #include <datadog/http_client.h>
+#include <datadog/mutex.h>
 #include <datadog/telemetry/metrics.h>
 #include <datadog/tracer_signature.h>
 
+#include <cstddef>
 #include <memory>
 #include <mutex>
 #include <vector>
 
 #include "config_manager.h"
 #include "remote_config/remote_config.h"
+#include "sharded.h"
+#include "stack_trace.h"
 #include "tracer_telemetry.h"
 
 namespace datadog {
 namespace tracing {
 
+struct AgentInfo;
 class FinalizedDatadogAgentConfig;
 class Logger;
 struct SpanData;
@@ -37,15 +42,45 @@ class DatadogAgent : public Collector {
     std::shared_ptr<TraceSampler> response_handler;
   };
 
+  // the versions of the Datadog Agent's traces API, which differ in payload
+  // format
+  enum class TraceFormat { V0_4, V0_5 };
+
  private:
-  std::mutex mutex_;
+  // `TraceSubmission` is a copy of the settings, guarded by `mutex_`, that
+  // are used to send traces to the Agent.
+  struct TraceSubmission {
+    HTTPClient::URL endpoint;
+    TraceFormat format;
+    std::size_t max_request_bytes;
+  };
+
+  // `PendingChunks` is the trace chunks sent by the threads of one shard (see
+  // `TracerConfig::shards`) and not yet flushed.
+  struct PendingChunks {
+    Mutex mutex{LockSite::DATADOG_AGENT_SHARD};
+    std::vector<TraceChunk> trace_chunks;
+  };
+
+  mutable Mutex mutex_{LockSite::DATADOG_AGENT};
   std::shared_ptr<TracerTelemetry> tracer_telemetry_;
   Clock clock_;
   std::shared_ptr<Logger> logger_;
-  std::vector<TraceChunk> trace_chunks_;
+  // `flush` merges the chunks of all shards.
+  Sharded<PendingChunks> pending_;
+  // `flush`, which is never called concurrently, symbolizes the error stacks
+  // captured by `Span::capture_error_stack`.
+  StackSymbolizer symbolizer_;
+  const HTTPClient::URL configured_url_;
+  const bool url_is_default_;
+  // The following depend on the Agent's response to "/info", and so are
+  // guarded by `mutex_`.
   HTTPClient::URL traces_endpoint_;
   HTTPClient::URL telemetry_endpoint_;
   HTTPClient::URL remote_configuration_endpoint_;
+  HTTPClient::URL info_endpoint_;
+  TraceFormat trace_format_;
+  std::size_t max_request_bytes_;
   std::shared_ptr<HTTPClient> http_client_;
   std::shared_ptr<EventScheduler> event_scheduler_;
   std::vector<EventScheduler::Cancel> tasks_;
@@ -60,6 +95,11 @@ class DatadogAgent : public Collector {
   TracerSignature tracer_signature_;
 
   void flush();
+  // Send the trace chunks `[begin, end)` in one or more requests, each within
+  // the size limit in the specified `submission`.
+  void post_traces(TraceChunk* begin, TraceChunk* end,
+                   const TraceSubmission& submission);
+  void apply_agent_info(const AgentInfo&);
   void send_telemetry(StringView, std::string);
   void send_heartbeat_and_telemetry();
   void send_app_closing();
@@ -69,7 +109,8 @@ class DatadogAgent : public Collector {
                const std::shared_ptr<TracerTelemetry>&,
                const std::shared_ptr<Logger>&, const TracerSignature& id,
                const std::vector<std::shared_ptr<remote_config::Listener>>&
-                   rc_listeners);
+                   rc_listeners,
+               std::size_t shards = 1);
   ~DatadogAgent();
 
   Expected<void> send(
@@ -83,6 +124,14 @@ class DatadogAgent : public Collector {
 
   void get_and_apply_remote_configuration_updates();
 
+  // Query the Datadog Agent's "/info" endpoint, and when the response arrives,
+  // choose the traces endpoint, payload format, request size limit, and
+  // connection method accordingly.
+  void query_agent_info();
+
+  // Return the number of trace chunks waiting to be sent to the Datadog Agent.
+  std::size_t pending_trace_chunks();
+
   std::string config() const override;
 };
 
@@ -30,6 +30,11 @@ Expected<DatadogAgentConfig> load_datadog_agent_env_config() {
     env_config.remote_configuration_poll_interval_seconds = *res;
   }
 
+  if (auto discovery_enabled =
+          lookup(environment::DD_TRACE_AGENT_DISCOVERY_ENABLED)) {
+    env_config.agent_discovery_enabled = !falsy(*discovery_enabled);
+  }
+
   auto env_host = lookup(environment::DD_AGENT_HOST);
   auto env_port = lookup(environment::DD_TRACE_AGENT_PORT);
 
@@ -134,6 +139,22 @@ Expected<FinalizedDatadogAgentConfig> finalize_config(
       value_or(env_config->remote_configuration_enabled,
                user_config.remote_configuration_enabled, true);
 
+  result.agent_discovery_enabled =
+      value_or(env_config->agent_discovery_enabled,
+               user_config.agent_discovery_enabled, true);
+
+  if (double info_poll_interval_seconds =
+          user_config.agent_info_poll_interval_seconds.value_or(60.0);
+      info_poll_interval_seconds > 0.0) {
+    result.agent_info_poll_interval =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::duration<double>(info_poll_interval_seconds));
+  } else {
+    return Error{Error::DATADOG_AGENT_INVALID_INFO_POLL_INTERVAL,
+                 "DatadogAgent: /info poll interval must be a positive number "
+                 "of seconds."};
+  }
+
   const auto [origin, url] =
       pick(env_config->url, user_config.url, "http://localhost:8126");
   auto parsed_url = HTTPClient::URL::parse(url);
@@ -141,6 +162,7 @@ Expected<FinalizedDatadogAgentConfig> finalize_config(
     return std::move(*error);
   }
   result.url = *parsed_url;
+  result.url_is_default = origin == ConfigMetadata::Origin::DEFAULT;
   result.metadata[ConfigName::AGENT_URL] =
       ConfigMetadata(ConfigName::AGENT_URL, url, origin);
 
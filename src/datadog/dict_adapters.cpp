@@ -0,0 +1,154 @@
+#include <datadog/dict_adapters.h>
+
+#include <cassert>
+#include <cstddef>
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+constexpr char ascii_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+// Return the 32-bit FNV-1a hash of the ASCII lower case form of the specified
+// `text`.
+std::uint32_t hash_lower(StringView text) {
+  std::uint32_t hash = 2166136261u;
+  for (const char c : text) {
+    hash ^= static_cast<unsigned char>(ascii_lower(c));
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+bool equal_ignoring_case(StringView left, StringView right) {
+  if (left.size() != right.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < left.size(); ++i) {
+    if (ascii_lower(left[i]) != ascii_lower(right[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool is_optional_whitespace(char c) { return c == ' ' || c == '\t'; }
+
+StringView trim_optional_whitespace(StringView text) {
+  while (!text.empty() && is_optional_whitespace(text.front())) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && is_optional_whitespace(text.back())) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+}  // namespace
+
+void IndexedDictReader::add(StringView key, StringView value) {
+  entries_.push_back(Entry{key, value, hash_lower(key)});
+}
+
+void IndexedDictReader::build_index() {
+  // Keep the load factor at or below one half, so that probe sequences stay
+  // short.
+  std::size_t capacity = 16;
+  while (capacity < entries_.size() * 2) {
+    capacity *= 2;
+  }
+  slots_.assign(capacity, 0);
+  const std::size_t mask = capacity - 1;
+
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < entries_.size(); ++i) {
+    const Entry entry = entries_[i];
+    std::size_t slot = entry.hash & mask;
+    for (;;) {
+      const std::uint32_t occupant = slots_[slot];
+      if (occupant == 0) {
+        entries_[kept] = entry;
+        slots_[slot] = std::uint32_t(++kept);
+        break;
+      }
+      Entry& existing = entries_[occupant - 1];
+      if (existing.hash == entry.hash &&
+          equal_ignoring_case(existing.key, entry.key)) {
+        // Repeated header. Join the values with a comma.
+        std::string joined;
+        joined.reserve(existing.value.size() + 1 + entry.value.size());
+        append(joined, existing.value);
+        joined += ',';
+        append(joined, entry.value);
+        joined_values_.push_back(std::move(joined));
+        existing.value = joined_values_.back();
+        break;
+      }
+      slot = (slot + 1) & mask;
+    }
+  }
+  entries_.resize(kept);
+}
+
+Optional<StringView> IndexedDictReader::lookup(StringView key) const {
+  assert(!slots_.empty());
+  const std::uint32_t hash = hash_lower(key);
+  const std::size_t mask = slots_.size() - 1;
+  for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+    const std::uint32_t occupant = slots_[slot];
+    if (occupant == 0) {
+      return nullopt;
+    }
+    const Entry& entry = entries_[occupant - 1];
+    if (entry.hash == hash && equal_ignoring_case(entry.key, key)) {
+      return entry.value;
+    }
+  }
+}
+
+void IndexedDictReader::visit(
+    const std::function<void(StringView key, StringView value)>& visitor)
+    const {
+  for (const Entry& entry : entries_) {
+    visitor(entry.key, entry.value);
+  }
+}
+
+HTTPHeaderBlockReader::HTTPHeaderBlockReader(StringView block) {
+  while (!block.empty()) {
+    auto end = block.find('\n');
+    StringView line = block.substr(0, end);
+    block.remove_prefix(end == StringView::npos ? block.size() : end + 1);
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    if (line.empty()) {
+      // End of the header block.
+      break;
+    }
+
+    const auto colon = line.find(':');
+    if (colon == StringView::npos || colon == 0) {
+      continue;
+    }
+    const StringView name = line.substr(0, colon);
+    bool valid_name = true;
+    for (const unsigned char c : name) {
+      if (c <= ' ' || c == 0x7F) {
+        valid_name = false;
+        break;
+      }
+    }
+    if (!valid_name) {
+      // This is a request line, a status line, or an obsolete line folding.
+      continue;
+    }
+    add(name, trim_optional_whitespace(line.substr(colon + 1)));
+  }
+  build_index();
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,459 @@
+#include "dogstatsd_client.h"
+
+#include <datadog/logger.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <locale>
+#include <sstream>
+
+#include "random.h"
+#include "string_util.h"
+
+#if defined(__APPLE__) || defined(__linux__) || defined(__unix__)
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Replace characters that are part of the DogStatsD syntax with underscores,
+// so that a metric name or tag cannot corrupt the line in which it appears.
+void append_sanitized(std::string& destination, StringView text,
+                      bool is_tag) {
+  for (const char c : text) {
+    switch (c) {
+      case '|':
+      case '#':
+      case '@':
+      case ',':
+      case '\n':
+      case '\r':
+        destination += '_';
+        break;
+      case ':':
+        // Tags are "key:value", but names may not contain a colon.
+        destination += is_tag ? c : '_';
+        break;
+      default:
+        destination += c;
+    }
+  }
+}
+
+void append_number(std::string& destination, double value) {
+  // Most values are integers, such as counts and sizes.  Format them without
+  // the overhead of a stream.
+  if (value == std::floor(value) && std::fabs(value) < 9007199254740992.0) {
+    destination += std::to_string(static_cast<std::int64_t>(value));
+    return;
+  }
+  std::ostringstream stream;
+  stream.imbue(std::locale::classic());
+  stream.precision(15);
+  stream << value;
+  destination += stream.str();
+}
+
+}  // namespace
+
+#if defined(__APPLE__) || defined(__linux__) || defined(__unix__)
+
+// `Socket` is a non-blocking datagram socket connected to the DogStatsD
+// server.  A UDP host name is resolved once, when the socket is created, so
+// that `send` never waits on DNS.  The connection is established lazily, and
+// is re-established after errors indicating that the server went away, such as
+// when the Datadog Agent restarts and recreates its Unix domain socket.  The
+// host name is resolved again only if resolution failed or the server is
+// unreachable, and then no more often than `resolve_backoff`.
+class DogStatsDClient::Socket {
+  static constexpr std::chrono::seconds resolve_backoff{30};
+
+  FinalizedDogStatsDConfig::Address address_;
+  sockaddr_storage destination_;
+  socklen_t destination_size_ = 0;
+  std::string resolve_error_;
+  std::chrono::steady_clock::time_point last_resolved_;
+  int fd_ = -1;
+
+  void close_socket() {
+    if (fd_ != -1) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  // Store the address of the server in `destination_`.  If an error occurs,
+  // store a description of the error in `resolve_error_` instead.
+  void resolve() {
+    using Kind = FinalizedDogStatsDConfig::Address::Kind;
+    last_resolved_ = std::chrono::steady_clock::now();
+    destination_size_ = 0;
+    resolve_error_.clear();
+    std::memset(&destination_, 0, sizeof destination_);
+
+    if (address_.kind == Kind::UNIX) {
+      auto& destination = reinterpret_cast<sockaddr_un&>(destination_);
+      destination.sun_family = AF_UNIX;
+      if (address_.host.size() >= sizeof destination.sun_path) {
+        resolve_error_ =
+            "Unix domain socket path is too long: " + address_.host;
+        return;
+      }
+      std::memcpy(destination.sun_path, address_.host.data(),
+                  address_.host.size());
+      destination_size_ = sizeof destination;
+      return;
+    }
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* results = nullptr;
+    if (const int rc = ::getaddrinfo(address_.host.c_str(),
+                                     address_.port.c_str(), &hints, &results);
+        rc != 0) {
+      resolve_error_ = "Unable to resolve " + address_.host + ":" +
+                       address_.port + ": " + ::gai_strerror(rc);
+      return;
+    }
+    // Datagrams need no handshake, so the first result is as good as any.
+    std::memcpy(&destination_, results->ai_addr, results->ai_addrlen);
+    destination_size_ = results->ai_addrlen;
+    ::freeaddrinfo(results);
+  }
+
+  // Resolve the server's address again if the previous attempt failed, or if
+  // `refresh` is true, but only once `resolve_backoff` has elapsed since the
+  // previous attempt.
+  void maybe_resolve(bool refresh) {
+    using Kind = FinalizedDogStatsDConfig::Address::Kind;
+    if (address_.kind == Kind::UNIX || (!refresh && resolve_error_.empty())) {
+      return;
+    }
+    if (std::chrono::steady_clock::now() - last_resolved_ >= resolve_backoff) {
+      resolve();
+    }
+  }
+
+  // Return an empty string on success, or a description of the error.
+  std::string open_socket() {
+    if (!resolve_error_.empty()) {
+      return resolve_error_;
+    }
+    fd_ = ::socket(destination_.ss_family, SOCK_DGRAM, 0);
+    if (fd_ == -1) {
+      return std::string("Unable to create socket: ") + std::strerror(errno);
+    }
+    if (::connect(fd_, reinterpret_cast<const sockaddr*>(&destination_),
+                  destination_size_) == -1) {
+      std::string error = "Unable to connect to " + address_.host;
+      if (!address_.port.empty()) {
+        error += ":" + address_.port;
+      }
+      error += ": ";
+      error += std::strerror(errno);
+      close_socket();
+      return error;
+    }
+
+    const int flags = ::fcntl(fd_, F_GETFL, 0);
+    if (flags == -1 || ::fcntl(fd_, F_SETFL, flags | O_NONBLOCK) == -1) {
+      std::string error = std::string("Unable to make socket non-blocking: ") +
+                          std::strerror(errno);
+      close_socket();
+      return error;
+    }
+    return "";
+  }
+
+ public:
+  explicit Socket(const FinalizedDogStatsDConfig::Address& address)
+      : address_(address) {
+    resolve();
+  }
+
+  ~Socket() { close_socket(); }
+
+  // Send the specified `datagram` without blocking.  Return an empty string
+  // on success, or a description of the error.
+  std::string send(StringView datagram) {
+    if (fd_ == -1) {
+      maybe_resolve(false);
+      if (auto error = open_socket(); !error.empty()) {
+        maybe_resolve(true);
+        return error;
+      }
+    }
+
+    int flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+    flags |= MSG_NOSIGNAL;
+#endif
+    if (::send(fd_, datagram.data(), datagram.size(), flags) ==
+        static_cast<ssize_t>(datagram.size())) {
+      return "";
+    }
+
+    const int error = errno;
+    if (error == EAGAIN || error == EWOULDBLOCK || error == ENOBUFS) {
+      // The socket buffer is full.  Drop the datagram rather than wait.
+      return "Socket buffer is full";
+    }
+    // The server might have gone away, or moved.  Reconnect on the next send,
+    // and look up the server's address again if it is time to.
+    close_socket();
+    maybe_resolve(true);
+    return std::string("Unable to send: ") + std::strerror(error);
+  }
+};
+
+#else
+
+class DogStatsDClient::Socket {
+ public:
+  explicit Socket(const FinalizedDogStatsDConfig::Address&) {}
+
+  std::string send(StringView) {
+    return "DogStatsD is not supported on this platform";
+  }
+};
+
+#endif
+
+DogStatsDClient::DogStatsDClient(const FinalizedDogStatsDConfig& config,
+                                 const std::shared_ptr<Logger>& logger)
+    : logger_(logger),
+      max_datagram_size_(config.max_datagram_size),
+      socket_(std::make_unique<Socket>(config.address)),
+      event_scheduler_(config.event_scheduler) {
+  for (const auto& tag : config.tags) {
+    if (!constant_tags_.empty()) {
+      constant_tags_ += ',';
+    }
+    append_sanitized(constant_tags_, tag, true);
+  }
+  datagram_.reserve(max_datagram_size_);
+
+  if (event_scheduler_) {
+    cancel_flush_ = event_scheduler_->schedule_recurring_event(
+        config.flush_interval, [this]() { flush(); });
+  }
+}
+
+DogStatsDClient::~DogStatsDClient() {
+  if (cancel_flush_) {
+    cancel_flush_();
+  }
+  flush();
+}
+
+void DogStatsDClient::count(StringView name, std::int64_t value,
+                            const Tags& tags) {
+  record(Type::COUNT, name, double(value), tags);
+}
+
+void DogStatsDClient::gauge(StringView name, double value, const Tags& tags) {
+  record(Type::GAUGE, name, value, tags);
+}
+
+void DogStatsDClient::distribution(StringView name, double value,
+                                   const Tags& tags) {
+  record(Type::DISTRIBUTION, name, value, tags);
+}
+
+void DogStatsDClient::record(Type type, StringView name, double value,
+                             const Tags& tags) {
+  if (!std::isfinite(value)) {
+    return;
+  }
+
+  std::string key;
+  key += static_cast<char>(type);
+  append_sanitized(key, name, false);
+  const std::size_t tags_begin = key.size() + 1;
+  key += '|';
+  for (std::size_t i = 0; i < tags.size(); ++i) {
+    if (i) {
+      key += ',';
+    }
+    append_sanitized(key, tags[i], true);
+  }
+
+  std::lock_guard<Mutex> lock(mutex_);
+  auto found = aggregates_.find(key);
+  if (found == aggregates_.end()) {
+    Aggregate aggregate;
+    aggregate.type = type;
+    aggregate.name = key.substr(1, tags_begin - 2);
+    aggregate.tags = key.substr(tags_begin);
+    found = aggregates_.emplace(std::move(key), std::move(aggregate)).first;
+  }
+
+  Aggregate& aggregate = found->second;
+  switch (type) {
+    case Type::COUNT:
+      aggregate.value += value;
+      break;
+    case Type::GAUGE:
+      aggregate.value = value;
+      break;
+    case Type::DISTRIBUTION:
+      // Reservoir sampling: once the reservoir is full, each value replaces
+      // a random kept value with probability (kept / observed).
+      if (aggregate.values.size() < max_distribution_values) {
+        aggregate.values.push_back(value);
+      } else if (const std::uint64_t slot =
+                     random_uint64() % (aggregate.observed + 1);
+                 slot < max_distribution_values) {
+        aggregate.values[slot] = value;
+      }
+      break;
+  }
+  ++aggregate.observed;
+}
+
+void DogStatsDClient::add_flush_hook(FlushHook hook) {
+  std::lock_guard<Mutex> lock(mutex_);
+  flush_hooks_.push_back(std::move(hook));
+}
+
+void DogStatsDClient::flush() {
+  std::lock_guard<Mutex> flush_lock(flush_mutex_);
+
+  std::vector<FlushHook> hooks;
+  {
+    std::lock_guard<Mutex> lock(mutex_);
+    hooks = flush_hooks_;
+  }
+  for (const auto& hook : hooks) {
+    hook(*this);
+  }
+
+  std::unordered_map<std::string, Aggregate> aggregates;
+  {
+    std::lock_guard<Mutex> lock(mutex_);
+    aggregates.swap(aggregates_);
+  }
+
+  for (const auto& [key, aggregate] : aggregates) {
+    (void)key;
+    append_line(aggregate);
+  }
+  send_datagram();
+}
+
+void DogStatsDClient::append_line(const Aggregate& aggregate) {
+  std::string suffix;
+  suffix += '|';
+  suffix += static_cast<char>(aggregate.type);
+  if (aggregate.type == Type::DISTRIBUTION &&
+      aggregate.observed > aggregate.values.size()) {
+    suffix += "|@";
+    append_number(suffix, double(aggregate.values.size()) /
+                              double(aggregate.observed));
+  }
+  if (!aggregate.tags.empty() || !constant_tags_.empty()) {
+    suffix += "|#";
+    suffix += aggregate.tags;
+    if (!aggregate.tags.empty() && !constant_tags_.empty()) {
+      suffix += ',';
+    }
+    suffix += constant_tags_;
+  }
+
+  std::string line = aggregate.name;
+  if (aggregate.type != Type::DISTRIBUTION) {
+    line += ':';
+    append_number(line, aggregate.value);
+    line += suffix;
+    append_to_datagram(line);
+    return;
+  }
+
+  // Pack as many of the distribution's values into each line as fit in a
+  // datagram.
+  std::string value;
+  std::size_t values_in_line = 0;
+  for (const double v : aggregate.values) {
+    value.clear();
+    value += ':';
+    append_number(value, v);
+    if (values_in_line &&
+        line.size() + value.size() + suffix.size() > max_datagram_size_) {
+      line += suffix;
+      append_to_datagram(line);
+      line = aggregate.name;
+      values_in_line = 0;
+    }
+    line += value;
+    ++values_in_line;
+  }
+  if (values_in_line) {
+    line += suffix;
+    append_to_datagram(line);
+  }
+}
+
+void DogStatsDClient::append_to_datagram(StringView line) {
+  if (line.size() > max_datagram_size_) {
+    // The line alone is too large to send.
+    ++datagrams_dropped_;
+    if (logger_) {
+      logger_->log_error([&](auto& stream) {
+        stream << "DogStatsD: Dropping metric line of " << line.size()
+               << " bytes, which exceeds the maximum datagram size of "
+               << max_datagram_size_ << " bytes.";
+      });
+    }
+    return;
+  }
+  if (!datagram_.empty() &&
+      datagram_.size() + 1 + line.size() > max_datagram_size_) {
+    send_datagram();
+  }
+  if (!datagram_.empty()) {
+    datagram_ += '\n';
+  }
+  append(datagram_, line);
+}
+
+void DogStatsDClient::send_datagram() {
+  if (datagram_.empty()) {
+    return;
+  }
+  if (auto error = socket_->send(datagram_); error.empty()) {
+    ++datagrams_sent_;
+    bytes_sent_ += datagram_.size();
+    last_send_failed_ = false;
+  } else {
+    ++datagrams_dropped_;
+    // Log only the first of a run of failures, so that an absent server does
+    // not flood the log.
+    if (!last_send_failed_ && logger_) {
+      logger_->log_error("DogStatsD: " + error);
+    }
+    last_send_failed_ = true;
+  }
+  datagram_.clear();
+}
+
+DogStatsDClient::Stats DogStatsDClient::stats() const {
+  Stats result;
+  result.datagrams_sent = datagrams_sent_;
+  result.datagrams_dropped = datagrams_dropped_;
+  result.bytes_sent = bytes_sent_;
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
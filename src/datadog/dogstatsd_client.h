@@ -0,0 +1,143 @@
+#pragma once
+
+// This component provides a class, `DogStatsDClient`, that reports metrics to
+// a DogStatsD server, such as the one embedded in the Datadog Agent.
+//
+// Metrics are aggregated in-process and sent periodically, rather than sent
+// one datagram per observation.  Between flushes:
+//
+// - counts with the same name and tags are summed,
+// - gauges with the same name and tags keep only the most recent value, and
+// - distributions with the same name and tags accumulate their values, up to a
+//   limit beyond which values are sampled.
+//
+// When flushed, the aggregated metrics are formatted as DogStatsD lines and
+// packed into as few datagrams as possible, each no larger than the configured
+// maximum datagram size.  Distributions use the multiple-value form of the
+// DogStatsD protocol, e.g. "latency:1.5:2:0.25|d|#env:prod".
+//
+// Datagrams are sent over UDP or over a Unix domain datagram socket without
+// blocking.  If the socket is not ready to accept a datagram, or if the server
+// is not listening, then the datagram is dropped.  Metrics are best-effort.
+// A UDP host name is resolved when the client is created, and thereafter only
+// periodically while the server is unreachable, so that flushes do not wait
+// on DNS.
+//
+// Flushes are driven by the `EventScheduler` in the client's configuration.
+// Before each flush, the client invokes its "flush hooks," which allow other
+// components to record gauges that are sampled rather than observed, such as
+// a queue depth.
+
+#include <datadog/dogstatsd_config.h>
+#include <datadog/event_scheduler.h>
+#include <datadog/mutex.h>
+#include <datadog/string_view.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+class Logger;
+
+class DogStatsDClient {
+ public:
+  // A list of tags, each of the form "key:value" or "key".
+  using Tags = std::vector<std::string>;
+  using FlushHook = std::function<void(DogStatsDClient&)>;
+
+  struct Stats {
+    std::uint64_t datagrams_sent = 0;
+    std::uint64_t datagrams_dropped = 0;
+    std::uint64_t bytes_sent = 0;
+  };
+
+  // The maximum number of values kept for a distribution between flushes.
+  // Beyond this, values are sampled, and the sample rate is included in the
+  // emitted line so that the server can scale its counts accordingly.
+  static constexpr std::size_t max_distribution_values = 256;
+
+ private:
+  enum class Type : char { COUNT = 'c', GAUGE = 'g', DISTRIBUTION = 'd' };
+
+  struct Aggregate {
+    Type type;
+    std::string name;
+    std::string tags;
+    double value = 0;
+    std::vector<double> values;
+    std::uint64_t observed = 0;
+  };
+
+  class Socket;
+
+  std::shared_ptr<Logger> logger_;
+  std::size_t max_datagram_size_;
+  std::string constant_tags_;
+
+  Mutex mutex_{LockSite::DOGSTATSD_CLIENT};
+  // Aggregates keyed by type, name, and tags.
+  std::unordered_map<std::string, Aggregate> aggregates_;
+  std::vector<FlushHook> flush_hooks_;
+
+  // Flushes are serialized by `flush_mutex_`, so that the socket and
+  // `datagram_` need no further synchronization.
+  Mutex flush_mutex_{LockSite::DOGSTATSD_CLIENT_FLUSH};
+  std::unique_ptr<Socket> socket_;
+  std::string datagram_;
+  bool last_send_failed_ = false;
+  std::atomic<std::uint64_t> datagrams_sent_{0};
+  std::atomic<std::uint64_t> datagrams_dropped_{0};
+  std::atomic<std::uint64_t> bytes_sent_{0};
+
+  std::shared_ptr<EventScheduler> event_scheduler_;
+  EventScheduler::Cancel cancel_flush_;
+
+  void record(Type type, StringView name, double value, const Tags& tags);
+  void append_line(const Aggregate&);
+  void append_to_datagram(StringView line);
+  void send_datagram();
+
+ public:
+  // Create a client that sends to the address in the specified `config`, and
+  // that schedules flushes on the `config.event_scheduler`, if any.  Errors
+  // are reported to the specified `logger`.
+  DogStatsDClient(const FinalizedDogStatsDConfig& config,
+                  const std::shared_ptr<Logger>& logger);
+  // Cancel the scheduled flush and then flush any remaining metrics.
+  ~DogStatsDClient();
+
+  DogStatsDClient(const DogStatsDClient&) = delete;
+  DogStatsDClient& operator=(const DogStatsDClient&) = delete;
+
+  // Add the specified `value` to the count having the specified `name` and
+  // `tags`.
+  void count(StringView name, std::int64_t value, const Tags& tags = {});
+  // Set the gauge having the specified `name` and `tags` to the specified
+  // `value`.
+  void gauge(StringView name, double value, const Tags& tags = {});
+  // Add the specified `value` to the distribution having the specified `name`
+  // and `tags`.
+  void distribution(StringView name, double value, const Tags& tags = {});
+
+  // Register the specified `hook` to be invoked at the beginning of each
+  // flush.
+  void add_flush_hook(FlushHook hook);
+
+  // Invoke the flush hooks, and then send all metrics aggregated since the
+  // previous flush.
+  void flush();
+
+  Stats stats() const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
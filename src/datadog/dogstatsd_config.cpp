@@ -0,0 +1,170 @@
+#include <datadog/dogstatsd_config.h>
+#include <datadog/environment.h>
+#include <datadog/error.h>
+
+#include <chrono>
+
+#include "parse_util.h"
+#include "string_util.h"
+#include "threaded_event_scheduler.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+constexpr StringView k_scheme_separator = "://";
+constexpr StringView k_default_port = "8125";
+
+// The default maximum datagram size for UDP is chosen so that a datagram,
+// together with its IPv4 and UDP headers, fits in an Ethernet frame.  Unix
+// domain sockets are not subject to the network MTU.
+constexpr std::size_t k_default_udp_datagram_size = 1432;
+constexpr std::size_t k_default_unix_datagram_size = 8192;
+
+// DogStatsD lines are at least a few bytes long, e.g. "a:1|c".  Reject sizes
+// that could not hold a useful metric.
+constexpr std::size_t k_minimum_datagram_size = 64;
+
+Expected<DogStatsDConfig> load_dogstatsd_env_config() {
+  DogStatsDConfig env_config;
+
+  if (auto enabled_env = lookup(environment::DD_RUNTIME_METRICS_ENABLED)) {
+    env_config.enabled = !falsy(*enabled_env);
+  }
+
+  auto env_host = lookup(environment::DD_AGENT_HOST);
+  auto env_port = lookup(environment::DD_DOGSTATSD_PORT);
+
+  if (auto url_env = lookup(environment::DD_DOGSTATSD_URL)) {
+    env_config.url = std::string{*url_env};
+  } else if (env_host || env_port) {
+    std::string configured_url = "udp://";
+    append(configured_url, env_host.value_or("localhost"));
+    configured_url += ':';
+    append(configured_url, env_port.value_or(k_default_port));
+
+    env_config.url = std::move(configured_url);
+  }
+
+  return env_config;
+}
+
+}  // namespace
+
+Expected<FinalizedDogStatsDConfig::Address>
+FinalizedDogStatsDConfig::Address::parse(StringView url) {
+  const auto after_scheme = url.find(k_scheme_separator);
+  if (after_scheme == StringView::npos) {
+    std::string message;
+    message += "DogStatsD URL is missing the \"://\" separator: \"";
+    append(message, url);
+    message += '\"';
+    return Error{Error::URL_MISSING_SEPARATOR, std::move(message)};
+  }
+
+  const StringView scheme = url.substr(0, after_scheme);
+  const StringView rest = url.substr(after_scheme + k_scheme_separator.size());
+
+  if (scheme == "unix") {
+    if (rest.empty() || rest[0] != '/') {
+      std::string message;
+      message +=
+          "Unix domain socket paths for DogStatsD must be absolute, i.e. must "
+          "begin with a \"/\". Error occurred for URL: \"";
+      append(message, url);
+      message += '\"';
+      return Error{Error::URL_UNIX_DOMAIN_SOCKET_PATH_NOT_ABSOLUTE,
+                   std::move(message)};
+    }
+    return Address{Kind::UNIX, std::string(rest), ""};
+  }
+
+  if (scheme != "udp") {
+    std::string message;
+    message += "Unsupported URI scheme \"";
+    append(message, scheme);
+    message += "\" in DogStatsD URL \"";
+    append(message, url);
+    message += "\". The following are supported: udp unix";
+    return Error{Error::URL_UNSUPPORTED_SCHEME, std::move(message)};
+  }
+
+  // The authority is "host", "host:port", "[IPv6]", or "[IPv6]:port".
+  StringView authority = rest.substr(0, rest.find('/'));
+  StringView host = authority;
+  StringView port = k_default_port;
+  if (!authority.empty() && authority[0] == '[') {
+    const auto close = authority.find(']');
+    host = authority.substr(1, close == StringView::npos ? close : close - 1);
+    if (close != StringView::npos && close + 1 < authority.size() &&
+        authority[close + 1] == ':') {
+      port = authority.substr(close + 2);
+    }
+  } else if (const auto colon = authority.rfind(':');
+             colon != StringView::npos) {
+    host = authority.substr(0, colon);
+    port = authority.substr(colon + 1);
+  }
+
+  return Address{Kind::UDP, std::string(host), std::string(port)};
+}
+
+Expected<FinalizedDogStatsDConfig> finalize_config(
+    const DogStatsDConfig& user_config) {
+  Expected<DogStatsDConfig> env_config = load_dogstatsd_env_config();
+  if (auto error = env_config.if_error()) {
+    return *error;
+  }
+
+  FinalizedDogStatsDConfig result;
+
+  result.enabled = value_or(env_config->enabled, user_config.enabled, false);
+
+  const auto url =
+      value_or(env_config->url, user_config.url, "udp://localhost:8125");
+  auto address = FinalizedDogStatsDConfig::Address::parse(url);
+  if (auto* error = address.if_error()) {
+    return std::move(*error);
+  }
+  result.address = std::move(*address);
+
+  if (auto flush_interval_milliseconds =
+          value_or(env_config->flush_interval_milliseconds,
+                   user_config.flush_interval_milliseconds, 10000);
+      flush_interval_milliseconds > 0) {
+    result.flush_interval =
+        std::chrono::milliseconds(flush_interval_milliseconds);
+  } else {
+    return Error{Error::DOGSTATSD_INVALID_FLUSH_INTERVAL,
+                 "DogStatsD: Flush interval must be a positive number of "
+                 "milliseconds."};
+  }
+
+  const std::size_t default_datagram_size =
+      result.address.kind == FinalizedDogStatsDConfig::Address::Kind::UNIX
+          ? k_default_unix_datagram_size
+          : k_default_udp_datagram_size;
+  result.max_datagram_size =
+      value_or(env_config->max_datagram_size, user_config.max_datagram_size,
+               default_datagram_size);
+  if (result.max_datagram_size < k_minimum_datagram_size) {
+    std::string message;
+    message += "DogStatsD: Maximum datagram size must be at least ";
+    message += std::to_string(k_minimum_datagram_size);
+    message += " bytes.";
+    return Error{Error::DOGSTATSD_INVALID_MAX_DATAGRAM_SIZE,
+                 std::move(message)};
+  }
+
+  // Don't start a thread unless metrics are going to be reported.
+  if (user_config.event_scheduler) {
+    result.event_scheduler = user_config.event_scheduler;
+  } else if (result.enabled) {
+    result.event_scheduler = std::make_shared<ThreadedEventScheduler>();
+  }
+
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
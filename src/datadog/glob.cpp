@@ -1,17 +1,155 @@
 #include "glob.h"
 
+#include <datadog/optional.h>
+
+#include <algorithm>
 #include <cctype>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 namespace datadog {
 namespace tracing {
+namespace {
 
-bool glob_match(StringView pattern, StringView subject) {
-  // This is a backtracking implementation of the glob matching algorithm.
-  // The glob pattern language supports `*` and `?`, but no escape sequences.
+using Word = std::uint64_t;
+constexpr std::size_t word_bits = 64;
+
+// `NoSteps` is a step counter that counts nothing, so that `glob_match`
+// without a counter pays nothing for counting.
+struct NoSteps {
+  NoSteps& operator+=(std::size_t) { return *this; }
+};
+
+unsigned char fold_case(char c) {
+  return static_cast<unsigned char>(
+      std::tolower(static_cast<unsigned char>(c)));
+}
+
+// This is a bit-parallel simulation of the nondeterministic finite automaton
+// of the pattern (the "Shift-And" algorithm, extended with self-loops for
+// `*`).
+//
+// After runs of `*` are collapsed into one, the pattern is a sequence of
+// `m` elements.  The automaton has a state for each prefix of the pattern, and
+// bit `i` of the state set is set when the subject consumed so far matches
+// the first `i` elements of the pattern.  For each character of the subject,
+// every state whose next element is `?` or that character advances by one,
+// and every state whose next element is `*` also stays where it is.  A state
+// whose next element is `*` also implies the state after the `*`, which
+// matches the `*` with the empty string.  The subject matches if the state
+// set finally contains state `m`.
+//
+// The state set is stored in `words` machine words, so that each character of
+// the subject costs `O(words)`, regardless of how many `*` the pattern has.
+template <typename Steps>
+bool automaton_match(StringView pattern, StringView subject, Steps& steps) {
+  // Runs of `*` are collapsed into one, which doesn't change the language,
+  // so that a `*` is never followed by another.  Each distinct (case folded)
+  // literal character of the pattern is assigned a class, starting at 1.
+  // Class 0 is for characters that don't appear in the pattern.  There are at
+  // most 255 classes, since `*` and `?` are not literals.
   //
-  // Based off of a Go example in <https://research.swtch.com/glob> accessed
-  // February 3, 2022.
+  // The number of elements in the collapsed pattern is at most the length of
+  // the pattern, which determines the number of words in each bit set.
+  const std::size_t words = (pattern.size() + word_bits) / word_bits;
+
+  // `storage` holds, in this order, `words` words for each of: the mask of
+  // `?` elements, the mask of `*` elements, the current state set, the next
+  // state set, and the mask of each class.  Bit `i` of a mask is set if
+  // element `i` of the pattern is the corresponding character or wildcard.
+  std::uint8_t class_of[256] = {};
+  std::size_t classes = 1;
+  const std::size_t max_storage_size =
+      (4 + 1 + std::min<std::size_t>(pattern.size(), 255)) * words;
+  Word local[512];
+  std::vector<Word> heap;
+  Word* storage = local;
+  if (max_storage_size > sizeof local / sizeof local[0]) {
+    heap.resize(max_storage_size);
+    storage = heap.data();
+  }
+  // Class 0 matches no literal, and the other classes are cleared as they're
+  // assigned.
+  std::fill(storage, storage + 5 * words, Word(0));
+  steps += 5 * words;
+
+  Word* const question = storage;
+  Word* const star = question + words;
+  Word* state = star + words;
+  Word* next = state + words;
+  Word* const masks = next + words;
+
+  steps += pattern.size();
+  std::size_t m = 0;
+  for (std::size_t i = 0; i < pattern.size(); ++i) {
+    const char c = pattern[i];
+    if (c == '*' && i != 0 && pattern[i - 1] == '*') {
+      continue;
+    }
+    const Word bit = Word(1) << (m % word_bits);
+    const std::size_t word = m / word_bits;
+    ++m;
+    if (c == '*') {
+      star[word] |= bit;
+    } else if (c == '?') {
+      question[word] |= bit;
+    } else {
+      std::uint8_t& cls = class_of[fold_case(c)];
+      if (cls == 0) {
+        cls = std::uint8_t(classes++);
+        std::fill(masks + cls * words, masks + (cls + 1) * words, Word(0));
+        steps += words;
+      }
+      masks[cls * words + word] |= bit;
+    }
+  }
+
+  // Add to `states` the states implied by `*` matching the empty string.
+  // Since a `*` is never followed by another, one shift suffices.
+  const auto close = [&](Word* states) {
+    Word carry = 0;
+    for (std::size_t w = 0; w < words; ++w) {
+      const Word stars = states[w] & star[w];
+      states[w] |= (stars << 1) | carry;
+      carry = stars >> (word_bits - 1);
+    }
+  };
 
+  state[0] = 1;
+  close(state);
+
+  for (const char c : subject) {
+    steps += 2 * words;
+    const Word* const mask = masks + class_of[fold_case(c)] * words;
+    Word carry = 0;
+    Word any = 0;
+    for (std::size_t w = 0; w < words; ++w) {
+      const Word advancing = state[w] & (mask[w] | question[w]);
+      next[w] = (advancing << 1) | carry | (state[w] & star[w]);
+      carry = advancing >> (word_bits - 1);
+      any |= next[w];
+    }
+    if (any == 0) {
+      return false;
+    }
+    close(next);
+    std::swap(state, next);
+  }
+
+  return (state[m / word_bits] >> (m % word_bits)) & 1;
+}
+
+// This is a backtracking implementation of the glob matching algorithm.
+// It's fast for the patterns and subjects typically seen, but in the worst
+// case takes time proportional to the product of their lengths.  So, it gives
+// up, returning `nullopt`, after the specified `budget` of steps.
+//
+// Based off of a Go example in <https://research.swtch.com/glob> accessed
+// February 3, 2022.
+template <typename Steps>
+Optional<bool> backtracking_match(StringView pattern, StringView subject,
+                                  std::size_t budget, Steps& steps) {
   using Index = std::size_t;
   Index p = 0;       // [p]attern index
   Index s = 0;       // [s]ubject index
@@ -21,7 +159,12 @@ bool glob_match(StringView pattern, StringView subject) {
   const size_t p_size = pattern.size();
   const size_t s_size = subject.size();
 
-  while (p < p_size || s < s_size) {
+  std::size_t taken = 0;
+  for (; p < p_size || s < s_size; ++taken) {
+    if (taken == budget) {
+      steps += taken;
+      return nullopt;
+    }
     if (p < p_size) {
       const char pattern_char = pattern[p];
       switch (pattern_char) {
@@ -40,7 +183,7 @@ bool glob_match(StringView pattern, StringView subject) {
           }
           break;
         default:
-          if (s < s_size && tolower(subject[s]) == tolower(pattern_char)) {
+          if (s < s_size && fold_case(subject[s]) == fold_case(pattern_char)) {
             ++p;
             ++s;
             continue;
@@ -53,10 +196,36 @@ bool glob_match(StringView pattern, StringView subject) {
       s = next_s;
       continue;
     }
+    steps += taken;
     return false;
   }
+  steps += taken;
   return true;
 }
 
+template <typename Steps>
+bool match(StringView pattern, StringView subject, Steps& steps) {
+  // Backtracking is cheaper to set up, and so faster for most inputs.  A
+  // match that doesn't backtrack takes at most `pattern.size() +
+  // subject.size()` steps.  If backtracking takes much longer than that, then
+  // the automaton finishes the job in linear time.
+  const std::size_t budget = 2 * (pattern.size() + subject.size()) + 64;
+  if (const auto result = backtracking_match(pattern, subject, budget, steps)) {
+    return *result;
+  }
+  return automaton_match(pattern, subject, steps);
+}
+
+}  // namespace
+
+bool glob_match(StringView pattern, StringView subject) {
+  NoSteps steps;
+  return match(pattern, subject, steps);
+}
+
+bool glob_match(StringView pattern, StringView subject, std::size_t& steps) {
+  return match(pattern, subject, steps);
+}
+
 }  // namespace tracing
 }  // namespace datadog
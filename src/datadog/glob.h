@@ -8,11 +8,24 @@
 // - "?" matches exactly one instance of any character.
 // - Other characters match exactly one instance of themselves.
 //
+// Matching is case-insensitive.
+//
 // The patterns are here called "glob patterns," though they are different from
 // the patterns used in Unix shells.
+//
+// Subjects often come from outside of the process, e.g. URLs in span tags
+// matched by sampling rules, and so matching must not be exploitable.
+// `glob_match` first tries a backtracking matcher, which is fastest for
+// typical inputs.  If that takes more than a small multiple of the length of
+// the inputs, then it switches to simulating the pattern's automaton, whose
+// cost is proportional to (pattern length + subject length) * (pattern length
+// / 64 + 1).  So, matching is linear in the length of the subject, and linear
+// overall for patterns of fewer than 64 characters.
 
 #include <datadog/string_view.h>
 
+#include <cstddef>
+
 namespace datadog {
 namespace tracing {
 
@@ -21,5 +34,12 @@ namespace tracing {
 // glob `pattern`.
 bool glob_match(StringView pattern, StringView subject);
 
+// Return whether the specified `subject` matches the specified glob `pattern`,
+// and add to the specified `steps` the number of 64-bit word operations that
+// the match performed.  The number of steps is at most
+// 2 * (pattern length + subject length + 131) * (pattern length / 64 + 2).
+// This overload is for tests and fuzzers that check the bound.
+bool glob_match(StringView pattern, StringView subject, std::size_t& steps);
+
 }  // namespace tracing
 }  // namespace datadog
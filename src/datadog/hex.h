@@ -49,5 +49,21 @@ std::string hex_padded(UnsignedInteger value) {
   return padded;
 }
 
+// Write the specified unsigned `value` as lower-case hexadecimal digits with
+// leading zeroes, as `hex_padded` would, starting at the specified `out`.
+// Return the end of the written characters.
+template <typename UnsignedInteger>
+char* write_hex_padded(char* out, UnsignedInteger value) {
+  static_assert(!std::numeric_limits<UnsignedInteger>::is_signed);
+
+  // 4 bits per hex digit char.
+  constexpr int num_digits = std::numeric_limits<UnsignedInteger>::digits / 4;
+  for (int i = num_digits - 1; i >= 0; --i) {
+    out[i] = "0123456789abcdef"[value & 0xf];
+    value >>= 4;
+  }
+  return out + num_digits;
+}
+
 }  // namespace tracing
 }  // namespace datadog
\ No newline at end of file
@@ -78,5 +78,12 @@ Expected<HTTPClient::URL> HTTPClient::URL::parse(StringView input) {
           : std::string(authority_and_path.substr(after_authority))};
 }
 
+Expected<void> HTTPClient::get(const URL&, HeadersSetter, ResponseHandler,
+                               ErrorHandler,
+                               std::chrono::steady_clock::time_point) {
+  return Error{Error::NOT_IMPLEMENTED,
+               "This HTTP client does not support GET requests."};
+}
+
 }  // namespace tracing
 }  // namespace datadog
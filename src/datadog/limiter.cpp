@@ -32,6 +32,16 @@ Limiter::Limiter(const Clock& clock, double allowed_per_second)
     : Limiter(clock, int(std::ceil(allowed_per_second)), allowed_per_second,
               1) {}
 
+void Limiter::set_allowed_per_second(double allowed_per_second) {
+  max_tokens_ = int(std::ceil(allowed_per_second));
+  tokens_per_refresh_ = 1;
+  refresh_interval_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::seconds(1)) /
+      allowed_per_second);
+  num_tokens_ = std::min(num_tokens_, max_tokens_);
+}
+
 Limiter::Result Limiter::allow() { return allow(1); }
 
 Limiter::Result Limiter::allow(int tokens_requested) {
@@ -30,6 +30,11 @@ class Limiter {
   Result allow();
   Result allow(int tokens);
 
+  // Change the rate of this limiter to the specified `allowed_per_second`, as
+  // if it had been constructed with it, but keep the tokens that it has, up
+  // to the new maximum, and its effective rate history.
+  void set_allowed_per_second(double allowed_per_second);
+
  private:
   Clock clock_;
   int num_tokens_;
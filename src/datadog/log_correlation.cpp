@@ -0,0 +1,128 @@
+#include <datadog/log_correlation.h>
+
+#include <charconv>
+#include <iterator>
+#include <string>
+
+#include "hex.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Append to the specified `destination` the specified `text` as the contents
+// of a JSON string, escaping characters as necessary.
+void append_json_escaped(std::string& destination, StringView text) {
+  for (const char ch : text) {
+    switch (ch) {
+      case '"':
+        destination += "\\\"";
+        break;
+      case '\\':
+        destination += "\\\\";
+        break;
+      case '\b':
+        destination += "\\b";
+        break;
+      case '\f':
+        destination += "\\f";
+        break;
+      case '\n':
+        destination += "\\n";
+        break;
+      case '\r':
+        destination += "\\r";
+        break;
+      case '\t':
+        destination += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(ch) < 0x20) {
+          destination += "\\u00";
+          destination += hex_padded(static_cast<std::uint8_t>(ch));
+        } else {
+          destination += ch;
+        }
+    }
+  }
+}
+
+// Append to the specified `destination` the specified `text` as a value in a
+// key=value pair, enclosing it in double quotes if necessary.
+void append_key_value_escaped(std::string& destination, StringView text) {
+  if (!text.empty() && text.find_first_of(" \"=\t\r\n") == StringView::npos) {
+    append(destination, text);
+    return;
+  }
+  destination += '"';
+  for (const char ch : text) {
+    if (ch == '"' || ch == '\\') {
+      destination += '\\';
+    }
+    destination += ch;
+  }
+  destination += '"';
+}
+
+// Append to the specified `destination` a field having the specified `key`
+// and `value` in the specified `format`.  Separate the field from the previous
+// one unless `first` is true.
+void append_field(std::string& destination, LogCorrelationFormat format,
+                  bool first, StringView key, StringView value) {
+  switch (format) {
+    case LogCorrelationFormat::JSON:
+      if (!first) {
+        destination += ',';
+      }
+      destination += '"';
+      append(destination, key);
+      destination += "\":\"";
+      append_json_escaped(destination, value);
+      destination += '"';
+      break;
+    case LogCorrelationFormat::KEY_VALUE:
+      if (!first) {
+        destination += ' ';
+      }
+      append(destination, key);
+      destination += '=';
+      append_key_value_escaped(destination, value);
+      break;
+  }
+}
+
+}  // namespace
+
+void append_log_correlation(std::string& destination,
+                            LogCorrelationFormat format, TraceID trace_id,
+                            std::uint64_t span_id, StringView service,
+                            Optional<StringView> environment,
+                            Optional<StringView> version) {
+  // Fields are separated from each other, but not from whatever precedes
+  // them in `destination`.  Integers are formatted on the stack, so that
+  // nothing is allocated if `destination` has room.
+  char buffer[32];
+  StringView trace_id_text;
+  if (trace_id.high) {
+    char* end = write_hex_padded(buffer, trace_id.high);
+    end = write_hex_padded(end, trace_id.low);
+    trace_id_text = StringView(buffer, end - buffer);
+  } else {
+    const auto result = std::to_chars(buffer, std::end(buffer), trace_id.low);
+    trace_id_text = StringView(buffer, result.ptr - buffer);
+  }
+  append_field(destination, format, true, "dd.trace_id", trace_id_text);
+  const auto result = std::to_chars(buffer, std::end(buffer), span_id);
+  append_field(destination, format, false, "dd.span_id",
+               StringView(buffer, result.ptr - buffer));
+  append_field(destination, format, false, "dd.service", service);
+  if (environment) {
+    append_field(destination, format, false, "dd.env", *environment);
+  }
+  if (version) {
+    append_field(destination, format, false, "dd.version", *version);
+  }
+}
+
+}  // namespace tracing
+}  // namespace datadog
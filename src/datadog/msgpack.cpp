@@ -7,6 +7,8 @@
 #include <limits>
 #include <type_traits>
 
+#include "utf8.h"
+
 namespace datadog {
 namespace tracing {
 namespace msgpack {
@@ -18,6 +20,7 @@ constexpr auto DOUBLE = std::byte(0xCB);
 constexpr auto INT64 = std::byte(0xD3);
 constexpr auto MAP32 = std::byte(0xDF);
 constexpr auto STR32 = std::byte(0xDB);
+constexpr auto UINT32 = std::byte(0xCE);
 constexpr auto UINT64 = std::byte(0xCF);
 }  // namespace types
 
@@ -70,6 +73,11 @@ void pack_integer(std::string& buffer, std::uint64_t value) {
   push_number_big_endian(buffer, static_cast<std::uint64_t>(value));
 }
 
+void pack_integer(std::string& buffer, std::uint32_t value) {
+  buffer.push_back(static_cast<char>(types::UINT32));
+  push_number_big_endian(buffer, value);
+}
+
 void pack_double(std::string& buffer, double value) {
   buffer.push_back(static_cast<char>(types::DOUBLE));
 
@@ -101,9 +109,30 @@ Expected<void> pack_string(std::string& buffer, const char* begin,
     return Error{Error::MESSAGEPACK_ENCODE_FAILURE,
                  make_overflow_message("string", size, max)};
   }
+
+  const StringView value{begin, size};
   buffer.push_back(static_cast<char>(types::STR32));
-  push_number_big_endian(buffer, static_cast<std::uint32_t>(size));
-  buffer.append(begin, size);
+  if (is_valid_utf8(value)) {
+    push_number_big_endian(buffer, static_cast<std::uint32_t>(size));
+    buffer.append(begin, size);
+    return {};
+  }
+
+  // Replace the invalid UTF-8 sequences, which the agent would reject, and
+  // then go back and write the length.
+  const std::size_t length_offset = buffer.size();
+  push_number_big_endian(buffer, std::uint32_t(0));
+  append_sanitized_utf8(buffer, value);
+  const std::size_t sanitized_size = buffer.size() - length_offset - 4;
+  if (sanitized_size > max) {
+    buffer.resize(length_offset - 1);
+    return Error{Error::MESSAGEPACK_ENCODE_FAILURE,
+                 make_overflow_message("string", sanitized_size, max)};
+  }
+  for (std::size_t i = 0; i < 4; ++i) {
+    buffer[length_offset + i] =
+        static_cast<char>((sanitized_size >> (CHAR_BIT * (3 - i))) & 0xFF);
+  }
   return {};
 }
 
@@ -26,9 +26,14 @@ namespace msgpack {
 void pack_integer(std::string& buffer, std::int64_t value);
 void pack_integer(std::string& buffer, std::uint64_t value);
 void pack_integer(std::string& buffer, std::int32_t value);
+void pack_integer(std::string& buffer, std::uint32_t value);
 
 void pack_double(std::string& buffer, double value);
 
+// Append to the specified `buffer` a MessagePack encoded string having the
+// specified `value`.  MessagePack strings are UTF-8, so any part of `value`
+// that is not valid UTF-8 is replaced by U+FFFD REPLACEMENT CHARACTER.  See
+// `utf8.h`.
 Expected<void> pack_string(std::string& buffer, StringView value);
 Expected<void> pack_string(std::string& buffer, const char* begin,
                            std::size_t size);
@@ -0,0 +1,281 @@
+#include <datadog/mutex.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <initializer_list>
+#include <utility>
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+#ifdef DD_TRACE_PROFILE_LOCKS
+
+using AtomicHistogram =
+    std::array<std::atomic<std::uint64_t>, lock_histogram_buckets>;
+
+// `SiteCounters` is the counts for one `LockSite`.  They're updated
+// concurrently by the threads that acquire mutexes of the site, and so are
+// atomic.
+struct SiteCounters {
+  std::atomic<std::uint64_t> acquisitions{0};
+  std::atomic<std::uint64_t> contended_acquisitions{0};
+  std::atomic<std::uint64_t> wait_nanoseconds{0};
+  std::atomic<std::uint64_t> hold_nanoseconds{0};
+  AtomicHistogram wait_histogram{};
+  AtomicHistogram hold_histogram{};
+};
+
+std::array<SiteCounters, lock_site_count> site_counters;
+
+SiteCounters& counters(LockSite site) {
+  return site_counters[std::size_t(site)];
+}
+
+std::size_t histogram_bucket(std::uint64_t nanoseconds) {
+  std::size_t bucket = 0;
+  while (nanoseconds > 1 && bucket < lock_histogram_buckets - 1) {
+    nanoseconds >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+void record(std::atomic<std::uint64_t>& total, AtomicHistogram& histogram,
+            std::chrono::steady_clock::duration elapsed) {
+  const auto nanoseconds = std::uint64_t(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  total.fetch_add(nanoseconds, std::memory_order_relaxed);
+  histogram[histogram_bucket(nanoseconds)].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+#endif
+
+// Return the approximate `quantile` (e.g. 0.99) of the durations counted in
+// the specified `histogram`, i.e. the upper bound of the bucket that contains
+// the quantile.
+std::uint64_t histogram_quantile(
+    const std::array<std::uint64_t, lock_histogram_buckets>& histogram,
+    std::uint64_t count, double quantile) {
+  const auto rank = std::uint64_t(double(count) * quantile);
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < histogram.size(); ++i) {
+    seen += histogram[i];
+    if (seen > rank) {
+      return std::uint64_t(1) << (i + 1);
+    }
+  }
+  return std::uint64_t(1) << histogram.size();
+}
+
+// Append to the specified `destination` the specified `nanoseconds`, in the
+// largest unit in which it's at least one.
+void append_duration(std::string& destination, std::uint64_t nanoseconds) {
+  char buffer[32];
+  if (nanoseconds < 1000) {
+    std::snprintf(buffer, sizeof buffer, "%lluns",
+                  static_cast<unsigned long long>(nanoseconds));
+  } else if (nanoseconds < 1000 * 1000) {
+    std::snprintf(buffer, sizeof buffer, "%.1fus", nanoseconds / 1e3);
+  } else if (nanoseconds < 1000 * 1000 * 1000) {
+    std::snprintf(buffer, sizeof buffer, "%.1fms", nanoseconds / 1e6);
+  } else {
+    std::snprintf(buffer, sizeof buffer, "%.1fs", nanoseconds / 1e9);
+  }
+  destination += buffer;
+}
+
+// Append to the specified `destination` the specified `text`, padded with
+// spaces on the left to the specified `width`.
+void append_column(std::string& destination, const std::string& text,
+                   std::size_t width) {
+  if (text.size() < width) {
+    destination.append(width - text.size(), ' ');
+  }
+  destination += text;
+}
+
+}  // namespace
+
+StringView to_string_view(LockSite site) {
+  switch (site) {
+    case LockSite::CERR_LOGGER:
+      return "CerrLogger::mutex_";
+    case LockSite::CONFIG_MANAGER:
+      return "ConfigManager::mutex_";
+    case LockSite::CURL:
+      return "CurlImpl::mutex_";
+    case LockSite::DATADOG_AGENT:
+      return "DatadogAgent::mutex_";
+    case LockSite::DATADOG_AGENT_SHARD:
+      return "DatadogAgent::PendingChunks::mutex";
+    case LockSite::DOGSTATSD_CLIENT:
+      return "DogStatsDClient::mutex_";
+    case LockSite::DOGSTATSD_CLIENT_FLUSH:
+      return "DogStatsDClient::flush_mutex_";
+    case LockSite::EVENT_SCHEDULER:
+      return "ThreadedEventScheduler::mutex_";
+    case LockSite::RESOURCE_QUANTIZER:
+      return "ResourceQuantizer::mutex_";
+    case LockSite::SPAN_SAMPLER_LIMITER:
+      return "SpanSampler::SynchronizedLimiter::mutex";
+    case LockSite::TRACE_CAPTURE:
+      return "TraceCapture::mutex_";
+    case LockSite::TRACE_SAMPLER:
+      return "TraceSampler::mutex_";
+    case LockSite::TRACE_SAMPLER_SHARD:
+      return "TraceSampler::Shard::mutex";
+    default:
+      assert(site == LockSite::TRACE_SEGMENT);
+      return "TraceSegment::mutex_";
+  }
+}
+
+#ifdef DD_TRACE_PROFILE_LOCKS
+
+void Mutex::lock() {
+  SiteCounters& site = counters(site_);
+  if (!mutex_.try_lock()) {
+    const auto before = std::chrono::steady_clock::now();
+    mutex_.lock();
+    acquired_ = std::chrono::steady_clock::now();
+    site.contended_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    record(site.wait_nanoseconds, site.wait_histogram, acquired_ - before);
+  } else {
+    acquired_ = std::chrono::steady_clock::now();
+    site.wait_histogram[0].fetch_add(1, std::memory_order_relaxed);
+  }
+  site.acquisitions.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool Mutex::try_lock() {
+  if (!mutex_.try_lock()) {
+    return false;
+  }
+  acquired_ = std::chrono::steady_clock::now();
+  SiteCounters& site = counters(site_);
+  site.wait_histogram[0].fetch_add(1, std::memory_order_relaxed);
+  site.acquisitions.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+void Mutex::unlock() {
+  const auto held = std::chrono::steady_clock::now() - acquired_;
+  mutex_.unlock();
+  SiteCounters& site = counters(site_);
+  record(site.hold_nanoseconds, site.hold_histogram, held);
+}
+
+bool lock_profiling_enabled() { return true; }
+
+std::vector<LockSiteProfile> lock_profile() {
+  std::vector<LockSiteProfile> result;
+  for (std::size_t i = 0; i < lock_site_count; ++i) {
+    const SiteCounters& site = site_counters[i];
+    LockSiteProfile profile;
+    profile.site = LockSite(i);
+    profile.acquisitions = site.acquisitions.load(std::memory_order_relaxed);
+    if (profile.acquisitions == 0) {
+      continue;
+    }
+    profile.contended_acquisitions =
+        site.contended_acquisitions.load(std::memory_order_relaxed);
+    profile.wait_nanoseconds =
+        site.wait_nanoseconds.load(std::memory_order_relaxed);
+    profile.hold_nanoseconds =
+        site.hold_nanoseconds.load(std::memory_order_relaxed);
+    for (std::size_t j = 0; j < lock_histogram_buckets; ++j) {
+      profile.wait_histogram[j] =
+          site.wait_histogram[j].load(std::memory_order_relaxed);
+      profile.hold_histogram[j] =
+          site.hold_histogram[j].load(std::memory_order_relaxed);
+    }
+    result.push_back(profile);
+  }
+  return result;
+}
+
+void reset_lock_profile() {
+  for (SiteCounters& site : site_counters) {
+    site.acquisitions.store(0, std::memory_order_relaxed);
+    site.contended_acquisitions.store(0, std::memory_order_relaxed);
+    site.wait_nanoseconds.store(0, std::memory_order_relaxed);
+    site.hold_nanoseconds.store(0, std::memory_order_relaxed);
+    for (std::size_t j = 0; j < lock_histogram_buckets; ++j) {
+      site.wait_histogram[j].store(0, std::memory_order_relaxed);
+      site.hold_histogram[j].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+#else
+
+bool lock_profiling_enabled() { return false; }
+
+std::vector<LockSiteProfile> lock_profile() { return {}; }
+
+void reset_lock_profile() {}
+
+#endif
+
+std::string lock_profile_report(const std::vector<LockSiteProfile>& profile) {
+  const char* const headings[] = {"lock site", "acquired", "contended",
+                                  "wait avg",  "wait p50", "wait p99",
+                                  "hold avg",  "hold p50", "hold p99"};
+  std::vector<std::vector<std::string>> rows;
+  rows.emplace_back(std::begin(headings), std::end(headings));
+
+  for (const auto& site : profile) {
+    std::vector<std::string> row;
+    row.emplace_back(to_string_view(site.site));
+    row.push_back(std::to_string(site.acquisitions));
+    char percent[16];
+    std::snprintf(percent, sizeof percent, "%.2f%%",
+                  site.acquisitions == 0 ? 0.0
+                                         : 100.0 * site.contended_acquisitions /
+                                               site.acquisitions);
+    row.emplace_back(percent);
+    const std::uint64_t count = site.acquisitions == 0 ? 1 : site.acquisitions;
+    for (const auto& [total, histogram] :
+         {std::make_pair(site.wait_nanoseconds, &site.wait_histogram),
+          std::make_pair(site.hold_nanoseconds, &site.hold_histogram)}) {
+      std::string cell;
+      append_duration(cell, total / count);
+      row.push_back(std::move(cell));
+      for (const double quantile : {0.5, 0.99}) {
+        cell = "<";
+        append_duration(cell,
+                        histogram_quantile(*histogram, site.acquisitions,
+                                           quantile));
+        row.push_back(std::move(cell));
+      }
+    }
+    rows.push_back(std::move(row));
+  }
+
+  std::vector<std::size_t> widths(rows.front().size(), 0);
+  for (const auto& row : rows) {
+    for (std::size_t i = 0; i < row.size(); ++i) {
+      widths[i] = std::max(widths[i], row[i].size());
+    }
+  }
+
+  std::string result;
+  for (const auto& row : rows) {
+    // The site name is left-aligned, and the numbers are right-aligned.
+    result += row[0];
+    result.append(widths[0] - row[0].size(), ' ');
+    for (std::size_t i = 1; i < row.size(); ++i) {
+      result += "  ";
+      append_column(result, row[i], widths[i]);
+    }
+    result += '\n';
+  }
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -13,6 +13,7 @@
 
 #if defined(__APPLE__) || defined(__linux__) || defined(__unix__)
 #  include <pthread.h>
+#  include <sys/stat.h>
 #  include <sys/types.h>
 #  include <sys/utsname.h>
 #  include <unistd.h>
@@ -228,6 +229,16 @@ int at_fork_in_child(void (*on_fork)()) {
 #endif
 }
 
+bool is_unix_socket(const std::string& path) {
+#if defined(_MSC_VER)
+  (void)path;
+  return false;
+#else
+  struct stat status;
+  return ::stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode);
+#endif
+}
+
 InMemoryFile::InMemoryFile(void* handle) : handle_(handle) {}
 
 InMemoryFile::InMemoryFile(InMemoryFile&& rhs) {
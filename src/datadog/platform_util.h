@@ -72,5 +72,9 @@ std::string get_process_name();
 
 int at_fork_in_child(void (*on_fork)());
 
+// Return whether the specified `path` names a Unix domain socket.  Return
+// `false` on platforms without Unix domain sockets.
+bool is_unix_socket(const std::string& path);
+
 }  // namespace tracing
 }  // namespace datadog
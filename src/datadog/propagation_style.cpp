@@ -16,6 +16,8 @@ StringView to_string_view(PropagationStyle style) {
       return "Datadog";
     case PropagationStyle::B3:
       return "B3";
+    case PropagationStyle::B3_SINGLE:
+      return "b3single";
     case PropagationStyle::W3C:
       return "tracecontext";  // for compatibility with OpenTelemetry
     case PropagationStyle::BAGGAGE:
@@ -44,6 +46,8 @@ Optional<PropagationStyle> parse_propagation_style(StringView text) {
     return PropagationStyle::DATADOG;
   } else if (token == "b3" || token == "b3multi") {
     return PropagationStyle::B3;
+  } else if (token == "b3single") {
+    return PropagationStyle::B3_SINGLE;
   } else if (token == "tracecontext") {
     return PropagationStyle::W3C;
   } else if (token == "none") {
@@ -4,8 +4,8 @@
 #include <datadog/remote_config/listener.h>
 #include <datadog/string_view.h>
 
-#include <cassert>
-#include <regex>
+#include <algorithm>
+#include <map>
 #include <unordered_set>
 
 #include "base64.h"
@@ -35,26 +35,58 @@ struct ConfigKeyMetadata final {
   StringView config_id;
 };
 
+// Return the product and configuration ID of the specified `config_path`, or
+// return `nullopt` if `config_path` is not of the form
+// "datadog/<org ID>/<product>/<config ID>/<name>" or
+// "employee/<product>/<config ID>/<name>", where the org ID is decimal digits
+// and the other components are not empty.
+//
+// This is a hand-written equivalent of matching the regular expression
+// "^(datadog/\d+|employee)/([^/]+)/([^/]+)/[^/]+$", which takes linear time.
+// `std::regex` can take super-linear time and recurses once per character,
+// and the path comes from the network.
 Optional<ConfigKeyMetadata> parse_config_path(StringView config_path) {
-  static const std::regex path_reg(
-      "^(datadog/\\d+|employee)/([^/]+)/([^/]+)/[^/]+$");
+  // Remove from the front of `config_path` the component that precedes the
+  // next "/", and return it, or return `nullopt` if there's no "/" or the
+  // component is empty.
+  const auto pop_component = [&]() -> Optional<StringView> {
+    const auto slash = config_path.find('/');
+    if (slash == 0 || slash == StringView::npos) {
+      return nullopt;
+    }
+    const StringView component = config_path.substr(0, slash);
+    config_path.remove_prefix(slash + 1);
+    return component;
+  };
 
-  std::cmatch match;
-  if (!std::regex_match(config_path.data(),
-                        config_path.data() + config_path.size(), match,
-                        path_reg)) {
+  const auto source = pop_component();
+  if (!source) {
+    return nullopt;
+  }
+  if (*source == "datadog") {
+    const auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+    const auto org_id = pop_component();
+    if (!org_id || !std::all_of(org_id->begin(), org_id->end(), is_digit)) {
+      return nullopt;
+    }
+  } else if (*source != "employee") {
     return nullopt;
   }
 
-  assert(match.ready());
-  assert(match.size() == 4);
-
-  StringView product_sv(config_path.data() + match.position(2),
-                        std::size_t(match.length(2)));
-  StringView config_id_sv{config_path.data() + match.position(3),
-                          static_cast<std::size_t>(match.length(3))};
+  const auto product = pop_component();
+  if (!product) {
+    return nullopt;
+  }
+  const auto config_id = pop_component();
+  if (!config_id) {
+    return nullopt;
+  }
+  // What remains is the name, which must be one nonempty component.
+  if (config_path.empty() || config_path.find('/') != StringView::npos) {
+    return nullopt;
+  }
 
-  return {{parse_product(product_sv), config_id_sv}};
+  return {{parse_product(*product), *config_id}};
 }
 
 }  // namespace
@@ -203,6 +235,12 @@ void Manager::process_response(const nlohmann::json& json) {
     // Keep track of config path received to know which ones to revert.
     std::unordered_set<std::string> visited_config;
 
+    // The target files, indexed by path when first needed, so that finding
+    // each configuration's file doesn't take time proportional to the number
+    // of files.
+    std::map<StringView, const nlohmann::json*> target_file_by_path;
+    bool target_files_indexed = false;
+
     for (const auto& client_config : *client_configs_it) {
       auto config_path = client_config.get<StringView>();
       visited_config.emplace(config_path);
@@ -225,14 +263,17 @@ void Manager::process_response(const nlohmann::json& json) {
         continue;
       }
 
-      const auto& target_files = json.at("/target_files"_json_pointer);
-      auto target_it = std::find_if(
-          target_files.cbegin(), target_files.cend(),
-          [&config_path](const nlohmann::json& j) {
-            return j.at("/path"_json_pointer).get<StringView>() == config_path;
-          });
+      if (!target_files_indexed) {
+        for (const auto& target_file : json.at("/target_files"_json_pointer)) {
+          target_file_by_path.emplace(
+              target_file.at("/path"_json_pointer).get<StringView>(),
+              &target_file);
+        }
+        target_files_indexed = true;
+      }
 
-      if (target_it == target_files.cend()) {
+      const auto target_it = target_file_by_path.find(config_path);
+      if (target_it == target_file_by_path.cend()) {
         std::string reason{"Target \""};
         append(reason, config_path);
         reason += "\" missing from the list of targets";
@@ -241,7 +282,7 @@ void Manager::process_response(const nlohmann::json& json) {
         return;
       }
 
-      auto raw_data = target_it->at("raw").get<StringView>();
+      auto raw_data = target_it->second->at("raw").get<StringView>();
       auto decoded_config = base64_decode(raw_data);
 
       Configuration new_config;
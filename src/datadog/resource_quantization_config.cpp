@@ -0,0 +1,49 @@
+#include <datadog/environment.h>
+#include <datadog/error.h>
+#include <datadog/resource_quantization_config.h>
+
+#include "parse_util.h"
+
+namespace datadog {
+namespace tracing {
+
+Expected<FinalizedResourceQuantizationConfig> finalize_config(
+    const ResourceQuantizationConfig& user_config) {
+  ResourceQuantizationConfig env_config;
+  if (auto enabled_env =
+          lookup(environment::DD_TRACE_RESOURCE_QUANTIZATION_ENABLED)) {
+    env_config.enabled = !falsy(*enabled_env);
+  }
+  if (auto limit_env =
+          lookup(environment::DD_TRACE_RESOURCE_CARDINALITY_LIMIT)) {
+    auto maybe_limit = parse_uint64(*limit_env, 10);
+    if (auto* error = maybe_limit.if_error()) {
+      return error->with_prefix(
+          "Unable to parse DD_TRACE_RESOURCE_CARDINALITY_LIMIT: ");
+    }
+    env_config.max_resources_per_service = std::size_t(*maybe_limit);
+  }
+
+  FinalizedResourceQuantizationConfig result;
+
+  result.enabled = value_or(env_config.enabled, user_config.enabled, false);
+  result.max_resources_per_service =
+      value_or(env_config.max_resources_per_service,
+               user_config.max_resources_per_service, std::size_t(1000));
+  result.max_services = user_config.max_services.value_or(100);
+  const int reset_interval_seconds =
+      user_config.reset_interval_seconds.value_or(60);
+  if (reset_interval_seconds < 0) {
+    return Error{Error::RESOURCE_QUANTIZATION_INVALID_RESET_INTERVAL,
+                 "Resource quantization reset interval must be a nonnegative "
+                 "number of seconds."};
+  }
+  result.reset_interval = std::chrono::seconds(reset_interval_seconds);
+  result.overflow_resource =
+      user_config.overflow_resource.value_or("<overflow>");
+
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,256 @@
+#include "resource_quantizer.h"
+
+#include <mutex>
+
+#include "span_data.h"
+#include "string_util.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+bool is_hex_digit_or_dash(char c) {
+  return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') ||
+         c == '-';
+}
+
+bool is_identifier_character(char c) {
+  return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         c == '_' || c == '$';
+}
+
+bool looks_like_identifier(StringView segment) {
+  if (segment.empty()) {
+    return false;
+  }
+  bool all_digits = true;
+  bool any_digit = false;
+  bool all_hex = true;
+  for (const char c : segment) {
+    const bool digit = is_digit(c);
+    all_digits = all_digits && digit;
+    any_digit = any_digit || digit;
+    all_hex = all_hex && is_hex_digit_or_dash(c);
+  }
+  return all_digits || (all_hex && any_digit && segment.size() >= 8);
+}
+
+// `Rewriter` builds a modified copy of a string from left to right, but only
+// allocates the copy once the first modification is made.
+class Rewriter {
+  const std::string& original_;
+  std::string result_;
+  // `original_[0, copied_)` is accounted for in `result_`.
+  std::size_t copied_ = 0;
+  bool modified_ = false;
+
+ public:
+  explicit Rewriter(const std::string& original) : original_(original) {}
+
+  // Replace `original_[begin, end)` with the specified `replacement`.
+  void replace(std::size_t begin, std::size_t end, StringView replacement) {
+    if (!modified_) {
+      result_.reserve(original_.size());
+      modified_ = true;
+    }
+    result_.append(original_, copied_, begin - copied_);
+    append(result_, replacement);
+    copied_ = end;
+  }
+
+  // If any replacements were made, assign the result to the specified
+  // `destination`, which is the original string.  Return whether any
+  // replacements were made.
+  bool finish(std::string& destination) {
+    if (!modified_) {
+      return false;
+    }
+    result_.append(original_, copied_, std::string::npos);
+    destination = std::move(result_);
+    return true;
+  }
+};
+
+}  // namespace
+
+bool quantize_path(std::string& resource) {
+  const std::size_t npos = std::string::npos;
+  std::size_t begin = resource.find('/');
+  while (begin != npos && begin != 0 && resource[begin - 1] != ' ') {
+    begin = resource.find('/', begin + 1);
+  }
+  if (begin == npos) {
+    return false;
+  }
+
+  // The path is `[begin, path_end)`.  The query and fragment, if any, are
+  // `[path_end, rest)`.  A "?" that is an entire path segment is a
+  // replacement made by previous quantization, not the start of a query.
+  const auto is_replacement = [&](std::size_t i) {
+    return resource[i] == '?' && resource[i - 1] == '/' &&
+           (i + 1 == resource.size() || resource[i + 1] == '/' ||
+            resource[i + 1] == ' ');
+  };
+  std::size_t path_end = resource.find_first_of("?# ", begin);
+  while (path_end != npos && is_replacement(path_end)) {
+    path_end = resource.find_first_of("?# ", path_end + 1);
+  }
+  if (path_end == npos) {
+    path_end = resource.size();
+  }
+  std::size_t rest = path_end;
+  if (rest != resource.size() && resource[rest] != ' ') {
+    rest = resource.find(' ', rest);
+    if (rest == npos) {
+      rest = resource.size();
+    }
+  }
+
+  Rewriter rewriter{resource};
+  std::size_t segment = begin + 1;
+  while (segment <= path_end) {
+    std::size_t segment_end = resource.find('/', segment);
+    if (segment_end > path_end) {
+      segment_end = path_end;
+    }
+    if (looks_like_identifier(
+            StringView{resource}.substr(segment, segment_end - segment))) {
+      rewriter.replace(segment, segment_end, "?");
+    }
+    segment = segment_end + 1;
+  }
+  if (rest != path_end) {
+    rewriter.replace(path_end, rest, "");
+  }
+  return rewriter.finish(resource);
+}
+
+bool quantize_sql(std::string& resource) {
+  Rewriter rewriter{resource};
+  const std::size_t size = resource.size();
+  std::size_t i = 0;
+  while (i < size) {
+    const char c = resource[i];
+    if (c == '\'') {
+      // A string literal, in which a quote is escaped either by doubling it
+      // or by a backslash.
+      std::size_t end = i + 1;
+      while (end < size) {
+        if (resource[end] == '\\') {
+          end += 2;
+        } else if (resource[end] != '\'') {
+          ++end;
+        } else if (end + 1 < size && resource[end + 1] == '\'') {
+          end += 2;
+        } else {
+          ++end;
+          break;
+        }
+      }
+      if (end > size) {
+        end = size;
+      }
+      rewriter.replace(i, end, "?");
+      i = end;
+    } else if (c == '"' || c == '`') {
+      // A quoted identifier, which is kept as is.
+      const std::size_t close = resource.find(c, i + 1);
+      i = close == std::string::npos ? size : close + 1;
+    } else if (is_digit(c) &&
+               (i == 0 || !is_identifier_character(resource[i - 1]))) {
+      // A numeric literal, including decimals and hexadecimal, e.g. "1.5" and
+      // "0xFF".
+      std::size_t end = i + 1;
+      while (end < size && (is_identifier_character(resource[end]) ||
+                            resource[end] == '.')) {
+        ++end;
+      }
+      rewriter.replace(i, end, "?");
+      i = end;
+    } else if (is_identifier_character(c)) {
+      // Skip the rest of the identifier, so that its digits aren't mistaken
+      // for a literal.
+      do {
+        ++i;
+      } while (i < size && is_identifier_character(resource[i]));
+    } else {
+      ++i;
+    }
+  }
+  return rewriter.finish(resource);
+}
+
+ResourceQuantizer::ResourceQuantizer(
+    const FinalizedResourceQuantizationConfig& config)
+    : max_resources_per_service_(config.max_resources_per_service),
+      max_services_(config.max_services),
+      reset_interval_(config.reset_interval),
+      overflow_resource_(config.overflow_resource) {}
+
+void ResourceQuantizer::quantize(
+    const std::vector<std::unique_ptr<SpanData>>& spans) {
+  for (const auto& span : spans) {
+    if (span->service_type == "sql") {
+      quantize_sql(span->resource);
+    } else {
+      quantize_path(span->resource);
+    }
+  }
+
+  if ((max_resources_per_service_ == 0 && max_services_ == 0) ||
+      spans.empty()) {
+    return;
+  }
+
+  std::lock_guard<Mutex> lock(mutex_);
+  if (reset_interval_ != reset_interval_.zero()) {
+    const auto now = spans.front()->start.tick;
+    if (now - interval_start_ >= reset_interval_) {
+      resources_.clear();
+      interval_start_ = now;
+    }
+  }
+
+  for (const auto& span : spans) {
+    auto found = resources_.find(span->service);
+    if (found == resources_.end()) {
+      if (max_services_ != 0 && resources_.size() >= max_services_) {
+        span->resource = overflow_resource_;
+        continue;
+      }
+      found = resources_.try_emplace(span->service).first;
+    }
+    if (max_resources_per_service_ == 0) {
+      continue;
+    }
+    auto& resources = found->second;
+    if (resources.count(span->resource)) {
+      continue;
+    }
+    if (resources.size() < max_resources_per_service_) {
+      resources.insert(span->resource);
+    } else {
+      span->resource = overflow_resource_;
+    }
+  }
+}
+
+StringView ResourceQuantizer::overflow_resource() const {
+  return overflow_resource_;
+}
+
+nlohmann::json ResourceQuantizer::config_json() const {
+  return nlohmann::json::object({
+      {"max_resources_per_service", max_resources_per_service_},
+      {"max_services", max_services_},
+      {"reset_interval_seconds",
+       std::chrono::duration_cast<std::chrono::seconds>(reset_interval_)
+           .count()},
+      {"overflow_resource", overflow_resource_},
+  });
+}
+
+}  // namespace tracing
+}  // namespace datadog
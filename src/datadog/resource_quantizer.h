@@ -0,0 +1,92 @@
+#pragma once
+
+// This component provides a class, `ResourceQuantizer`, that limits the
+// cardinality of span resource names when a trace segment finishes, before it
+// is sampled and encoded.  A sampling decision made earlier, e.g. when trace
+// context is injected, sees the resource names before quantization.
+//
+// Quantization replaces the parts of a resource that vary from request to
+// request with "?":
+//
+// - In a URL path, such as the "/users/123" of "GET /users/123?page=2", each
+//   path segment that looks like an identifier is replaced, and the query and
+//   fragment are removed, giving "GET /users/?".  A segment looks like an
+//   identifier if it is all decimal digits, or if it is at least eight
+//   hexadecimal digits and dashes of which at least one is a decimal digit,
+//   e.g. a UUID or a hash.
+// - In the resource of a span of type "sql", each string and numeric literal
+//   is replaced, e.g. "SELECT * FROM t WHERE id = 42 AND name = 'bob'" becomes
+//   "SELECT * FROM t WHERE id = ? AND name = ?".
+//
+// Then, the limiter remembers the distinct resources of each service, up to a
+// configured number.  A span whose resource is not remembered, and whose
+// service already has the maximum number of resources, is given a sentinel
+// resource instead.  The number of services remembered is subject to a
+// separate limit, and a span whose service is not remembered is likewise given
+// the sentinel.  Everything remembered is forgotten at a configured interval,
+// measured using the start times of the trace segments' local root spans, so
+// that the limits apply to each interval rather than to the life of the
+// process.
+//
+// The quantization functions are free, and allocate only if a resource is
+// changed.  The limiter takes one lock per trace segment.
+
+#include <datadog/mutex.h>
+#include <datadog/resource_quantization_config.h>
+#include <datadog/string_view.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "json.hpp"
+
+namespace datadog {
+namespace tracing {
+
+struct SpanData;
+
+// Replace the identifiers in the URL path within the specified `resource`, and
+// remove its query and fragment, as described above.  The path begins at the
+// first "/" that either begins `resource` or follows a space.  Return whether
+// `resource` was modified.
+bool quantize_path(std::string& resource);
+
+// Replace the string and numeric literals in the specified SQL `resource`, as
+// described above.  Return whether `resource` was modified.
+bool quantize_sql(std::string& resource);
+
+class ResourceQuantizer {
+  const std::size_t max_resources_per_service_;
+  const std::size_t max_services_;
+  const std::chrono::steady_clock::duration reset_interval_;
+  const std::string overflow_resource_;
+
+  Mutex mutex_{LockSite::RESOURCE_QUANTIZER};
+  // service -> distinct resources
+  std::unordered_map<std::string, std::unordered_set<std::string>> resources_;
+  // When `resources_` was last cleared.
+  std::chrono::steady_clock::time_point interval_start_;
+
+ public:
+  explicit ResourceQuantizer(const FinalizedResourceQuantizationConfig&);
+
+  // Quantize the resource of each of the specified `spans`, and then replace
+  // the resources that exceed the cardinality limits.  The first of `spans` is
+  // the local root, whose start time determines whether the remembered
+  // resources are first forgotten.
+  void quantize(const std::vector<std::unique_ptr<SpanData>>& spans);
+
+  // Return the resource given to spans that exceed the cardinality limit.
+  StringView overflow_resource() const;
+
+  // Return a JSON representation of this object's configuration.
+  nlohmann::json config_json() const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,275 @@
+#include "runtime_metrics.h"
+
+#include <cstring>
+
+#include "tracer_telemetry.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Parse the unsigned decimal integer at the beginning of the specified `text`,
+// ignoring leading spaces and tabs, into the specified `value`.  Return
+// whether there was such an integer.
+bool parse_decimal(StringView text, std::uint64_t& value) {
+  std::size_t i = 0;
+  while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) {
+    ++i;
+  }
+  const std::size_t begin = i;
+  std::uint64_t result = 0;
+  for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+    result = result * 10 + std::uint64_t(text[i] - '0');
+  }
+  if (i == begin) {
+    return false;
+  }
+  value = result;
+  return true;
+}
+
+bool starts_with(StringView text, StringView prefix) {
+  return text.size() >= prefix.size() &&
+         text.substr(0, prefix.size()) == prefix;
+}
+
+}  // namespace
+
+bool parse_proc_stat(StringView contents, std::uint64_t ticks_per_second,
+                     RuntimeMetricsSampler::Sample& result) {
+  // The second field is the executable name in parentheses, which can itself
+  // contain spaces and parentheses.  The fields of interest follow the last
+  // closing parenthesis, and are numbered as in proc(5).
+  const auto close = contents.rfind(')');
+  if (close == StringView::npos || ticks_per_second == 0) {
+    return false;
+  }
+  contents.remove_prefix(close + 1);
+
+  std::uint64_t user_ticks = 0;
+  std::uint64_t system_ticks = 0;
+  std::uint64_t threads = 0;
+  int field = 2;
+  int found = 0;
+  while (!contents.empty() && found < 3) {
+    // Skip the separating space and move to the next field.
+    contents.remove_prefix(1);
+    ++field;
+    if (field == 14) {
+      found += parse_decimal(contents, user_ticks);
+    } else if (field == 15) {
+      found += parse_decimal(contents, system_ticks);
+    } else if (field == 20) {
+      found += parse_decimal(contents, threads);
+    }
+    const auto space = contents.find(' ');
+    if (space == StringView::npos) {
+      break;
+    }
+    contents.remove_prefix(space);
+  }
+  if (found != 3) {
+    return false;
+  }
+
+  result.cpu_user_milliseconds = user_ticks * 1000 / ticks_per_second;
+  result.cpu_system_milliseconds = system_ticks * 1000 / ticks_per_second;
+  result.threads = threads;
+  return true;
+}
+
+bool parse_proc_status(StringView contents,
+                       RuntimeMetricsSampler::Sample& result) {
+  constexpr StringView rss_key = "VmRSS:";
+  constexpr StringView voluntary_key = "voluntary_ctxt_switches:";
+  constexpr StringView involuntary_key = "nonvoluntary_ctxt_switches:";
+
+  std::uint64_t rss_kilobytes = 0;
+  std::uint64_t voluntary = 0;
+  std::uint64_t involuntary = 0;
+  int found = 0;
+  while (!contents.empty() && found < 3) {
+    const auto end = contents.find('\n');
+    const StringView line = contents.substr(0, end);
+    contents.remove_prefix(end == StringView::npos ? contents.size() : end + 1);
+
+    if (starts_with(line, rss_key)) {
+      found += parse_decimal(line.substr(rss_key.size()), rss_kilobytes);
+    } else if (starts_with(line, voluntary_key)) {
+      found += parse_decimal(line.substr(voluntary_key.size()), voluntary);
+    } else if (starts_with(line, involuntary_key)) {
+      found += parse_decimal(line.substr(involuntary_key.size()), involuntary);
+    }
+  }
+  if (found != 3) {
+    return false;
+  }
+
+  result.rss_bytes = rss_kilobytes * 1024;
+  result.voluntary_context_switches = voluntary;
+  result.involuntary_context_switches = involuntary;
+  return true;
+}
+
+RuntimeMetricsSampler::RuntimeMetricsSampler(
+    const std::shared_ptr<TracerTelemetry>& tracer_telemetry,
+    const std::shared_ptr<EventScheduler>& event_scheduler,
+    std::chrono::steady_clock::duration interval)
+    : tracer_telemetry_(tracer_telemetry), event_scheduler_(event_scheduler) {
+  // The files of interest are a few kilobytes at most.  Reading them into a
+  // buffer that is too small is detected, and the buffer grows.
+  buffer_.resize(4096);
+#if defined(__linux__)
+  if (const long ticks = ::sysconf(_SC_CLK_TCK); ticks > 0) {
+    ticks_per_second_ = std::uint64_t(ticks);
+  }
+#endif
+  open_files();
+  sample();
+  if (event_scheduler_) {
+    cancel_ = event_scheduler_->schedule_recurring_event(
+        interval, [this]() { sample(); });
+  }
+}
+
+RuntimeMetricsSampler::~RuntimeMetricsSampler() {
+  if (cancel_) {
+    cancel_();
+  }
+  close_files();
+}
+
+#if defined(__linux__)
+
+void RuntimeMetricsSampler::open_files() {
+  pid_ = int(::getpid());
+  stat_fd_ = ::open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+  status_fd_ = ::open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+  fd_directory_ = ::open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+void RuntimeMetricsSampler::close_files() {
+  for (int* fd : {&stat_fd_, &status_fd_, &fd_directory_}) {
+    if (*fd != -1) {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+StringView RuntimeMetricsSampler::read_file(int fd) {
+  if (fd == -1) {
+    return StringView{};
+  }
+  for (;;) {
+    std::size_t size = 0;
+    for (;;) {
+      const ssize_t rc = ::pread(fd, buffer_.data() + size,
+                                 buffer_.size() - size, off_t(size));
+      if (rc < 0) {
+        return StringView{};
+      }
+      if (rc == 0) {
+        return StringView{buffer_.data(), size};
+      }
+      size += std::size_t(rc);
+      if (size == buffer_.size()) {
+        break;
+      }
+    }
+    // The buffer is full, so the file might be truncated.  Grow the buffer
+    // and read again.  This happens at most a few times over the life of the
+    // process.
+    buffer_.resize(buffer_.size() * 2);
+  }
+}
+
+long RuntimeMetricsSampler::count_directory_entries() {
+  if (fd_directory_ == -1 || ::lseek(fd_directory_, 0, SEEK_SET) == -1) {
+    return -1;
+  }
+  // Each record returned by getdents64(2) is a `struct linux_dirent64`: an
+  // 8-byte inode number, an 8-byte offset, a 2-byte record length, a 1-byte
+  // type, and then the null-terminated name.
+  constexpr std::size_t reclen_offset = 16;
+  constexpr std::size_t name_offset = 19;
+  long count = 0;
+  for (;;) {
+    const long rc = ::syscall(SYS_getdents64, fd_directory_, buffer_.data(),
+                              buffer_.size());
+    if (rc < 0) {
+      return -1;
+    }
+    if (rc == 0) {
+      return count;
+    }
+    for (long offset = 0; offset < rc;) {
+      const char* record = buffer_.data() + offset;
+      unsigned short reclen;
+      std::memcpy(&reclen, record + reclen_offset, sizeof reclen);
+      const char* name = record + name_offset;
+      if (std::strcmp(name, ".") != 0 && std::strcmp(name, "..") != 0) {
+        ++count;
+      }
+      offset += reclen;
+    }
+  }
+}
+
+bool RuntimeMetricsSampler::sample() {
+  if (int(::getpid()) != pid_) {
+    close_files();
+    open_files();
+  }
+
+  Sample current = last_sample_;
+  bool complete =
+      parse_proc_stat(read_file(stat_fd_), ticks_per_second_, current);
+  complete = parse_proc_status(read_file(status_fd_), current) && complete;
+  if (long entries = count_directory_entries(); entries >= 0) {
+    // Don't count the files opened by this sampler.
+    for (const int fd : {stat_fd_, status_fd_, fd_directory_}) {
+      entries -= (fd != -1);
+    }
+    current.open_file_descriptors = std::uint64_t(entries > 0 ? entries : 0);
+  } else {
+    complete = false;
+  }
+  last_sample_ = current;
+
+  if (tracer_telemetry_) {
+    auto& runtime = tracer_telemetry_->metrics().runtime;
+    runtime.cpu_user_time.set(current.cpu_user_milliseconds);
+    runtime.cpu_system_time.set(current.cpu_system_milliseconds);
+    runtime.rss.set(current.rss_bytes);
+    runtime.threads.set(current.threads);
+    runtime.open_file_descriptors.set(current.open_file_descriptors);
+    runtime.voluntary_context_switches.set(current.voluntary_context_switches);
+    runtime.involuntary_context_switches.set(
+        current.involuntary_context_switches);
+  }
+  return complete;
+}
+
+#else
+
+void RuntimeMetricsSampler::open_files() {}
+
+void RuntimeMetricsSampler::close_files() {}
+
+StringView RuntimeMetricsSampler::read_file(int) { return StringView{}; }
+
+long RuntimeMetricsSampler::count_directory_entries() { return -1; }
+
+bool RuntimeMetricsSampler::sample() { return false; }
+
+#endif
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,99 @@
+#pragma once
+
+// This component provides a class, `RuntimeMetricsSampler`, that periodically
+// samples the runtime metrics of the current process and publishes them as
+// gauges through `TracerTelemetry`.
+//
+// On Linux, the metrics are read from "/proc/self/stat", "/proc/self/status",
+// and "/proc/self/fd".  The sampler is meant to run in latency-sensitive
+// processes, so it keeps those files open, reads them into a buffer that is
+// reused across samples, and parses them by hand.  Taking a sample does not
+// allocate memory.
+//
+// On other platforms, sampling always fails and nothing is published.
+
+#include <datadog/event_scheduler.h>
+#include <datadog/string_view.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+class TracerTelemetry;
+
+class RuntimeMetricsSampler {
+ public:
+  struct Sample {
+    std::uint64_t cpu_user_milliseconds = 0;
+    std::uint64_t cpu_system_milliseconds = 0;
+    std::uint64_t rss_bytes = 0;
+    std::uint64_t threads = 0;
+    std::uint64_t open_file_descriptors = 0;
+    std::uint64_t voluntary_context_switches = 0;
+    std::uint64_t involuntary_context_switches = 0;
+  };
+
+ private:
+  std::shared_ptr<TracerTelemetry> tracer_telemetry_;
+  // The process whose "/proc" files are open.  After a fork, "/proc/self" in
+  // the child refers to the child, but the files opened by the parent still
+  // refer to the parent, so they must be reopened.
+  int pid_ = -1;
+  int stat_fd_ = -1;
+  int status_fd_ = -1;
+  int fd_directory_ = -1;
+  std::uint64_t ticks_per_second_ = 100;
+  std::vector<char> buffer_;
+  Sample last_sample_;
+  std::shared_ptr<EventScheduler> event_scheduler_;
+  EventScheduler::Cancel cancel_;
+
+  void open_files();
+  void close_files();
+  // Read the entire file open as the specified `fd` into `buffer_`.  Return
+  // the contents, or return an empty view if an error occurs.
+  StringView read_file(int fd);
+  // Return the number of entries in the directory open as `fd_directory_`,
+  // excluding "." and "..", or return -1 if an error occurs.
+  long count_directory_entries();
+
+ public:
+  // Create a sampler that publishes to the specified `tracer_telemetry`, if
+  // not null.  If the specified `event_scheduler` is not null, then take a
+  // sample every `interval`.
+  explicit RuntimeMetricsSampler(
+      const std::shared_ptr<TracerTelemetry>& tracer_telemetry,
+      const std::shared_ptr<EventScheduler>& event_scheduler = nullptr,
+      std::chrono::steady_clock::duration interval = std::chrono::seconds(10));
+  ~RuntimeMetricsSampler();
+
+  RuntimeMetricsSampler(const RuntimeMetricsSampler&) = delete;
+  RuntimeMetricsSampler& operator=(const RuntimeMetricsSampler&) = delete;
+
+  // Read the current runtime metrics of this process and publish them.
+  // Return whether all of the metrics were read.  `sample` is not
+  // thread-safe; it is called by the event scheduler's thread.
+  bool sample();
+
+  // Return the values read by the most recent call to `sample`.
+  const Sample& last_sample() const { return last_sample_; }
+};
+
+// Parse the specified `contents` of "/proc/<pid>/stat" into the CPU time and
+// thread count of the specified `result`, where CPU time is measured in units
+// of the specified `ticks_per_second`.  Return whether parsing succeeded.
+bool parse_proc_stat(StringView contents, std::uint64_t ticks_per_second,
+                     RuntimeMetricsSampler::Sample& result);
+
+// Parse the specified `contents` of "/proc/<pid>/status" into the resident
+// set size and context switch counts of the specified `result`.  Return
+// whether parsing succeeded.
+bool parse_proc_status(StringView contents,
+                       RuntimeMetricsSampler::Sample& result);
+
+}  // namespace tracing
+}  // namespace datadog
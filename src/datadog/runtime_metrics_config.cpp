@@ -0,0 +1,42 @@
+#include <datadog/environment.h>
+#include <datadog/error.h>
+#include <datadog/runtime_metrics_config.h>
+
+#include <chrono>
+
+#include "parse_util.h"
+
+namespace datadog {
+namespace tracing {
+
+Expected<FinalizedRuntimeMetricsConfig> finalize_config(
+    const RuntimeMetricsConfig& user_config) {
+  RuntimeMetricsConfig env_config;
+  if (auto enabled_env = lookup(environment::DD_RUNTIME_METRICS_ENABLED)) {
+    env_config.enabled = !falsy(*enabled_env);
+  }
+
+  FinalizedRuntimeMetricsConfig result;
+
+  result.enabled = value_or(env_config.enabled, user_config.enabled, false);
+
+  if (auto sample_interval_milliseconds =
+          value_or(user_config.sample_interval_milliseconds, 10000);
+      sample_interval_milliseconds > 0) {
+    result.sample_interval =
+        std::chrono::milliseconds(sample_interval_milliseconds);
+  } else {
+    return Error{Error::RUNTIME_METRICS_INVALID_SAMPLE_INTERVAL,
+                 "RuntimeMetrics: Sample interval must be a positive number of "
+                 "milliseconds."};
+  }
+
+  // If null, the event scheduler is filled in by the tracer's
+  // `finalize_config`.
+  result.event_scheduler = user_config.event_scheduler;
+
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,29 @@
+#include <datadog/shard.h>
+
+#include <atomic>
+#include <limits>
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+constexpr std::size_t unassigned = std::numeric_limits<std::size_t>::max();
+
+// the shard index that will be assigned to the next thread that needs one
+std::atomic<std::size_t> next_shard{0};
+
+thread_local std::size_t thread_shard = unassigned;
+
+}  // namespace
+
+void set_current_shard(std::size_t index) { thread_shard = index; }
+
+std::size_t current_shard() {
+  if (thread_shard == unassigned) {
+    thread_shard = next_shard.fetch_add(1, std::memory_order_relaxed);
+  }
+  return thread_shard;
+}
+
+}  // namespace tracing
+}  // namespace datadog
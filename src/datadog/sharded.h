@@ -0,0 +1,72 @@
+#pragma once
+
+// This component provides a class template, `Sharded`, that is a fixed number
+// of objects of the same type, one for each shard of a sharded tracer.  See
+// `shard.h`.
+//
+// Each object is allocated separately and aligned to a cache line, so that
+// threads of different shards modifying their own objects do not share any
+// cache lines.
+//
+// `Sharded::local` returns the object of the calling thread's shard.  Code
+// that merges the shards, e.g. a periodic flush, visits every object using
+// `Sharded::size` and `Sharded::operator[]`.
+//
+// `Sharded` does not synchronize access to the objects.  Typically, each
+// object contains its own `Mutex`, which is uncontended as long as each shard
+// is used by one thread.
+
+#include <datadog/shard.h>
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+// The size of a cache line on the processors that we care about.
+constexpr std::size_t cache_line_size = 64;
+
+template <typename Value>
+class Sharded {
+  struct alignas(cache_line_size) Slot {
+    Value value;
+
+    template <typename... Args>
+    explicit Slot(const Args&... args) : value(args...) {}
+  };
+
+  std::vector<std::unique_ptr<Slot>> slots_;
+
+ public:
+  // Create the specified `count` of objects, each constructed from the
+  // specified `args`.  The behavior is undefined if `count` is zero.
+  template <typename... Args>
+  explicit Sharded(std::size_t count, const Args&... args) {
+    assert(count > 0);
+    slots_.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      slots_.push_back(std::make_unique<Slot>(args...));
+    }
+  }
+
+  std::size_t size() const { return slots_.size(); }
+
+  Value& operator[](std::size_t index) { return slots_[index]->value; }
+  const Value& operator[](std::size_t index) const {
+    return slots_[index]->value;
+  }
+
+  // Return the object of the calling thread's shard.
+  Value& local() {
+    if (slots_.size() == 1) {
+      return slots_.front()->value;
+    }
+    return slots_[current_shard() % slots_.size()]->value;
+  }
+};
+
+}  // namespace tracing
+}  // namespace datadog
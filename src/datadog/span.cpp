@@ -2,32 +2,54 @@
 #include <datadog/optional.h>
 #include <datadog/span.h>
 #include <datadog/span_config.h>
+#include <datadog/span_prototype.h>
 #include <datadog/string_view.h>
 #include <datadog/trace_segment.h>
 
 #include <cassert>
+#include <memory>
 #include <string>
+#include <utility>
 
 #include "span_data.h"
+#include "stack_trace.h"
 #include "tags.h"
+#include "usdt.h"
 
 namespace datadog {
 namespace tracing {
 
+struct Span::LogCorrelation {
+  std::string json;
+  std::string key_value;
+};
+
 Span::Span(SpanData* data, const std::shared_ptr<TraceSegment>& trace_segment,
            const std::function<std::uint64_t()>& generate_span_id,
            const Clock& clock)
     : trace_segment_(trace_segment),
       data_(data),
       generate_span_id_(generate_span_id),
-      clock_(clock) {
+      clock_(clock),
+      log_correlation_(nullptr) {
   assert(trace_segment_);
   assert(data_);
   assert(generate_span_id_);
   assert(clock_);
+  DD_TRACE_PROBE3(span_create, data_->trace_id.low, data_->span_id,
+                  data_->parent_id);
 }
 
+Span::Span(Span&& other)
+    : trace_segment_(std::move(other.trace_segment_)),
+      data_(other.data_),
+      generate_span_id_(std::move(other.generate_span_id_)),
+      clock_(std::move(other.clock_)),
+      end_time_(std::move(other.end_time_)),
+      log_correlation_(other.log_correlation_.exchange(nullptr)) {}
+
 Span::~Span() {
+  delete log_correlation_.load(std::memory_order_acquire);
   if (!trace_segment_) {
     // We were moved from.
     return;
@@ -39,13 +61,31 @@ Span::~Span() {
     const auto now = clock_();
     data_->duration = now - data_->start;
   }
-
-  trace_segment_->span_finished();
+  DD_TRACE_PROBE3(
+      span_finish, data_->trace_id.low, data_->span_id,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(data_->duration)
+          .count());
+
+  if (trace_segment_->span_finished()) {
+    // This was the last span of a single-threaded segment, which its spans
+    // own jointly.
+    delete trace_segment_.get();
+  }
 }
 
 Span Span::create_child(const SpanConfig& config) const {
   auto span_data = std::make_unique<SpanData>();
   span_data->apply_config(trace_segment_->defaults(), config, clock_);
+  return make_child(std::move(span_data));
+}
+
+Span Span::create_child() const { return create_child(SpanConfig{}); }
+
+Span Span::create_child(const SpanPrototype& prototype) const {
+  return make_child(prototype.instantiate(trace_segment_->defaults(), clock_));
+}
+
+Span Span::make_child(std::unique_ptr<SpanData> span_data) const {
   span_data->trace_id = data_->trace_id;
   span_data->parent_id = data_->span_id;
   span_data->span_id = generate_span_id_();
@@ -55,8 +95,6 @@ Span Span::create_child(const SpanConfig& config) const {
   return Span(span_data_ptr, trace_segment_, generate_span_id_, clock_);
 }
 
-Span Span::create_child() const { return create_child(SpanConfig{}); }
-
 void Span::inject(DictWriter& writer) const {
   trace_segment_->inject(writer, *data_);
 }
@@ -65,6 +103,35 @@ void Span::inject(DictWriter& writer, const InjectionOptions& options) const {
   trace_segment_->inject(writer, *data_, options);
 }
 
+StringView Span::log_correlation(LogCorrelationFormat format) const {
+  LogCorrelation* cached = log_correlation_.load(std::memory_order_acquire);
+  if (!cached) {
+    auto formatted = std::make_unique<LogCorrelation>();
+    const auto environment = data_->environment();
+    const auto version = data_->version();
+    append_log_correlation(formatted->json, LogCorrelationFormat::JSON,
+                           data_->trace_id, data_->span_id, data_->service,
+                           environment, version);
+    append_log_correlation(formatted->key_value,
+                           LogCorrelationFormat::KEY_VALUE, data_->trace_id,
+                           data_->span_id, data_->service, environment,
+                           version);
+    // If another thread published its fragments first, then use those and
+    // discard ours.
+    if (log_correlation_.compare_exchange_strong(cached, formatted.get(),
+                                                 std::memory_order_acq_rel,
+                                                 std::memory_order_acquire)) {
+      cached = formatted.release();
+    }
+  }
+  return format == LogCorrelationFormat::JSON ? cached->json
+                                              : cached->key_value;
+}
+
+void Span::forget_log_correlation() {
+  delete log_correlation_.exchange(nullptr, std::memory_order_acq_rel);
+}
+
 std::uint64_t Span::id() const { return data_->span_id; }
 
 TraceID Span::trace_id() const { return data_->trace_id; }
@@ -105,14 +172,28 @@ Optional<double> Span::lookup_metric(StringView name) const {
 }
 
 void Span::set_tag(StringView name, StringView value) {
+  if (trace_segment_->filtered()) {
+    return;
+  }
   data_->tags.insert_or_assign(std::string(name), std::string(value));
+  if (name == tags::environment || name == tags::version) {
+    forget_log_correlation();
+  }
 }
 
 void Span::set_metric(StringView name, double value) {
+  if (trace_segment_->filtered()) {
+    return;
+  }
   data_->numeric_tags.insert_or_assign(std::string(name), value);
 }
 
-void Span::remove_tag(StringView name) { data_->tags.erase(std::string(name)); }
+void Span::remove_tag(StringView name) {
+  data_->tags.erase(std::string(name));
+  if (name == tags::environment || name == tags::version) {
+    forget_log_correlation();
+  }
+}
 
 void Span::remove_metric(StringView name) {
   data_->numeric_tags.erase(std::string(name));
@@ -120,6 +201,7 @@ void Span::remove_metric(StringView name) {
 
 void Span::set_service_name(StringView service) {
   assign(data_->service, service);
+  forget_log_correlation();
 }
 
 void Span::set_service_type(StringView type) {
@@ -131,6 +213,9 @@ void Span::set_resource_name(StringView resource) {
 }
 
 void Span::set_error(bool is_error) {
+  if (trace_segment_->filtered()) {
+    return;
+  }
   data_->error = is_error;
   if (!is_error) {
     data_->tags.erase("error.message");
@@ -139,20 +224,42 @@ void Span::set_error(bool is_error) {
 }
 
 void Span::set_error_message(StringView message) {
+  if (trace_segment_->filtered()) {
+    return;
+  }
   data_->error = true;
   data_->tags.insert_or_assign("error.message", std::string(message));
 }
 
 void Span::set_error_type(StringView type) {
+  if (trace_segment_->filtered()) {
+    return;
+  }
   data_->error = true;
   data_->tags.insert_or_assign("error.type", std::string(type));
 }
 
 void Span::set_error_stack(StringView type) {
+  if (trace_segment_->filtered()) {
+    return;
+  }
   data_->error = true;
+  data_->error_stack.reset();
   data_->tags.insert_or_assign("error.stack", std::string(type));
 }
 
+void Span::capture_error_stack() {
+  if (trace_segment_->filtered()) {
+    return;
+  }
+  auto stack = std::make_shared<CapturedStack>();
+  // Omit this function's frame.
+  capture_stack(*stack, 1);
+  data_->error = true;
+  data_->error_stack = std::move(stack);
+  data_->tags.erase("error.stack");
+}
+
 void Span::set_name(StringView value) { assign(data_->name, value); }
 
 void Span::set_end_time(std::chrono::steady_clock::time_point end_time) {
@@ -0,0 +1,304 @@
+#include "span_columns.h"
+
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <string_view>
+
+#include "msgpack.h"
+#include "span_data.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// The MessagePack encoded size of each integer and double, which
+// `msgpack::pack_integer` and `msgpack::pack_double` always encode as a type
+// byte followed by eight bytes.
+constexpr std::size_t packed_number_size = 9;
+// The MessagePack encoded size of an array or map header, which
+// `msgpack::pack_array` and `msgpack::pack_map` always encode as a type byte
+// followed by four bytes.
+constexpr std::size_t packed_header_size = 5;
+
+// `EncodedKeys` contains the MessagePack encoded names of the fields of a span,
+// in the order that `msgpack_encode(std::string&, const SpanData&)` encodes
+// them.
+struct EncodedKeys {
+  std::string service;
+  std::string name;
+  std::string resource;
+  std::string trace_id;
+  std::string span_id;
+  std::string parent_id;
+  std::string start;
+  std::string duration;
+  std::string error;
+  std::string meta;
+  std::string metrics;
+  std::string type;
+  // the sum of the sizes of all of the above
+  std::size_t total_size;
+};
+
+const EncodedKeys& encoded_keys() {
+  static const EncodedKeys keys = []() {
+    EncodedKeys keys;
+    keys.total_size = 0;
+    const auto encode = [&](std::string& destination, StringView name) {
+      (void)msgpack::pack_string(destination, name);
+      keys.total_size += destination.size();
+    };
+    encode(keys.service, "service");
+    encode(keys.name, "name");
+    encode(keys.resource, "resource");
+    encode(keys.trace_id, "trace_id");
+    encode(keys.span_id, "span_id");
+    encode(keys.parent_id, "parent_id");
+    encode(keys.start, "start");
+    encode(keys.duration, "duration");
+    encode(keys.error, "error");
+    encode(keys.meta, "meta");
+    encode(keys.metrics, "metrics");
+    encode(keys.type, "type");
+    return keys;
+  }();
+  return keys;
+}
+
+// The number of fields in an encoded span.
+constexpr std::size_t span_field_count = 12;
+
+// The MessagePack encoded size of a span, excluding its strings and tags.
+std::size_t fixed_span_size() {
+  return packed_header_size + encoded_keys().total_size +
+         6 * packed_number_size + 2 * packed_header_size;
+}
+
+std::uint64_t nanoseconds(Duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+      .count();
+}
+
+}  // namespace
+
+std::size_t SpanColumns::Hash::operator()(StringView value) const {
+  // `StringView` might be `absl::string_view`, which `std::hash` doesn't
+  // support.
+  return std::hash<std::string_view>{}(
+      std::string_view{value.data(), value.size()});
+}
+
+void SpanColumns::append_chunk(
+    const std::vector<std::unique_ptr<SpanData>>& spans) {
+  for (const auto& span_ptr : spans) {
+    assert(span_ptr);
+    const SpanData& span = *span_ptr;
+    trace_ids.push_back(span.trace_id.low);
+    span_ids.push_back(span.span_id);
+    parent_ids.push_back(span.parent_id);
+    starts.push_back(nanoseconds(span.start.wall.time_since_epoch()));
+    durations.push_back(nanoseconds(span.duration));
+    errors.push_back(span.error);
+    services.push_back(intern(span.service));
+    names.push_back(intern(span.name));
+    resources.push_back(intern(span.resource));
+    service_types.push_back(intern(span.service_type));
+
+    for (const auto& [key, value] : span.tags) {
+      tag_keys.push_back(intern(key));
+      tag_values.push_back(intern(value));
+    }
+    tag_offsets.push_back(static_cast<std::uint32_t>(tag_keys.size()));
+
+    for (const auto& [key, value] : span.numeric_tags) {
+      metric_keys.push_back(intern(key));
+      metric_values.push_back(value);
+    }
+    metric_offsets.push_back(static_cast<std::uint32_t>(metric_keys.size()));
+  }
+  chunk_offsets.push_back(static_cast<std::uint32_t>(trace_ids.size()));
+}
+
+SpanColumns::Handle SpanColumns::intern(StringView value) {
+  const auto found = handles_.find(value);
+  if (found != handles_.end()) {
+    return found->second;
+  }
+  const auto handle = static_cast<Handle>(strings_.size());
+  const std::string& stored = strings_.emplace_back(value);
+  handles_.emplace(stored, handle);
+  return handle;
+}
+
+const std::string& SpanColumns::string(Handle handle) const {
+  return strings_[handle];
+}
+
+std::size_t SpanColumns::string_count() const { return strings_.size(); }
+
+std::size_t SpanColumns::span_count() const { return trace_ids.size(); }
+
+std::size_t SpanColumns::chunk_count() const {
+  return chunk_offsets.size() - 1;
+}
+
+Expected<void> msgpack_encode(std::string& destination,
+                              const SpanColumns& columns) {
+  using Handle = SpanColumns::Handle;
+
+  // Encode each pooled string once.  The encoding of the string referred to
+  // by handle `h` is `encoded[offsets[h], offsets[h + 1])`.
+  std::string encoded;
+  std::vector<std::size_t> offsets;
+  offsets.reserve(columns.string_count() + 1);
+  for (std::size_t i = 0; i < columns.string_count(); ++i) {
+    offsets.push_back(encoded.size());
+    auto result = msgpack::pack_string(
+        encoded, columns.string(static_cast<Handle>(i)));
+    if (auto* error = result.if_error()) {
+      return std::move(*error);
+    }
+  }
+  offsets.push_back(encoded.size());
+
+  const auto encoded_size = [&](Handle handle) {
+    return offsets[handle + 1] - offsets[handle];
+  };
+  const auto append_string = [&](Handle handle) {
+    destination.append(encoded, offsets[handle], encoded_size(handle));
+  };
+
+  // Compute the size of the result, so that `destination` is allocated once.
+  const std::size_t span_count = columns.span_count();
+  std::size_t size = packed_header_size +
+                     columns.chunk_count() * packed_header_size +
+                     span_count * fixed_span_size();
+  for (std::size_t i = 0; i < span_count; ++i) {
+    size += encoded_size(columns.services[i]) +
+            encoded_size(columns.names[i]) +
+            encoded_size(columns.resources[i]) +
+            encoded_size(columns.service_types[i]);
+  }
+  for (std::size_t i = 0; i < columns.tag_keys.size(); ++i) {
+    size += encoded_size(columns.tag_keys[i]) +
+            encoded_size(columns.tag_values[i]);
+  }
+  for (const Handle key : columns.metric_keys) {
+    size += encoded_size(key) + packed_number_size;
+  }
+  destination.reserve(destination.size() + size);
+
+  const EncodedKeys& keys = encoded_keys();
+  auto result = msgpack::pack_array(destination, columns.chunk_count());
+  if (auto* error = result.if_error()) {
+    return std::move(*error);
+  }
+  for (std::size_t chunk = 0; chunk < columns.chunk_count(); ++chunk) {
+    const std::size_t begin = columns.chunk_offsets[chunk];
+    const std::size_t end = columns.chunk_offsets[chunk + 1];
+    (void)msgpack::pack_array(destination, end - begin);
+    for (std::size_t i = begin; i < end; ++i) {
+      (void)msgpack::pack_map(destination, span_field_count);
+      destination += keys.service;
+      append_string(columns.services[i]);
+      destination += keys.name;
+      append_string(columns.names[i]);
+      destination += keys.resource;
+      append_string(columns.resources[i]);
+      destination += keys.trace_id;
+      msgpack::pack_integer(destination, columns.trace_ids[i]);
+      destination += keys.span_id;
+      msgpack::pack_integer(destination, columns.span_ids[i]);
+      destination += keys.parent_id;
+      msgpack::pack_integer(destination, columns.parent_ids[i]);
+      destination += keys.start;
+      msgpack::pack_integer(destination, columns.starts[i]);
+      destination += keys.duration;
+      msgpack::pack_integer(destination, columns.durations[i]);
+      destination += keys.error;
+      msgpack::pack_integer(destination, std::int32_t(columns.errors[i]));
+
+      destination += keys.meta;
+      const std::size_t tags_begin = columns.tag_offsets[i];
+      const std::size_t tags_end = columns.tag_offsets[i + 1];
+      (void)msgpack::pack_map(destination, tags_end - tags_begin);
+      for (std::size_t j = tags_begin; j < tags_end; ++j) {
+        append_string(columns.tag_keys[j]);
+        append_string(columns.tag_values[j]);
+      }
+
+      destination += keys.metrics;
+      const std::size_t metrics_begin = columns.metric_offsets[i];
+      const std::size_t metrics_end = columns.metric_offsets[i + 1];
+      (void)msgpack::pack_map(destination, metrics_end - metrics_begin);
+      for (std::size_t j = metrics_begin; j < metrics_end; ++j) {
+        append_string(columns.metric_keys[j]);
+        msgpack::pack_double(destination, columns.metric_values[j]);
+      }
+
+      destination += keys.type;
+      append_string(columns.service_types[i]);
+    }
+  }
+
+  return nullopt;
+}
+
+Expected<void> msgpack_encode_v05(std::string& destination,
+                                  const SpanColumns& columns) {
+  (void)msgpack::pack_array(destination, 2);
+  auto result = msgpack::pack_array(destination, columns.string_count());
+  if (auto* error = result.if_error()) {
+    return std::move(*error);
+  }
+  for (std::size_t i = 0; i < columns.string_count(); ++i) {
+    result = msgpack::pack_string(
+        destination, columns.string(static_cast<SpanColumns::Handle>(i)));
+    if (auto* error = result.if_error()) {
+      return std::move(*error);
+    }
+  }
+
+  (void)msgpack::pack_array(destination, columns.chunk_count());
+  for (std::size_t chunk = 0; chunk < columns.chunk_count(); ++chunk) {
+    const std::size_t begin = columns.chunk_offsets[chunk];
+    const std::size_t end = columns.chunk_offsets[chunk + 1];
+    (void)msgpack::pack_array(destination, end - begin);
+    for (std::size_t i = begin; i < end; ++i) {
+      (void)msgpack::pack_array(destination, span_field_count);
+      msgpack::pack_integer(destination, columns.services[i]);
+      msgpack::pack_integer(destination, columns.names[i]);
+      msgpack::pack_integer(destination, columns.resources[i]);
+      msgpack::pack_integer(destination, columns.trace_ids[i]);
+      msgpack::pack_integer(destination, columns.span_ids[i]);
+      msgpack::pack_integer(destination, columns.parent_ids[i]);
+      msgpack::pack_integer(destination, columns.starts[i]);
+      msgpack::pack_integer(destination, columns.durations[i]);
+      msgpack::pack_integer(destination, std::int32_t(columns.errors[i]));
+
+      const std::size_t tags_begin = columns.tag_offsets[i];
+      const std::size_t tags_end = columns.tag_offsets[i + 1];
+      (void)msgpack::pack_map(destination, tags_end - tags_begin);
+      for (std::size_t j = tags_begin; j < tags_end; ++j) {
+        msgpack::pack_integer(destination, columns.tag_keys[j]);
+        msgpack::pack_integer(destination, columns.tag_values[j]);
+      }
+
+      const std::size_t metrics_begin = columns.metric_offsets[i];
+      const std::size_t metrics_end = columns.metric_offsets[i + 1];
+      (void)msgpack::pack_map(destination, metrics_end - metrics_begin);
+      for (std::size_t j = metrics_begin; j < metrics_end; ++j) {
+        msgpack::pack_integer(destination, columns.metric_keys[j]);
+        msgpack::pack_double(destination, columns.metric_values[j]);
+      }
+
+      msgpack::pack_integer(destination, columns.service_types[i]);
+    }
+  }
+
+  return nullopt;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,141 @@
+#pragma once
+
+// This component provides a class, `SpanColumns`, that stores the spans of one
+// or more trace chunks as a structure of arrays, and a function that
+// MessagePack encodes a `SpanColumns` as the body of a request to the Datadog
+// Agent's traces endpoint.
+//
+// Each `SpanData` is a separate heap object whose strings and tags are
+// separate heap objects, too.  Encoding a large batch of `SpanData` is mostly
+// pointer chasing, and strings that are the same in most spans, such as the
+// service name and tag names, are validated and encoded once per span.
+//
+// `SpanColumns` instead has one array per span field.  Integer fields are
+// stored by value, and string fields are stored as handles into a string pool
+// that contains each distinct string once.  The tags of all spans are stored
+// in two further pairs of arrays, one pair for string tags and one for numeric
+// tags, with each span's tags being a contiguous range.
+//
+// The encoder encodes each pooled string once, computes the exact size of the
+// result, and then copies each span's encoded fields in order.  The result is
+// byte-for-byte the same as that of encoding the original `SpanData` objects
+// with `msgpack_encode` from `span_data.h`.
+//
+// Encoding a `SpanColumns` is a fraction of the cost of encoding the same
+// `SpanData` objects, but copying `SpanData` objects into a `SpanColumns` costs
+// more than the difference, because each string must be looked up in the
+// pool.  So, `DatadogAgent` encodes `SpanData` objects directly for version
+// 0.4 of the Agent's traces API, and uses `SpanColumns` only for version 0.5,
+// whose string table, see `msgpack_encode_v05`, makes requests much smaller.
+// See `BM_EncodeChunk` in the benchmark.
+
+#include <datadog/expected.h>
+#include <datadog/string_view.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+struct SpanData;
+
+class SpanColumns {
+ public:
+  // A `Handle` refers to a string in the pool.
+  using Handle = std::uint32_t;
+
+ private:
+  struct Hash {
+    std::size_t operator()(StringView) const;
+  };
+
+  // `strings_[handle]` is the string referred to by `handle`.  The keys of
+  // `handles_` refer to the elements of `strings_`, which don't move.
+  std::deque<std::string> strings_;
+  std::unordered_map<StringView, Handle, Hash> handles_;
+
+ public:
+  // The following vectors contain one element per span.
+  std::vector<std::uint64_t> trace_ids;
+  std::vector<std::uint64_t> span_ids;
+  std::vector<std::uint64_t> parent_ids;
+  // nanoseconds since the Unix epoch
+  std::vector<std::uint64_t> starts;
+  // nanoseconds
+  std::vector<std::uint64_t> durations;
+  std::vector<std::uint8_t> errors;
+  std::vector<Handle> services;
+  std::vector<Handle> names;
+  std::vector<Handle> resources;
+  std::vector<Handle> service_types;
+
+  // The string tags of span `i` are at indices
+  // `[tag_offsets[i], tag_offsets[i + 1])` of `tag_keys` and `tag_values`.
+  std::vector<std::uint32_t> tag_offsets{0};
+  std::vector<Handle> tag_keys;
+  std::vector<Handle> tag_values;
+
+  // The numeric tags of span `i` are at indices
+  // `[metric_offsets[i], metric_offsets[i + 1])` of `metric_keys` and
+  // `metric_values`.
+  std::vector<std::uint32_t> metric_offsets{0};
+  std::vector<Handle> metric_keys;
+  std::vector<double> metric_values;
+
+  // The spans of trace chunk `i` are at indices
+  // `[chunk_offsets[i], chunk_offsets[i + 1])` of the span arrays.
+  std::vector<std::uint32_t> chunk_offsets{0};
+
+  SpanColumns() = default;
+  // The string pool refers to itself, so `SpanColumns` can be moved but not
+  // copied.
+  SpanColumns(const SpanColumns&) = delete;
+  SpanColumns(SpanColumns&&) = default;
+  SpanColumns& operator=(const SpanColumns&) = delete;
+  SpanColumns& operator=(SpanColumns&&) = default;
+
+  // Append the specified `spans` as a new trace chunk.  The behavior is
+  // undefined if any span is `nullptr`.
+  void append_chunk(const std::vector<std::unique_ptr<SpanData>>& spans);
+
+  // Return the handle of the pooled string equal to the specified `value`,
+  // adding `value` to the pool if necessary.
+  Handle intern(StringView value);
+
+  // Return the pooled string referred to by the specified `handle`.
+  const std::string& string(Handle handle) const;
+
+  // Return the number of distinct strings in the pool.
+  std::size_t string_count() const;
+
+  // Return the total number of spans in all chunks.
+  std::size_t span_count() const;
+
+  // Return the number of trace chunks.
+  std::size_t chunk_count() const;
+};
+
+// Append to the specified `destination` the MessagePack representation of an
+// array containing, for each trace chunk in the specified `columns`, an array
+// of the chunk's spans.
+Expected<void> msgpack_encode(std::string& destination,
+                              const SpanColumns& columns);
+
+// Append to the specified `destination` the MessagePack representation of the
+// specified `columns` in version 0.5 of the Datadog Agent's traces format.
+// That is an array of two elements: an array of the pooled strings in handle
+// order, and an array containing, for each trace chunk, an array of the
+// chunk's spans.  Each span is an array of its fields in the order used by
+// `msgpack_encode`, with each string replaced by its handle.  The Agent
+// expects the first pooled string to be empty.
+Expected<void> msgpack_encode_v05(std::string& destination,
+                                  const SpanColumns& columns);
+
+}  // namespace tracing
+}  // namespace datadog
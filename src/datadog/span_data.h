@@ -17,6 +17,7 @@
 namespace datadog {
 namespace tracing {
 
+struct CapturedStack;
 struct SpanConfig;
 struct SpanDefaults;
 
@@ -33,6 +34,10 @@ struct SpanData {
   bool error = false;
   std::unordered_map<std::string, std::string> tags;
   std::unordered_map<std::string, double> numeric_tags;
+  // The call stack captured by `Span::capture_error_stack`, if any, until it
+  // is symbolized into the "error.stack" tag by the collector.  See
+  // `collector.h` and `stack_trace.h`.
+  std::shared_ptr<const CapturedStack> error_stack;
 
   Optional<StringView> environment() const;
   Optional<StringView> version() const;
@@ -0,0 +1,42 @@
+#include <datadog/span_config.h>
+#include <datadog/span_defaults.h>
+#include <datadog/span_prototype.h>
+
+#include <cassert>
+
+#include "span_data.h"
+
+namespace datadog {
+namespace tracing {
+
+SpanPrototype::SpanPrototype(
+    const std::shared_ptr<const SpanDefaults>& defaults,
+    const SpanConfig& config)
+    : defaults_(defaults) {
+  assert(defaults_);
+  auto stripped = std::make_shared<SpanConfig>(config);
+  stripped->start = nullopt;
+  config_ = std::move(stripped);
+
+  // The start time is overwritten when the prototype is instantiated.
+  auto data = std::make_shared<SpanData>();
+  data->apply_config(*defaults_, *config_, []() { return TimePoint{}; });
+  data_ = std::move(data);
+}
+
+std::unique_ptr<SpanData> SpanPrototype::instantiate(
+    const SpanDefaults& defaults, const Clock& clock) const {
+  if (&defaults != defaults_.get()) {
+    // The defaults changed after this prototype was created.
+    auto span = std::make_unique<SpanData>();
+    span->apply_config(defaults, *config_, clock);
+    return span;
+  }
+
+  auto span = std::make_unique<SpanData>(*data_);
+  span->start = clock();
+  return span;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -38,7 +38,7 @@ SamplingDecision SpanSampler::Rule::decide(const SpanData& span) {
     return decision;
   }
 
-  std::lock_guard<std::mutex> lock(limiter_->mutex);
+  std::lock_guard<Mutex> lock(limiter_->mutex);
   const auto result = limiter_->limiter.allow();
   if (result.allowed) {
     decision.priority = int(SamplingPriority::USER_KEEP);
@@ -19,6 +19,7 @@
 // sampling rules.
 
 #include <datadog/clock.h>
+#include <datadog/mutex.h>
 #include <datadog/sampling_decision.h>
 #include <datadog/span_sampler_config.h>
 
@@ -34,7 +35,7 @@ namespace tracing {
 class SpanSampler {
  public:
   struct SynchronizedLimiter {
-    std::mutex mutex;
+    Mutex mutex{LockSite::SPAN_SAMPLER_LIMITER};
     Limiter limiter;
 
     SynchronizedLimiter(const Clock&, double max_per_second);
@@ -0,0 +1,119 @@
+#include "stack_trace.h"
+
+#if defined(__APPLE__) || defined(__linux__) || defined(__unix__)
+#  include <cxxabi.h>
+#  include <dlfcn.h>
+#  include <unwind.h>
+#  define DD_TRACE_UNWIND
+#elif defined(_MSC_VER)
+#  include <windows.h>
+#endif
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "hex.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+#if defined(DD_TRACE_UNWIND)
+struct UnwindState {
+  CapturedStack* stack;
+  std::size_t skip;
+};
+
+_Unwind_Reason_Code record_frame(_Unwind_Context* context, void* arg) {
+  auto& state = *static_cast<UnwindState*>(arg);
+  if (state.skip > 0) {
+    --state.skip;
+    return _URC_NO_REASON;
+  }
+
+  const std::uintptr_t address = _Unwind_GetIP(context);
+  if (address == 0) {
+    return _URC_END_OF_STACK;
+  }
+  CapturedStack& stack = *state.stack;
+  stack.frames[stack.size++] = reinterpret_cast<void*>(address);
+  if (stack.size == CapturedStack::max_frames) {
+    return _URC_END_OF_STACK;
+  }
+  return _URC_NO_REASON;
+}
+#endif
+
+std::string describe(const void* frame) {
+  const auto address = reinterpret_cast<std::uintptr_t>(frame);
+  std::string description = "0x";
+  description += hex(address);
+
+#if defined(DD_TRACE_UNWIND)
+  // A return address is just past its call instruction, which might be the
+  // last instruction of the function, so look up the byte before it.
+  Dl_info info;
+  if (dladdr(reinterpret_cast<const void*>(address - 1), &info) == 0) {
+    return description;
+  }
+  if (info.dli_sname && info.dli_saddr) {
+    description += ' ';
+    int status = 0;
+    char* demangled =
+        abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    description += status == 0 ? demangled : info.dli_sname;
+    std::free(demangled);
+    description += "+0x";
+    description += hex(address - std::uintptr_t(info.dli_saddr));
+  }
+  if (info.dli_fname && info.dli_fbase) {
+    description += " (";
+    description += info.dli_fname;
+    description += "+0x";
+    description += hex(address - std::uintptr_t(info.dli_fbase));
+    description += ')';
+  }
+#endif
+
+  return description;
+}
+
+}  // namespace
+
+void capture_stack(CapturedStack& stack, std::size_t skip) {
+  stack.size = 0;
+#if defined(DD_TRACE_UNWIND)
+  // The first frame unwound is that of this function.
+  UnwindState state{&stack, skip + 1};
+  _Unwind_Backtrace(record_frame, &state);
+#elif defined(_MSC_VER)
+  stack.size = RtlCaptureStackBackTrace(
+      DWORD(skip + 1), DWORD(CapturedStack::max_frames), stack.frames, nullptr);
+#else
+  (void)skip;
+#endif
+}
+
+std::string StackSymbolizer::symbolize(const CapturedStack& stack) {
+  std::string result;
+  for (std::size_t i = 0; i < stack.size; ++i) {
+    auto found = cache_.find(stack.frames[i]);
+    if (found == cache_.end()) {
+      if (cache_.size() == max_cache_size) {
+        cache_.clear();
+      }
+      found = cache_.emplace(stack.frames[i], describe(stack.frames[i])).first;
+    }
+    if (i != 0) {
+      result += '\n';
+    }
+    result += '#';
+    result += std::to_string(i);
+    result += ' ';
+    result += found->second;
+  }
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
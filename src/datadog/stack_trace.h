@@ -0,0 +1,62 @@
+#pragma once
+
+// This component provides a `struct`, `CapturedStack`, that holds the return
+// addresses of a call stack; a function, `capture_stack`, that fills a
+// `CapturedStack` from the calling thread's call stack; and a `class`,
+// `StackSymbolizer`, that describes a `CapturedStack` as text.
+//
+// Capturing a stack only walks the stack's frames, and so is cheap enough to
+// do on a thread that is handling a request.  Symbolizing a stack looks up
+// the function and module containing each return address, which is much more
+// expensive.  `Span::capture_error_stack` captures a stack, and the
+// `DatadogAgent` symbolizes it into the span's "error.stack" tag when it
+// flushes the span's trace, on its own thread, and only if the span is kept.
+// Other collectors must symbolize captured stacks themselves.  See
+// `collector.h`.
+//
+// On Windows, and on other platforms without `_Unwind_Backtrace` and
+// `dladdr`, frames are described by their addresses only.
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+namespace datadog {
+namespace tracing {
+
+struct CapturedStack {
+  // Frames beyond this many from the top of the stack are not captured.
+  static constexpr std::size_t max_frames = 64;
+
+  // `frames[0]` is the innermost frame.
+  void* frames[max_frames];
+  std::size_t size = 0;
+};
+
+// Store into the specified `stack` the return addresses of the calling
+// thread's call stack, starting with the caller of `capture_stack` and
+// omitting the specified `skip` frames after it.
+void capture_stack(CapturedStack& stack, std::size_t skip = 0);
+
+// `StackSymbolizer` remembers the description of each address that it has
+// symbolized, so that the common frames of many stacks are symbolized once.
+// `StackSymbolizer` is not thread-safe.
+class StackSymbolizer {
+  std::unordered_map<const void*, std::string> cache_;
+
+ public:
+  // When the cache has this many entries, it is cleared rather than grown.
+  static constexpr std::size_t max_cache_size = 4096;
+
+  // Return a description of the specified `stack` with one line per frame,
+  // e.g.
+  //
+  //     #0 0x55d4c2a1b2c3 handle(Request const&)+0x4f (/usr/bin/app+0x1b2c3)
+  //
+  // where the offset within the module allows the frame to be symbolized
+  // offline when the function's name is not available.
+  std::string symbolize(const CapturedStack& stack);
+};
+
+}  // namespace tracing
+}  // namespace datadog
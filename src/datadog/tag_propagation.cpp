@@ -64,10 +64,12 @@ void append_tag(std::string& serialized_tags, StringView tag_key,
 Expected<std::vector<std::pair<std::string, std::string>>> decode_tags(
     StringView header_value) {
   std::vector<std::pair<std::string, std::string>> tags;
-  tags.reserve(header_value.size());
-
   if (header_value.empty()) return tags;
 
+  // There's one tag per comma-separated entry.  Reserving one per byte of the
+  // header instead would allocate dozens of times the header's size.
+  tags.reserve(std::count(header_value.begin(), header_value.end(), ',') + 1);
+
   std::size_t beg = 0;
   for (std::size_t i = 0; i < header_value.size(); ++i) {
     if (header_value[i] == ',') {
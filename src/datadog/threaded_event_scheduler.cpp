@@ -38,7 +38,7 @@ EventScheduler::Cancel ThreadedEventScheduler::schedule_recurring_event(
   auto config = std::make_shared<EventConfig>(std::move(callback), interval);
 
   {
-    std::lock_guard<std::mutex> guard(mutex_);
+    std::lock_guard<Mutex> guard(mutex_);
     upcoming_.push(ScheduledRun{now + interval, config});
     schedule_or_shutdown_.notify_one();
   }
@@ -49,7 +49,7 @@ EventScheduler::Cancel ThreadedEventScheduler::schedule_recurring_event(
       return;
     }
 
-    std::unique_lock<std::mutex> lock(mutex_);
+    std::unique_lock<Mutex> lock(mutex_);
     config->cancelled = true;
     current_done_.wait(lock, [this, &config]() {
       return !running_current_ || current_.config != config;
@@ -65,7 +65,7 @@ std::string ThreadedEventScheduler::config() const {
 }
 
 void ThreadedEventScheduler::run() {
-  std::unique_lock<std::mutex> lock(mutex_);
+  std::unique_lock<Mutex> lock(mutex_);
 
   for (;;) {
     schedule_or_shutdown_.wait(
@@ -6,6 +6,7 @@
 // `DatadogAgent::event_scheduler` is not specified.
 
 #include <datadog/event_scheduler.h>
+#include <datadog/mutex.h>
 
 #include <chrono>
 #include <condition_variable>
@@ -38,11 +39,11 @@ class ThreadedEventScheduler : public EventScheduler {
     bool operator()(const ScheduledRun&, const ScheduledRun&) const;
   };
 
-  std::mutex mutex_;
+  Mutex mutex_{LockSite::EVENT_SCHEDULER};
   ScheduledRun current_;
-  std::condition_variable schedule_or_shutdown_;
+  std::condition_variable_any schedule_or_shutdown_;
   bool running_current_;
-  std::condition_variable current_done_;
+  std::condition_variable_any current_done_;
   std::priority_queue<ScheduledRun, std::vector<ScheduledRun>, GreaterThan>
       upcoming_;
   bool shutting_down_;
@@ -0,0 +1,400 @@
+#include <datadog/logger.h>
+#include <datadog/trace_capture.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include "json.hpp"
+#include "span_data.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// A capture file begins with this magic string, which includes the version
+// of the format.
+constexpr char file_magic[] = "DDTRCAP2";
+constexpr std::size_t file_magic_size = sizeof file_magic - 1;
+
+// Each record begins with one of these bytes.  A reset record has no
+// contents.  It indicates that subsequent records do not refer to strings
+// written before it.
+constexpr char headers_record = 'H';
+constexpr char chunk_record = 'C';
+constexpr char reset_record = 'R';
+
+// Records are accumulated in memory and written to the file once the buffer
+// exceeds this size.
+constexpr std::size_t buffer_flush_threshold = 64 * 1024;
+
+void write_varint(std::string& destination, std::uint64_t value) {
+  while (value >= 0x80) {
+    destination += char((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  destination += char(value);
+}
+
+void write_double(std::string& destination, double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof bits);
+  for (int i = 0; i < 8; ++i) {
+    destination += char(bits >> (8 * i));
+  }
+}
+
+std::uint64_t to_nanoseconds(std::chrono::nanoseconds value) {
+  return value.count() < 0 ? 0 : std::uint64_t(value.count());
+}
+
+Error io_error(const std::string& path, const char* operation) {
+  std::string message = "Unable to ";
+  message += operation;
+  message += " trace capture file \"";
+  message += path;
+  message += "\": ";
+  message += std::strerror(errno);
+  return Error{Error::TRACE_CAPTURE_IO_ERROR, std::move(message)};
+}
+
+// `Decoder` reads the elements of a capture file that has been loaded into
+// memory.  The first malformed element encountered puts the decoder into an
+// error state, after which all reads yield zero values.
+class Decoder {
+  StringView input_;
+  std::size_t offset_ = 0;
+  std::vector<std::string> strings_;
+  bool failed_ = false;
+
+ public:
+  explicit Decoder(StringView input) : input_(input) {}
+
+  bool failed() const { return failed_; }
+  bool done() const { return failed_ || offset_ == input_.size(); }
+  std::size_t offset() const { return offset_; }
+
+  void fail() { failed_ = true; }
+
+  // Forget the strings read so far.
+  void reset_strings() { strings_.clear(); }
+
+  char byte() {
+    if (failed_ || offset_ == input_.size()) {
+      failed_ = true;
+      return 0;
+    }
+    return input_[offset_++];
+  }
+
+  std::uint64_t varint() {
+    std::uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      const auto b = static_cast<unsigned char>(byte());
+      result |= std::uint64_t(b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+        return result;
+      }
+    }
+    failed_ = true;
+    return 0;
+  }
+
+  double float64() {
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i) {
+      bits |= std::uint64_t(static_cast<unsigned char>(byte())) << (8 * i);
+    }
+    double result;
+    std::memcpy(&result, &bits, sizeof result);
+    return result;
+  }
+
+  // Read a string, which is either an index of a previously read string, or
+  // zero followed by a new string.
+  std::string string() {
+    const std::uint64_t index = varint();
+    if (index != 0) {
+      if (index > strings_.size()) {
+        failed_ = true;
+        return std::string{};
+      }
+      return strings_[index - 1];
+    }
+    const std::uint64_t size = varint();
+    if (failed_ || size > input_.size() - offset_) {
+      failed_ = true;
+      return std::string{};
+    }
+    strings_.emplace_back(input_.substr(offset_, size));
+    offset_ += size;
+    return strings_.back();
+  }
+};
+
+}  // namespace
+
+TraceCapture::TraceCapture(const std::string& path, std::FILE* file)
+    : path_(path), file_(file) {
+  buffer_.append(file_magic, file_magic_size);
+}
+
+Expected<std::shared_ptr<TraceCapture>> TraceCapture::create(
+    const std::string& path) {
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return io_error(path, "create");
+  }
+  return std::shared_ptr<TraceCapture>(new TraceCapture(path, file));
+}
+
+TraceCapture::~TraceCapture() {
+  flush();
+  std::fclose(file_);
+}
+
+void TraceCapture::begin_record(char type) {
+  // The table of strings is reset only between records, so that each record
+  // can be decoded using the strings written since the last reset.
+  if (strings_.size() >= max_strings || string_bytes_ >= max_string_bytes) {
+    buffer_ += reset_record;
+    strings_.clear();
+    string_bytes_ = 0;
+  }
+  buffer_ += type;
+}
+
+void TraceCapture::write_string(const std::string& value) {
+  const auto [iter, inserted] = strings_.emplace(value, strings_.size() + 1);
+  if (!inserted) {
+    write_varint(buffer_, iter->second);
+    return;
+  }
+  string_bytes_ += value.size();
+  write_varint(buffer_, 0);
+  write_varint(buffer_, value.size());
+  buffer_ += value;
+}
+
+Expected<void> TraceCapture::end_record() {
+  if (buffer_.size() >= buffer_flush_threshold) {
+    return write_buffer();
+  }
+  return nullopt;
+}
+
+Expected<void> TraceCapture::write_buffer() {
+  if (buffer_.empty()) {
+    return nullopt;
+  }
+  const std::size_t written =
+      std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+  const bool failed = written != buffer_.size();
+  buffer_.clear();
+  if (failed) {
+    error_ = io_error(path_, "write");
+    strings_.clear();
+    return *error_;
+  }
+  return nullopt;
+}
+
+Expected<void> TraceCapture::record_headers(
+    TraceID trace_id,
+    const std::vector<std::pair<std::string, std::string>>& headers) {
+  std::lock_guard<Mutex> lock(mutex_);
+  if (error_) {
+    return nullopt;
+  }
+  begin_record(headers_record);
+  write_varint(buffer_, trace_id.low);
+  write_varint(buffer_, trace_id.high);
+  write_varint(buffer_, headers.size());
+  for (const auto& [key, value] : headers) {
+    write_string(key);
+    write_string(value);
+  }
+  return end_record();
+}
+
+Expected<void> TraceCapture::record_chunk(const Chunk& chunk) {
+  std::lock_guard<Mutex> lock(mutex_);
+  if (error_) {
+    return nullopt;
+  }
+  begin_record(chunk_record);
+  write_varint(buffer_, chunk.size());
+  for (const auto& span_ptr : chunk) {
+    const SpanData& span = *span_ptr;
+    write_string(span.service);
+    write_string(span.service_type);
+    write_string(span.name);
+    write_string(span.resource);
+    write_varint(buffer_, span.trace_id.low);
+    write_varint(buffer_, span.trace_id.high);
+    write_varint(buffer_, span.span_id);
+    write_varint(buffer_, span.parent_id);
+    write_varint(buffer_, to_nanoseconds(span.start.wall.time_since_epoch()));
+    write_varint(buffer_, to_nanoseconds(span.duration));
+    buffer_ += char(span.error);
+    write_varint(buffer_, span.tags.size());
+    for (const auto& [key, value] : span.tags) {
+      write_string(key);
+      write_string(value);
+    }
+    write_varint(buffer_, span.numeric_tags.size());
+    for (const auto& [key, value] : span.numeric_tags) {
+      write_string(key);
+      write_double(buffer_, value);
+    }
+  }
+  return end_record();
+}
+
+Expected<void> TraceCapture::flush() {
+  std::lock_guard<Mutex> lock(mutex_);
+  if (error_) {
+    return nullopt;
+  }
+  if (auto result = write_buffer(); !result) {
+    return result;
+  }
+  if (std::fflush(file_) != 0) {
+    error_ = io_error(path_, "write");
+    return *error_;
+  }
+  return nullopt;
+}
+
+Optional<Error> TraceCapture::error() const {
+  std::lock_guard<Mutex> lock(mutex_);
+  return error_;
+}
+
+Expected<std::vector<TraceCapture::Record>> TraceCapture::read(
+    const std::string& path) {
+  std::FILE* file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return io_error(path, "open");
+  }
+  std::string contents;
+  char block[64 * 1024];
+  std::size_t count;
+  while ((count = std::fread(block, 1, sizeof block, file)) != 0) {
+    contents.append(block, count);
+  }
+  const bool read_failed = std::ferror(file);
+  std::fclose(file);
+  if (read_failed) {
+    return io_error(path, "read");
+  }
+
+  if (contents.compare(0, file_magic_size, file_magic) != 0) {
+    std::string message = "\"";
+    message += path;
+    message += "\" is not a trace capture file of a supported version.";
+    return Error{Error::TRACE_CAPTURE_MALFORMED, std::move(message)};
+  }
+
+  Decoder decoder{StringView{contents}.substr(file_magic_size)};
+  std::vector<Record> records;
+  while (!decoder.done()) {
+    const char type = decoder.byte();
+    if (type == reset_record) {
+      decoder.reset_strings();
+    } else if (type == headers_record) {
+      Headers headers;
+      headers.trace_id.low = decoder.varint();
+      headers.trace_id.high = decoder.varint();
+      const std::uint64_t count = decoder.varint();
+      for (std::uint64_t i = 0; i < count && !decoder.failed(); ++i) {
+        auto key = decoder.string();
+        auto value = decoder.string();
+        headers.headers.emplace_back(std::move(key), std::move(value));
+      }
+      records.emplace_back(std::move(headers));
+    } else if (type == chunk_record) {
+      Chunk chunk;
+      const std::uint64_t count = decoder.varint();
+      for (std::uint64_t i = 0; i < count && !decoder.failed(); ++i) {
+        auto span = std::make_unique<SpanData>();
+        span->service = decoder.string();
+        span->service_type = decoder.string();
+        span->name = decoder.string();
+        span->resource = decoder.string();
+        span->trace_id.low = decoder.varint();
+        span->trace_id.high = decoder.varint();
+        span->span_id = decoder.varint();
+        span->parent_id = decoder.varint();
+        // Only the wall clock start time is recorded.  The tick is derived
+        // from it so that the span's time point is self-consistent.
+        const std::chrono::nanoseconds start{decoder.varint()};
+        span->start.wall = std::chrono::system_clock::time_point{
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                start)};
+        span->start.tick = std::chrono::steady_clock::time_point{
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                start)};
+        span->duration = std::chrono::nanoseconds{decoder.varint()};
+        span->error = decoder.byte() != 0;
+        const std::uint64_t tag_count = decoder.varint();
+        for (std::uint64_t j = 0; j < tag_count && !decoder.failed(); ++j) {
+          auto key = decoder.string();
+          span->tags.insert_or_assign(std::move(key), decoder.string());
+        }
+        const std::uint64_t metric_count = decoder.varint();
+        for (std::uint64_t j = 0; j < metric_count && !decoder.failed();
+             ++j) {
+          auto key = decoder.string();
+          span->numeric_tags.insert_or_assign(std::move(key),
+                                              decoder.float64());
+        }
+        chunk.push_back(std::move(span));
+      }
+      records.emplace_back(std::move(chunk));
+    } else {
+      decoder.fail();
+    }
+
+    if (decoder.failed()) {
+      std::string message = "Trace capture file \"";
+      message += path;
+      message += "\" is malformed or truncated near offset ";
+      message += std::to_string(file_magic_size + decoder.offset());
+      message += '.';
+      return Error{Error::TRACE_CAPTURE_MALFORMED, std::move(message)};
+    }
+  }
+
+  return records;
+}
+
+RecordingCollector::RecordingCollector(
+    const std::shared_ptr<Collector>& collector,
+    const std::shared_ptr<TraceCapture>& capture,
+    const std::shared_ptr<Logger>& logger)
+    : collector_(collector), capture_(capture), logger_(logger) {}
+
+Expected<void> RecordingCollector::send(
+    std::vector<std::unique_ptr<SpanData>>&& spans,
+    const std::shared_ptr<TraceSampler>& response_handler) {
+  auto recorded = capture_->record_chunk(spans);
+  if (auto* error = recorded.if_error()) {
+    logger_->log_error(*error);
+  }
+  return collector_->send(std::move(spans), response_handler);
+}
+
+std::string RecordingCollector::config() const {
+  // clang-format off
+  return nlohmann::json::object({
+    {"type", "datadog::tracing::RecordingCollector"},
+    {"config", nlohmann::json::object({
+      {"collector", nlohmann::json::parse(collector_->config())},
+    })},
+  }).dump();
+  // clang-format on
+}
+
+}  // namespace tracing
+}  // namespace datadog
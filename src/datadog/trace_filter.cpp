@@ -0,0 +1,172 @@
+#include "trace_filter.h"
+
+#include <datadog/error.h>
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <unordered_set>
+
+#include "glob.h"
+#include "json_serializer.h"
+#include "span_data.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+char fold_case(char c) {
+  return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+std::string lower(StringView text) {
+  std::string result;
+  result.reserve(text.size());
+  std::transform(text.begin(), text.end(), std::back_inserter(result),
+                 fold_case);
+  return result;
+}
+
+// Return whether the specified `subject` equals the specified `lowered`,
+// ignoring the case of `subject`.
+bool equals_folded(StringView subject, StringView lowered) {
+  return subject.size() == lowered.size() &&
+         std::equal(subject.begin(), subject.end(), lowered.begin(),
+                    [](char s, char l) { return fold_case(s) == l; });
+}
+
+}  // namespace
+
+TraceFilter::Pattern::Pattern(StringView glob) {
+  const auto is_wild = [](char c) { return c == '*' || c == '?'; };
+  const auto first_wild = std::find_if(glob.begin(), glob.end(), is_wild);
+  if (first_wild == glob.end()) {
+    kind_ = Kind::LITERAL;
+    text_ = lower(glob);
+    return;
+  }
+
+  const auto is_star = [](char c) { return c == '*'; };
+  if (std::all_of(glob.begin(), glob.end(), is_star)) {
+    kind_ = Kind::ANY;
+    return;
+  }
+
+  // "abc*" is a prefix, and "*abc" is a suffix.
+  const std::size_t literal_begin = glob.find_first_not_of('*');
+  const std::size_t literal_end = glob.find_last_not_of('*') + 1;
+  const StringView literal =
+      glob.substr(literal_begin, literal_end - literal_begin);
+  if (std::none_of(literal.begin(), literal.end(), is_wild)) {
+    if (literal_begin == 0) {
+      kind_ = Kind::PREFIX;
+      text_ = lower(literal);
+      return;
+    }
+    if (literal_end == glob.size()) {
+      kind_ = Kind::SUFFIX;
+      text_ = lower(literal);
+      return;
+    }
+  }
+
+  kind_ = Kind::GLOB;
+  text_ = std::string(glob);
+}
+
+bool TraceFilter::Pattern::match(StringView subject) const {
+  switch (kind_) {
+    case Kind::ANY:
+      return true;
+    case Kind::LITERAL:
+      return equals_folded(subject, text_);
+    case Kind::PREFIX:
+      return subject.size() >= text_.size() &&
+             equals_folded(subject.substr(0, text_.size()), text_);
+    case Kind::SUFFIX:
+      return subject.size() >= text_.size() &&
+             equals_folded(subject.substr(subject.size() - text_.size()),
+                           text_);
+    case Kind::GLOB:
+      break;
+  }
+  return glob_match(text_, subject);
+}
+
+TraceFilter::TraceFilter(std::vector<SpanMatcher> rules)
+    : matchers_(std::move(rules)) {
+  rules_.reserve(matchers_.size());
+  for (const auto& matcher : matchers_) {
+    Rule rule{Pattern{matcher.service}, Pattern{matcher.name},
+              Pattern{matcher.resource}, {}};
+    for (const auto& [key, pattern] : matcher.tags) {
+      rule.tags.emplace_back(key, Pattern{pattern});
+    }
+    rules_.push_back(std::move(rule));
+  }
+}
+
+bool TraceFilter::match(const SpanData& span) const {
+  return std::any_of(rules_.begin(), rules_.end(), [&](const Rule& rule) {
+    return rule.service.match(span.service) && rule.name.match(span.name) &&
+           rule.resource.match(span.resource) &&
+           std::all_of(rule.tags.begin(), rule.tags.end(),
+                       [&](const auto& entry) {
+                         const auto& [key, pattern] = entry;
+                         auto found = span.tags.find(key);
+                         return found != span.tags.end() &&
+                                pattern.match(found->second);
+                       });
+  });
+}
+
+bool TraceFilter::empty() const { return rules_.empty(); }
+
+nlohmann::json TraceFilter::config_json() const {
+  return nlohmann::json(matchers_);
+}
+
+Expected<std::vector<SpanMatcher>> parse_trace_filter_rules(
+    const nlohmann::json& json_rules) {
+  if (!json_rules.is_array()) {
+    std::string message;
+    message += "Trace filter rules must be an array, but this has type \"";
+    message += json_rules.type_name();
+    message += "\": ";
+    message += json_rules.dump();
+    return Error{Error::TRACE_FILTER_RULES_WRONG_TYPE, std::move(message)};
+  }
+
+  const std::unordered_set<std::string> allowed_properties{
+      "service", "name", "resource", "tags"};
+
+  std::vector<SpanMatcher> rules;
+  for (const auto& json_rule : json_rules) {
+    auto matcher = from_json(json_rule);
+    if (auto* error = matcher.if_error()) {
+      return error->with_prefix("Unable to create a trace filter rule: ");
+    }
+
+    for (const auto& [key, value] : json_rule.items()) {
+      if (allowed_properties.count(key)) {
+        continue;
+      }
+      std::string message;
+      message += "Unexpected property \"";
+      message += key;
+      message += "\" having value ";
+      message += value.dump();
+      message += " in trace filter rule ";
+      message += json_rule.dump();
+      return Error{Error::TRACE_FILTER_RULES_UNKNOWN_PROPERTY,
+                   std::move(message)};
+    }
+
+    rules.push_back(std::move(*matcher));
+  }
+
+  return rules;
+}
+
+}  // namespace tracing
+}  // namespace datadog
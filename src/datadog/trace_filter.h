@@ -0,0 +1,74 @@
+#pragma once
+
+// This component provides a `class`, `TraceFilter`, that decides whether a new
+// trace is filtered, i.e. turned into a trace that is neither finalized nor
+// sent.  See `trace_filter_config.h`.
+//
+// `TraceFilter` is consulted for every root span, and so compiles its rules
+// when it is constructed.  Each glob pattern is classified as matching
+// anything, a literal, a literal prefix, a literal suffix, or a general
+// pattern, and only general patterns are matched using `glob_match`.  The
+// literal parts of patterns are folded to lower case once, ahead of time.
+//
+// A `TraceFilter` is immutable.  `ConfigManager` replaces the `TraceFilter`
+// when Remote Configuration changes the rules.
+
+#include <datadog/expected.h>
+#include <datadog/span_matcher.h>
+#include <datadog/string_view.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json.hpp"
+
+namespace datadog {
+namespace tracing {
+
+struct SpanData;
+
+class TraceFilter {
+  // `Pattern` is a compiled glob pattern.  See `glob.h`.
+  class Pattern {
+    enum class Kind { ANY, LITERAL, PREFIX, SUFFIX, GLOB };
+    Kind kind_;
+    // `LITERAL`, `PREFIX`, and `SUFFIX` patterns keep their literal part in
+    // lower case.  `GLOB` patterns keep the original pattern.
+    std::string text_;
+
+   public:
+    explicit Pattern(StringView glob);
+    bool match(StringView subject) const;
+  };
+
+  struct Rule {
+    Pattern service;
+    Pattern name;
+    Pattern resource;
+    std::vector<std::pair<std::string, Pattern>> tags;
+  };
+
+  std::vector<Rule> rules_;
+  std::vector<SpanMatcher> matchers_;
+
+ public:
+  explicit TraceFilter(std::vector<SpanMatcher> rules);
+
+  // Return whether the specified root `span` matches any of the rules.
+  bool match(const SpanData& span) const;
+
+  // Return whether there are no rules, in which case no trace is filtered.
+  bool empty() const;
+
+  nlohmann::json config_json() const;
+};
+
+// Return the trace filter rules in the specified `rules`, which must be a JSON
+// array of objects each having any of the properties "service", "name",
+// "resource", and "tags", or return an error.
+Expected<std::vector<SpanMatcher>> parse_trace_filter_rules(
+    const nlohmann::json& rules);
+
+}  // namespace tracing
+}  // namespace datadog
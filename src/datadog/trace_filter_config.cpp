@@ -0,0 +1,64 @@
+#include <datadog/environment.h>
+#include <datadog/error.h>
+#include <datadog/trace_filter_config.h>
+
+#include <string>
+#include <utility>
+
+#include "json.hpp"
+#include "json_serializer.h"
+#include "trace_filter.h"
+
+namespace datadog {
+namespace tracing {
+
+Expected<FinalizedTraceFilterConfig> finalize_config(
+    const TraceFilterConfig& user_config) {
+  FinalizedTraceFilterConfig result;
+
+  if (auto rules_env = lookup(environment::DD_TRACE_FILTER_RULES)) {
+    const auto env_var = name(environment::DD_TRACE_FILTER_RULES);
+    nlohmann::json json_rules;
+    try {
+      json_rules = nlohmann::json::parse(*rules_env);
+    } catch (const nlohmann::json::parse_error& error) {
+      std::string message;
+      message += "Unable to parse JSON from ";
+      append(message, env_var);
+      message += " value ";
+      append(message, *rules_env);
+      message += ": ";
+      message += error.what();
+      return Error{Error::TRACE_FILTER_RULES_INVALID_JSON, std::move(message)};
+    }
+
+    auto maybe_rules = parse_trace_filter_rules(json_rules);
+    if (auto* error = maybe_rules.if_error()) {
+      std::string prefix;
+      prefix += "With ";
+      append(prefix, env_var);
+      prefix += '=';
+      append(prefix, *rules_env);
+      prefix += ": ";
+      return error->with_prefix(prefix);
+    }
+    result.rules = std::move(*maybe_rules);
+    result.metadata[ConfigName::TRACE_FILTER_RULES] =
+        ConfigMetadata(ConfigName::TRACE_FILTER_RULES, json_rules.dump(),
+                       ConfigMetadata::Origin::ENVIRONMENT_VARIABLE);
+  } else if (!user_config.rules.empty()) {
+    result.rules = user_config.rules;
+    result.metadata[ConfigName::TRACE_FILTER_RULES] = ConfigMetadata(
+        ConfigName::TRACE_FILTER_RULES, nlohmann::json(result.rules).dump(),
+        ConfigMetadata::Origin::CODE);
+  } else {
+    result.metadata[ConfigName::TRACE_FILTER_RULES] =
+        ConfigMetadata(ConfigName::TRACE_FILTER_RULES, "[]",
+                       ConfigMetadata::Origin::DEFAULT);
+  }
+
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
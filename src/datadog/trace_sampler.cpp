@@ -7,6 +7,7 @@
 #include <cassert>
 #include <cstdint>
 #include <limits>
+#include <vector>
 
 #include "collector_response.h"
 #include "json_serializer.h"
@@ -17,6 +18,9 @@ namespace datadog {
 namespace tracing {
 namespace {
 
+// how often the limiters of a sharded sampler are rebalanced
+constexpr std::chrono::seconds rebalance_interval{1};
+
 nlohmann::json to_json(const TraceSamplerRule& rule) {
   nlohmann::json j = rule.matcher;
   j["sample_rate"] = rule.rate.value();
@@ -25,11 +29,17 @@ nlohmann::json to_json(const TraceSamplerRule& rule) {
 
 }  // namespace
 
+TraceSampler::Shard::Shard(const Clock& clock, double allowed_per_second)
+    : limiter(clock, allowed_per_second) {}
+
 TraceSampler::TraceSampler(const FinalizedTraceSamplerConfig& config,
-                           const Clock& clock)
+                           const Clock& clock, std::size_t shards)
     : rules_(config.rules),
-      limiter_(clock, config.max_per_second),
-      limiter_max_per_second_(config.max_per_second) {}
+      limiter_max_per_second_(config.max_per_second),
+      clock_(clock),
+      shards_(shards, clock, config.max_per_second / shards),
+      next_rebalance_(
+          (clock().tick + rebalance_interval).time_since_epoch().count()) {}
 
 void TraceSampler::set_rules(std::vector<TraceSamplerRule> rules) {
   std::lock_guard lock(mutex_);
@@ -45,9 +55,14 @@ SamplingDecision TraceSampler::decide(const SpanData& span) {
       std::find_if(rules_.cbegin(), rules_.cend(),
                    [&](const auto& it) { return it.matcher.match(span); });
 
-  // `mutex_` protects `limiter_`, `collector_sample_rates_`, and
-  // `collector_default_sample_rate_`, so let's lock it here.
-  std::lock_guard lock(mutex_);
+  if (found_rule != rules_.end() && shards_.size() > 1) {
+    rebalance_if_due();
+  }
+
+  // `Shard::mutex` protects the shard's limiter and collector sample rates,
+  // so let's lock it here.
+  Shard& shard = shards_.local();
+  std::lock_guard lock(shard.mutex);
 
   if (found_rule != rules_.end()) {
     const auto& rule = *found_rule;
@@ -56,7 +71,8 @@ SamplingDecision TraceSampler::decide(const SpanData& span) {
     decision.configured_rate = rule.rate;
     const std::uint64_t threshold = max_id_from_rate(rule.rate);
     if (knuth_hash(span.trace_id.low) < threshold) {
-      const auto result = limiter_.allow();
+      ++shard.demand;
+      const auto result = shard.limiter.allow();
       if (result.allowed) {
         decision.priority = int(SamplingPriority::USER_KEEP);
       } else {
@@ -72,14 +88,14 @@ SamplingDecision TraceSampler::decide(const SpanData& span) {
 
   // No sampling rule matched.  Find the appropriate collector-controlled
   // sample rate.
-  auto found_rate = collector_sample_rates_.find(
+  auto found_rate = shard.collector_sample_rates.find(
       CollectorResponse::key(span.service, span.environment().value_or("")));
-  if (found_rate != collector_sample_rates_.end()) {
+  if (found_rate != shard.collector_sample_rates.end()) {
     decision.configured_rate = found_rate->second;
     decision.mechanism = int(SamplingMechanism::AGENT_RATE);
   } else {
-    if (collector_default_sample_rate_) {
-      decision.configured_rate = *collector_default_sample_rate_;
+    if (shard.collector_default_sample_rate) {
+      decision.configured_rate = *shard.collector_default_sample_rate;
       decision.mechanism = int(SamplingMechanism::AGENT_RATE);
     } else {
       // We have yet to receive a default rate from the collector.  This
@@ -99,17 +115,61 @@ SamplingDecision TraceSampler::decide(const SpanData& span) {
   return decision;
 }
 
+void TraceSampler::rebalance_if_due() {
+  const auto tick = clock_().tick;
+  auto due = next_rebalance_.load(std::memory_order_relaxed);
+  if (tick.time_since_epoch().count() < due) {
+    return;
+  }
+  // Only the thread that advances `next_rebalance_` rebalances.
+  const auto next = (tick + rebalance_interval).time_since_epoch().count();
+  if (!next_rebalance_.compare_exchange_strong(due, next,
+                                               std::memory_order_relaxed)) {
+    return;
+  }
+
+  std::vector<std::uint64_t> demands;
+  demands.reserve(shards_.size());
+  std::uint64_t total_demand = 0;
+  for (std::size_t i = 0; i < shards_.size(); ++i) {
+    Shard& shard = shards_[i];
+    std::lock_guard lock(shard.mutex);
+    demands.push_back(shard.demand);
+    total_demand += shard.demand;
+    shard.demand = 0;
+  }
+
+  // Half of the limit is divided evenly, so that a shard whose demand
+  // increases isn't starved until the next rebalancing.  The other half is
+  // divided in proportion to demand.
+  const double count = double(shards_.size());
+  const double even_share = limiter_max_per_second_ / 2 / count;
+  for (std::size_t i = 0; i < shards_.size(); ++i) {
+    const double demand_share =
+        total_demand == 0 ? 1 / count
+                          : double(demands[i]) / double(total_demand);
+    Shard& shard = shards_[i];
+    std::lock_guard lock(shard.mutex);
+    shard.limiter.set_allowed_per_second(
+        even_share + limiter_max_per_second_ / 2 * demand_share);
+  }
+}
+
 void TraceSampler::handle_collector_response(
     const CollectorResponse& response) {
   const auto found =
       response.sample_rate_by_key.find(response.key_of_default_rate);
-  std::lock_guard<std::mutex> lock(mutex_);
 
-  if (found != response.sample_rate_by_key.end()) {
-    collector_default_sample_rate_ = found->second;
-  }
+  for (std::size_t i = 0; i < shards_.size(); ++i) {
+    Shard& shard = shards_[i];
+    std::lock_guard<Mutex> lock(shard.mutex);
+
+    if (found != response.sample_rate_by_key.end()) {
+      shard.collector_default_sample_rate = found->second;
+    }
 
-  collector_sample_rates_ = response.sample_rate_by_key;
+    shard.collector_sample_rates = response.sample_rate_by_key;
+  }
 }
 
 nlohmann::json TraceSampler::config_json() const {
@@ -82,18 +82,34 @@
 // rate) is limited by a configurable number of traces-per-second.  The limit is
 // configured via `TraceSamplerConfig::max_per_second` or the
 // `DD_TRACE_RATE_LIMIT` environment variable.
+//
+// Sharding
+// --------
+// If the tracer is sharded (see `TracerConfig::shards`), then each shard has
+// its own limiter and its own copy of the Agent-provided sample rates, so that
+// sampling decisions made on different cores don't contend.  The limit is
+// apportioned among the shards: half of it evenly, and half in proportion to
+// each shard's share of the traces that consulted the limiter since the last
+// rebalancing.  The limiters are rebalanced once per second, by whichever
+// thread first notices that it's time.
 
 #include <datadog/clock.h>
+#include <datadog/mutex.h>
 #include <datadog/optional.h>
 #include <datadog/rate.h>
 #include <datadog/trace_sampler_config.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <mutex>
 #include <string>
 #include <unordered_map>
 
 #include "json.hpp"
 #include "limiter.h"
+#include "sharded.h"
 
 namespace datadog {
 namespace tracing {
@@ -104,16 +120,41 @@ struct SpanData;
 
 class TraceSampler {
  private:
-  std::mutex mutex_;
+  // `Shard` is the part of the sampler that's used by the threads of one
+  // shard.
+  struct Shard {
+    Mutex mutex{LockSite::TRACE_SAMPLER_SHARD};
+    // The following are guarded by `mutex`.
+    Optional<Rate> collector_default_sample_rate;
+    std::unordered_map<std::string, Rate> collector_sample_rates;
+    Limiter limiter;
+    // the number of traces that consulted `limiter` since the last
+    // rebalancing
+    std::uint64_t demand = 0;
+
+    Shard(const Clock& clock, double allowed_per_second);
+  };
 
-  Optional<Rate> collector_default_sample_rate_;
-  std::unordered_map<std::string, Rate> collector_sample_rates_;
+  // `mutex_` guards `rules_` when they're replaced.
+  Mutex mutex_{LockSite::TRACE_SAMPLER};
   std::vector<TraceSamplerRule> rules_;
-  Limiter limiter_;
   double limiter_max_per_second_;
+  Clock clock_;
+  Sharded<Shard> shards_;
+  // when the limiters of `shards_` are next to be rebalanced, in ticks of the
+  // steady clock
+  std::atomic<std::chrono::steady_clock::rep> next_rebalance_;
+
+  // If it's time, apportion `limiter_max_per_second_` among the limiters of
+  // `shards_` according to their demand since the last time.
+  void rebalance_if_due();
 
  public:
-  TraceSampler(const FinalizedTraceSamplerConfig& config, const Clock& clock);
+  // Create a sampler configured by the specified `config`, that uses the
+  // specified `clock` for rate limiting, and that has the optionally
+  // specified number of `shards`.
+  TraceSampler(const FinalizedTraceSamplerConfig& config, const Clock& clock,
+               std::size_t shards = 1);
 
   void set_rules(std::vector<TraceSamplerRule> rules);
 
@@ -2,6 +2,7 @@
 #include <datadog/dict_reader.h>
 #include <datadog/dict_writer.h>
 #include <datadog/error.h>
+#include <datadog/id_generator.h>
 #include <datadog/injection_options.h>
 #include <datadog/logger.h>
 #include <datadog/optional.h>
@@ -10,23 +11,29 @@
 #include <datadog/trace_segment.h>
 
 #include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "b3_propagation.h"
 #include "collector_response.h"
 #include "config_manager.h"
 #include "hex.h"
 #include "json.hpp"
 #include "platform_util.h"
 #include "random.h"
+#include "resource_quantizer.h"
 #include "span_data.h"
 #include "span_sampler.h"
 #include "tag_propagation.h"
 #include "tags.h"
 #include "trace_sampler.h"
 #include "tracer_telemetry.h"
+#include "usdt.h"
 #include "w3c_propagation.h"
 
 namespace datadog {
@@ -51,18 +58,119 @@ int Cache::process_id;
 // `cache_singleton.process_id`.
 Cache cache_singleton;
 
+// `HeaderBatch` accumulates the headers produced by `TraceSegment::inject`, so
+// that they can be delivered to the destination `DictWriter` in a single call
+// to `DictWriter::set_all`. The batch has a fixed capacity and does not
+// allocate. Keys must outlive the batch (they are string literals in
+// practice). A value is either a view of characters that outlive the batch, a
+// number that the batch formats into its own buffer, or a string moved into
+// the batch. If the batch fills, then its headers are delivered early, in an
+// additional call to `set_all`.
+class HeaderBatch {
+  // Every injection style, each with its own "x-datadog-origin" and
+  // "x-datadog-tags", produces at most 15 headers, of which at most 5 values
+  // are strings.
+  static constexpr std::size_t max_headers = 16;
+  static constexpr std::size_t max_strings = 6;
+  // Room for each of the injected numbers and hex IDs, formatted.
+  static constexpr std::size_t buffer_size = 160;
+
+  DictWriter& destination_;
+  std::pair<StringView, StringView> headers_[max_headers];
+  std::size_t num_headers_ = 0;
+  std::string strings_[max_strings];
+  std::size_t num_strings_ = 0;
+  char buffer_[buffer_size];
+  std::size_t buffer_used_ = 0;
+
+  // Return where to format a value of at most the specified `size` characters.
+  // Deliver the accumulated headers first if there is no room for another.
+  char* prepare(std::size_t size) {
+    if (num_headers_ == max_headers || buffer_used_ + size > buffer_size) {
+      flush();
+    }
+    return buffer_ + buffer_used_;
+  }
+
+  // Add a header having the specified `key` and the value formatted by the
+  // previous call to `prepare`, which ends at the specified `end`.
+  void commit(StringView key, char* end) {
+    char* const begin = buffer_ + buffer_used_;
+    buffer_used_ = end - buffer_;
+    headers_[num_headers_++] = {key, StringView(begin, end - begin)};
+  }
+
+ public:
+  explicit HeaderBatch(DictWriter& destination) : destination_(destination) {}
+
+  // Add a header having the specified `key` and `value`. The characters of
+  // `value` must remain valid until the batch is flushed.
+  void set(StringView key, StringView value) {
+    if (num_headers_ == max_headers) {
+      flush();
+    }
+    headers_[num_headers_++] = {key, value};
+  }
+
+  // Add a header having the specified `key` and `value`.
+  void set(StringView key, std::string&& value) {
+    if (num_headers_ == max_headers || num_strings_ == max_strings) {
+      flush();
+    }
+    std::string& stored = strings_[num_strings_++];
+    stored = std::move(value);
+    headers_[num_headers_++] = {key, stored};
+  }
+
+  // Add a header having the specified `key` and the specified `value` in
+  // decimal.
+  template <typename Integer>
+  void set_decimal(StringView key, Integer value) {
+    constexpr std::size_t max_size = std::numeric_limits<Integer>::digits10 + 2;
+    char* const begin = prepare(max_size);
+    commit(key, std::to_chars(begin, begin + max_size, value).ptr);
+  }
+
+  // Add a header having the specified `key` and the specified `value` in
+  // hexadecimal, padded with zeroes to 16 digits.
+  void set_hex_padded(StringView key, std::uint64_t value) {
+    commit(key, write_hex_padded(prepare(16), value));
+  }
+
+  // Add a header having the specified `key` and the specified `trace_id` in
+  // hexadecimal, padded with zeroes to 16 digits if its higher 64 bits are
+  // zero, or to 32 digits otherwise.
+  void set_hex_padded(StringView key, TraceID trace_id) {
+    char* end = prepare(32);
+    if (trace_id.high) {
+      end = write_hex_padded(end, trace_id.high);
+    }
+    commit(key, write_hex_padded(end, trace_id.low));
+  }
+
+  // Deliver the accumulated headers to the destination.
+  void flush() {
+    if (num_headers_ != 0) {
+      destination_.set_all(headers_, num_headers_);
+    }
+    num_headers_ = 0;
+    num_strings_ = 0;
+    buffer_used_ = 0;
+  }
+};
+
 // Encode the specified `trace_tags`. If the encoded value is not longer than
 // the specified `tags_header_max_size`, then set it as the "x-datadog-tags"
 // header using the specified `writer`. If the encoded value is oversized, then
 // write a diagnostic to the specified `logger` and set a propagation error tag
 // on the specified `local_root_tags`.
 void inject_trace_tags(
-    DictWriter& writer,
+    HeaderBatch& writer,
     const std::vector<std::pair<std::string, std::string>>& trace_tags,
     std::size_t tags_header_max_size,
     std::unordered_map<std::string, std::string>& local_root_tags,
     Logger& logger) {
-  const std::string encoded_trace_tags = encode_tags(trace_tags);
+  std::string encoded_trace_tags = encode_tags(trace_tags);
 
   if (encoded_trace_tags.size() > tags_header_max_size) {
     std::string message;
@@ -76,7 +184,7 @@ void inject_trace_tags(
     logger.log_error(message);
     local_root_tags[tags::internal::propagation_error] = "inject_max_size";
   } else if (!encoded_trace_tags.empty()) {
-    writer.set("x-datadog-tags", encoded_trace_tags);
+    writer.set("x-datadog-tags", std::move(encoded_trace_tags));
   }
 }
 
@@ -88,8 +196,10 @@ TraceSegment::TraceSegment(
     const std::shared_ptr<TracerTelemetry>& tracer_telemetry,
     const std::shared_ptr<TraceSampler>& trace_sampler,
     const std::shared_ptr<SpanSampler>& span_sampler,
+    const std::shared_ptr<ResourceQuantizer>& resource_quantizer,
     const std::shared_ptr<const SpanDefaults>& defaults,
     const std::shared_ptr<ConfigManager>& config_manager,
+    const std::shared_ptr<const IDGenerator>& generator,
     const RuntimeID& runtime_id,
     const std::vector<PropagationStyle>& injection_styles,
     const Optional<std::string>& hostname, Optional<std::string> origin,
@@ -98,17 +208,24 @@ TraceSegment::TraceSegment(
     Optional<SamplingDecision> sampling_decision,
     Optional<std::string> additional_w3c_tracestate,
     Optional<std::string> additional_datadog_w3c_tracestate,
-    std::unique_ptr<SpanData> local_root)
-    : logger_(logger),
+    bool single_threaded, bool filtered, std::unique_ptr<SpanData> local_root)
+    : mutex_(LockSite::TRACE_SEGMENT, !single_threaded),
+      single_threaded_(single_threaded),
+      count_spans_on_close_(single_threaded || tracer_telemetry->sharded()),
+      filtered_(filtered),
+      logger_(logger),
       collector_(collector),
       tracer_telemetry_(tracer_telemetry),
       trace_sampler_(trace_sampler),
       span_sampler_(span_sampler),
+      resource_quantizer_(resource_quantizer),
+      generator_(generator),
       defaults_(defaults),
       runtime_id_(runtime_id),
       injection_styles_(injection_styles),
       hostname_(hostname),
       origin_(std::move(origin)),
+      local_root_id_(local_root->span_id),
       tags_header_max_size_(tags_header_max_size),
       trace_tags_(std::move(trace_tags)),
       num_finished_spans_(0),
@@ -122,6 +239,7 @@ TraceSegment::TraceSegment(
   assert(tracer_telemetry_);
   assert(trace_sampler_);
   assert(span_sampler_);
+  assert(generator_);
   assert(defaults_);
   assert(config_manager_);
 
@@ -136,35 +254,67 @@ const Optional<std::string>& TraceSegment::hostname() const {
 
 const Optional<std::string>& TraceSegment::origin() const { return origin_; }
 
+std::uint64_t TraceSegment::local_root_id() const { return local_root_id_; }
+
 Optional<SamplingDecision> TraceSegment::sampling_decision() const {
   // `sampling_decision_` can change, so we need a lock.
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<OptionalMutex> lock(mutex_);
   return sampling_decision_;
 }
 
+bool TraceSegment::filtered() const { return filtered_; }
+
 Logger& TraceSegment::logger() const { return *logger_; }
 
+std::uint64_t TraceSegment::generate_span_id() const {
+  return generator_->span_id();
+}
+
 void TraceSegment::register_span(std::unique_ptr<SpanData> span) {
-  tracer_telemetry_->metrics().tracer.spans_created.inc();
+  if (!count_spans_on_close_) {
+    tracer_telemetry_->metrics().tracer.spans_created.inc();
+  }
 
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<OptionalMutex> lock(mutex_);
   assert(spans_.empty() || num_finished_spans_ < spans_.size());
   spans_.emplace_back(std::move(span));
 }
 
-void TraceSegment::span_finished() {
+bool TraceSegment::span_finished() {
   {
-    tracer_telemetry_->metrics().tracer.spans_finished.inc();
-    std::lock_guard<std::mutex> lock(mutex_);
+    if (!count_spans_on_close_) {
+      tracer_telemetry_->metrics().tracer.spans_finished.inc();
+    }
+    std::lock_guard<OptionalMutex> lock(mutex_);
     ++num_finished_spans_;
     assert(num_finished_spans_ <= spans_.size());
     if (num_finished_spans_ < spans_.size()) {
-      return;
+      return false;
     }
   }
   // We don't need the lock anymore.  There's nobody left to call our methods.
   // On the other hand, there's nobody left to contend for the mutex, so it
   // doesn't make any difference.
+
+  // The telemetry counters are shared by all threads, so a single-threaded
+  // or sharded segment counts all of its spans at once rather than as each is
+  // created and finished.
+  const std::size_t span_count = count_spans_on_close_ ? spans_.size() : 0;
+
+  // A filtered trace is discarded without being finalized.
+  if (filtered_) {
+    tracer_telemetry_->count_trace_segment_closed(span_count);
+    tracer_telemetry_->count_trace_segment_filtered();
+    return single_threaded_;
+  }
+
+  // Quantize resource names before the samplers match rules against them.
+  // Note that a sampling decision made earlier, e.g. when trace context was
+  // injected, saw the resource names as they were then.
+  if (resource_quantizer_) {
+    resource_quantizer_->quantize(spans_);
+  }
+
   make_sampling_decision_if_null();
   assert(sampling_decision_);
 
@@ -191,6 +341,14 @@ void TraceSegment::span_finished() {
             *decision.limiter_max_per_second;
       }
     }
+
+    // Captured error stacks are symbolized only for spans that are kept.
+    for (const auto& span_ptr : spans_) {
+      if (!span_ptr->numeric_tags.count(
+              tags::internal::span_sampling_mechanism)) {
+        span_ptr->error_stack.reset();
+      }
+    }
   }
 
   const SamplingDecision& decision = *sampling_decision_;
@@ -237,6 +395,8 @@ void TraceSegment::span_finished() {
     span.tags[tags::internal::runtime_id] = runtime_id_.string();
   }
 
+  DD_TRACE_PROBE3(segment_finalize, local_root.trace_id.low, spans_.size(),
+                  decision.priority);
   if (config_manager_->report_traces()) {
     const auto result = collector_->send(std::move(spans_), trace_sampler_);
     if (auto* error = result.if_error()) {
@@ -245,7 +405,8 @@ void TraceSegment::span_finished() {
     }
   }
 
-  tracer_telemetry_->metrics().tracer.trace_segments_closed.inc();
+  tracer_telemetry_->count_trace_segment_closed(span_count);
+  return single_threaded_;
 }
 
 void TraceSegment::override_sampling_priority(SamplingPriority priority) {
@@ -258,7 +419,7 @@ void TraceSegment::override_sampling_priority(int priority) {
   decision.mechanism = int(SamplingMechanism::MANUAL);
   decision.origin = SamplingDecision::Origin::LOCAL;
 
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<OptionalMutex> lock(mutex_);
   sampling_decision_ = decision;
   update_decision_maker_trace_tag();
 }
@@ -272,6 +433,9 @@ void TraceSegment::make_sampling_decision_if_null() {
 
   const SpanData& local_root = *spans_.front();
   sampling_decision_ = trace_sampler_->decide(local_root);
+  DD_TRACE_PROBE3(sampling_decision, local_root.trace_id.low,
+                  sampling_decision_->priority,
+                  sampling_decision_->mechanism.value_or(-1));
 
   update_decision_maker_trace_tag();
 }
@@ -307,8 +471,8 @@ bool TraceSegment::inject(DictWriter& writer, const SpanData& span) {
   return inject(writer, span, InjectionOptions{});
 }
 
-bool TraceSegment::inject(DictWriter& writer, const SpanData& span,
-                          const InjectionOptions&) {
+bool TraceSegment::inject(DictWriter& destination, const SpanData& span,
+                          const InjectionOptions& options) {
   // If the only injection style is `NONE`, then don't do anything.
   if (injection_styles_.size() == 1 &&
       injection_styles_[0] == PropagationStyle::NONE) {
@@ -322,20 +486,25 @@ bool TraceSegment::inject(DictWriter& writer, const SpanData& span,
   int sampling_priority;
   std::vector<std::pair<std::string, std::string>> trace_tags;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<OptionalMutex> lock(mutex_);
     make_sampling_decision_if_null();
     assert(sampling_decision_);
     sampling_priority = sampling_decision_->priority;
     trace_tags = trace_tags_;
   }
 
+  // Headers are accumulated and then delivered to `destination` all at once.
+  HeaderBatch writer{destination};
+  char b3_buffer[b3_single_max_size];
   for (const auto style : injection_styles_) {
+    if (!should_inject(options, style)) {
+      continue;
+    }
     switch (style) {
       case PropagationStyle::DATADOG:
-        writer.set("x-datadog-trace-id", std::to_string(span.trace_id.low));
-        writer.set("x-datadog-parent-id", std::to_string(span.span_id));
-        writer.set("x-datadog-sampling-priority",
-                   std::to_string(sampling_priority));
+        writer.set_decimal("x-datadog-trace-id", span.trace_id.low);
+        writer.set_decimal("x-datadog-parent-id", span.span_id);
+        writer.set_decimal("x-datadog-sampling-priority", sampling_priority);
         if (origin_) {
           writer.set("x-datadog-origin", *origin_);
         }
@@ -343,13 +512,19 @@ bool TraceSegment::inject(DictWriter& writer, const SpanData& span,
                           spans_.front()->tags, *logger_);
         break;
       case PropagationStyle::B3:
-        if (span.trace_id.high) {
-          writer.set("x-b3-traceid", span.trace_id.hex_padded());
-        } else {
-          writer.set("x-b3-traceid", hex_padded(span.trace_id.low));
+        writer.set_hex_padded("x-b3-traceid", span.trace_id);
+        writer.set_hex_padded("x-b3-spanid", span.span_id);
+        writer.set("x-b3-sampled",
+                   StringView(sampling_priority > 0 ? "1" : "0"));
+        if (origin_) {
+          writer.set("x-datadog-origin", *origin_);
         }
-        writer.set("x-b3-spanid", hex_padded(span.span_id));
-        writer.set("x-b3-sampled", std::to_string(int(sampling_priority > 0)));
+        inject_trace_tags(writer, trace_tags, tags_header_max_size_,
+                          spans_.front()->tags, *logger_);
+        break;
+      case PropagationStyle::B3_SINGLE:
+        writer.set("b3", encode_b3_single(span.trace_id, span.span_id,
+                                          sampling_priority, b3_buffer));
         if (origin_) {
           writer.set("x-datadog-origin", *origin_);
         }
@@ -364,13 +539,15 @@ bool TraceSegment::inject(DictWriter& writer, const SpanData& span,
             "tracestate",
             encode_tracestate(span.span_id, sampling_priority, origin_,
                               trace_tags, additional_datadog_w3c_tracestate_,
-                              additional_w3c_tracestate_));
+                              additional_w3c_tracestate_,
+                              options.max_tracestate_size));
         break;
       default:
         break;
     }
   }
 
+  writer.flush();
   return true;
 }
 
@@ -3,8 +3,13 @@
 #include <datadog/id_generator.h>
 #include <datadog/logger.h>
 #include <datadog/runtime_id.h>
+#include <datadog/sampling_decision.h>
+#include <datadog/sampling_mechanism.h>
+#include <datadog/sampling_priority.h>
 #include <datadog/span.h>
 #include <datadog/span_config.h>
+#include <datadog/span_prototype.h>
+#include <datadog/trace_capture.h>
 #include <datadog/trace_segment.h>
 #include <datadog/tracer.h>
 #include <datadog/tracer_signature.h>
@@ -12,9 +17,15 @@
 
 #include <algorithm>
 #include <cassert>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <utility>
 
+#include "b3_propagation.h"
 #include "config_manager.h"
 #include "datadog_agent.h"
+#include "dogstatsd_client.h"
 #include "extracted_data.h"
 #include "extraction_util.h"
 #include "hex.h"
@@ -22,15 +33,71 @@
 #include "msgpack.h"
 #include "platform_util.h"
 #include "random.h"
+#include "resource_quantizer.h"
+#include "runtime_metrics.h"
 #include "span_data.h"
 #include "span_sampler.h"
 #include "tags.h"
+#include "trace_filter.h"
 #include "trace_sampler.h"
 #include "tracer_telemetry.h"
 #include "w3c_propagation.h"
 
 namespace datadog {
 namespace tracing {
+namespace {
+
+// Report the current values of the specified telemetry `gauges` to the
+// specified DogStatsD `client`.
+void report_gauges(DogStatsDClient& client,
+                   std::initializer_list<telemetry::GaugeMetric*> gauges) {
+  for (auto* gauge : gauges) {
+    client.gauge("datadog.tracer." + gauge->name(), double(gauge->value()),
+                 gauge->tags());
+  }
+}
+
+// Return whether the specified `local_root` matches any rule of the specified
+// `trace_filter`.  If it does, then replace the specified `sampling_decision`
+// with "user drop," so that downstream services drop the trace too.
+bool apply_trace_filter(const TraceFilter& trace_filter,
+                        const SpanData& local_root,
+                        Optional<SamplingDecision>& sampling_decision) {
+  if (trace_filter.empty() || !trace_filter.match(local_root)) {
+    return false;
+  }
+  SamplingDecision decision;
+  decision.priority = int(SamplingPriority::USER_DROP);
+  decision.mechanism = int(SamplingMechanism::MANUAL);
+  decision.origin = SamplingDecision::Origin::LOCAL;
+  sampling_decision = decision;
+  return true;
+}
+
+// Return a new `TraceSegment` constructed from the specified `args`, which
+// include the specified `single_threaded`.  A single-threaded segment is
+// returned in a `std::shared_ptr` that does not own it.  Instead, its spans
+// own it jointly, and the last of them to finish destroys it (see
+// `TraceSegment::span_finished`), so that creating and finishing a child span
+// does not touch an atomic reference count.
+template <typename... Args>
+std::shared_ptr<TraceSegment> make_segment(bool single_threaded,
+                                           Args&&... args) {
+  if (!single_threaded) {
+    return std::make_shared<TraceSegment>(std::forward<Args>(args)...);
+  }
+  return std::shared_ptr<TraceSegment>(
+      std::shared_ptr<TraceSegment>(),
+      new TraceSegment(std::forward<Args>(args)...));
+}
+
+// Return a function that generates the IDs of child spans in the specified
+// `segment`.
+std::function<std::uint64_t()> span_id_generator(TraceSegment* segment) {
+  return [segment]() { return segment->generate_span_id(); };
+}
+
+}  // namespace
 
 void to_json(nlohmann::json& j, const PropagationStyle& style) {
   j = to_string_view(style);
@@ -54,6 +121,10 @@ Tracer::Tracer(const FinalizedTracerConfig& config,
       collector_(/* see constructor body */),
       span_sampler_(
           std::make_shared<SpanSampler>(config.span_sampler, config.clock)),
+      resource_quantizer_(config.resource_quantization.enabled
+                              ? std::make_shared<ResourceQuantizer>(
+                                    config.resource_quantization)
+                              : nullptr),
       generator_(generator),
       clock_(config.clock),
       injection_styles_(config.injection_styles),
@@ -61,10 +132,16 @@ Tracer::Tracer(const FinalizedTracerConfig& config,
       tags_header_max_size_(config.tags_header_size),
       baggage_opts_(config.baggage_opts),
       baggage_injection_enabled_(false),
-      baggage_extraction_enabled_(false) {
+      baggage_extraction_enabled_(false),
+      single_threaded_(config.single_threaded),
+      shards_(config.shards) {
+  if (shards_ > 1) {
+    tracer_telemetry_->use_shards(shards_);
+  }
   if (config.report_hostname) {
     hostname_ = get_hostname();
   }
+  std::weak_ptr<DatadogAgent> datadog_agent;
   if (auto* collector =
           std::get_if<std::shared_ptr<Collector>>(&config.collector)) {
     collector_ = *collector;
@@ -74,16 +151,60 @@ Tracer::Tracer(const FinalizedTracerConfig& config,
 
     auto rc_listeners = agent_config.remote_configuration_listeners;
     rc_listeners.emplace_back(config_manager_);
-    auto agent =
-        std::make_shared<DatadogAgent>(agent_config, tracer_telemetry_,
-                                       config.logger, signature_, rc_listeners);
+    auto agent = std::make_shared<DatadogAgent>(
+        agent_config, tracer_telemetry_, config.logger, signature_,
+        rc_listeners, config.shards);
     collector_ = agent;
+    datadog_agent = agent;
 
     if (tracer_telemetry_->enabled()) {
       agent->send_app_started(config.metadata);
     }
   }
 
+  if (config.trace_capture) {
+    trace_capture_ = config.trace_capture;
+    collector_ = std::make_shared<RecordingCollector>(
+        collector_, trace_capture_, logger_);
+  }
+
+  if (config.runtime_metrics.enabled) {
+    runtime_metrics_ = std::make_shared<RuntimeMetricsSampler>(
+        tracer_telemetry_, config.runtime_metrics.event_scheduler,
+        config.runtime_metrics.sample_interval);
+  }
+
+  if (config.dogstatsd.enabled) {
+    dogstatsd_ = std::make_shared<DogStatsDClient>(config.dogstatsd, logger_);
+    // Sample the tracer's state just before each flush.  The hook refers to
+    // the tracer's components weakly, so that it does not extend their
+    // lifetimes.
+    dogstatsd_->add_flush_hook(
+        [telemetry = std::weak_ptr<TracerTelemetry>(tracer_telemetry_),
+         agent = std::move(datadog_agent),
+         runtime_metrics = bool(runtime_metrics_)](DogStatsDClient& client) {
+          if (auto tracer_telemetry = telemetry.lock()) {
+            tracer_telemetry->merge_shards();
+            auto& metrics = tracer_telemetry->metrics();
+            client.gauge("datadog.tracer.trace_segments.open",
+                         double(metrics.tracer.trace_segments_open.value()));
+            if (runtime_metrics) {
+              auto& runtime = metrics.runtime;
+              report_gauges(client, {&runtime.cpu_user_time,
+                                     &runtime.cpu_system_time, &runtime.rss,
+                                     &runtime.threads,
+                                     &runtime.open_file_descriptors,
+                                     &runtime.voluntary_context_switches,
+                                     &runtime.involuntary_context_switches});
+            }
+          }
+          if (auto collector = agent.lock()) {
+            client.gauge("datadog.tracer.queue.depth",
+                         double(collector->pending_trace_chunks()));
+          }
+        });
+  }
+
   for (const auto style : extraction_styles_) {
     if (style == PropagationStyle::BAGGAGE) {
       baggage_extraction_enabled_ = true;
@@ -130,6 +251,15 @@ std::string Tracer::config() const {
   if (hostname_) {
     config["hostname"] = *hostname_;
   }
+  if (resource_quantizer_) {
+    config["resource_quantization"] = resource_quantizer_->config_json();
+  }
+  if (single_threaded_) {
+    config["single_threaded"] = true;
+  }
+  if (shards_ > 1) {
+    config["shards"] = shards_;
+  }
 
   return config.dump();
 }
@@ -176,6 +306,21 @@ Span Tracer::create_span(const SpanConfig& config) {
   auto defaults = config_manager_->span_defaults();
   auto span_data = std::make_unique<SpanData>();
   span_data->apply_config(*defaults, config, clock_);
+  return make_root_span(std::move(span_data), defaults);
+}
+
+Span Tracer::create_span(const SpanPrototype& prototype) {
+  auto defaults = config_manager_->span_defaults();
+  return make_root_span(prototype.instantiate(*defaults, clock_), defaults);
+}
+
+SpanPrototype Tracer::create_span_prototype(const SpanConfig& config) {
+  return SpanPrototype{config_manager_->span_defaults(), config};
+}
+
+Span Tracer::make_root_span(
+    std::unique_ptr<SpanData> span_data,
+    const std::shared_ptr<const SpanDefaults>& defaults) {
   span_data->trace_id = generator_->trace_id(span_data->start);
   span_data->span_id = span_data->trace_id.low;
   span_data->parent_id = 0;
@@ -186,18 +331,23 @@ Span Tracer::create_span(const SpanConfig& config) {
                             hex_padded(span_data->trace_id.high));
   }
 
+  // A filtered trace is dropped, and downstream services are told so.
+  Optional<SamplingDecision> sampling_decision;
+  const bool filtered = apply_trace_filter(*config_manager_->trace_filter(),
+                                           *span_data, sampling_decision);
+
   const auto span_data_ptr = span_data.get();
-  tracer_telemetry_->metrics().tracer.trace_segments_created_new.inc();
-  const auto segment = std::make_shared<TraceSegment>(
-      logger_, collector_, tracer_telemetry_, config_manager_->trace_sampler(),
-      span_sampler_, defaults, config_manager_, runtime_id_, injection_styles_,
+  tracer_telemetry_->count_trace_segment_created(false);
+  const auto segment = make_segment(
+      single_threaded_, logger_, collector_, tracer_telemetry_,
+      config_manager_->trace_sampler(), span_sampler_, resource_quantizer_,
+      defaults, config_manager_, generator_, runtime_id_, injection_styles_,
       hostname_, nullopt /* origin */, tags_header_max_size_,
-      std::move(trace_tags), nullopt /* sampling_decision */,
+      std::move(trace_tags), std::move(sampling_decision),
       nullopt /* additional_w3c_tracestate */,
-      nullopt /* additional_datadog_w3c_tracestate*/, std::move(span_data));
-  Span span{span_data_ptr, segment,
-            [generator = generator_]() { return generator->span_id(); },
-            clock_};
+      nullopt /* additional_datadog_w3c_tracestate*/, single_threaded_,
+      filtered, std::move(span_data));
+  Span span{span_data_ptr, segment, span_id_generator(segment.get()), clock_};
   return span;
 }
 
@@ -215,6 +365,8 @@ Expected<Span> Tracer::extract_span(const DictReader& reader,
   Optional<PropagationStyle> first_style_with_trace_id;
   Optional<PropagationStyle> first_style_with_parent_id;
   std::unordered_map<PropagationStyle, ExtractedData> extracted_contexts;
+  // The headers examined by any style, if they're to be captured.
+  std::vector<std::pair<std::string, std::string>> headers_examined;
 
   for (const auto style : extraction_styles_) {
     using Extractor = decltype(&extract_datadog);  // function pointer
@@ -226,6 +378,9 @@ Expected<Span> Tracer::extract_span(const DictReader& reader,
       case PropagationStyle::B3:
         extract = &extract_b3;
         break;
+      case PropagationStyle::B3_SINGLE:
+        extract = &extract_b3_single;
+        break;
       case PropagationStyle::W3C:
         extract = &extract_w3c;
         break;
@@ -248,6 +403,14 @@ Expected<Span> Tracer::extract_span(const DictReader& reader,
     }
 
     data->headers_examined = audited_reader.entries_found;
+    if (trace_capture_) {
+      for (const auto& entry : audited_reader.entries_found) {
+        if (std::find(headers_examined.begin(), headers_examined.end(),
+                      entry) == headers_examined.end()) {
+          headers_examined.push_back(entry);
+        }
+      }
+    }
     extracted_contexts.emplace(style, std::move(*data));
   }
 
@@ -386,20 +549,32 @@ Expected<Span> Tracer::extract_span(const DictReader& reader,
     sampling_decision = decision;
   }
 
+  // A filtered trace is dropped, overriding any extracted decision, and
+  // downstream services are told so.
+  const bool filtered = apply_trace_filter(*config_manager_->trace_filter(),
+                                           *span_data, sampling_decision);
+
+  if (trace_capture_) {
+    auto recorded =
+        trace_capture_->record_headers(span_data->trace_id, headers_examined);
+    if (auto* error = recorded.if_error()) {
+      logger_->log_error(*error);
+    }
+  }
+
   const auto span_data_ptr = span_data.get();
-  tracer_telemetry_->metrics().tracer.trace_segments_created_continued.inc();
-  const auto segment = std::make_shared<TraceSegment>(
-      logger_, collector_, tracer_telemetry_, config_manager_->trace_sampler(),
-      span_sampler_, config_manager_->span_defaults(), config_manager_,
+  tracer_telemetry_->count_trace_segment_created(true);
+  const auto segment = make_segment(
+      single_threaded_, logger_, collector_, tracer_telemetry_,
+      config_manager_->trace_sampler(), span_sampler_, resource_quantizer_,
+      config_manager_->span_defaults(), config_manager_, generator_,
       runtime_id_, injection_styles_, hostname_,
       std::move(merged_context.origin), tags_header_max_size_,
       std::move(merged_context.trace_tags), std::move(sampling_decision),
       std::move(merged_context.additional_w3c_tracestate),
       std::move(merged_context.additional_datadog_w3c_tracestate),
-      std::move(span_data));
-  Span span{span_data_ptr, segment,
-            [generator = generator_]() { return generator->span_id(); },
-            clock_};
+      single_threaded_, filtered, std::move(span_data));
+  Span span{span_data_ptr, segment, span_id_generator(segment.get()), clock_};
   return span;
 }
 
@@ -437,11 +612,20 @@ Baggage Tracer::extract_or_create_baggage(const DictReader& reader) {
 }
 
 Expected<void> Tracer::inject(const Baggage& baggage, DictWriter& writer) {
+  return inject(baggage, writer, InjectionOptions{});
+}
+
+Expected<void> Tracer::inject(const Baggage& baggage, DictWriter& writer,
+                              const InjectionOptions& options) {
   if (!baggage_injection_enabled_) {
     // TODO(@dmehala): update `Expected` to support `<void, Error>`
     return Error{Error::Code::OTHER, "Baggage propagation is disabled"};
   }
 
+  if (!should_inject(options, PropagationStyle::BAGGAGE)) {
+    return {};
+  }
+
   auto res = baggage.inject(writer, baggage_opts_);
   if (auto err = res.if_error()) {
     logger_->log_error(
@@ -51,7 +51,8 @@ Expected<std::vector<PropagationStyle>> parse_propagation_styles(
       message += "\" in list \"";
       append(message, input);
       message +=
-          "\".  The following styles are supported: Datadog, B3, tracecontext.";
+          "\".  The following styles are supported: Datadog, B3, b3single, "
+          "tracecontext.";
       return Error{Error::UNKNOWN_PROPAGATION_STYLE, std::move(message)};
     }
 
@@ -397,6 +398,14 @@ Expected<FinalizedTracerConfig> finalize_config(const TracerConfig &user_config,
     final_config.runtime_id = user_config.runtime_id;
   }
 
+  final_config.single_threaded = user_config.single_threaded.value_or(false);
+
+  final_config.shards = user_config.shards.value_or(1);
+  if (final_config.shards == 0) {
+    return Error{Error::INVALID_SHARD_COUNT,
+                 "The number of shards must be at least one."};
+  }
+
   if (!user_config.collector) {
     auto finalized =
         finalize_config(user_config.agent, final_config.logger, clock);
@@ -431,6 +440,60 @@ Expected<FinalizedTracerConfig> finalize_config(const TracerConfig &user_config,
     return std::move(telemetry_final_config.error());
   }
 
+  if (auto dogstatsd_config = finalize_config(user_config.dogstatsd)) {
+    final_config.dogstatsd = std::move(*dogstatsd_config);
+  } else {
+    return std::move(dogstatsd_config.error());
+  }
+  // Tag metrics with the same unified service tags as traces.
+  final_config.dogstatsd.tags.push_back("service:" +
+                                        final_config.defaults.service);
+  if (!final_config.defaults.environment.empty()) {
+    final_config.dogstatsd.tags.push_back("env:" +
+                                          final_config.defaults.environment);
+  }
+  if (!final_config.defaults.version.empty()) {
+    final_config.dogstatsd.tags.push_back("version:" +
+                                          final_config.defaults.version);
+  }
+
+  if (auto runtime_metrics_config =
+          finalize_config(user_config.runtime_metrics)) {
+    final_config.runtime_metrics = std::move(*runtime_metrics_config);
+  } else {
+    return std::move(runtime_metrics_config.error());
+  }
+  // Runtime metrics are reported only to DogStatsD, and are sampled on the
+  // DogStatsD client's event scheduler unless another is specified.
+  if (final_config.runtime_metrics.enabled) {
+    if (!final_config.dogstatsd.enabled) {
+      return Error{Error::RUNTIME_METRICS_WITHOUT_DOGSTATSD,
+                   "RuntimeMetrics: Runtime metrics are reported to DogStatsD, "
+                   "which is disabled."};
+    }
+    if (!final_config.runtime_metrics.event_scheduler) {
+      final_config.runtime_metrics.event_scheduler =
+          final_config.dogstatsd.event_scheduler;
+    }
+  }
+
+  if (auto resource_quantization_config =
+          finalize_config(user_config.resource_quantization)) {
+    final_config.resource_quantization =
+        std::move(*resource_quantization_config);
+  } else {
+    return std::move(resource_quantization_config.error());
+  }
+
+  if (auto trace_filter_config = finalize_config(user_config.trace_filter)) {
+    final_config.metadata.merge(trace_filter_config->metadata);
+    final_config.trace_filter = std::move(*trace_filter_config);
+  } else {
+    return std::move(trace_filter_config.error());
+  }
+
+  final_config.trace_capture = user_config.trace_capture;
+
   return final_config;
 }
 
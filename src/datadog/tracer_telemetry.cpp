@@ -4,6 +4,8 @@
 #include <datadog/span_defaults.h>
 #include <datadog/version.h>
 
+#include <algorithm>
+
 #include "platform_util.h"
 
 namespace datadog {
@@ -50,6 +52,8 @@ std::string to_string(datadog::tracing::ConfigName name) {
       return "trace_baggage_max_bytes";
     case ConfigName::TRACE_BAGGAGE_MAX_ITEMS:
       return "trace_baggage_max_items";
+    case ConfigName::TRACE_FILTER_RULES:
+      return "trace_filter_rules";
   }
 
   std::abort();
@@ -84,6 +88,8 @@ TracerTelemetry::TracerTelemetry(
         metrics_.tracer.trace_segments_created_continued, MetricSnapshot{});
     metrics_snapshots_.emplace_back(metrics_.tracer.trace_segments_closed,
                                     MetricSnapshot{});
+    metrics_snapshots_.emplace_back(metrics_.tracer.trace_segments_filtered,
+                                    MetricSnapshot{});
     metrics_snapshots_.emplace_back(metrics_.trace_api.requests,
                                     MetricSnapshot{});
     metrics_snapshots_.emplace_back(metrics_.trace_api.responses_1xx,
@@ -227,7 +233,94 @@ std::string TracerTelemetry::app_started(
   return batch.dump();
 }
 
+void TracerTelemetry::use_shards(std::size_t shards) {
+  shards_ = std::make_unique<Sharded<ShardCounts>>(shards);
+}
+
+void TracerTelemetry::count_trace_segment_created(bool continued) {
+  if (shards_) {
+    auto& counts = shards_->local();
+    auto& counter = continued ? counts.trace_segments_created_continued
+                              : counts.trace_segments_created_new;
+    counter.fetch_add(1, std::memory_order_relaxed);
+    counts.trace_segments_open.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  if (continued) {
+    metrics_.tracer.trace_segments_created_continued.inc();
+  } else {
+    metrics_.tracer.trace_segments_created_new.inc();
+  }
+  metrics_.tracer.trace_segments_open.inc();
+}
+
+void TracerTelemetry::count_trace_segment_closed(std::size_t spans) {
+  if (shards_) {
+    auto& counts = shards_->local();
+    counts.trace_segments_closed.fetch_add(1, std::memory_order_relaxed);
+    counts.spans.fetch_add(spans, std::memory_order_relaxed);
+    counts.trace_segments_open.fetch_sub(1, std::memory_order_relaxed);
+    return;
+  }
+
+  if (spans) {
+    metrics_.tracer.spans_created.add(spans);
+    metrics_.tracer.spans_finished.add(spans);
+  }
+  metrics_.tracer.trace_segments_closed.inc();
+  metrics_.tracer.trace_segments_open.dec();
+}
+
+void TracerTelemetry::count_trace_segment_filtered() {
+  if (shards_) {
+    shards_->local().trace_segments_filtered.fetch_add(
+        1, std::memory_order_relaxed);
+    return;
+  }
+
+  metrics_.tracer.trace_segments_filtered.inc();
+}
+
+void TracerTelemetry::merge_shards() {
+  if (!shards_) {
+    return;
+  }
+
+  std::uint64_t created_new = 0;
+  std::uint64_t created_continued = 0;
+  std::uint64_t closed = 0;
+  std::uint64_t filtered = 0;
+  std::uint64_t spans = 0;
+  std::int64_t open = 0;
+  for (std::size_t i = 0; i < shards_->size(); ++i) {
+    auto& counts = (*shards_)[i];
+    created_new += counts.trace_segments_created_new.exchange(0);
+    created_continued += counts.trace_segments_created_continued.exchange(0);
+    closed += counts.trace_segments_closed.exchange(0);
+    filtered += counts.trace_segments_filtered.exchange(0);
+    spans += counts.spans.exchange(0);
+    open += counts.trace_segments_open.load(std::memory_order_relaxed);
+  }
+
+  auto& tracer = metrics_.tracer;
+  tracer.trace_segments_created_new.add(created_new);
+  tracer.trace_segments_created_continued.add(created_continued);
+  tracer.trace_segments_closed.add(closed);
+  tracer.trace_segments_filtered.add(filtered);
+  tracer.spans_created.add(spans);
+  tracer.spans_finished.add(spans);
+  // `merge_shards` is called by both the telemetry and the DogStatsD flush
+  // tasks, so publish the number of open segments with a single store rather
+  // than adjusting the gauge, which concurrent merges could make drift.  The
+  // sum is read one shard at a time, so it might briefly be negative.
+  tracer.trace_segments_open.set(
+      std::uint64_t(std::max<std::int64_t>(open, 0)));
+}
+
 void TracerTelemetry::capture_metrics() {
+  merge_shards();
+
   std::time_t timepoint = std::chrono::duration_cast<std::chrono::seconds>(
                               clock_().wall.time_since_epoch())
                               .count();
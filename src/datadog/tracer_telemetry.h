@@ -34,10 +34,15 @@
 #include <datadog/telemetry/metrics.h>
 #include <datadog/tracer_signature.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "json.hpp"
 #include "platform_util.h"
+#include "sharded.h"
 #include "telemetry/log.h"
 
 namespace datadog {
@@ -77,6 +82,15 @@ class TracerTelemetry {
           true};
       telemetry::CounterMetric trace_segments_closed = {
           "trace_segments_closed", "tracers", {}, true};
+      // The number of trace segments closed without being sent because a
+      // trace filter rule matched their root span.
+      telemetry::CounterMetric trace_segments_filtered = {
+          "trace_segments_filtered", "tracers", {}, true};
+      // The number of trace segments created but not yet closed.  This is
+      // reported to DogStatsD, not in telemetry "generate-metrics" messages,
+      // because capturing a metric for telemetry resets its value.
+      telemetry::GaugeMetric trace_segments_open = {
+          "trace_segments_open", "tracers", {}, true};
       telemetry::CounterMetric baggage_items_exceeded = {
           "context_header.truncated",
           "tracers",
@@ -113,6 +127,25 @@ class TracerTelemetry {
           "trace_api.errors", "tracers", {"type:status_code"}, true};
 
     } trace_api;
+    // Process runtime metrics, sampled by `RuntimeMetricsSampler`.  Like
+    // `trace_segments_open`, these are reported to DogStatsD, not in telemetry
+    // "generate-metrics" messages.
+    struct {
+      telemetry::GaugeMetric cpu_user_time = {
+          "runtime.cpu.user_time_ms", "runtime", {}, false};
+      telemetry::GaugeMetric cpu_system_time = {
+          "runtime.cpu.system_time_ms", "runtime", {}, false};
+      telemetry::GaugeMetric rss = {
+          "runtime.mem.rss_bytes", "runtime", {}, false};
+      telemetry::GaugeMetric threads = {
+          "runtime.threads", "runtime", {}, false};
+      telemetry::GaugeMetric open_file_descriptors = {
+          "runtime.open_fds", "runtime", {}, false};
+      telemetry::GaugeMetric voluntary_context_switches = {
+          "runtime.context_switches", "runtime", {"type:voluntary"}, false};
+      telemetry::GaugeMetric involuntary_context_switches = {
+          "runtime.context_switches", "runtime", {"type:involuntary"}, false};
+    } runtime;
   } metrics_;
   // Each metric has an associated MetricSnapshot that contains the data points,
   // represented as a timestamp and the value of that metric.
@@ -135,6 +168,24 @@ class TracerTelemetry {
 
   std::vector<telemetry::LogMessage> logs_;
 
+  // `ShardCounts` is the counts of trace segments and spans made by the
+  // threads of one shard of a sharded tracer (see `TracerConfig::shards`).
+  struct ShardCounts {
+    std::atomic<std::uint64_t> trace_segments_created_new{0};
+    std::atomic<std::uint64_t> trace_segments_created_continued{0};
+    std::atomic<std::uint64_t> trace_segments_closed{0};
+    std::atomic<std::uint64_t> trace_segments_filtered{0};
+    std::atomic<std::uint64_t> spans{0};
+    // The number of trace segments created minus the number closed by this
+    // shard's threads.  A segment can be created on one shard and closed on
+    // another, so this can be negative, but the sum over the shards can't.
+    // Unlike the other counts, this is not reset by `merge_shards`.
+    std::atomic<std::int64_t> trace_segments_open{0};
+  };
+  // If the tracer is sharded, then trace segments and spans are counted in
+  // `shards_`, and the counts are added to `metrics_` by `merge_shards`.
+  std::unique_ptr<Sharded<ShardCounts>> shards_;
+
  public:
   TracerTelemetry(
       bool enabled, const Clock& clock, const std::shared_ptr<Logger>& logger,
@@ -148,6 +199,26 @@ class TracerTelemetry {
   // Provides access to the telemetry metrics for updating the values.
   // This value should not be stored.
   auto& metrics() { return metrics_; }
+  // Count trace segments and spans separately for each of the specified
+  // number of `shards`.  This must be called before anything is counted.
+  void use_shards(std::size_t shards);
+  inline bool sharded() const { return shards_ != nullptr; }
+  // Count the creation of a trace segment that begins a new trace, or that
+  // continues a trace extracted from another service if the specified
+  // `continued` is true.
+  void count_trace_segment_created(bool continued);
+  // Count the closing of a trace segment, and count the specified number of
+  // `spans` as having been created and finished.  The spans of a trace segment
+  // are counted when it closes, instead of as they're created and finished, if
+  // the tracer is single-threaded or sharded.
+  void count_trace_segment_closed(std::size_t spans);
+  // Count a trace segment that was closed without being sent because it was
+  // filtered.  See `trace_filter_config.h`.
+  void count_trace_segment_filtered();
+  // Add the counts of each shard to the metrics, reset them, and set the
+  // number of open trace segments.  If the tracer isn't sharded, then do
+  // nothing.  This may be called concurrently from multiple threads.
+  void merge_shards();
   // Constructs an `app-started` message using information provided when
   // constructed and the tracer_config value passed in.
   std::string app_started(
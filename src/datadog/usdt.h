@@ -0,0 +1,59 @@
+#pragma once
+
+// This component provides macros that define USDT ("user-level statically
+// defined tracing") probes at interesting points in the tracer, such as span
+// creation and the flushing of traces to the Datadog Agent.
+//
+// If the library is built with the CMake option `DD_TRACE_ENABLE_USDT`, then
+// each probe compiles to a single `nop` instruction and an entry in the
+// ".note.stapsdt" ELF section, which tools such as bpftrace and perf use to
+// attach to the probe at run time.  A probe costs nothing beyond the `nop`
+// while nothing is attached.  Otherwise, the probes compile to nothing, and
+// their arguments are not evaluated.
+//
+// All probes belong to the provider `dd_trace_cpp`.  Probe arguments must be
+// integers or pointers.  See `examples/usdt` for bpftrace scripts that use the
+// probes.
+//
+// The probes and their arguments are:
+//
+// - `span_create(trace_id_low, span_id, parent_id)` when a span is created.
+// - `span_finish(trace_id_low, span_id, duration_nanoseconds)` when a span is
+//   finished.
+// - `sampling_decision(trace_id_low, priority, mechanism)` when the sampling
+//   decision for a trace segment is made locally.
+// - `segment_finalize(trace_id_low, span_count, priority)` when all of the
+//   spans in a trace segment have finished and the segment is about to be
+//   sent to the collector.
+// - `agent_send(span_count, pending_chunks)` when `DatadogAgent` receives a
+//   trace chunk to be sent at the next flush.
+// - `flush_start(chunk_count)` when `DatadogAgent` begins a flush, and
+//   `flush_end(chunk_count, body_bytes)` when it has finished encoding and
+//   submitting a request.  A flush that exceeds the Agent's request size limit
+//   is divided into several requests.
+// - `http_complete(curl_result, status, response_bytes)` when an HTTP request
+//   made by the libcurl-based `HTTPClient` completes or fails.  `status` is -1
+//   if there was no response.
+
+#if defined(DD_TRACE_ENABLE_USDT)
+
+#include <sys/sdt.h>
+
+#define DD_TRACE_PROBE1(name, a) DTRACE_PROBE1(dd_trace_cpp, name, a)
+#define DD_TRACE_PROBE2(name, a, b) DTRACE_PROBE2(dd_trace_cpp, name, a, b)
+#define DD_TRACE_PROBE3(name, a, b, c) \
+  DTRACE_PROBE3(dd_trace_cpp, name, a, b, c)
+
+#else
+
+#define DD_TRACE_PROBE1(name, a) \
+  do {                           \
+  } while (false)
+#define DD_TRACE_PROBE2(name, a, b) \
+  do {                              \
+  } while (false)
+#define DD_TRACE_PROBE3(name, a, b, c) \
+  do {                                 \
+  } while (false)
+
+#endif
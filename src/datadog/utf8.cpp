@@ -0,0 +1,435 @@
+#include "utf8.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DD_TRACE_UTF8_SSE2
+#include <emmintrin.h>
+// The block validator needs SSSE3.  If the compiler doesn't assume SSSE3, but
+// can target it for one function, then the validator is selected at runtime.
+#if defined(__SSSE3__)
+#define DD_TRACE_UTF8_SSSE3
+#include <tmmintrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DD_TRACE_UTF8_SSSE3
+#define DD_TRACE_UTF8_SSSE3_DISPATCH
+#include <tmmintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define DD_TRACE_UTF8_NEON
+#include <arm_neon.h>
+#endif
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+using Byte = unsigned char;
+
+// Return a pointer to the first byte in `[begin, end)` that is not ASCII, or
+// return `end` if there is no such byte.
+const Byte* skip_ascii(const Byte* begin, const Byte* end) {
+  const Byte* p = begin;
+  // Skip blocks of sixty-four and then sixteen ASCII bytes.  A block that
+  // contains a non-ASCII byte is searched by the loops that follow.
+#if defined(DD_TRACE_UTF8_SSE2)
+  const auto load = [](const Byte* bytes) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+  };
+  while (end - p >= 64) {
+    const __m128i any = _mm_or_si128(_mm_or_si128(load(p), load(p + 16)),
+                                     _mm_or_si128(load(p + 32), load(p + 48)));
+    // The mask has a bit for each byte whose high bit is set.
+    if (_mm_movemask_epi8(any) != 0) {
+      break;
+    }
+    p += 64;
+  }
+  while (end - p >= 16) {
+    if (_mm_movemask_epi8(load(p)) != 0) {
+      break;
+    }
+    p += 16;
+  }
+#elif defined(DD_TRACE_UTF8_NEON)
+  while (end - p >= 64) {
+    const uint8x16_t any =
+        vorrq_u8(vorrq_u8(vld1q_u8(p), vld1q_u8(p + 16)),
+                 vorrq_u8(vld1q_u8(p + 32), vld1q_u8(p + 48)));
+    if (vmaxvq_u8(any) >= 0x80) {
+      break;
+    }
+    p += 64;
+  }
+  while (end - p >= 16) {
+    if (vmaxvq_u8(vld1q_u8(p)) >= 0x80) {
+      break;
+    }
+    p += 16;
+  }
+#endif
+
+  while (end - p >= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof word);
+    if (word & 0x8080808080808080ull) {
+      break;
+    }
+    p += 8;
+  }
+
+  while (p != end && *p < 0x80) {
+    ++p;
+  }
+  return p;
+}
+
+struct Sequence {
+  // If `valid`, the length of the well-formed sequence.  Otherwise, the
+  // length of the maximal subpart of a well-formed sequence, or one if the
+  // first byte begins no well-formed sequence.
+  std::size_t size;
+  bool valid;
+};
+
+// Return the sequence at the beginning of the nonempty range `[begin, end)`.
+// The well-formed sequences are those of table 3-7 of the Unicode Standard.
+Sequence next_sequence(const Byte* begin, const Byte* end) {
+  const Byte lead = *begin;
+  if (lead < 0x80) {
+    return {1, true};
+  }
+
+  // The number of continuation bytes that follow `lead`, and the range of the
+  // first of them.  Subsequent continuation bytes are in [0x80, 0xBF].  The
+  // narrower ranges exclude overlong encodings, surrogates, and code points
+  // beyond U+10FFFF.
+  std::size_t continuations;
+  Byte low = 0x80;
+  Byte high = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    continuations = 1;
+  } else if (lead == 0xE0) {
+    continuations = 2;
+    low = 0xA0;
+  } else if ((lead >= 0xE1 && lead <= 0xEC) || lead == 0xEE || lead == 0xEF) {
+    continuations = 2;
+  } else if (lead == 0xED) {
+    continuations = 2;
+    high = 0x9F;
+  } else if (lead == 0xF0) {
+    continuations = 3;
+    low = 0x90;
+  } else if (lead >= 0xF1 && lead <= 0xF3) {
+    continuations = 3;
+  } else if (lead == 0xF4) {
+    continuations = 3;
+    high = 0x8F;
+  } else {
+    // 0x80 through 0xC1, and 0xF5 through 0xFF, begin no sequence.
+    return {1, false};
+  }
+
+  std::size_t size = 1;
+  for (; size <= continuations; ++size) {
+    if (begin + size == end || begin[size] < low || begin[size] > high) {
+      return {size, false};
+    }
+    low = 0x80;
+    high = 0xBF;
+  }
+  return {size, true};
+}
+
+#if defined(DD_TRACE_UTF8_SSSE3) || defined(DD_TRACE_UTF8_NEON)
+// The block validator classifies each pair of adjacent bytes using three
+// sixteen-entry tables, indexed by the high and low nibbles of the first byte
+// and by the high nibble of the second byte.  Each bit of a table entry is an
+// error that the pair might be evidence of, and the pair is in error if a bit
+// is set in all three entries.  This is the "lookup" algorithm of Keiser and
+// Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte" (2021).
+constexpr Byte too_short = 1 << 0;  // lead byte then lead byte or ASCII
+constexpr Byte too_long = 1 << 1;   // ASCII then continuation byte
+constexpr Byte overlong_3 = 1 << 2;
+constexpr Byte too_large = 1 << 3;
+constexpr Byte surrogate = 1 << 4;
+constexpr Byte overlong_2 = 1 << 5;
+constexpr Byte too_large_1000 = 1 << 6;
+constexpr Byte overlong_4 = 1 << 6;
+constexpr Byte two_continuations = 1 << 7;
+// The bits whose meaning doesn't depend on the first byte's low nibble.
+constexpr Byte carry = too_short | too_long | two_continuations;
+
+alignas(16) constexpr Byte first_high_nibble[16] = {
+    // 0___: ASCII
+    too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+    too_long,
+    // 10__: continuation
+    two_continuations, two_continuations, two_continuations,
+    two_continuations,
+    // 1100: two byte lead, or overlong
+    too_short | overlong_2,
+    // 1101: two byte lead
+    too_short,
+    // 1110: three byte lead
+    too_short | overlong_3 | surrogate,
+    // 1111: four byte lead
+    too_short | too_large | too_large_1000 | overlong_4};
+
+alignas(16) constexpr Byte first_low_nibble[16] = {
+    carry | overlong_3 | overlong_2 | overlong_4,  // ____0000
+    carry | overlong_2,                            // ____0001
+    carry,                                         // ____0010
+    carry,                                         // ____0011
+    carry | too_large,                             // ____0100
+    carry | too_large | too_large_1000,            // ____0101 and above
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000 | surrogate,  // ____1101
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000};
+
+alignas(16) constexpr Byte second_high_nibble[16] = {
+    // 0___: ASCII
+    too_short, too_short, too_short, too_short, too_short, too_short,
+    too_short, too_short,
+    // 1000: continuation
+    too_long | overlong_2 | two_continuations | overlong_3 | too_large_1000 |
+        overlong_4,
+    // 1001: continuation
+    too_long | overlong_2 | two_continuations | overlong_3 | too_large,
+    // 101_: continuation
+    too_long | overlong_2 | two_continuations | surrogate | too_large,
+    too_long | overlong_2 | two_continuations | surrogate | too_large,
+    // 11__: lead
+    too_short, too_short, too_short, too_short};
+
+// The largest value that each of the last three bytes of a block can have
+// without beginning a sequence that continues into the next block.
+alignas(16) constexpr Byte max_final_bytes[16] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF};
+#endif
+
+#if defined(DD_TRACE_UTF8_SSSE3)
+#if defined(DD_TRACE_UTF8_SSSE3_DISPATCH)
+#define DD_TRACE_UTF8_SSSE3_TARGET __attribute__((target("ssse3")))
+#else
+#define DD_TRACE_UTF8_SSSE3_TARGET
+#endif
+
+__m128i load(const Byte* bytes) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+}
+
+// `Ssse3Validator` accumulates the errors in a sequence of sixteen byte
+// blocks.  Its member functions are not lambdas, because a lambda doesn't
+// inherit its enclosing function's `target` attribute.
+struct Ssse3Validator {
+  __m128i previous = _mm_setzero_si128();
+  __m128i previous_incomplete = _mm_setzero_si128();
+  __m128i error = _mm_setzero_si128();
+
+  // Note that the next bytes are ASCII, the last sixteen of which are
+  // `final`.
+  void skip_ascii(__m128i final) {
+    // ASCII is valid unless it interrupts a sequence.
+    error = _mm_or_si128(error, previous_incomplete);
+    previous_incomplete = _mm_setzero_si128();
+    previous = final;
+  }
+
+  DD_TRACE_UTF8_SSSE3_TARGET void check(__m128i input) {
+    if (_mm_movemask_epi8(input) == 0) {
+      skip_ascii(input);
+      return;
+    }
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    const __m128i high = _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble);
+    // `prev1` is each byte's predecessor, `prev2` its predecessor's
+    // predecessor, and so on.
+    const __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    const __m128i prev1_high =
+        _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble);
+    const __m128i prev1_low = _mm_and_si128(prev1, low_nibble);
+    const __m128i special = _mm_and_si128(
+        _mm_and_si128(_mm_shuffle_epi8(load(first_high_nibble), prev1_high),
+                      _mm_shuffle_epi8(load(first_low_nibble), prev1_low)),
+        _mm_shuffle_epi8(load(second_high_nibble), high));
+    // The third and fourth bytes of a sequence are the only continuation
+    // bytes that `special` doesn't expect, so they're accounted for here.
+    const __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+    const __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+    const __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80));
+    const __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80));
+    const __m128i expected = _mm_and_si128(_mm_or_si128(third, fourth),
+                                           _mm_set1_epi8(char(0x80)));
+    error = _mm_or_si128(error, _mm_xor_si128(expected, special));
+    previous_incomplete = _mm_subs_epu8(input, load(max_final_bytes));
+    previous = input;
+  }
+};
+
+// Return whether `[p, end)` is valid UTF-8, sixteen bytes at a time.
+DD_TRACE_UTF8_SSSE3_TARGET bool is_valid_utf8_ssse3(const Byte* p,
+                                                    const Byte* end) {
+  Ssse3Validator validator;
+  for (; end - p >= 64; p += 64) {
+    const __m128i a = load(p);
+    const __m128i b = load(p + 16);
+    const __m128i c = load(p + 32);
+    const __m128i d = load(p + 48);
+    if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b),
+                                       _mm_or_si128(c, d))) == 0) {
+      validator.skip_ascii(d);
+      continue;
+    }
+    validator.check(a);
+    validator.check(b);
+    validator.check(c);
+    validator.check(d);
+  }
+  for (; end - p >= 16; p += 16) {
+    validator.check(load(p));
+  }
+  if (p != end) {
+    // The final partial block is padded with ASCII.
+    Byte last[16] = {};
+    std::memcpy(last, p, end - p);
+    validator.check(load(last));
+  }
+  const __m128i error =
+      _mm_or_si128(validator.error, validator.previous_incomplete);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) ==
+         0xFFFF;
+}
+#elif defined(DD_TRACE_UTF8_NEON)
+// Return whether `[begin, end)` is valid UTF-8, sixteen bytes at a time.
+bool is_valid_utf8_neon(const Byte* p, const Byte* end) {
+  const uint8x16_t first_high = vld1q_u8(first_high_nibble);
+  const uint8x16_t first_low = vld1q_u8(first_low_nibble);
+  const uint8x16_t second_high = vld1q_u8(second_high_nibble);
+  const uint8x16_t max_final = vld1q_u8(max_final_bytes);
+  const uint8x16_t low_nibble = vdupq_n_u8(0x0F);
+
+  uint8x16_t previous = vdupq_n_u8(0);
+  uint8x16_t previous_incomplete = vdupq_n_u8(0);
+  uint8x16_t error = vdupq_n_u8(0);
+  // See `is_valid_utf8_ssse3`.
+  const auto check = [&](uint8x16_t input) {
+    if (vmaxvq_u8(input) < 0x80) {
+      error = vorrq_u8(error, previous_incomplete);
+      previous_incomplete = vdupq_n_u8(0);
+      previous = input;
+      return;
+    }
+    const uint8x16_t prev1 = vextq_u8(previous, input, 15);
+    const uint8x16_t special = vandq_u8(
+        vandq_u8(vqtbl1q_u8(first_high, vshrq_n_u8(prev1, 4)),
+                 vqtbl1q_u8(first_low, vandq_u8(prev1, low_nibble))),
+        vqtbl1q_u8(second_high, vshrq_n_u8(input, 4)));
+    const uint8x16_t prev2 = vextq_u8(previous, input, 14);
+    const uint8x16_t prev3 = vextq_u8(previous, input, 13);
+    const uint8x16_t third = vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80));
+    const uint8x16_t fourth = vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80));
+    const uint8x16_t expected =
+        vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+    error = vorrq_u8(error, veorq_u8(expected, special));
+    previous_incomplete = vqsubq_u8(input, max_final);
+    previous = input;
+  };
+
+  for (; end - p >= 16; p += 16) {
+    check(vld1q_u8(p));
+  }
+  if (p != end) {
+    Byte last[16] = {};
+    std::memcpy(last, p, end - p);
+    check(vld1q_u8(last));
+  }
+  error = vorrq_u8(error, previous_incomplete);
+  return vmaxvq_u8(error) == 0;
+}
+#endif
+
+}  // namespace
+
+const StringView utf8_replacement_character = "\xEF\xBF\xBD";
+
+bool is_valid_utf8(StringView input) {
+  const Byte* const end =
+      reinterpret_cast<const Byte*>(input.data()) + input.size();
+  // Most strings are entirely ASCII, which `skip_ascii` checks fastest.  The
+  // block validators then begin at the first byte outside of ASCII.
+  const Byte* const begin =
+      skip_ascii(reinterpret_cast<const Byte*>(input.data()), end);
+  if (begin == end) {
+    return true;
+  }
+#if defined(DD_TRACE_UTF8_SSSE3_DISPATCH)
+  static const bool has_ssse3 = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+  }();
+  if (has_ssse3) {
+    return is_valid_utf8_ssse3(begin, end);
+  }
+#elif defined(DD_TRACE_UTF8_SSSE3)
+  return is_valid_utf8_ssse3(begin, end);
+#elif defined(DD_TRACE_UTF8_NEON)
+  return is_valid_utf8_neon(begin, end);
+#endif
+  return utf8_valid_prefix(input) == input.size();
+}
+
+std::size_t utf8_valid_prefix(StringView input) {
+  const Byte* const begin = reinterpret_cast<const Byte*>(input.data());
+  const Byte* const end = begin + input.size();
+  const Byte* p = begin;
+  for (;;) {
+    p = skip_ascii(p, end);
+    if (p == end) {
+      return input.size();
+    }
+    const Sequence sequence = next_sequence(p, end);
+    if (!sequence.valid) {
+      return p - begin;
+    }
+    p += sequence.size;
+  }
+}
+
+std::size_t append_sanitized_utf8(std::string& destination, StringView input) {
+  const Byte* p = reinterpret_cast<const Byte*>(input.data());
+  const Byte* const end = p + input.size();
+  // Valid bytes are appended in runs that end before an invalid sequence.
+  const Byte* run = p;
+  std::size_t replacements = 0;
+  for (;;) {
+    p = skip_ascii(p, end);
+    if (p == end) {
+      break;
+    }
+    const Sequence sequence = next_sequence(p, end);
+    if (!sequence.valid) {
+      destination.append(reinterpret_cast<const char*>(run), p - run);
+      destination.append(utf8_replacement_character.data(),
+                         utf8_replacement_character.size());
+      ++replacements;
+      run = p + sequence.size;
+    }
+    p += sequence.size;
+  }
+  destination.append(reinterpret_cast<const char*>(run), end - run);
+  return replacements;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,51 @@
+#pragma once
+
+// This component provides functions for validating UTF-8 and for replacing
+// the parts of a string that are not valid UTF-8.
+//
+// The agent rejects a MessagePack payload that has a string that is not valid
+// UTF-8, and with it every trace in the payload.  Span tags can contain
+// arbitrary bytes, e.g. binary values copied from request headers, and so
+// `msgpack::pack_string` uses these functions to make each string valid before
+// it is encoded.
+//
+// `is_valid_utf8` validates sixteen bytes at a time using SSSE3 (selected at
+// runtime on x86) or NEON, and skips sixty-four bytes at a time of ASCII.
+// Almost all strings are ASCII and valid, so this is the fast path.
+//
+// `utf8_valid_prefix` and `append_sanitized_utf8` find the exact position of
+// each invalid sequence, so they check sixteen bytes at a time for a byte
+// outside of ASCII (using SSE2 or NEON where available, or eight bytes at a
+// time using a 64-bit word otherwise), and validate multibyte sequences one at
+// a time when they find one.
+//
+// Invalid sequences are replaced following the "maximal subpart" practice of
+// the Unicode Standard (section 3.9, "U+FFFD Substitution of Maximal
+// Subparts"), which is also what web browsers do: each maximal prefix of a
+// well-formed sequence, or each byte that begins no well-formed sequence, is
+// replaced by one U+FFFD REPLACEMENT CHARACTER.
+
+#include <datadog/string_view.h>
+
+#include <cstddef>
+#include <string>
+
+namespace datadog {
+namespace tracing {
+
+// U+FFFD REPLACEMENT CHARACTER, encoded as UTF-8.
+extern const StringView utf8_replacement_character;
+
+// Return the length of the longest prefix of the specified `input` that is
+// valid UTF-8.  The result is `input.size()` if all of `input` is valid.
+std::size_t utf8_valid_prefix(StringView input);
+
+// Return whether the specified `input` is valid UTF-8.
+bool is_valid_utf8(StringView input);
+
+// Append the specified `input` to the specified `destination`, replacing each
+// invalid sequence in `input` by U+FFFD.  Return the number of replacements.
+std::size_t append_sanitized_utf8(std::string& destination, StringView input);
+
+}  // namespace tracing
+}  // namespace datadog
@@ -406,14 +406,43 @@ std::string encode_tracestate(
     const Optional<std::string>& origin,
     const std::vector<std::pair<std::string, std::string>>& trace_tags,
     const Optional<std::string>& additional_datadog_w3c_tracestate,
-    const Optional<std::string>& additional_w3c_tracestate) {
+    const Optional<std::string>& additional_w3c_tracestate,
+    Optional<std::size_t> max_size) {
   std::string result =
       encode_datadog_tracestate(span_id, sampling_priority, origin, trace_tags,
                                 additional_datadog_w3c_tracestate);
 
+  if (!max_size) {
+    if (additional_w3c_tracestate) {
+      result += ',';
+      result += *additional_w3c_tracestate;
+    }
+    return result;
+  }
+
+  // The Datadog entry begins with "dd=s:<priority>;p:<parent ID>". Those two
+  // fields are kept no matter what. Optional fields follow, each preceded by a
+  // semicolon, so there are optional fields whenever there is more than one
+  // semicolon.
+  while (result.size() > *max_size &&
+         std::count(result.begin(), result.end(), ';') > 1) {
+    result.resize(result.rfind(';'));
+  }
+
   if (additional_w3c_tracestate) {
-    result += ',';
-    result += *additional_w3c_tracestate;
+    // Other vendors' list-members are kept in order for as long as they fit.
+    StringView members = *additional_w3c_tracestate;
+    while (!members.empty()) {
+      const auto comma = members.find(',');
+      const StringView member = members.substr(0, comma);
+      if (result.size() + 1 + member.size() > *max_size) {
+        break;
+      }
+      result += ',';
+      append(result, member);
+      members.remove_prefix(comma == StringView::npos ? members.size()
+                                                      : comma + 1);
+    }
   }
 
   return result;
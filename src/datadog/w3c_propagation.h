@@ -9,6 +9,7 @@
 #include <datadog/optional.h>
 #include <datadog/trace_id.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <unordered_map>
@@ -38,12 +39,17 @@ std::string encode_traceparent(TraceID trace_id, std::uint64_t span_id,
                                int sampling_priority);
 
 // Return a value for the "tracestate" header containing the specified fields.
+// If the optionally specified `max_size` is not null, then drop entries other
+// than the Datadog entry from the end of the result, and then optional fields
+// from the end of the Datadog entry, until the result is no longer than
+// `max_size` or only the Datadog sampling priority and parent ID remain.
 std::string encode_tracestate(
     uint64_t span_id, int sampling_priority,
     const Optional<std::string>& origin,
     const std::vector<std::pair<std::string, std::string>>& trace_tags,
     const Optional<std::string>& additional_datadog_w3c_tracestate,
-    const Optional<std::string>& additional_w3c_tracestate);
+    const Optional<std::string>& additional_w3c_tracestate,
+    Optional<std::size_t> max_size = nullopt);
 
 }  // namespace tracing
 }  // namespace datadog
@@ -0,0 +1,699 @@
+#include "agent_emulator.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <datadog/json.hpp>
+#include <system_error>
+#include <unordered_map>
+
+namespace {
+
+constexpr std::size_t max_header_bytes = 64 * 1024;
+constexpr std::size_t receive_buffer_size = 64 * 1024;
+// How often blocked threads check whether the emulator is stopping.
+constexpr int poll_milliseconds = 50;
+
+[[noreturn]] void throw_errno(const std::string& what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+std::string lower(std::string text) {
+  std::transform(text.begin(), text.end(), text.begin(),
+                 [](unsigned char ch) { return std::tolower(ch); });
+  return text;
+}
+
+std::string trim(const std::string& text) {
+  const auto begin = text.find_first_not_of(" \t");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  const auto end = text.find_last_not_of(" \t\r");
+  return text.substr(begin, end - begin + 1);
+}
+
+const char* reason_phrase(int status) {
+  switch (status) {
+    case 100:
+      return "Continue";
+    case 200:
+      return "OK";
+    case 400:
+      return "Bad Request";
+    case 404:
+      return "Not Found";
+    case 411:
+      return "Length Required";
+    case 413:
+      return "Payload Too Large";
+    case 429:
+      return "Too Many Requests";
+    default:
+      return "Internal Server Error";
+  }
+}
+
+bool send_all(int socket, const std::string& data) {
+  if (socket < 0) {
+    return false;
+  }
+  std::size_t sent = 0;
+  while (sent < data.size()) {
+    const auto rc =
+        ::send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      return false;
+    }
+    sent += static_cast<std::size_t>(rc);
+  }
+  return true;
+}
+
+// `MessagePackReader` walks MessagePack encoded data without decoding it,
+// which is enough to count the trace chunks and spans in a payload.
+class MessagePackReader {
+  const unsigned char* position_;
+  const unsigned char* end_;
+
+  bool read_size(std::size_t bytes, std::size_t& size) {
+    if (std::size_t(end_ - position_) < bytes) {
+      return false;
+    }
+    size = 0;
+    for (std::size_t i = 0; i < bytes; ++i) {
+      size = (size << 8) | *position_++;
+    }
+    return true;
+  }
+
+  bool advance(std::size_t bytes) {
+    if (std::size_t(end_ - position_) < bytes) {
+      return false;
+    }
+    position_ += bytes;
+    return true;
+  }
+
+ public:
+  explicit MessagePackReader(const std::string& data)
+      : position_(reinterpret_cast<const unsigned char*>(data.data())),
+        end_(position_ + data.size()) {}
+
+  bool at_end() const { return position_ == end_; }
+
+  // Read an array header, storing the number of elements into the specified
+  // `size`.  Return false if the next value is not an array.
+  bool read_array(std::size_t& size) {
+    if (position_ == end_) {
+      return false;
+    }
+    const unsigned char type = *position_++;
+    if (type >= 0x90 && type <= 0x9F) {
+      size = type & 0x0F;
+      return true;
+    }
+    if (type == 0xDC) {
+      return read_size(2, size);
+    }
+    if (type == 0xDD) {
+      return read_size(4, size);
+    }
+    return false;
+  }
+
+  // Skip the next value, including any nested values.  Return false if the
+  // data is malformed.
+  bool skip(int depth = 0) {
+    if (position_ == end_ || depth > 64) {
+      return false;
+    }
+    const unsigned char type = *position_++;
+    std::size_t size = 0;
+    std::size_t elements = 0;
+    if (type <= 0x7F || type >= 0xE0 || type == 0xC0 || type == 0xC2 ||
+        type == 0xC3) {
+      return true;
+    } else if (type >= 0x80 && type <= 0x8F) {
+      elements = 2 * (type & 0x0F);
+    } else if (type >= 0x90 && type <= 0x9F) {
+      elements = type & 0x0F;
+    } else if (type >= 0xA0 && type <= 0xBF) {
+      return advance(type & 0x1F);
+    } else if (type >= 0xC4 && type <= 0xC6) {
+      // bin 8, 16, 32
+      return read_size(std::size_t(1) << (type - 0xC4), size) && advance(size);
+    } else if (type >= 0xC7 && type <= 0xC9) {
+      // ext 8, 16, 32
+      return read_size(std::size_t(1) << (type - 0xC7), size) &&
+             advance(size + 1);
+    } else if (type == 0xCA) {
+      return advance(4);
+    } else if (type == 0xCB) {
+      return advance(8);
+    } else if (type >= 0xCC && type <= 0xD3) {
+      // unsigned and signed integers of 1, 2, 4, and 8 bytes
+      return advance(std::size_t(1) << ((type - 0xCC) % 4));
+    } else if (type >= 0xD4 && type <= 0xD8) {
+      // fixext 1, 2, 4, 8, 16
+      return advance(1 + (std::size_t(1) << (type - 0xD4)));
+    } else if (type >= 0xD9 && type <= 0xDB) {
+      // str 8, 16, 32
+      return read_size(std::size_t(1) << (type - 0xD9), size) && advance(size);
+    } else if (type == 0xDC || type == 0xDD) {
+      if (!read_size(type == 0xDC ? 2 : 4, elements)) {
+        return false;
+      }
+    } else if (type == 0xDE || type == 0xDF) {
+      if (!read_size(type == 0xDE ? 2 : 4, size)) {
+        return false;
+      }
+      elements = 2 * size;
+    } else {
+      // 0xC1 is never used.
+      return false;
+    }
+
+    for (std::size_t i = 0; i < elements; ++i) {
+      if (!skip(depth + 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// Count the trace chunks and spans in the specified MessagePack `payload`,
+// which is in version 0.5 of the traces format if `v05` is true, or in version
+// 0.4 otherwise.  Return false if `payload` is malformed.
+bool count_traces(const std::string& payload, bool v05, std::uint64_t& chunks,
+                  std::uint64_t& spans) {
+  MessagePackReader reader{payload};
+  std::size_t size;
+  if (v05) {
+    // [[strings...], [chunks...]]
+    if (!reader.read_array(size) || size != 2 || !reader.read_array(size)) {
+      return false;
+    }
+    for (std::size_t i = 0; i < size; ++i) {
+      if (!reader.skip()) {
+        return false;
+      }
+    }
+  }
+
+  std::size_t chunk_count;
+  if (!reader.read_array(chunk_count)) {
+    return false;
+  }
+  chunks = chunk_count;
+  spans = 0;
+  for (std::size_t i = 0; i < chunk_count; ++i) {
+    std::size_t span_count;
+    if (!reader.read_array(span_count)) {
+      return false;
+    }
+    spans += span_count;
+    for (std::size_t j = 0; j < span_count; ++j) {
+      if (!reader.skip()) {
+        return false;
+      }
+    }
+  }
+  return reader.at_end();
+}
+
+}  // namespace
+
+struct AgentEmulator::Request {
+  std::string method;
+  std::string path;
+  // keys are lower case
+  std::unordered_map<std::string, std::string> headers;
+  std::string body;
+};
+
+std::string AgentEmulatorReport::to_json() const {
+  auto responses = nlohmann::json::object();
+  for (const auto& [status, count] : trace_responses) {
+    responses[std::to_string(status)] = count;
+  }
+  // clang-format off
+  return nlohmann::json::object({
+    {"connections", connections},
+    {"trace_requests", trace_requests},
+    {"trace_bytes", trace_bytes},
+    {"trace_chunks", trace_chunks},
+    {"spans", spans},
+    {"accepted_trace_chunks", accepted_trace_chunks},
+    {"trace_responses", responses},
+    {"connection_resets", connection_resets},
+    {"telemetry_requests", telemetry_requests},
+    {"telemetry_messages", telemetry_messages},
+    {"remote_config_requests", remote_config_requests},
+    {"info_requests", info_requests},
+    {"bad_requests", bad_requests},
+  }).dump(2);
+  // clang-format on
+}
+
+AgentEmulator::AgentEmulator(const AgentEmulatorConfig& config)
+    : config_(config), random_(config.seed) {
+  if (config_.unix_socket.empty()) {
+    listen_socket_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_socket_ < 0) {
+      throw_errno("socket");
+    }
+    const int yes = 1;
+    ::setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<std::uint16_t>(config_.port));
+    if (::inet_pton(AF_INET, config_.host.c_str(), &address.sin_addr) != 1) {
+      ::close(listen_socket_);
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                              "invalid IPv4 address: " + config_.host);
+    }
+    if (::bind(listen_socket_, reinterpret_cast<sockaddr*>(&address),
+               sizeof address) != 0) {
+      const int error = errno;
+      ::close(listen_socket_);
+      errno = error;
+      throw_errno("bind");
+    }
+    socklen_t length = sizeof address;
+    ::getsockname(listen_socket_, reinterpret_cast<sockaddr*>(&address),
+                  &length);
+    port_ = ntohs(address.sin_port);
+  } else {
+    sockaddr_un address{};
+    if (config_.unix_socket.size() >= sizeof address.sun_path) {
+      throw std::system_error(
+          std::make_error_code(std::errc::filename_too_long),
+          "Unix domain socket path is too long: " + config_.unix_socket);
+    }
+    listen_socket_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_socket_ < 0) {
+      throw_errno("socket");
+    }
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, config_.unix_socket.c_str());
+    ::unlink(config_.unix_socket.c_str());
+    if (::bind(listen_socket_, reinterpret_cast<sockaddr*>(&address),
+               sizeof address) != 0) {
+      const int error = errno;
+      ::close(listen_socket_);
+      errno = error;
+      throw_errno("bind");
+    }
+  }
+
+  if (::listen(listen_socket_, SOMAXCONN) != 0) {
+    const int error = errno;
+    ::close(listen_socket_);
+    errno = error;
+    throw_errno("listen");
+  }
+
+  acceptor_ = std::thread([this]() { accept_connections(); });
+}
+
+AgentEmulator::~AgentEmulator() { stop(); }
+
+void AgentEmulator::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      return;
+    }
+    stopping_ = true;
+    // Wake up any connection waiting for data.
+    for (auto& connection : connections_) {
+      if (connection.socket >= 0) {
+        ::shutdown(connection.socket, SHUT_RDWR);
+      }
+    }
+  }
+  changed_.notify_all();
+
+  acceptor_.join();
+  // Now that `acceptor_` is finished, `connections_` doesn't change.
+  for (auto& connection : connections_) {
+    connection.thread.join();
+  }
+  connections_.clear();
+
+  ::close(listen_socket_);
+  if (!config_.unix_socket.empty()) {
+    ::unlink(config_.unix_socket.c_str());
+  }
+}
+
+int AgentEmulator::port() const { return port_; }
+
+std::string AgentEmulator::url() const {
+  if (!config_.unix_socket.empty()) {
+    return "unix://" + config_.unix_socket;
+  }
+  return "http://" + config_.host + ":" + std::to_string(port_);
+}
+
+AgentEmulatorReport AgentEmulator::report() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return report_;
+}
+
+AgentEmulatorReport AgentEmulator::wait_until(
+    const std::function<bool(const AgentEmulatorReport&)>& condition,
+    std::chrono::milliseconds timeout) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait_for(lock, timeout, [&]() { return condition(report_); });
+  return report_;
+}
+
+void AgentEmulator::accept_connections() {
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_) {
+        return;
+      }
+      // Reap the threads of connections that have finished.
+      for (auto it = connections_.begin(); it != connections_.end();) {
+        if (it->finished) {
+          it->thread.join();
+          it = connections_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    pollfd request{listen_socket_, POLLIN, 0};
+    if (::poll(&request, 1, poll_milliseconds) <= 0) {
+      continue;
+    }
+    const int socket = ::accept(listen_socket_, nullptr, nullptr);
+    if (socket < 0) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      ::close(socket);
+      return;
+    }
+    ++report_.connections;
+    Connection& connection = connections_.emplace_back();
+    connection.socket = socket;
+    connection.thread =
+        std::thread([this, &connection]() { serve(connection); });
+  }
+}
+
+void AgentEmulator::serve(Connection& connection) {
+  std::string buffer;
+  Request request;
+  while (read_request(connection, buffer, request) &&
+         respond(connection, request)) {
+    const auto found = request.headers.find("connection");
+    if (found != request.headers.end() && lower(found->second) == "close") {
+      break;
+    }
+    request = Request{};
+  }
+
+  close_connection(connection, false);
+  std::lock_guard<std::mutex> lock(mutex_);
+  connection.finished = true;
+}
+
+bool AgentEmulator::sleep_for(std::chrono::milliseconds duration) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return changed_.wait_for(lock, duration, [this]() { return stopping_; });
+}
+
+bool AgentEmulator::receive(Connection& connection, std::string& buffer,
+                            std::size_t max_size) {
+  int socket;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ || connection.socket < 0) {
+      return false;
+    }
+    socket = connection.socket;
+  }
+
+  std::size_t size = std::min(max_size, receive_buffer_size);
+  if (config_.read_bytes_per_second) {
+    // Read a twentieth of the rate limit, and then wait a twentieth of a
+    // second.
+    size = std::min(size, std::max<std::size_t>(
+                              1, config_.read_bytes_per_second / 20));
+  }
+
+  for (;;) {
+    pollfd request{socket, POLLIN, 0};
+    const int rc = ::poll(&request, 1, poll_milliseconds);
+    if (rc < 0 && errno != EINTR) {
+      return false;
+    }
+    if (rc > 0) {
+      break;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      return false;
+    }
+  }
+
+  char chunk[receive_buffer_size];
+  const auto received = ::recv(socket, chunk, size, 0);
+  if (received <= 0) {
+    return false;
+  }
+  buffer.append(chunk, static_cast<std::size_t>(received));
+
+  if (config_.read_bytes_per_second) {
+    return !sleep_for(std::chrono::milliseconds(50));
+  }
+  return true;
+}
+
+bool AgentEmulator::read_request(Connection& connection, std::string& buffer,
+                                 Request& request) {
+  std::size_t header_end;
+  while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+    if (buffer.size() > max_header_bytes ||
+        !receive(connection, buffer, receive_buffer_size)) {
+      return false;
+    }
+  }
+
+  // request line
+  std::size_t line_end = buffer.find("\r\n");
+  const std::string request_line = buffer.substr(0, line_end);
+  const auto method_end = request_line.find(' ');
+  const auto target_end = request_line.find(' ', method_end + 1);
+  if (method_end == std::string::npos || target_end == std::string::npos) {
+    return false;
+  }
+  request.method = request_line.substr(0, method_end);
+  request.path =
+      request_line.substr(method_end + 1, target_end - method_end - 1);
+  request.path = request.path.substr(0, request.path.find('?'));
+
+  // header fields
+  while (line_end < header_end) {
+    const std::size_t begin = line_end + 2;
+    line_end = buffer.find("\r\n", begin);
+    const std::string line = buffer.substr(begin, line_end - begin);
+    const auto colon = line.find(':');
+    if (colon != std::string::npos) {
+      request.headers[lower(line.substr(0, colon))] =
+          trim(line.substr(colon + 1));
+    }
+  }
+  buffer.erase(0, header_end + 4);
+
+  std::size_t content_length = 0;
+  if (const auto found = request.headers.find("content-length");
+      found != request.headers.end()) {
+    content_length = std::strtoull(found->second.c_str(), nullptr, 10);
+  } else if (request.headers.count("transfer-encoding")) {
+    // Chunked requests aren't supported.  libcurl doesn't send them.
+    std::string response = "HTTP/1.1 411 ";
+    response += reason_phrase(411);
+    response += "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    send_all(connection_socket(connection), response);
+    return false;
+  }
+
+  if (const auto found = request.headers.find("expect");
+      found != request.headers.end() &&
+      lower(found->second) == "100-continue") {
+    if (!send_all(connection_socket(connection),
+                  "HTTP/1.1 100 Continue\r\n\r\n")) {
+      return false;
+    }
+  }
+
+  while (buffer.size() < content_length) {
+    if (!receive(connection, buffer, content_length - buffer.size())) {
+      return false;
+    }
+  }
+  request.body = buffer.substr(0, content_length);
+  buffer.erase(0, content_length);
+  return true;
+}
+
+bool AgentEmulator::respond(Connection& connection, const Request& request) {
+  if (config_.latency.count() && sleep_for(config_.latency)) {
+    return false;
+  }
+
+  int status = 200;
+  std::string body;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const bool v04 = request.path == "/v0.4/traces";
+    const bool v05 = request.path == "/v0.5/traces";
+    if (request.method == "POST" && (v04 || v05)) {
+      ++report_.trace_requests;
+      report_.trace_bytes += request.body.size();
+      std::uint64_t chunks = 0;
+      std::uint64_t spans = 0;
+      if (!count_traces(request.body, v05, chunks, spans)) {
+        ++report_.bad_requests;
+        status = 400;
+      } else {
+        report_.trace_chunks += chunks;
+        report_.spans += spans;
+        const double roll =
+            std::uniform_real_distribution<double>(0, 1)(random_);
+        double threshold = config_.reset_rate;
+        if (roll < threshold) {
+          // Status zero means "reset the connection" below.
+          ++report_.connection_resets;
+          status = 0;
+        } else if (roll < (threshold += config_.error_rate)) {
+          status = 500;
+        } else if (roll < (threshold += config_.request_too_large_rate) ||
+                   (config_.max_request_bytes &&
+                    request.body.size() > config_.max_request_bytes)) {
+          status = 413;
+        } else if (roll < (threshold += config_.too_many_requests_rate)) {
+          status = 429;
+        } else {
+          report_.accepted_trace_chunks += chunks;
+          body = R"({"rate_by_service":{"service:,env:":1}})";
+        }
+      }
+      if (status) {
+        ++report_.trace_responses[status];
+      }
+    } else if (request.method == "POST" &&
+               request.path == "/telemetry/proxy/api/v2/apmtelemetry") {
+      ++report_.telemetry_requests;
+      const auto message =
+          nlohmann::json::parse(request.body, nullptr, false);
+      if (message.is_discarded() || !message.is_object()) {
+        ++report_.bad_requests;
+        status = 400;
+      } else {
+        const std::string type = message.value("request_type", "");
+        ++report_.telemetry_messages[type];
+        const auto payload = message.find("payload");
+        if (type == "message-batch" && payload != message.end() &&
+            payload->is_array()) {
+          for (const auto& item : *payload) {
+            if (item.is_object()) {
+              ++report_.telemetry_messages[item.value("request_type", "")];
+            }
+          }
+        }
+      }
+    } else if (request.method == "POST" && request.path == "/v0.7/config") {
+      ++report_.remote_config_requests;
+      if (next_remote_config_response_ <
+          config_.remote_config_responses.size()) {
+        body = config_.remote_config_responses[next_remote_config_response_++];
+      } else {
+        body = "{}";
+      }
+    } else if (request.method == "GET" && request.path == "/info") {
+      ++report_.info_requests;
+      if (!config_.info.empty()) {
+        body = config_.info;
+      } else {
+        auto info = nlohmann::json::object({
+            {"version", "agent-emulator"},
+            {"endpoints",
+             {"/v0.4/traces", "/v0.5/traces",
+              "/telemetry/proxy/api/v2/apmtelemetry", "/v0.7/config",
+              "/info"}},
+            {"feature_flags", nlohmann::json::array()},
+            {"client_drop_p0s", false},
+            {"config", nlohmann::json::object()},
+        });
+        if (config_.max_request_bytes) {
+          info["config"]["max_request_bytes"] = config_.max_request_bytes;
+        }
+        if (!config_.unix_socket.empty()) {
+          info["config"]["receiver_socket"] = config_.unix_socket;
+        }
+        body = info.dump();
+      }
+    } else {
+      ++report_.bad_requests;
+      status = 404;
+    }
+  }
+  changed_.notify_all();
+
+  if (status == 0) {
+    close_connection(connection, true);
+    return false;
+  }
+
+  std::string response = "HTTP/1.1 " + std::to_string(status) + " ";
+  response += reason_phrase(status);
+  response += "\r\nContent-Type: application/json\r\nContent-Length: ";
+  response += std::to_string(body.size());
+  response += "\r\n\r\n";
+  response += body;
+  return send_all(connection_socket(connection), response);
+}
+
+int AgentEmulator::connection_socket(const Connection& connection) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return connection.socket;
+}
+
+void AgentEmulator::close_connection(Connection& connection, bool reset) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (connection.socket < 0) {
+    return;
+  }
+  if (reset) {
+    // Closing a socket that lingers for zero seconds sends a TCP RST.
+    linger option{1, 0};
+    ::setsockopt(connection.socket, SOL_SOCKET, SO_LINGER, &option,
+                 sizeof option);
+  }
+  ::close(connection.socket);
+  connection.socket = -1;
+}
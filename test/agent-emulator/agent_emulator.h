@@ -0,0 +1,181 @@
+#pragma once
+
+// This component provides a `class`, `AgentEmulator`, that is an HTTP server
+// that behaves enough like the Datadog Agent for dd-trace-cpp to deliver
+// traces, telemetry, and Remote Configuration polls to it, and that can be
+// configured to misbehave in the ways that a real Agent sometimes does.
+//
+// `AgentEmulator` serves the following endpoints, over TCP or over a Unix
+// domain socket:
+//
+// - "/v0.4/traces" and "/v0.5/traces" decode the MessagePack payload and
+//   count its trace chunks and spans.
+// - "/telemetry/proxy/api/v2/apmtelemetry" counts telemetry messages by their
+//   "request_type".
+// - "/v0.7/config" answers Remote Configuration polls with a scripted sequence
+//   of responses, and with an empty object afterward.
+// - "/info" describes the emulated Agent.  See `agent_info.h` in the library.
+//
+// Every response can be delayed, and request bodies can be read slowly.  Trace
+// requests can additionally be answered with status 500, 413 (Payload Too
+// Large), or 429 (Too Many Requests), or have their connection reset instead
+// of being answered.  See `AgentEmulatorConfig`.
+//
+// `AgentEmulator::report` returns what has been received so far.
+//
+// `AgentEmulator` is used by the soak tests in `test_soak.cpp`, and by the
+// `agent-emulator` program in `main.cpp`, which is useful for load testing an
+// application instrumented with dd-trace-cpp.
+//
+// `AgentEmulator` uses POSIX sockets, and so is not available on Windows.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AgentEmulatorConfig {
+  // The TCP address on which to listen.  If `port` is zero, then a free port
+  // is chosen.  See `AgentEmulator::port`.
+  std::string host = "127.0.0.1";
+  int port = 0;
+  // If not empty, listen on a Unix domain socket at this path instead of on
+  // TCP.  Any file already at the path is removed.
+  std::string unix_socket;
+
+  // How long to wait before sending each response.
+  std::chrono::milliseconds latency{0};
+  // If not zero, the maximum rate at which request bodies are read.
+  std::size_t read_bytes_per_second = 0;
+
+  // The probabilities that a trace request is answered with status 500, with
+  // status 413, with status 429, or has its connection reset instead.
+  double error_rate = 0;
+  double request_too_large_rate = 0;
+  double too_many_requests_rate = 0;
+  double reset_rate = 0;
+  // If not zero, trace requests larger than this are answered with status
+  // 413, and the limit is advertised in the "/info" response.
+  std::size_t max_request_bytes = 0;
+
+  // The body of responses to "/info".  If empty, the response describes an
+  // Agent that supports all of the endpoints above.
+  std::string info;
+  // The bodies of successive responses to "/v0.7/config".  After they're
+  // used up, the response is an empty JSON object, meaning "no changes."
+  std::vector<std::string> remote_config_responses;
+
+  // The seed of the random choice of faults, so that runs are reproducible.
+  std::uint64_t seed = 0;
+};
+
+struct AgentEmulatorReport {
+  std::uint64_t connections = 0;
+  // requests to "/v0.4/traces" and "/v0.5/traces"
+  std::uint64_t trace_requests = 0;
+  std::uint64_t trace_bytes = 0;
+  // the trace chunks and spans in all trace requests, however they were
+  // answered
+  std::uint64_t trace_chunks = 0;
+  std::uint64_t spans = 0;
+  // the trace chunks in trace requests that were answered with status 200
+  std::uint64_t accepted_trace_chunks = 0;
+  // the number of trace requests answered with each status
+  std::map<int, std::uint64_t> trace_responses;
+  // the number of trace requests whose connection was reset instead
+  std::uint64_t connection_resets = 0;
+  std::uint64_t telemetry_requests = 0;
+  // the number of telemetry messages of each "request_type", including those
+  // inside of a "message-batch"
+  std::map<std::string, std::uint64_t> telemetry_messages;
+  std::uint64_t remote_config_requests = 0;
+  std::uint64_t info_requests = 0;
+  // requests for unknown endpoints, and requests whose body could not be
+  // decoded
+  std::uint64_t bad_requests = 0;
+
+  // Return a JSON representation of this object.
+  std::string to_json() const;
+};
+
+class AgentEmulator {
+  struct Connection {
+    std::thread thread;
+    // The connection's socket, or -1 once the connection is closed.  Guarded
+    // by `mutex_`.
+    int socket;
+    bool finished = false;
+  };
+
+  struct Request;
+
+  AgentEmulatorConfig config_;
+  int listen_socket_ = -1;
+  int port_ = 0;
+
+  mutable std::mutex mutex_;
+  mutable std::condition_variable changed_;
+  bool stopping_ = false;
+  AgentEmulatorReport report_;
+  std::size_t next_remote_config_response_ = 0;
+  std::mt19937_64 random_;
+  std::list<Connection> connections_;
+  std::thread acceptor_;
+
+  void accept_connections();
+  void serve(Connection&);
+  // Wait for the specified `duration` or until `stop` is called.  Return
+  // whether `stop` was called.
+  bool sleep_for(std::chrono::milliseconds duration);
+  // Receive at most the specified `max_size` bytes from the specified
+  // `connection`, appending them to the specified `buffer`.  Return false if
+  // the connection was closed or the emulator is stopping.
+  bool receive(Connection& connection, std::string& buffer,
+               std::size_t max_size);
+  bool read_request(Connection&, std::string& buffer, Request&);
+  // Handle the specified `request` and send a response on the specified
+  // `connection`.  Return false if the connection was closed instead.
+  bool respond(Connection& connection, const Request& request);
+  // Close the specified `connection`, sending a TCP RST if the specified
+  // `reset` is true.
+  void close_connection(Connection& connection, bool reset);
+  int connection_socket(const Connection&) const;
+
+ public:
+  // Start listening as described by the specified `config`.  Throw
+  // `std::system_error` if that's not possible.
+  explicit AgentEmulator(const AgentEmulatorConfig& config);
+  // Call `stop`.
+  ~AgentEmulator();
+
+  AgentEmulator(const AgentEmulator&) = delete;
+  AgentEmulator& operator=(const AgentEmulator&) = delete;
+
+  // Stop listening, close all connections, and wait for the threads that
+  // serve them to finish.  Subsequent calls have no effect.
+  void stop();
+
+  // Return the TCP port on which this object is listening, or zero if it's
+  // listening on a Unix domain socket.
+  int port() const;
+
+  // Return a URL suitable for `DatadogAgentConfig::url`.
+  std::string url() const;
+
+  // Return what this object has received so far.
+  AgentEmulatorReport report() const;
+
+  // Wait until the specified `condition` is true of the report, or until the
+  // specified `timeout` elapses.  Return the last report.
+  AgentEmulatorReport wait_until(
+      const std::function<bool(const AgentEmulatorReport&)>& condition,
+      std::chrono::milliseconds timeout) const;
+};
@@ -0,0 +1,147 @@
+// This program runs an `AgentEmulator` until it receives SIGINT or SIGTERM,
+// or until a specified duration elapses, and then prints what it received as
+// JSON to standard output.  See `print_usage`.
+
+#include <pthread.h>
+#include <signal.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "agent_emulator.h"
+
+namespace {
+
+void print_usage(std::string_view program) {
+  // clang-format off
+  std::cerr << program << "\n\n"
+            << "Usage: emulate the Datadog Agent for load testing a traced application.\n\n"
+            << "--host ADDRESS\t\t\tListen on this IPv4 address (default 127.0.0.1).\n"
+            << "--port PORT\t\t\tListen on this TCP port (default 8126; 0 for any).\n"
+            << "--unix-socket PATH\t\tListen on a Unix domain socket instead of TCP.\n"
+            << "--latency-ms N\t\t\tDelay each response by N milliseconds.\n"
+            << "--read-bytes-per-second N\tRead request bodies at most this fast.\n"
+            << "--error-rate P\t\t\tAnswer this fraction of trace requests with 500.\n"
+            << "--too-large-rate P\t\tAnswer this fraction of trace requests with 413.\n"
+            << "--too-many-requests-rate P\tAnswer this fraction of trace requests with 429.\n"
+            << "--reset-rate P\t\t\tReset the connection of this fraction of trace requests.\n"
+            << "--max-request-bytes N\t\tAnswer larger trace requests with 413.\n"
+            << "--info FILE\t\t\tAnswer \"/info\" with the contents of FILE.\n"
+            << "--remote-config FILE\t\tAnswer the next Remote Configuration poll with the\n"
+            << "\t\t\t\tcontents of FILE.  May be repeated.\n"
+            << "--seed N\t\t\tSeed the random choice of faults.\n"
+            << "--duration-seconds N\t\tStop after N seconds instead of at SIGINT or SIGTERM.\n"
+            << "-h, --help\t\t\tPrint this help message.\n";
+  // clang-format on
+}
+
+bool read_file(const std::string& path, std::string& contents) {
+  std::ifstream file{path};
+  if (!file) {
+    return false;
+  }
+  std::ostringstream stream;
+  stream << file.rdbuf();
+  contents = stream.str();
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  AgentEmulatorConfig config;
+  config.port = 8126;
+  double duration_seconds = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (arg == "-h" || arg == "--help") {
+      print_usage(argv[0]);
+      return 0;
+    }
+    if (i + 1 == argc) {
+      std::cerr << "Unknown option or missing value: " << arg << '\n';
+      print_usage(argv[0]);
+      return 1;
+    }
+    const std::string value = argv[++i];
+    if (arg == "--host") {
+      config.host = value;
+    } else if (arg == "--port") {
+      config.port = std::atoi(value.c_str());
+    } else if (arg == "--unix-socket") {
+      config.unix_socket = value;
+    } else if (arg == "--latency-ms") {
+      config.latency = std::chrono::milliseconds(std::atoll(value.c_str()));
+    } else if (arg == "--read-bytes-per-second") {
+      config.read_bytes_per_second = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--error-rate") {
+      config.error_rate = std::atof(value.c_str());
+    } else if (arg == "--too-large-rate") {
+      config.request_too_large_rate = std::atof(value.c_str());
+    } else if (arg == "--too-many-requests-rate") {
+      config.too_many_requests_rate = std::atof(value.c_str());
+    } else if (arg == "--reset-rate") {
+      config.reset_rate = std::atof(value.c_str());
+    } else if (arg == "--max-request-bytes") {
+      config.max_request_bytes = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--info") {
+      if (!read_file(value, config.info)) {
+        std::cerr << "Unable to read " << value << '\n';
+        return 1;
+      }
+    } else if (arg == "--remote-config") {
+      if (!read_file(value, config.remote_config_responses.emplace_back())) {
+        std::cerr << "Unable to read " << value << '\n';
+        return 1;
+      }
+    } else if (arg == "--seed") {
+      config.seed = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--duration-seconds") {
+      duration_seconds = std::atof(value.c_str());
+    } else {
+      std::cerr << "Unknown option: " << arg << '\n';
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // Block the signals that stop the program before any threads are started,
+  // so that they are received by the waiting below rather than by a handler.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  try {
+    AgentEmulator emulator{config};
+    std::cerr << "Listening at " << emulator.url() << '\n';
+
+    if (duration_seconds > 0) {
+      timespec timeout;
+      timeout.tv_sec = static_cast<std::time_t>(duration_seconds);
+      timeout.tv_nsec =
+          static_cast<long>((duration_seconds - timeout.tv_sec) * 1e9);
+      while (sigtimedwait(&signals, nullptr, &timeout) < 0 && errno == EINTR) {
+      }
+    } else {
+      int signal;
+      sigwait(&signals, &signal);
+    }
+
+    emulator.stop();
+    std::cout << emulator.report().to_json() << std::endl;
+  } catch (const std::system_error& error) {
+    std::cerr << error.what() << '\n';
+    return 1;
+  }
+}
@@ -1,6 +1,7 @@
 #include <algorithm>
 
 #include "catch.hpp"
+#include "datadog/base64.h"
 #include "datadog/json.hpp"
 #include "datadog/remote_config/remote_config.h"
 #include "null_logger.h"
@@ -43,6 +44,30 @@ struct FakeListener : public rc::Listener {
 
 auto logger = std::make_shared<NullLogger>();
 
+// Return a response that has a configuration, with the specified `content`, at
+// each of the specified `paths`.
+nlohmann::json make_response(const std::vector<std::string>& paths,
+                             const std::string& content) {
+  auto targets = nlohmann::json::object();
+  auto target_files = nlohmann::json::array();
+  for (const auto& path : paths) {
+    targets[path] = {{"custom", {{"v", 1}}},
+                     {"hashes", {{"sha256", "0123"}}},
+                     {"length", content.size()}};
+    target_files.push_back({{"path", path}, {"raw", base64_encode(content)}});
+  }
+
+  const nlohmann::json signed_targets = {
+      {"signed",
+       {{"custom", {{"opaque_backend_state", "15"}}},
+        {"targets", std::move(targets)},
+        {"version", 2}}}};
+
+  return {{"targets", base64_encode(signed_targets.dump())},
+          {"client_configs", paths},
+          {"target_files", std::move(target_files)}};
+}
+
 }  // namespace
 
 REMOTE_CONFIG_TEST("initial state payload") {
@@ -442,3 +467,98 @@ REMOTE_CONFIG_TEST("response processing") {
     }
   }
 }
+
+REMOTE_CONFIG_TEST("configuration paths") {
+  const TracerSignature tracer_signature{
+      /* runtime_id = */ RuntimeID::generate(),
+      /* service = */ "testsvc",
+      /* environment = */ "test"};
+
+  auto listener = std::make_shared<FakeListener>();
+  listener->products = rc::product::APM_TRACING;
+  std::string config_id;
+  listener->update_callback = [&](const rc::Listener::Configuration& conf) {
+    config_id = conf.id;
+    return nullopt;
+  };
+
+  rc::Manager rc(tracer_signature, {listener}, logger);
+
+  SECTION("valid") {
+    auto path = GENERATE(values<std::string>({
+        "datadog/2/APM_TRACING/config-id/name",
+        "datadog/1234567890/APM_TRACING/config-id/name",
+        "employee/APM_TRACING/config-id/name",
+    }));
+    CAPTURE(path);
+
+    rc.process_response(make_response({path}, "{}"));
+    const auto payload = rc.make_request_payload();
+    CHECK(payload.contains("/client/state/has_error"_json_pointer) == false);
+    CHECK(listener->count_on_update == 1);
+    CHECK(config_id == "config-id");
+  }
+
+  SECTION("invalid") {
+    auto path = GENERATE(values<std::string>({
+        "",
+        "employee",
+        "employee/APM_TRACING/config-id",
+        "employee/APM_TRACING/config-id/",
+        "employee/APM_TRACING//name",
+        "employee//config-id/name",
+        "employee/APM_TRACING/config-id/name/extra",
+        "/employee/APM_TRACING/config-id/name",
+        "datadog/APM_TRACING/config-id/name",
+        "datadog//APM_TRACING/config-id/name",
+        "datadog/2a/APM_TRACING/config-id/name",
+        "datadog/-2/APM_TRACING/config-id/name",
+        "datadog/2/APM_TRACING/config-id",
+        "datadog/2/APM_TRACING/config-id/name/extra",
+        "foo/APM_TRACING/config-id/name",
+    }));
+    CAPTURE(path);
+
+    rc.process_response(make_response({path}, "{}"));
+    const auto payload = rc.make_request_payload();
+    CHECK(payload.contains("/client/state/has_error"_json_pointer) == true);
+    CHECK(listener->count_on_update == 0);
+  }
+
+  SECTION("long paths are rejected without exhausting the stack") {
+    std::string path = "employee/APM_TRACING/";
+    path.append(1000000, 'x');
+    path += "//name";
+
+    rc.process_response(make_response({path}, "{}"));
+    const auto payload = rc.make_request_payload();
+    CHECK(payload.contains("/client/state/has_error"_json_pointer) == true);
+  }
+}
+
+REMOTE_CONFIG_TEST("response with many configurations") {
+  // Each configuration's target file must be found without searching all of
+  // the target files, or this would take time quadratic in the number of
+  // configurations.
+  const TracerSignature tracer_signature{
+      /* runtime_id = */ RuntimeID::generate(),
+      /* service = */ "testsvc",
+      /* environment = */ "test"};
+
+  auto listener = std::make_shared<FakeListener>();
+  listener->products = rc::product::APM_TRACING;
+
+  std::vector<std::string> paths;
+  for (int i = 0; i < 10000; ++i) {
+    paths.push_back("datadog/2/APM_TRACING/config-" + std::to_string(i) +
+                    "/name");
+  }
+
+  rc::Manager rc(tracer_signature, {listener}, logger);
+  rc.process_response(make_response(paths, "{}"));
+
+  const auto payload = rc.make_request_payload();
+  CHECK(payload.contains("/client/state/has_error"_json_pointer) == false);
+  CHECK(listener->count_on_update == paths.size());
+  CHECK(payload["client"]["state"]["config_states"].size() == paths.size());
+}
@@ -0,0 +1,138 @@
+// These are tests for `ActiveSpanScope` and the functions that write and read
+// an `ActiveSpanSlot`.
+
+#include <datadog/active_span.h>
+#include <datadog/null_collector.h>
+#include <datadog/span.h>
+#include <datadog/span_config.h>
+#include <datadog/trace_segment.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "mocks/loggers.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+
+#define ACTIVE_SPAN_TEST(x) TEST_CASE(x, "[active_span]")
+
+namespace {
+
+ActiveSpanContext read_current() {
+  ActiveSpanContext context;
+  REQUIRE(read_active_span(active_span_slot(), context));
+  return context;
+}
+
+}  // namespace
+
+ACTIVE_SPAN_TEST("ActiveSpanScope publishes the span in the thread's slot") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.collector = std::make_shared<NullCollector>();
+  config.logger = std::make_shared<MockLogger>();
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  Tracer tracer{*finalized};
+
+  REQUIRE(read_current().span_id == 0);
+
+  SpanConfig root_config;
+  root_config.resource = "GET /api/v1/users";
+  auto root = tracer.create_span(root_config);
+  {
+    ActiveSpanScope root_scope{root};
+    auto context = read_current();
+    REQUIRE(context.trace_id == root.trace_id());
+    REQUIRE(context.span_id == root.id());
+    REQUIRE(context.local_root_span_id == root.id());
+    REQUIRE(context.endpoint() == "GET /api/v1/users");
+
+    SpanConfig child_config;
+    child_config.resource = "select * from users";
+    auto child = root.create_child(child_config);
+    {
+      // A child of the active span inherits its endpoint.
+      ActiveSpanScope child_scope{child};
+      context = read_current();
+      REQUIRE(context.trace_id == root.trace_id());
+      REQUIRE(context.span_id == child.id());
+      REQUIRE(context.local_root_span_id == root.id());
+      REQUIRE(context.endpoint() == "GET /api/v1/users");
+
+      // A span from another trace does not.
+      auto other = tracer.create_span();
+      auto other_child = other.create_child();
+      {
+        ActiveSpanScope other_scope{other_child};
+        context = read_current();
+        REQUIRE(context.span_id == other_child.id());
+        REQUIRE(context.local_root_span_id == other.id());
+        REQUIRE(context.endpoint() == "");
+      }
+
+      // The endpoint can be specified, and is truncated.
+      const std::string long_endpoint(100, 'x');
+      {
+        ActiveSpanScope explicit_scope{child, long_endpoint};
+        context = read_current();
+        REQUIRE(context.endpoint() ==
+                long_endpoint.substr(0, ActiveSpanSlot::endpoint_capacity));
+      }
+
+      context = read_current();
+      REQUIRE(context.span_id == child.id());
+      REQUIRE(context.endpoint() == "GET /api/v1/users");
+    }
+
+    context = read_current();
+    REQUIRE(context.span_id == root.id());
+  }
+
+  REQUIRE(read_current().span_id == 0);
+}
+
+ACTIVE_SPAN_TEST("read_active_span sees consistent contents") {
+  // One thread writes to a slot while another reads it.  Each write stores
+  // fields that are derived from a single counter, so a torn read would be
+  // detected as a mismatch between fields.
+  ActiveSpanSlot slot;
+  std::atomic<bool> done{false};
+
+  std::thread writer{[&]() {
+    ActiveSpanContext context;
+    for (std::uint64_t i = 1; i <= 200000; ++i) {
+      context.trace_id = TraceID{i, ~i};
+      context.span_id = i;
+      context.local_root_span_id = i * 2;
+      const std::string endpoint = std::to_string(i);
+      context.endpoint_size = endpoint.size();
+      endpoint.copy(context.endpoint_buffer, endpoint.size());
+      write_active_span(slot, context);
+    }
+    done = true;
+  }};
+
+  bool consistent = true;
+  while (!done) {
+    ActiveSpanContext context;
+    if (!read_active_span(slot, context) || context.span_id == 0) {
+      continue;
+    }
+    const auto i = context.span_id;
+    consistent = consistent && context.trace_id == TraceID{i, ~i} &&
+                 context.local_root_span_id == i * 2 &&
+                 context.endpoint() == std::to_string(i);
+  }
+  writer.join();
+
+  REQUIRE(consistent);
+  ActiveSpanContext last;
+  REQUIRE(read_active_span(slot, last));
+  REQUIRE(last.span_id == 200000);
+  REQUIRE(last.endpoint() == "200000");
+}
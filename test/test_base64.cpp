@@ -15,6 +15,11 @@ BASE64_TEST("invalid inputs") {
     CHECK(base64_decode("In@#*!^validData") == "");
   }
 
+  SECTION("non-ASCII characters") {
+    CHECK(base64_decode("\xff\xfe\x80\x81") == "");
+    CHECK(base64_decode("bGlnaHQgd29y\xe9\x80\x80\x80") == "");
+  }
+
   SECTION("single character without padding") {
     CHECK(base64_decode("V") == "");
   }
@@ -30,3 +35,16 @@ BASE64_TEST("padding") {
   CHECK(base64_decode("bGlnaHQgd28=") == "light wo");
   CHECK(base64_decode("bGlnaHQgd29y") == "light wor");
 }
+
+BASE64_TEST("encoding") {
+  CHECK(base64_encode("") == "");
+  CHECK(base64_encode("light w") == "bGlnaHQgdw==");
+  CHECK(base64_encode("light wo") == "bGlnaHQgd28=");
+  CHECK(base64_encode("light wor") == "bGlnaHQgd29y");
+
+  std::string bytes;
+  for (int i = 0; i < 256; ++i) {
+    bytes.push_back(char(i));
+  }
+  CHECK(base64_decode(base64_encode(bytes)) == bytes);
+}
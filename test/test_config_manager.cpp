@@ -1,6 +1,7 @@
 #include "catch.hpp"
 #include "datadog/config_manager.h"
 #include "datadog/remote_config/listener.h"
+#include "datadog/span_data.h"
 #include "datadog/trace_sampler.h"
 
 namespace rc = datadog::remote_config;
@@ -184,4 +185,53 @@ CONFIG_MANAGER_TEST("remote configuration handling") {
     const auto reverted_tracing_status = config_manager.report_traces();
     CHECK(old_tracing_status == reverted_tracing_status);
   }
+
+  SECTION("handling of `tracing_filter_rules`") {
+    config_update.content = R"({
+        "lib_config": {
+          "library_language": "all",
+          "library_version": "latest",
+          "service_name": "testsvc",
+          "env": "test",
+          "tracing_filter_rules": [
+            {"resource": "GET /health"}
+          ]
+        },
+        "service_target": {
+           "service": "testsvc",
+           "env": "test"
+        }
+      })";
+
+    SpanData health_check;
+    health_check.service = "testsvc";
+    health_check.resource = "GET /health";
+
+    REQUIRE(config_manager.trace_filter()->empty());
+
+    const auto err = config_manager.on_update(config_update);
+    CHECK(!err);
+
+    const auto filter = config_manager.trace_filter();
+    CHECK(!filter->empty());
+    CHECK(filter->match(health_check));
+
+    config_manager.on_revert(config_update);
+
+    CHECK(config_manager.trace_filter()->empty());
+  }
+
+  SECTION("invalid `tracing_filter_rules` are ignored") {
+    config_update.content = R"({
+        "lib_config": {
+          "tracing_filter_rules": [
+            {"resource": "GET /health", "sample_rate": 1}
+          ]
+        }
+      })";
+
+    const auto err = config_manager.on_update(config_update);
+    CHECK(!err);
+    CHECK(config_manager.trace_filter()->empty());
+  }
 }
@@ -37,6 +37,8 @@ class SingleRequestMockCurlLibrary : public CurlLibrary {
   // message to the event loop. This allows races to be explored between request
   // registration and `Curl` shutdown.
   bool delay_message_ = false;
+  // `http_get_` is whether the request was made using `Curl::get`.
+  bool http_get_ = false;
 
   void easy_cleanup(CURL *handle) override {
     destroyed_handles_.insert(handle);
@@ -72,6 +74,11 @@ class SingleRequestMockCurlLibrary : public CurlLibrary {
     return CURLE_OK;
   }
 
+  CURLcode easy_setopt_httpget(CURL *, long get) override {
+    http_get_ = get;
+    return CURLE_OK;
+  }
+
   CURLcode easy_setopt_timeout_ms(CURL *, long) override { return CURLE_OK; }
 
   CURLMcode multi_add_handle(CURLM *, CURL *easy_handle) override {
@@ -151,8 +158,10 @@ TEST_CASE("parse response headers and body", "[curl]") {
     config.logger = logger;
     config.agent.http_client = client;
     // The http client is a mock that only expects a single request, so
-    // force only tracing to be sent and exclude telemetry.
+    // force only tracing to be sent and exclude telemetry and the query of the
+    // Agent's "/info" endpoint.
     config.telemetry.enabled = false;
+    config.agent.agent_discovery_enabled = false;
 
     const auto finalized = finalize_config(config);
     REQUIRE(finalized);
@@ -200,6 +209,29 @@ TEST_CASE("parse response headers and body", "[curl]") {
       std::rethrow_exception(exception);
     }
     REQUIRE_FALSE(post_error);
+    REQUIRE_FALSE(library.http_get_);
+  }
+
+  SECTION("by hand, using GET") {
+    Optional<Error> get_error;
+    Optional<std::string> response_body;
+    const HTTPClient::URL url = {"http", "whatever", "/info"};
+    const auto result = client->get(
+        url, [](const auto &) {},
+        [&](int status, const DictReader &, std::string body) {
+          if (status == 200) {
+            response_body = std::move(body);
+          }
+        },
+        [&](const Error &error) { get_error = error; },
+        clock().tick + std::chrono::seconds(10));
+
+    REQUIRE(result);
+    client->drain(clock().tick + std::chrono::seconds(1));
+    REQUIRE_FALSE(get_error);
+    REQUIRE(library.http_get_);
+    REQUIRE(response_body ==
+            "{\"message\": \"Dogs don't know it's not libcurl!\"}");
   }
 }
 
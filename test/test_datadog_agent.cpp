@@ -1,17 +1,36 @@
+#include <datadog/agent_info.h>
 #include <datadog/collector_response.h>
 #include <datadog/datadog_agent.h>
 #include <datadog/datadog_agent_config.h>
+#include <datadog/msgpack.h>
+#include <datadog/shard.h>
+#include <datadog/span_columns.h>
+#include <datadog/span_data.h>
+#include <datadog/stack_trace.h>
 #include <datadog/tracer.h>
 #include <datadog/tracer_config.h>
 
 #include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "mocks/dict_readers.h"
+#include "mocks/dict_writers.h"
 #include "mocks/event_schedulers.h"
 #include "mocks/http_clients.h"
 #include "mocks/loggers.h"
 #include "test.h"
 
+#if !defined(_MSC_VER)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
 using namespace datadog::tracing;
 using namespace std::chrono_literals;
 
@@ -229,3 +248,399 @@ TEST_CASE("Remote Configuration", "[datadog_agent]") {
     CHECK(logger->error_count() == 1);
   }
 }
+
+TEST_CASE("parse_agent_info", "[datadog_agent]") {
+  SECTION("all fields") {
+    auto info = parse_agent_info(R"json({
+      "version": "7.52.0",
+      "endpoints": ["/v0.4/traces", "/v0.5/traces", "/v0.6/stats"],
+      "feature_flags": ["discovery"],
+      "client_drop_p0s": true,
+      "config": {
+        "receiver_socket": "/var/run/datadog/apm.socket",
+        "max_request_bytes": 1000,
+        "statsd_port": 8125
+      },
+      "peer_tags": null
+    })json");
+    REQUIRE(info);
+    REQUIRE(info->version == "7.52.0");
+    REQUIRE(info->has_endpoint("/v0.5/traces"));
+    REQUIRE(!info->has_endpoint("/v0.7/traces"));
+    REQUIRE(info->feature_flags == std::vector<std::string>{"discovery"});
+    REQUIRE(info->client_drop_p0s);
+    REQUIRE(info->receiver_socket == "/var/run/datadog/apm.socket");
+    REQUIRE(info->max_request_bytes == 1000);
+  }
+
+  SECTION("missing fields") {
+    auto info =
+        parse_agent_info(R"json({"config": {"receiver_socket": ""}})json");
+    REQUIRE(info);
+    REQUIRE(info->endpoints.empty());
+    REQUIRE(!info->client_drop_p0s);
+    REQUIRE(!info->receiver_socket);
+    REQUIRE(!info->max_request_bytes);
+  }
+
+  SECTION("invalid") {
+    auto body = GENERATE(values<std::string>({
+        "not JSON",
+        "[]",
+        R"json({"version": 7})json",
+        R"json({"endpoints": "/v0.4/traces"})json",
+        R"json({"endpoints": [4]})json",
+        R"json({"client_drop_p0s": "yes"})json",
+        R"json({"config": []})json",
+        R"json({"config": {"max_request_bytes": -1}})json",
+        R"json({"config": {"receiver_socket": false}})json",
+    }));
+    CAPTURE(body);
+    auto info = parse_agent_info(body);
+    REQUIRE(!info);
+    REQUIRE(info.error().code == Error::DATADOG_AGENT_INVALID_INFO_RESPONSE);
+  }
+}
+
+namespace {
+
+// `MockAgent` is an `HTTPClient` that behaves like a Datadog Agent whose
+// "/info" response is `info_status` and `info_body`.  Requests are answered
+// immediately.  POST requests are recorded and receive an empty JSON object.
+struct MockAgent : public HTTPClient {
+  struct Request {
+    URL url;
+    std::unordered_map<std::string, std::string> headers;
+    std::string body;
+  };
+
+  int info_status = 200;
+  std::string info_body = "{}";
+  std::vector<URL> info_requests;
+  std::vector<Request> requests;
+
+  Expected<void> post(
+      const URL& url, HeadersSetter set_headers, std::string body,
+      ResponseHandler on_response, ErrorHandler /*on_error*/,
+      std::chrono::steady_clock::time_point /*deadline*/) override {
+    MockDictWriter headers;
+    set_headers(headers);
+    requests.push_back(Request{url, std::move(headers.items), std::move(body)});
+    on_response(200, MockDictReader{}, "{}");
+    return {};
+  }
+
+  Expected<void> get(
+      const URL& url, HeadersSetter /*set_headers*/,
+      ResponseHandler on_response, ErrorHandler /*on_error*/,
+      std::chrono::steady_clock::time_point /*deadline*/) override {
+    info_requests.push_back(url);
+    on_response(info_status, MockDictReader{}, info_body);
+    return {};
+  }
+
+  void drain(std::chrono::steady_clock::time_point /*deadline*/) override {}
+
+  std::string config() const override {
+    return nlohmann::json::object({{"type", "MockAgent"}}).dump();
+  }
+};
+
+std::vector<std::unique_ptr<SpanData>> make_chunk(std::uint64_t trace_id) {
+  std::vector<std::unique_ptr<SpanData>> spans;
+  for (std::uint64_t i = 1; i <= 3; ++i) {
+    auto span = std::make_unique<SpanData>();
+    span->service = "testsvc";
+    span->name = "do.thing";
+    span->resource = "thing " + std::to_string(i);
+    span->trace_id = TraceID{trace_id};
+    span->span_id = trace_id * 10 + i;
+    span->parent_id = i == 1 ? 0 : trace_id * 10 + 1;
+    span->tags["env"] = "test";
+    spans.push_back(std::move(span));
+  }
+  return spans;
+}
+
+}  // namespace
+
+TEST_CASE("Agent discovery", "[datadog_agent]") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  logger->echo = nullptr;
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto mock_agent = std::make_shared<MockAgent>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = mock_agent;
+  config.agent.remote_configuration_enabled = false;
+  config.telemetry.enabled = false;
+
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+
+  std::unique_ptr<DatadogAgent> agent;
+  const auto make_agent = [&]() {
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    auto telemetry = std::make_shared<TracerTelemetry>(
+        false, finalized->clock, finalized->logger, signature, "", "");
+    const auto& agent_config =
+        std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+    agent = std::make_unique<DatadogAgent>(
+        agent_config, telemetry, logger, signature,
+        std::vector<std::shared_ptr<datadog::remote_config::Listener>>{});
+  };
+
+  // Send the specified number of trace chunks via a new `DatadogAgent`, and
+  // then destroy it, which flushes the chunks.
+  const auto send_chunks = [&](std::size_t chunk_count) {
+    make_agent();
+    for (std::size_t i = 1; i <= chunk_count; ++i) {
+      REQUIRE(agent->send(make_chunk(i), nullptr));
+    }
+    agent.reset();
+  };
+
+  // Return the v0.4 encoding of the first `chunk_count` chunks.
+  const auto encode_v04 = [](std::size_t chunk_count) {
+    std::string body;
+    (void)msgpack::pack_array(body, chunk_count);
+    for (std::size_t i = 1; i <= chunk_count; ++i) {
+      REQUIRE(msgpack_encode(body, make_chunk(i)));
+    }
+    return body;
+  };
+
+  SECTION("the Agent is queried on startup and periodically") {
+    make_agent();
+    REQUIRE(mock_agent->info_requests.size() == 1);
+    REQUIRE(mock_agent->info_requests[0].path == "/info");
+    REQUIRE(event_scheduler->recurrence_interval == std::chrono::seconds(60));
+    event_scheduler->event_callback();
+    REQUIRE(mock_agent->info_requests.size() == 2);
+    agent.reset();
+  }
+
+  SECTION("discovery can be disabled") {
+    config.agent.agent_discovery_enabled = false;
+    send_chunks(1);
+    REQUIRE(mock_agent->info_requests.empty());
+    REQUIRE(mock_agent->requests.size() == 1);
+    REQUIRE(mock_agent->requests[0].url.path == "/v0.4/traces");
+  }
+
+  SECTION("v0.4 is used when v0.5 is not advertised") {
+    auto info = GENERATE(values<std::pair<int, std::string>>({
+        {200, R"json({})json"},
+        {200, R"json({"endpoints": ["/v0.3/traces", "/v0.4/traces"]})json"},
+        {404, "404 page not found"},
+    }));
+    CAPTURE(info.first, info.second);
+    mock_agent->info_status = info.first;
+    mock_agent->info_body = info.second;
+    send_chunks(2);
+    REQUIRE(logger->error_count() == 0);
+    REQUIRE(mock_agent->requests.size() == 1);
+    const auto& request = mock_agent->requests[0];
+    REQUIRE(request.url.path == "/v0.4/traces");
+    REQUIRE(request.headers.at("X-Datadog-Trace-Count") == "2");
+    REQUIRE(request.body == encode_v04(2));
+  }
+
+  SECTION("an invalid response is logged and the defaults are kept") {
+    mock_agent->info_body = R"json({"endpoints": "/v0.5/traces"})json";
+    send_chunks(1);
+    REQUIRE(logger->error_count() == 1);
+    REQUIRE(logger->first_error().code ==
+            Error::DATADOG_AGENT_INVALID_INFO_RESPONSE);
+    REQUIRE(mock_agent->requests.size() == 1);
+    REQUIRE(mock_agent->requests[0].url.path == "/v0.4/traces");
+  }
+
+  SECTION("v0.5 is used when advertised") {
+    mock_agent->info_body =
+        R"json({"endpoints": ["/v0.4/traces", "/v0.5/traces"]})json";
+    send_chunks(2);
+    REQUIRE(logger->error_count() == 0);
+    REQUIRE(mock_agent->requests.size() == 1);
+    const auto& request = mock_agent->requests[0];
+    REQUIRE(request.url.path == "/v0.5/traces");
+    REQUIRE(request.headers.at("X-Datadog-Trace-Count") == "2");
+
+    SpanColumns columns;
+    REQUIRE(columns.intern("") == 0);
+    columns.append_chunk(make_chunk(1));
+    columns.append_chunk(make_chunk(2));
+    std::string expected;
+    REQUIRE(msgpack_encode_v05(expected, columns));
+    REQUIRE(request.body == expected);
+    // The v0.5 payload's string table makes it smaller.
+    REQUIRE(request.body.size() < encode_v04(2).size());
+  }
+
+  SECTION("requests are divided to fit the Agent's size limit") {
+    // Allow three chunks per request.
+    const std::size_t limit = encode_v04(3).size();
+    mock_agent->info_body = R"json({"config": {"max_request_bytes": )json" +
+                            std::to_string(limit) + "}}";
+    send_chunks(10);
+    REQUIRE(logger->error_count() == 0);
+    REQUIRE(mock_agent->requests.size() > 1);
+    int total_chunks = 0;
+    for (const auto& request : mock_agent->requests) {
+      REQUIRE(request.body.size() <= limit);
+      total_chunks += std::stoi(request.headers.at("X-Datadog-Trace-Count"));
+    }
+    REQUIRE(total_chunks == 10);
+  }
+
+  SECTION("a chunk larger than the Agent's size limit is dropped") {
+    mock_agent->info_body = R"json({"config": {"max_request_bytes": 10}})json";
+    send_chunks(2);
+    REQUIRE(mock_agent->requests.empty());
+    REQUIRE(logger->error_count() == 2);
+    REQUIRE(logger->first_error().code ==
+            Error::DATADOG_AGENT_REQUEST_TOO_LARGE);
+  }
+
+  SECTION("the Agent's Unix domain socket is used if it exists") {
+    SECTION("socket doesn't exist") {
+      mock_agent->info_body =
+          R"json({"config": {"receiver_socket": "/nonexistent/apm.sock"}})json";
+      send_chunks(1);
+      REQUIRE(mock_agent->requests.size() == 1);
+      REQUIRE(mock_agent->requests[0].url.scheme == "http");
+    }
+
+#if !defined(_MSC_VER)
+    // Create a socket for the mock Agent to advertise.
+    std::string path = "/tmp/dd-trace-cpp-test-" +
+                       std::to_string(::getpid()) + ".socket";
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    REQUIRE(fd != -1);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    REQUIRE(path.size() < sizeof address.sun_path);
+    std::copy(path.begin(), path.end(), address.sun_path);
+    (void)std::remove(path.c_str());
+    REQUIRE(::bind(fd, reinterpret_cast<const sockaddr*>(&address),
+                   sizeof address) == 0);
+    mock_agent->info_body =
+        R"json({"config": {"receiver_socket": ")json" + path + "\"}}";
+
+    SECTION("default url") {
+      make_agent();
+      REQUIRE(agent->send(make_chunk(1), nullptr));
+      // The periodic query is made via the socket.
+      event_scheduler->event_callback();
+      REQUIRE(mock_agent->info_requests.back().scheme == "unix");
+      agent.reset();
+
+      REQUIRE(mock_agent->requests.size() == 1);
+      const auto& url = mock_agent->requests[0].url;
+      REQUIRE(url.scheme == "unix");
+      REQUIRE(url.authority == path);
+      REQUIRE(url.path == "/v0.4/traces");
+    }
+
+    SECTION("configured url") {
+      config.agent.url = "http://localhost:8126";
+      send_chunks(1);
+      REQUIRE(mock_agent->requests.size() == 1);
+      REQUIRE(mock_agent->requests[0].url.scheme == "http");
+    }
+
+    ::close(fd);
+    (void)std::remove(path.c_str());
+#endif
+  }
+}
+
+TEST_CASE("sharded pending trace chunks", "[datadog_agent]") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto mock_agent = std::make_shared<MockAgent>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = mock_agent;
+  config.agent.remote_configuration_enabled = false;
+  config.agent.agent_discovery_enabled = false;
+  config.telemetry.enabled = false;
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  auto telemetry = std::make_shared<TracerTelemetry>(
+      false, finalized->clock, finalized->logger, signature, "", "");
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+  const std::size_t shards = 4;
+  DatadogAgent agent{
+      agent_config, telemetry, logger, signature,
+      std::vector<std::shared_ptr<datadog::remote_config::Listener>>{},
+      shards};
+
+  // Send chunks as if from threads of every shard, and more.
+  for (std::size_t i = 1; i <= 10; ++i) {
+    set_current_shard(i);
+    REQUIRE(agent.send(make_chunk(i), nullptr));
+  }
+  set_current_shard(0);
+  REQUIRE(agent.pending_trace_chunks() == 10);
+
+  // One flush merges the chunks of all shards into one request.
+  event_scheduler->event_callback();
+  REQUIRE(agent.pending_trace_chunks() == 0);
+  REQUIRE(logger->error_count() == 0);
+  REQUIRE(mock_agent->requests.size() == 1);
+  const auto& request = mock_agent->requests[0];
+  REQUIRE(request.headers.at("X-Datadog-Trace-Count") == "10");
+}
+
+TEST_CASE("captured error stacks are symbolized when flushed",
+          "[datadog_agent]") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto mock_agent = std::make_shared<MockAgent>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = mock_agent;
+  config.agent.remote_configuration_enabled = false;
+  config.agent.agent_discovery_enabled = false;
+  config.telemetry.enabled = false;
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  auto telemetry = std::make_shared<TracerTelemetry>(
+      false, finalized->clock, finalized->logger, signature, "", "");
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+  DatadogAgent agent{agent_config, telemetry, logger, signature, {}};
+
+  auto chunk = make_chunk(1);
+  auto stack = std::make_shared<CapturedStack>();
+  capture_stack(*stack);
+  const std::string expected = StackSymbolizer{}.symbolize(*stack);
+  chunk.front()->error = true;
+  chunk.front()->error_stack = stack;
+  REQUIRE(agent.send(std::move(chunk), nullptr));
+
+  event_scheduler->event_callback();
+  REQUIRE(logger->error_count() == 0);
+  REQUIRE(mock_agent->requests.size() == 1);
+  const std::string& body = mock_agent->requests[0].body;
+  REQUIRE(body.find("error.stack") != std::string::npos);
+  REQUIRE(body.find(expected) != std::string::npos);
+}
@@ -0,0 +1,148 @@
+// This test covers the `DictReader` and `DictWriter` implementations defined in
+// `dict_adapters.h`.
+
+#include <datadog/dict_adapters.h>
+#include <datadog/optional.h>
+#include <datadog/string_view.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+#define DICT_ADAPTERS_TEST(x) TEST_CASE(x, "[dict_adapters]")
+
+DICT_ADAPTERS_TEST("IndexedDictReader looks up keys case-insensitively") {
+  const std::vector<std::pair<std::string, std::string>> headers{
+      {"Host", "example.com"},
+      {"X-Datadog-Trace-ID", "123"},
+      {"x-datadog-parent-id", "456"},
+      {"TRACEPARENT",
+       "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"},
+  };
+  const IndexedDictReader reader{headers};
+
+  REQUIRE(reader.lookup("x-datadog-trace-id") == Optional<StringView>("123"));
+  REQUIRE(reader.lookup("X-DATADOG-PARENT-ID") == Optional<StringView>("456"));
+  REQUIRE(reader.lookup("traceparent") ==
+          Optional<StringView>(
+              "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"));
+  REQUIRE(reader.lookup("host") == Optional<StringView>("example.com"));
+  REQUIRE(reader.lookup("x-datadog-origin") == nullopt);
+  REQUIRE(reader.lookup("") == nullopt);
+}
+
+DICT_ADAPTERS_TEST("IndexedDictReader joins repeated keys with commas") {
+  const std::vector<std::pair<std::string, std::string>> headers{
+      {"tracestate", "foo=1"},
+      {"baggage", "a=b"},
+      {"TraceState", "bar=2"},
+      {"tracestate", "dd=s:1"},
+  };
+  const IndexedDictReader reader{headers};
+
+  REQUIRE(reader.lookup("tracestate") ==
+          Optional<StringView>("foo=1,bar=2,dd=s:1"));
+  REQUIRE(reader.lookup("baggage") == Optional<StringView>("a=b"));
+
+  std::vector<std::pair<std::string, std::string>> visited;
+  reader.visit([&](StringView key, StringView value) {
+    visited.emplace_back(std::string(key), std::string(value));
+  });
+  const std::vector<std::pair<std::string, std::string>> expected{
+      {"tracestate", "foo=1,bar=2,dd=s:1"},
+      {"baggage", "a=b"},
+  };
+  REQUIRE(visited == expected);
+}
+
+DICT_ADAPTERS_TEST("IndexedDictReader adapts maps") {
+  SECTION("std::map") {
+    const std::map<std::string, std::string> headers{{"X-B3-TraceId", "abc"}};
+    const IndexedDictReader reader{headers};
+    REQUIRE(reader.lookup("x-b3-traceid") == Optional<StringView>("abc"));
+  }
+
+  SECTION("std::unordered_map") {
+    const std::unordered_map<std::string, std::string> headers{
+        {"X-B3-SpanId", "def"}};
+    const IndexedDictReader reader{headers};
+    REQUIRE(reader.lookup("x-b3-spanid") == Optional<StringView>("def"));
+  }
+
+  SECTION("empty") {
+    const std::map<std::string, std::string> headers;
+    const IndexedDictReader reader{headers};
+    REQUIRE(reader.lookup("x-b3-spanid") == nullopt);
+  }
+}
+
+DICT_ADAPTERS_TEST("IndexedDictReader with many headers") {
+  std::vector<std::pair<std::string, std::string>> headers;
+  for (int i = 0; i < 1000; ++i) {
+    headers.emplace_back("Header-" + std::to_string(i), std::to_string(i));
+  }
+  const IndexedDictReader reader{headers};
+  for (int i = 0; i < 1000; ++i) {
+    const auto value = reader.lookup("header-" + std::to_string(i));
+    REQUIRE(value);
+    REQUIRE(*value == std::to_string(i));
+  }
+  REQUIRE(reader.lookup("header-1000") == nullopt);
+}
+
+DICT_ADAPTERS_TEST("HTTPHeaderBlockReader") {
+  const StringView block =
+      "GET /api/v1/users HTTP/1.1\r\n"
+      "Host: example.com:8080\r\n"
+      "X-Datadog-Trace-ID:123\r\n"
+      "x-datadog-parent-id: \t456 \r\n"
+      "Baggage: a=b\n"
+      " folded continuation\r\n"
+      "Bad Name: ignored\r\n"
+      "x-caf\xC3\xA9: latte\r\n"
+      ": no name\r\n"
+      "baggage: c=d\r\n"
+      "\r\n"
+      "x-datadog-origin: body is not headers\r\n";
+  const HTTPHeaderBlockReader reader{block};
+
+  REQUIRE(reader.lookup("host") == Optional<StringView>("example.com:8080"));
+  REQUIRE(reader.lookup("x-datadog-trace-id") == Optional<StringView>("123"));
+  REQUIRE(reader.lookup("x-datadog-parent-id") == Optional<StringView>("456"));
+  REQUIRE(reader.lookup("baggage") == Optional<StringView>("a=b,c=d"));
+  REQUIRE(reader.lookup("x-datadog-origin") == nullopt);
+  REQUIRE(reader.lookup("bad name") == nullopt);
+  // Bytes outside of ASCII are allowed in header names.
+  REQUIRE(reader.lookup("x-caf\xC3\xA9") == Optional<StringView>("latte"));
+
+  int count = 0;
+  reader.visit([&](StringView, StringView) { ++count; });
+  REQUIRE(count == 5);
+}
+
+DICT_ADAPTERS_TEST("writers") {
+  SECTION("VectorDictWriter appends") {
+    std::vector<std::pair<std::string, std::string>> headers;
+    VectorDictWriter writer{headers};
+    writer.set("traceparent", "foo");
+    writer.set("traceparent", "bar");
+    const std::vector<std::pair<std::string, std::string>> expected{
+        {"traceparent", "foo"}, {"traceparent", "bar"}};
+    REQUIRE(headers == expected);
+  }
+
+  SECTION("MapDictWriter overwrites") {
+    std::map<std::string, std::string> headers;
+    MapDictWriter<std::map<std::string, std::string>> writer{headers};
+    writer.set("traceparent", "foo");
+    writer.set("traceparent", "bar");
+    REQUIRE(headers.size() == 1);
+    REQUIRE(headers["traceparent"] == "bar");
+  }
+}
@@ -0,0 +1,478 @@
+// This test covers the DogStatsD client defined in `dogstatsd_client.h`, and
+// its configuration, defined in `dogstatsd_config.h`.  The client sends to a
+// local datagram socket that stands in for the Datadog Agent.
+
+#include <datadog/dogstatsd_client.h>
+#include <datadog/dogstatsd_config.h>
+#include <datadog/error.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/environment.h"
+#include "mocks/event_schedulers.h"
+#include "mocks/http_clients.h"
+#include "mocks/loggers.h"
+#include "test.h"
+
+#if defined(__linux__) || defined(__unix__) || defined(__APPLE__)
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+using namespace datadog::tracing;
+using namespace datadog::test;
+
+#define DOGSTATSD_TEST(x) TEST_CASE(x, "[dogstatsd]")
+
+DOGSTATSD_TEST("DogStatsDConfig") {
+  DogStatsDConfig config;
+  using Kind = FinalizedDogStatsDConfig::Address::Kind;
+
+  SECTION("defaults") {
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(!finalized->enabled);
+    REQUIRE(finalized->address.kind == Kind::UDP);
+    REQUIRE(finalized->address.host == "localhost");
+    REQUIRE(finalized->address.port == "8125");
+    REQUIRE(finalized->max_datagram_size == 1432);
+    // No thread is started when metrics are disabled.
+    REQUIRE(finalized->event_scheduler == nullptr);
+  }
+
+  SECTION("URLs") {
+    struct TestCase {
+      std::string url;
+      Kind kind;
+      std::string host;
+      std::string port;
+    };
+
+    auto test_case = GENERATE(values<TestCase>({
+        {"udp://dogstatsd", Kind::UDP, "dogstatsd", "8125"},
+        {"udp://10.0.0.1:9125", Kind::UDP, "10.0.0.1", "9125"},
+        {"udp://[::1]:9125", Kind::UDP, "::1", "9125"},
+        {"udp://[::1]", Kind::UDP, "::1", "8125"},
+        {"unix:///var/run/datadog/dsd.socket", Kind::UNIX,
+         "/var/run/datadog/dsd.socket", ""},
+    }));
+
+    CAPTURE(test_case.url);
+    config.url = test_case.url;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(finalized->address.kind == test_case.kind);
+    REQUIRE(finalized->address.host == test_case.host);
+    REQUIRE(finalized->address.port == test_case.port);
+    if (test_case.kind == Kind::UNIX) {
+      REQUIRE(finalized->max_datagram_size == 8192);
+    }
+  }
+
+  SECTION("invalid") {
+    struct TestCase {
+      std::string name;
+      DogStatsDConfig config;
+      Error::Code expected_error;
+    };
+
+    DogStatsDConfig no_separator;
+    no_separator.url = "localhost:8125";
+    DogStatsDConfig wrong_scheme;
+    wrong_scheme.url = "http://localhost:8125";
+    DogStatsDConfig relative_path;
+    relative_path.url = "unix://dsd.socket";
+    DogStatsDConfig zero_interval;
+    zero_interval.flush_interval_milliseconds = 0;
+    DogStatsDConfig tiny_datagram;
+    tiny_datagram.max_datagram_size = 10;
+
+    auto test_case = GENERATE_COPY(values<TestCase>({
+        {"no separator", no_separator, Error::URL_MISSING_SEPARATOR},
+        {"wrong scheme", wrong_scheme, Error::URL_UNSUPPORTED_SCHEME},
+        {"relative path", relative_path,
+         Error::URL_UNIX_DOMAIN_SOCKET_PATH_NOT_ABSOLUTE},
+        {"zero interval", zero_interval,
+         Error::DOGSTATSD_INVALID_FLUSH_INTERVAL},
+        {"tiny datagram", tiny_datagram,
+         Error::DOGSTATSD_INVALID_MAX_DATAGRAM_SIZE},
+    }));
+
+    CAPTURE(test_case.name);
+    auto finalized = finalize_config(test_case.config);
+    REQUIRE(!finalized);
+    REQUIRE(finalized.error().code == test_case.expected_error);
+  }
+
+  SECTION("environment variables") {
+    SECTION("DD_RUNTIME_METRICS_ENABLED overrides enabled") {
+      const EnvGuard guard{"DD_RUNTIME_METRICS_ENABLED", "true"};
+      config.enabled = false;
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      REQUIRE(finalized->enabled);
+      REQUIRE(finalized->event_scheduler != nullptr);
+    }
+
+    SECTION("DD_DOGSTATSD_URL overrides url") {
+      const EnvGuard guard{"DD_DOGSTATSD_URL", "unix:///tmp/dsd.socket"};
+      config.url = "udp://localhost:8125";
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      REQUIRE(finalized->address.kind == Kind::UNIX);
+      REQUIRE(finalized->address.host == "/tmp/dsd.socket");
+    }
+
+    SECTION("DD_AGENT_HOST and DD_DOGSTATSD_PORT") {
+      const EnvGuard host_guard{"DD_AGENT_HOST", "agent"};
+      const EnvGuard port_guard{"DD_DOGSTATSD_PORT", "9125"};
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      REQUIRE(finalized->address.kind == Kind::UDP);
+      REQUIRE(finalized->address.host == "agent");
+      REQUIRE(finalized->address.port == "9125");
+    }
+  }
+
+  SECTION("tracer tags metrics with service, env, and version") {
+    TracerConfig tracer_config;
+    tracer_config.service = "testsvc";
+    tracer_config.environment = "test";
+    auto finalized = finalize_config(tracer_config);
+    REQUIRE(finalized);
+    const std::vector<std::string> expected{"service:testsvc", "env:test"};
+    REQUIRE(finalized->dogstatsd.tags == expected);
+  }
+}
+
+#if defined(__linux__) || defined(__unix__) || defined(__APPLE__)
+
+namespace {
+
+// `DatagramServer` is a datagram socket bound to a local address, standing in
+// for the DogStatsD server in the Datadog Agent.
+class DatagramServer {
+  int fd_;
+  std::string url_;
+  std::string path_;
+
+ public:
+  // Bind to an ephemeral UDP port on the loopback interface.
+  DatagramServer() {
+    fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    REQUIRE(fd_ != -1);
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    REQUIRE(::bind(fd_, reinterpret_cast<sockaddr*>(&address),
+                   sizeof address) == 0);
+    socklen_t length = sizeof address;
+    REQUIRE(::getsockname(fd_, reinterpret_cast<sockaddr*>(&address),
+                          &length) == 0);
+    url_ = "udp://127.0.0.1:" + std::to_string(ntohs(address.sin_port));
+  }
+
+  // Bind to a Unix domain datagram socket at the specified `path`.
+  explicit DatagramServer(std::string path) : path_(std::move(path)) {
+    ::unlink(path_.c_str());
+    fd_ = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    REQUIRE(fd_ != -1);
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof address);
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path_.data(), path_.size());
+    REQUIRE(::bind(fd_, reinterpret_cast<sockaddr*>(&address),
+                   sizeof address) == 0);
+    url_ = "unix://" + path_;
+  }
+
+  ~DatagramServer() {
+    ::close(fd_);
+    if (!path_.empty()) {
+      ::unlink(path_.c_str());
+    }
+  }
+
+  const std::string& url() const { return url_; }
+
+  // Return the datagrams received so far.  Sends to a local socket complete
+  // before `send` returns, so there's no need to wait.
+  std::vector<std::string> receive() {
+    std::vector<std::string> datagrams;
+    char buffer[65536];
+    for (;;) {
+      const auto size = ::recv(fd_, buffer, sizeof buffer, MSG_DONTWAIT);
+      if (size < 0) {
+        break;
+      }
+      datagrams.emplace_back(buffer, size);
+    }
+    return datagrams;
+  }
+};
+
+// Return the lines in the specified `datagrams`, sorted.
+std::vector<std::string> lines_of(const std::vector<std::string>& datagrams) {
+  std::vector<std::string> lines;
+  for (const auto& datagram : datagrams) {
+    std::size_t begin = 0;
+    for (;;) {
+      const auto end = datagram.find('\n', begin);
+      lines.push_back(datagram.substr(begin, end - begin));
+      if (end == std::string::npos) {
+        break;
+      }
+      begin = end + 1;
+    }
+  }
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+FinalizedDogStatsDConfig client_config(
+    const std::string& url, Optional<std::size_t> max_datagram_size = nullopt,
+    std::shared_ptr<EventScheduler> event_scheduler = nullptr) {
+  DogStatsDConfig config;
+  config.enabled = true;
+  config.url = url;
+  config.max_datagram_size = max_datagram_size;
+  config.event_scheduler = event_scheduler
+                               ? event_scheduler
+                               : std::make_shared<MockEventScheduler>();
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  return *finalized;
+}
+
+}  // namespace
+
+DOGSTATSD_TEST("DogStatsDClient aggregates metrics between flushes") {
+  DatagramServer server;
+  auto config = client_config(server.url());
+  config.tags = {"service:testsvc"};
+  DogStatsDClient client{config, std::make_shared<MockLogger>()};
+
+  client.count("requests", 2, {"status:200"});
+  client.count("requests", 3, {"status:200"});
+  client.count("requests", 1, {"status:500"});
+  client.gauge("queue", 7);
+  client.gauge("queue", 4);
+  client.gauge("ratio", 0.25);
+  client.distribution("latency", 1.5, {"route:/"});
+  client.distribution("latency", 2, {"route:/"});
+  client.count("bad|name:x", 1, {"a|b:c,d"});
+  REQUIRE(server.receive().empty());
+
+  client.flush();
+  const auto datagrams = server.receive();
+  // Everything fits in one datagram.
+  REQUIRE(datagrams.size() == 1);
+  const std::vector<std::string> expected{
+      "bad_name_x:1|c|#a_b:c_d,service:testsvc",
+      "latency:1.5:2|d|#route:/,service:testsvc",
+      "queue:4|g|#service:testsvc",
+      "ratio:0.25|g|#service:testsvc",
+      "requests:1|c|#status:500,service:testsvc",
+      "requests:5|c|#status:200,service:testsvc",
+  };
+  REQUIRE(lines_of(datagrams) == expected);
+
+  // Aggregates are reset by a flush.
+  client.flush();
+  REQUIRE(server.receive().empty());
+
+  const auto stats = client.stats();
+  REQUIRE(stats.datagrams_sent == 1);
+  REQUIRE(stats.datagrams_dropped == 0);
+  REQUIRE(stats.bytes_sent == datagrams[0].size());
+}
+
+DOGSTATSD_TEST("DogStatsDClient packs lines into datagrams") {
+  DatagramServer server;
+  const std::size_t max_size = 100;
+  DogStatsDClient client{client_config(server.url(), max_size),
+                         std::make_shared<MockLogger>()};
+
+  std::vector<std::string> expected;
+  for (int i = 0; i < 50; ++i) {
+    const std::string name = "metric." + std::to_string(i);
+    client.gauge(name, i);
+    expected.push_back(name + ':' + std::to_string(i) + "|g");
+  }
+  // A distribution with many values is split across lines.
+  for (int i = 0; i < 100; ++i) {
+    client.distribution("dist", 1000 + i);
+  }
+  client.flush();
+
+  const auto datagrams = server.receive();
+  std::size_t total_size = 0;
+  for (const auto& datagram : datagrams) {
+    REQUIRE(datagram.size() <= max_size);
+    total_size += datagram.size() + 1;
+  }
+  // The datagrams are nearly full.
+  REQUIRE(datagrams.size() <= total_size / (max_size - 20) + 1);
+
+  std::vector<std::string> gauges;
+  std::size_t distribution_values = 0;
+  for (const auto& line : lines_of(datagrams)) {
+    if (line.rfind("dist:", 0) == 0) {
+      REQUIRE(line.size() >= 5);
+      REQUIRE(line.substr(line.size() - 2) == "|d");
+      distribution_values += std::count(line.begin(), line.end(), ':');
+    } else {
+      gauges.push_back(line);
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+  REQUIRE(gauges == expected);
+  REQUIRE(distribution_values == 100);
+}
+
+DOGSTATSD_TEST("DogStatsDClient samples large distributions") {
+  DatagramServer server;
+  DogStatsDClient client{client_config(server.url(), 65000),
+                         std::make_shared<MockLogger>()};
+
+  const std::size_t kept = DogStatsDClient::max_distribution_values;
+  for (std::size_t i = 0; i < kept * 4; ++i) {
+    client.distribution("dist", 1);
+  }
+  client.flush();
+
+  const auto lines = lines_of(server.receive());
+  REQUIRE(lines.size() == 1);
+  const auto& line = lines[0];
+  REQUIRE(std::size_t(std::count(line.begin(), line.end(), ':')) == kept);
+  REQUIRE(line.substr(line.size() - 8) == "|d|@0.25");
+}
+
+DOGSTATSD_TEST("DogStatsDClient over a Unix domain socket") {
+  DatagramServer server{"/tmp/dd-trace-cpp-test-dogstatsd.socket"};
+  DogStatsDClient client{client_config(server.url()),
+                         std::make_shared<MockLogger>()};
+
+  client.count("hits", 1);
+  client.flush();
+  REQUIRE(server.receive() == std::vector<std::string>{"hits:1|c"});
+}
+
+DOGSTATSD_TEST("DogStatsDClient drops metrics when there is no server") {
+  const auto logger = std::make_shared<MockLogger>();
+  DogStatsDClient client{
+      client_config("unix:///tmp/dd-trace-cpp-test-nonexistent.socket"),
+      logger};
+
+  client.count("hits", 1);
+  client.flush();
+  client.count("hits", 1);
+  client.flush();
+
+  const auto stats = client.stats();
+  REQUIRE(stats.datagrams_sent == 0);
+  REQUIRE(stats.datagrams_dropped == 2);
+  // Consecutive failures are logged once.
+  REQUIRE(logger->error_count() == 1);
+}
+
+DOGSTATSD_TEST("DogStatsDClient connects once the server is listening") {
+  const std::string path = "/tmp/dd-trace-cpp-test-dogstatsd-late.socket";
+  ::unlink(path.c_str());
+  DogStatsDClient client{client_config("unix://" + path),
+                         std::make_shared<MockLogger>()};
+
+  client.count("hits", 1);
+  client.flush();
+  REQUIRE(client.stats().datagrams_dropped == 1);
+
+  DatagramServer server{path};
+  client.count("hits", 2);
+  client.flush();
+  REQUIRE(server.receive() == std::vector<std::string>{"hits:2|c"});
+  REQUIRE(client.stats().datagrams_sent == 1);
+}
+
+DOGSTATSD_TEST("DogStatsDClient is driven by the event scheduler") {
+  DatagramServer server;
+  const auto scheduler = std::make_shared<MockEventScheduler>();
+  auto config = client_config(server.url(), nullopt, scheduler);
+  config.flush_interval = std::chrono::seconds(3);
+
+  {
+    DogStatsDClient client{config, std::make_shared<MockLogger>()};
+    REQUIRE(scheduler->recurrence_interval == std::chrono::seconds(3));
+
+    int hook_calls = 0;
+    client.add_flush_hook([&](DogStatsDClient& hooked) {
+      ++hook_calls;
+      hooked.gauge("sampled", hook_calls);
+    });
+
+    client.count("hits", 1);
+    scheduler->event_callback();
+    REQUIRE(hook_calls == 1);
+    REQUIRE(lines_of(server.receive()) ==
+            std::vector<std::string>{"hits:1|c", "sampled:1|g"});
+
+    client.count("hits", 2);
+    REQUIRE(!scheduler->cancelled);
+  }
+
+  // Destroying the client cancels the scheduled flush and then flushes.
+  REQUIRE(scheduler->cancelled);
+  REQUIRE(lines_of(server.receive()) ==
+          std::vector<std::string>{"hits:2|c", "sampled:2|g"});
+}
+
+DOGSTATSD_TEST("Tracer reports open trace segments and queue depth") {
+  DatagramServer server;
+  const auto scheduler = std::make_shared<MockEventScheduler>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = std::make_shared<MockLogger>();
+  config.telemetry.enabled = false;
+  config.agent.http_client = std::make_shared<MockHTTPClient>();
+  config.agent.event_scheduler = std::make_shared<MockEventScheduler>();
+  config.dogstatsd.enabled = true;
+  config.dogstatsd.url = server.url();
+  config.dogstatsd.event_scheduler = scheduler;
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+
+  Tracer tracer{*finalized};
+  REQUIRE(scheduler->event_callback);
+
+  {
+    auto span = tracer.create_span();
+    scheduler->event_callback();
+    const std::vector<std::string> expected{
+        "datadog.tracer.queue.depth:0|g|#service:testsvc",
+        "datadog.tracer.trace_segments.open:1|g|#service:testsvc",
+    };
+    REQUIRE(lines_of(server.receive()) == expected);
+  }
+
+  // The finished trace is waiting for the agent's (mock) flush.
+  scheduler->event_callback();
+  const std::vector<std::string> expected{
+      "datadog.tracer.queue.depth:1|g|#service:testsvc",
+      "datadog.tracer.trace_segments.open:0|g|#service:testsvc",
+  };
+  REQUIRE(lines_of(server.receive()) == expected);
+}
+
+#endif
@@ -4,6 +4,12 @@
 #include <datadog/glob.h>
 #include <datadog/string_view.h>
 
+#include <cctype>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
 #include "test.h"
 
 using namespace datadog::tracing;
@@ -48,7 +54,25 @@ TEST_CASE("glob", "[glob]") {
     {"true", "TRUE", true},
     {"true", "True", true},
     {"true", "tRue", true},
-    {"false", "FALSE", true}
+    {"false", "FALSE", true},
+
+    // runs of stars
+    {"a**b", "ab", true},
+    {"a***b", "axxb", true},
+    {"**", "", true},
+    {"?*?", "a", false},
+    {"?*?", "ab", true},
+
+    // patterns longer than one machine word
+    {"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef*z",
+     "0123456789ABCDEF0123456789abcdef0123456789abcdef0123456789abcdefxyz",
+     true},
+    {"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef?",
+     "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef",
+     false},
+    {"*0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef",
+     "xx0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef",
+     true}
   }));
   // clang-format on
 
@@ -58,3 +82,92 @@ TEST_CASE("glob", "[glob]") {
   REQUIRE(glob_match(test_case.pattern, test_case.subject) ==
           test_case.expected);
 }
+
+namespace {
+
+// Return whether `subject` matches `pattern`, by dynamic programming over
+// all prefixes.  This is slow, and obviously correct.
+bool reference_glob_match(const std::string& pattern,
+                          const std::string& subject) {
+  // `matches[j]` is whether the first `i` pattern characters match the first
+  // `j` subject characters.
+  std::vector<bool> matches(subject.size() + 1, false);
+  matches[0] = true;
+  for (const char p : pattern) {
+    std::vector<bool> next(subject.size() + 1, false);
+    for (std::size_t j = 0; j <= subject.size(); ++j) {
+      if (p == '*') {
+        next[j] = matches[j] || (j > 0 && next[j - 1]);
+      } else if (j > 0) {
+        next[j] = matches[j - 1] &&
+                  (p == '?' || std::tolower(static_cast<unsigned char>(p)) ==
+                                   std::tolower(static_cast<unsigned char>(
+                                       subject[j - 1])));
+      }
+    }
+    matches = std::move(next);
+  }
+  return matches[subject.size()];
+}
+
+// Return the maximum number of steps that `glob_match` may take, as
+// documented in `glob.h`.
+std::size_t step_bound(StringView pattern, StringView subject) {
+  return 2 * (pattern.size() + subject.size() + 131) *
+         (pattern.size() / 64 + 2);
+}
+
+}  // namespace
+
+TEST_CASE("glob matching agrees with a reference implementation", "[glob]") {
+  std::mt19937 generator{GENERATE(1u, 2u, 3u)};
+  // A small alphabet makes matches likely.
+  const std::string pattern_alphabet = "abA*?";
+  const std::string subject_alphabet = "abB";
+  const auto random_string = [&](const std::string& alphabet,
+                                 std::size_t max_size) {
+    std::string result(generator() % (max_size + 1), ' ');
+    for (char& c : result) {
+      c = alphabet[generator() % alphabet.size()];
+    }
+    return result;
+  };
+
+  for (int i = 0; i < 2000; ++i) {
+    const auto pattern = random_string(pattern_alphabet, 80);
+    const auto subject = random_string(subject_alphabet, 150);
+    CAPTURE(pattern);
+    CAPTURE(subject);
+    std::size_t steps = 0;
+    REQUIRE(glob_match(pattern, subject, steps) ==
+            reference_glob_match(pattern, subject));
+    REQUIRE(steps <= step_bound(pattern, subject));
+  }
+}
+
+TEST_CASE("glob matching takes linear time", "[glob]") {
+  // These would make a backtracking matcher take time proportional to the
+  // product of the pattern and subject lengths.
+  std::string pattern;
+  for (int i = 0; i < 60; ++i) {
+    pattern += "*a";
+  }
+  pattern += "*b";
+  const std::string subject(100000, 'a');
+
+  std::size_t steps = 0;
+  REQUIRE(!glob_match(pattern, subject, steps));
+  REQUIRE(steps <= step_bound(pattern, subject));
+
+  const std::string long_pattern = "*" + std::string(500, '?') + "*b";
+  steps = 0;
+  REQUIRE(!glob_match(long_pattern, subject, steps));
+  REQUIRE(steps <= step_bound(long_pattern, subject));
+
+  // This one matches, but only at the very end.
+  const std::string suffix_pattern = "*" + std::string(30, 'a') + "b";
+  const std::string suffix_subject = subject + "b";
+  steps = 0;
+  REQUIRE(glob_match(suffix_pattern, suffix_subject, steps));
+  REQUIRE(steps <= step_bound(suffix_pattern, suffix_subject));
+}
@@ -0,0 +1,168 @@
+// These are tests for `append_log_correlation`, which formats the fields that
+// correlate log lines with a span, and for `Span::log_correlation`, which
+// stores the formatted fields in the span.
+
+#include <datadog/log_correlation.h>
+#include <datadog/null_collector.h>
+#include <datadog/span.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mocks/loggers.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+
+#define LOG_CORRELATION_TEST(x) TEST_CASE(x, "[log_correlation]")
+
+LOG_CORRELATION_TEST("append_log_correlation") {
+  std::string destination = "prefix ";
+
+  SECTION("JSON") {
+    append_log_correlation(destination, LogCorrelationFormat::JSON,
+                           TraceID{1234}, 5678, "shop", StringView{"prod"},
+                           StringView{"1.2.3"});
+    REQUIRE(destination ==
+            "prefix \"dd.trace_id\":\"1234\",\"dd.span_id\":\"5678\","
+            "\"dd.service\":\"shop\",\"dd.env\":\"prod\","
+            "\"dd.version\":\"1.2.3\"");
+  }
+
+  SECTION("key=value") {
+    append_log_correlation(destination, LogCorrelationFormat::KEY_VALUE,
+                           TraceID{1234}, 5678, "shop", StringView{"prod"},
+                           StringView{"1.2.3"});
+    REQUIRE(destination ==
+            "prefix dd.trace_id=1234 dd.span_id=5678 dd.service=shop "
+            "dd.env=prod dd.version=1.2.3");
+  }
+
+  SECTION("128-bit trace IDs are formatted in hexadecimal") {
+    append_log_correlation(destination, LogCorrelationFormat::KEY_VALUE,
+                           TraceID{0xcafe, 0x6ff1c2c100000000}, 1, "shop",
+                           nullopt, nullopt);
+    REQUIRE(destination ==
+            "prefix dd.trace_id=6ff1c2c100000000000000000000cafe "
+            "dd.span_id=1 dd.service=shop");
+  }
+
+  SECTION("values are escaped") {
+    SECTION("JSON") {
+      append_log_correlation(destination, LogCorrelationFormat::JSON,
+                             TraceID{1}, 2, "a \"quoted\"\\\n\x01 service",
+                             nullopt, StringView{""});
+      REQUIRE(destination ==
+              "prefix \"dd.trace_id\":\"1\",\"dd.span_id\":\"2\","
+              "\"dd.service\":\"a \\\"quoted\\\"\\\\\\n\\u0001 service\","
+              "\"dd.version\":\"\"");
+    }
+
+    SECTION("key=value") {
+      append_log_correlation(destination, LogCorrelationFormat::KEY_VALUE,
+                             TraceID{1}, 2, "a \"quoted\" service",
+                             StringView{"x=y"}, StringView{""});
+      REQUIRE(destination ==
+              "prefix dd.trace_id=1 dd.span_id=2 "
+              "dd.service=\"a \\\"quoted\\\" service\" dd.env=\"x=y\" "
+              "dd.version=\"\"");
+    }
+  }
+}
+
+LOG_CORRELATION_TEST("Span::log_correlation") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.environment = "test";
+  config.version = "1.0";
+  config.collector = std::make_shared<NullCollector>();
+  config.logger = std::make_shared<MockLogger>();
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  Tracer tracer{*finalized};
+
+  auto span = tracer.create_span();
+
+  const auto expected_key_value = [&span]() {
+    std::string result;
+    append_log_correlation(result, LogCorrelationFormat::KEY_VALUE,
+                           span.trace_id(), span.id(), span.service_name(),
+                           span.lookup_tag("env"), span.lookup_tag("version"));
+    return result;
+  };
+
+  const StringView key_value =
+      span.log_correlation(LogCorrelationFormat::KEY_VALUE);
+  REQUIRE(key_value == expected_key_value());
+  REQUIRE(key_value.find("dd.service=testsvc dd.env=test dd.version=1.0") !=
+          StringView::npos);
+
+  SECTION("the fragment is computed once") {
+    const StringView again =
+        span.log_correlation(LogCorrelationFormat::KEY_VALUE);
+    REQUIRE(again.data() == key_value.data());
+    REQUIRE(span.log_correlation(LogCorrelationFormat::JSON)
+                .find("\"dd.service\":\"testsvc\"") != StringView::npos);
+  }
+
+  SECTION("changing the service, environment, or version recomputes it") {
+    span.set_service_name("othersvc");
+    REQUIRE(span.log_correlation(LogCorrelationFormat::KEY_VALUE) ==
+            expected_key_value());
+    span.set_tag("env", "prod");
+    REQUIRE(span.log_correlation(LogCorrelationFormat::KEY_VALUE) ==
+            expected_key_value());
+    span.remove_tag("version");
+    const StringView without_version =
+        span.log_correlation(LogCorrelationFormat::KEY_VALUE);
+    REQUIRE(without_version == expected_key_value());
+    REQUIRE(without_version.find("dd.version") == StringView::npos);
+  }
+
+  SECTION("other changes keep it") {
+    span.set_tag("foo", "bar");
+    span.set_resource_name("GET /");
+    REQUIRE(span.log_correlation(LogCorrelationFormat::KEY_VALUE).data() ==
+            key_value.data());
+  }
+
+  SECTION("a moved-to span keeps it") {
+    Span moved{std::move(span)};
+    REQUIRE(moved.log_correlation(LogCorrelationFormat::KEY_VALUE).data() ==
+            key_value.data());
+  }
+}
+
+LOG_CORRELATION_TEST("Span::log_correlation from multiple threads") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.collector = std::make_shared<NullCollector>();
+  config.logger = std::make_shared<MockLogger>();
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  Tracer tracer{*finalized};
+
+  // Every thread sees the same stored fragment, whichever thread formatted
+  // it.
+  auto span = tracer.create_span();
+  std::vector<const char*> fragments(4);
+  std::vector<std::thread> threads;
+  for (auto& fragment : fragments) {
+    threads.emplace_back([&span, &fragment]() {
+      fragment = span.log_correlation(LogCorrelationFormat::JSON).data();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const char* const expected =
+      span.log_correlation(LogCorrelationFormat::JSON).data();
+  for (const char* fragment : fragments) {
+    REQUIRE(fragment == expected);
+  }
+}
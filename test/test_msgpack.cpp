@@ -57,6 +57,30 @@ TEST_CASE("map element fails to encode") {
 
 // The following group of tests verify that encoding routines return an error
 // if the size of their input cannot fit in 32 bits.
+TEST_CASE("strings are sanitized to UTF-8") {
+  std::string destination;
+
+  SECTION("valid strings are copied") {
+    const std::string value = "caf\xC3\xA9";
+    REQUIRE(msgpack::pack_string(destination, value));
+    REQUIRE(destination == std::string("\xDB\0\0\0\x05", 5) + value);
+  }
+
+  SECTION("invalid sequences are replaced and the length is updated") {
+    REQUIRE(msgpack::pack_string(destination, "a\xFF\xC3"));
+    REQUIRE(destination == std::string("\xDB\0\0\0\x07", 5) +
+                               "a\xEF\xBF\xBD\xEF\xBF\xBD");
+  }
+
+  SECTION("a long invalid string") {
+    std::string value(1000, '\xFF');
+    REQUIRE(msgpack::pack_string(destination, value));
+    // Each byte becomes the three bytes of U+FFFD.
+    REQUIRE(destination.substr(0, 5) == std::string("\xDB\0\0\x0B\xB8", 5));
+    REQUIRE(destination.size() == 5 + 3000);
+  }
+}
+
 // This is impossible to do on a 32-bit system, so these tests are excluded by
 // the preprocessor when the pointer size is not greater than four.
 #if UINTPTR_MAX > UINT32_MAX
@@ -0,0 +1,171 @@
+// These are tests for `Mutex` and the lock contention profile.  Counts are
+// only checked when the library is built with the CMake option
+// `DD_TRACE_PROFILE_LOCKS`.
+
+#include <datadog/mutex.h>
+#include <datadog/span.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "mocks/collectors.h"
+#include "mocks/loggers.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+
+#define MUTEX_TEST(x) TEST_CASE(x, "[mutex]")
+
+MUTEX_TEST("Mutex is a lockable that works with condition variables") {
+  Mutex mutex{LockSite::EVENT_SCHEDULER};
+  std::condition_variable_any ready;
+  bool done = false;
+
+  std::thread worker{[&]() {
+    std::lock_guard<Mutex> lock(mutex);
+    done = true;
+    ready.notify_one();
+  }};
+
+  {
+    std::unique_lock<Mutex> lock(mutex);
+    ready.wait(lock, [&]() { return done; });
+    REQUIRE(done);
+  }
+  worker.join();
+
+  REQUIRE(mutex.try_lock());
+  mutex.unlock();
+}
+
+MUTEX_TEST("lock sites have names") {
+  for (std::size_t i = 0; i < lock_site_count; ++i) {
+    const auto name = to_string_view(LockSite(i));
+    REQUIRE(name.find("mutex") != StringView::npos);
+  }
+}
+
+MUTEX_TEST("lock profile report") {
+  LockSiteProfile segment;
+  segment.site = LockSite::TRACE_SEGMENT;
+  segment.acquisitions = 200;
+  segment.contended_acquisitions = 50;
+  segment.wait_nanoseconds = 200 * 1500;
+  segment.hold_nanoseconds = 200 * 100;
+  // 150 acquisitions didn't wait, and 50 waited between 2^12 and 2^13 ns.
+  segment.wait_histogram[0] = 150;
+  segment.wait_histogram[12] = 50;
+  // All were held between 2^6 and 2^7 ns.
+  segment.hold_histogram[6] = 200;
+
+  const std::string report = lock_profile_report({segment});
+  CAPTURE(report);
+  REQUIRE(report.find("lock site") == 0);
+  REQUIRE(std::count(report.begin(), report.end(), '\n') == 2);
+  const auto row = report.substr(report.find("TraceSegment::mutex_"));
+  REQUIRE(row.find(" 200 ") != std::string::npos);
+  REQUIRE(row.find("25.00%") != std::string::npos);
+  // mean wait
+  REQUIRE(row.find("1.5us") != std::string::npos);
+  // p50 wait, p99 wait, mean hold, p50 and p99 hold
+  REQUIRE(row.find("<2ns") != std::string::npos);
+  REQUIRE(row.find("<8.2us") != std::string::npos);
+  REQUIRE(row.find("100ns") != std::string::npos);
+  REQUIRE(row.find("<128ns") != std::string::npos);
+}
+
+#ifdef DD_TRACE_PROFILE_LOCKS
+
+namespace {
+
+// Return the profile of the specified `site`, or a profile of zeros if the
+// site hasn't been acquired.
+LockSiteProfile profile_of(LockSite site) {
+  const auto profile = lock_profile();
+  const auto found = std::find_if(
+      profile.begin(), profile.end(),
+      [&](const LockSiteProfile& entry) { return entry.site == site; });
+  if (found == profile.end()) {
+    LockSiteProfile empty;
+    empty.site = site;
+    return empty;
+  }
+  return *found;
+}
+
+}  // namespace
+
+MUTEX_TEST("lock profiling counts acquisitions and contention") {
+  REQUIRE(lock_profiling_enabled());
+  reset_lock_profile();
+
+  Mutex mutex{LockSite::TRACE_CAPTURE};
+  std::atomic<bool> waiting{false};
+  std::unique_lock<Mutex> lock(mutex);
+  std::thread waiter{[&]() {
+    waiting = true;
+    std::lock_guard<Mutex> inner(mutex);
+  }};
+  while (!waiting) {
+    std::this_thread::yield();
+  }
+  // Give the waiter time to block on the lock.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  lock.unlock();
+  waiter.join();
+
+  const auto profile = profile_of(LockSite::TRACE_CAPTURE);
+  REQUIRE(profile.acquisitions == 2);
+  REQUIRE(profile.contended_acquisitions == 1);
+  REQUIRE(profile.hold_nanoseconds >= 50 * 1000 * 1000);
+  REQUIRE(profile.wait_nanoseconds > 0);
+  std::uint64_t waits = 0;
+  std::uint64_t holds = 0;
+  for (std::size_t i = 0; i < lock_histogram_buckets; ++i) {
+    waits += profile.wait_histogram[i];
+    holds += profile.hold_histogram[i];
+  }
+  REQUIRE(waits == 2);
+  REQUIRE(holds == 2);
+
+  reset_lock_profile();
+  REQUIRE(profile_of(LockSite::TRACE_CAPTURE).acquisitions == 0);
+}
+
+MUTEX_TEST("tracer locks are profiled") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.collector = std::make_shared<MockCollector>();
+  config.logger = std::make_shared<MockLogger>();
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  Tracer tracer{*finalized};
+
+  reset_lock_profile();
+  {
+    auto root = tracer.create_span();
+    auto child = root.create_child();
+  }
+  REQUIRE(profile_of(LockSite::TRACE_SEGMENT).acquisitions > 0);
+  REQUIRE(profile_of(LockSite::TRACE_SAMPLER_SHARD).acquisitions > 0);
+}
+
+#else
+
+MUTEX_TEST("lock profiling is disabled by default") {
+  REQUIRE(!lock_profiling_enabled());
+  Mutex mutex{LockSite::TRACE_SEGMENT};
+  {
+    std::lock_guard<Mutex> lock(mutex);
+  }
+  REQUIRE(lock_profile().empty());
+}
+
+#endif
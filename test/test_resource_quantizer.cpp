@@ -0,0 +1,258 @@
+// These are tests for `ResourceQuantizer`, which replaces identifiers and
+// literals in span resource names and limits the number of distinct resource
+// names per service, and for its configuration,
+// `ResourceQuantizationConfig`.
+
+#include <datadog/error.h>
+#include <datadog/resource_quantization_config.h>
+#include <datadog/resource_quantizer.h>
+#include <datadog/span_data.h>
+#include <datadog/tracer.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/environment.h"
+#include "mocks/collectors.h"
+#include "null_logger.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace datadog::test;
+
+#define RESOURCE_TEST(x) TEST_CASE(x, "[resource_quantizer]")
+
+namespace {
+
+std::unique_ptr<SpanData> make_span(StringView service, StringView resource) {
+  auto span = std::make_unique<SpanData>();
+  span->service = std::string(service);
+  span->resource = std::string(resource);
+  return span;
+}
+
+}  // namespace
+
+RESOURCE_TEST("ResourceQuantizationConfig") {
+  ResourceQuantizationConfig config;
+
+  SECTION("defaults") {
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(!finalized->enabled);
+    REQUIRE(finalized->max_resources_per_service == 1000);
+    REQUIRE(finalized->max_services == 100);
+    REQUIRE(finalized->reset_interval == std::chrono::seconds(60));
+    REQUIRE(finalized->overflow_resource == "<overflow>");
+  }
+
+  SECTION("environment overrides") {
+    const EnvGuard enabled{"DD_TRACE_RESOURCE_QUANTIZATION_ENABLED", "true"};
+    const EnvGuard limit{"DD_TRACE_RESOURCE_CARDINALITY_LIMIT", "12"};
+    config.enabled = false;
+    config.max_resources_per_service = 100;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(finalized->enabled);
+    REQUIRE(finalized->max_resources_per_service == 12);
+  }
+
+  SECTION("invalid limit") {
+    const EnvGuard limit{"DD_TRACE_RESOURCE_CARDINALITY_LIMIT", "lots"};
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    REQUIRE(finalized.error().code == Error::INVALID_INTEGER);
+  }
+
+  SECTION("invalid reset interval") {
+    config.reset_interval_seconds = -1;
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    REQUIRE(finalized.error().code ==
+            Error::RESOURCE_QUANTIZATION_INVALID_RESET_INTERVAL);
+  }
+}
+
+RESOURCE_TEST("path quantization") {
+  struct TestCase {
+    std::string input;
+    std::string expected;
+  };
+
+  auto test_case = GENERATE(values<TestCase>({
+      {"GET /users/123", "GET /users/?"},
+      {"/users/123/orders/456", "/users/?/orders/?"},
+      {"GET /users/123?page=2&id=7", "GET /users/?"},
+      {"GET /search#results", "GET /search"},
+      {"GET /users/123 HTTP/1.1", "GET /users/? HTTP/1.1"},
+      {"GET /files/3fa85f64-5717-4562-b3fc-2c963f66afa6", "GET /files/?"},
+      {"GET /commits/9fceb02d0ae598e95dc970b74767f19372d61af8",
+       "GET /commits/?"},
+      // Words and version prefixes are kept, as are short hexadecimal words.
+      {"GET /api/v1/users/me", "GET /api/v1/users/me"},
+      {"GET /cafe/beef/add1", "GET /cafe/beef/add1"},
+      {"GET /", "GET /"},
+      {"GET /users/", "GET /users/"},
+      {"GET /users//123", "GET /users//?"},
+      // Only a "/" at the beginning or after a space begins a path.
+      {"cache.get user/123", "cache.get user/123"},
+      {"no path here", "no path here"},
+      // Quantization is idempotent.
+      {"GET /users/?", "GET /users/?"},
+      {"GET /users/?/orders/? HTTP/1.1", "GET /users/?/orders/? HTTP/1.1"},
+      {"GET /users/?page=2", "GET /users/"},
+  }));
+
+  CAPTURE(test_case.input);
+  std::string resource = test_case.input;
+  REQUIRE(quantize_path(resource) == (test_case.input != test_case.expected));
+  REQUIRE(resource == test_case.expected);
+}
+
+RESOURCE_TEST("SQL quantization") {
+  struct TestCase {
+    std::string input;
+    std::string expected;
+  };
+
+  auto test_case = GENERATE(values<TestCase>({
+      {"SELECT * FROM users WHERE id = 42", "SELECT * FROM users WHERE id = ?"},
+      {"SELECT * FROM t WHERE name = 'bob' AND age > 21.5",
+       "SELECT * FROM t WHERE name = ? AND age > ?"},
+      {"SELECT 'it''s', 'a\\'b', 0xFF, -1", "SELECT ?, ?, ?, -?"},
+      {"INSERT INTO t2 (c1, c2) VALUES (1, 'x')",
+       "INSERT INTO t2 (c1, c2) VALUES (?, ?)"},
+      {"SELECT \"column1\", `t2`.c3 FROM t1",
+       "SELECT \"column1\", `t2`.c3 FROM t1"},
+      {"SELECT 'unterminated", "SELECT ?"},
+      {"SELECT * FROM users WHERE id = ?", "SELECT * FROM users WHERE id = ?"},
+  }));
+
+  CAPTURE(test_case.input);
+  std::string resource = test_case.input;
+  REQUIRE(quantize_sql(resource) == (test_case.input != test_case.expected));
+  REQUIRE(resource == test_case.expected);
+}
+
+RESOURCE_TEST("cardinality limit") {
+  ResourceQuantizationConfig config;
+  config.enabled = true;
+  config.max_resources_per_service = 2;
+  config.max_services = 2;
+  config.overflow_resource = "too many";
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  ResourceQuantizer quantizer{*finalized};
+
+  std::vector<std::unique_ptr<SpanData>> spans;
+  spans.push_back(make_span("web", "GET /a"));
+  spans.push_back(make_span("web", "GET /b"));
+  spans.push_back(make_span("web", "GET /c"));
+  spans.push_back(make_span("web", "GET /a"));
+  spans.push_back(make_span("db", "GET /c"));
+  spans.push_back(make_span("cache", "GET /a"));
+  quantizer.quantize(spans);
+
+  REQUIRE(spans[0]->resource == "GET /a");
+  REQUIRE(spans[1]->resource == "GET /b");
+  REQUIRE(spans[2]->resource == "too many");
+  REQUIRE(spans[3]->resource == "GET /a");
+  // The limit is per service.
+  REQUIRE(spans[4]->resource == "GET /c");
+  // The number of services is limited separately.
+  REQUIRE(spans[5]->resource == "too many");
+
+  SECTION("resources are quantized before they're counted") {
+    std::vector<std::unique_ptr<SpanData>> more;
+    more.push_back(make_span("db", "GET /users/1"));
+    more.push_back(make_span("db", "GET /users/2"));
+    more.push_back(make_span("db", "GET /users/3"));
+    quantizer.quantize(more);
+    for (const auto& span : more) {
+      REQUIRE(span->resource == "GET /users/?");
+    }
+  }
+
+  SECTION("everything is forgotten after the reset interval") {
+    const auto start = spans.front()->start.tick;
+    std::vector<std::unique_ptr<SpanData>> later;
+    later.push_back(make_span("cache", "GET /c"));
+    later.push_back(make_span("web", "GET /c"));
+    later.front()->start.tick = start + std::chrono::seconds(59);
+    quantizer.quantize(later);
+    REQUIRE(later[0]->resource == "too many");
+    REQUIRE(later[1]->resource == "too many");
+
+    later[0]->resource = "GET /c";
+    later[1]->resource = "GET /c";
+    later.front()->start.tick = start + std::chrono::seconds(60);
+    quantizer.quantize(later);
+    REQUIRE(later[0]->resource == "GET /c");
+    REQUIRE(later[1]->resource == "GET /c");
+  }
+
+  SECTION("zero means no limit") {
+    config.max_resources_per_service = 0;
+    auto unlimited_config = finalize_config(config);
+    REQUIRE(unlimited_config);
+    ResourceQuantizer unlimited{*unlimited_config};
+    std::vector<std::unique_ptr<SpanData>> many;
+    for (int i = 0; i < 100; ++i) {
+      many.push_back(make_span("web", "op" + std::to_string(i)));
+    }
+    unlimited.quantize(many);
+    REQUIRE(many.back()->resource == "op99");
+  }
+}
+
+RESOURCE_TEST("tracer quantizes resources before sampling") {
+  TracerConfig config;
+  config.service = "testsvc";
+  const auto collector = std::make_shared<MockCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<NullLogger>();
+  // Keep only the quantized resource.
+  TraceSamplerConfig::Rule keep;
+  keep.resource = "GET /users/?";
+  keep.sample_rate = 1;
+  config.trace_sampler.rules.push_back(keep);
+  config.trace_sampler.sample_rate = 0;
+
+  SECTION("enabled") {
+    config.resource_quantization.enabled = true;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    Tracer tracer{*finalized};
+    {
+      auto root = tracer.create_span();
+      root.set_resource_name("GET /users/123?verbose=1");
+      auto child = root.create_child();
+      child.set_service_type("sql");
+      child.set_resource_name("SELECT * FROM users WHERE id = 123");
+    }
+
+    REQUIRE(collector->chunks.size() == 1);
+    const auto& chunk = collector->chunks.front();
+    REQUIRE(chunk.size() == 2);
+    REQUIRE(chunk[0]->resource == "GET /users/?");
+    REQUIRE(chunk[0]->numeric_tags.at("_sampling_priority_v1") == 2);
+    REQUIRE(chunk[1]->resource == "SELECT * FROM users WHERE id = ?");
+  }
+
+  SECTION("disabled") {
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    Tracer tracer{*finalized};
+    {
+      auto root = tracer.create_span();
+      root.set_resource_name("GET /users/123?verbose=1");
+    }
+
+    REQUIRE(collector->chunks.size() == 1);
+    const auto& span = collector->first_span();
+    REQUIRE(span.resource == "GET /users/123?verbose=1");
+    REQUIRE(span.numeric_tags.at("_sampling_priority_v1") == -1);
+  }
+}
@@ -0,0 +1,194 @@
+// These are tests for `RuntimeMetricsSampler`, which samples the runtime
+// metrics of the current process and publishes them through
+// `TracerTelemetry`, and for its configuration, `RuntimeMetricsConfig`.
+
+#include <datadog/clock.h>
+#include <datadog/error.h>
+#include <datadog/runtime_id.h>
+#include <datadog/runtime_metrics.h>
+#include <datadog/runtime_metrics_config.h>
+#include <datadog/tracer_config.h>
+#include <datadog/tracer_signature.h>
+#include <datadog/tracer_telemetry.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "common/environment.h"
+#include "mocks/event_schedulers.h"
+#include "mocks/loggers.h"
+#include "test.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace datadog::tracing;
+using namespace datadog::test;
+
+#define RUNTIME_METRICS_TEST(x) TEST_CASE(x, "[runtime_metrics]")
+
+RUNTIME_METRICS_TEST("RuntimeMetricsConfig") {
+  RuntimeMetricsConfig config;
+
+  SECTION("defaults") {
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(!finalized->enabled);
+    REQUIRE(finalized->sample_interval == std::chrono::seconds(10));
+    REQUIRE(finalized->event_scheduler == nullptr);
+  }
+
+  SECTION("DD_RUNTIME_METRICS_ENABLED overrides enabled") {
+    const EnvGuard guard{"DD_RUNTIME_METRICS_ENABLED", "true"};
+    config.enabled = false;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(finalized->enabled);
+    // The tracer fills in its DogStatsD client's event scheduler.
+    REQUIRE(finalized->event_scheduler == nullptr);
+  }
+
+  SECTION("sample interval must be positive") {
+    config.sample_interval_milliseconds = 0;
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    REQUIRE(finalized.error().code ==
+            Error::RUNTIME_METRICS_INVALID_SAMPLE_INTERVAL);
+  }
+}
+
+RUNTIME_METRICS_TEST("runtime metrics in TracerConfig") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.runtime_metrics.enabled = true;
+
+  SECTION("require DogStatsD") {
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    REQUIRE(finalized.error().code ==
+            Error::RUNTIME_METRICS_WITHOUT_DOGSTATSD);
+  }
+
+  SECTION("share DogStatsD's event scheduler by default") {
+    config.dogstatsd.enabled = true;
+    const auto scheduler = std::make_shared<MockEventScheduler>();
+    config.dogstatsd.event_scheduler = scheduler;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(finalized->runtime_metrics.event_scheduler == scheduler);
+  }
+
+  SECTION("use their own event scheduler if specified") {
+    config.dogstatsd.enabled = true;
+    config.dogstatsd.event_scheduler = std::make_shared<MockEventScheduler>();
+    const auto scheduler = std::make_shared<MockEventScheduler>();
+    config.runtime_metrics.event_scheduler = scheduler;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(finalized->runtime_metrics.event_scheduler == scheduler);
+  }
+}
+
+RUNTIME_METRICS_TEST("parse /proc/<pid>/stat") {
+  RuntimeMetricsSampler::Sample sample;
+
+  SECTION("executable name containing spaces and parentheses") {
+    const StringView contents =
+        "4242 (my (weird) exe) S 1 4242 4242 0 -1 4194560 1234 0 0 0 250 "
+        "125 0 0 20 0 7 0 123456 987654321 2048 18446744073709551615 1 1 "
+        "0 0 0 0 0 4096 0 0 0 0 17 3 0 0 0 0 0\n";
+    REQUIRE(parse_proc_stat(contents, 100, sample));
+    REQUIRE(sample.cpu_user_milliseconds == 2500);
+    REQUIRE(sample.cpu_system_milliseconds == 1250);
+    REQUIRE(sample.threads == 7);
+  }
+
+  SECTION("malformed") {
+    auto contents = GENERATE(values<std::string>({
+        "",
+        "4242 my-exe S 1 4242",
+        "4242 (my-exe) S 1 4242 4242 0 -1 4194560 1234 0 0 0 250",
+        "4242 (my-exe) S 1 4242 4242 0 -1 4194560 1234 0 0 0 x y 0 0 20 0 7",
+    }));
+    CAPTURE(contents);
+    REQUIRE(!parse_proc_stat(contents, 100, sample));
+  }
+}
+
+RUNTIME_METRICS_TEST("parse /proc/<pid>/status") {
+  RuntimeMetricsSampler::Sample sample;
+
+  SECTION("well-formed") {
+    const StringView contents =
+        "Name:\tmy-exe\n"
+        "State:\tS (sleeping)\n"
+        "VmPeak:\t   20000 kB\n"
+        "VmRSS:\t    1536 kB\n"
+        "Threads:\t7\n"
+        "voluntary_ctxt_switches:\t42\n"
+        "nonvoluntary_ctxt_switches:\t3\n";
+    REQUIRE(parse_proc_status(contents, sample));
+    REQUIRE(sample.rss_bytes == 1536 * 1024);
+    REQUIRE(sample.voluntary_context_switches == 42);
+    REQUIRE(sample.involuntary_context_switches == 3);
+  }
+
+  SECTION("missing fields") {
+    // Kernel threads, for example, have no "VmRSS" field.
+    const StringView contents =
+        "Name:\tkthreadd\n"
+        "voluntary_ctxt_switches:\t42\n"
+        "nonvoluntary_ctxt_switches:\t3\n";
+    REQUIRE(!parse_proc_status(contents, sample));
+  }
+}
+
+#if defined(__linux__)
+
+RUNTIME_METRICS_TEST("RuntimeMetricsSampler samples this process") {
+  const TracerSignature tracer_signature{RuntimeID::generate(), "testsvc",
+                                         "test"};
+  const auto tracer_telemetry = std::make_shared<TracerTelemetry>(
+      false, default_clock, std::make_shared<MockLogger>(), tracer_signature,
+      "", "");
+  const auto scheduler = std::make_shared<MockEventScheduler>();
+
+  {
+    RuntimeMetricsSampler sampler{tracer_telemetry, scheduler,
+                                  std::chrono::seconds(5)};
+    REQUIRE(scheduler->recurrence_interval == std::chrono::seconds(5));
+
+    // A sample is taken immediately.
+    const auto first = sampler.last_sample();
+    REQUIRE(first.threads >= 1);
+    REQUIRE(first.rss_bytes > 0);
+    REQUIRE(first.open_file_descriptors >= 1);
+
+    auto& runtime = tracer_telemetry->metrics().runtime;
+    REQUIRE(runtime.threads.value() == first.threads);
+    REQUIRE(runtime.rss.value() == first.rss_bytes);
+    REQUIRE(runtime.open_file_descriptors.value() ==
+            first.open_file_descriptors);
+
+    // Opening a file is observed by the next sample.
+    const int fd = ::open("/dev/null", O_RDONLY);
+    REQUIRE(fd != -1);
+    REQUIRE(sampler.sample());
+    REQUIRE(sampler.last_sample().open_file_descriptors ==
+            first.open_file_descriptors + 1);
+    ::close(fd);
+
+    // The scheduler drives sampling.
+    scheduler->event_callback();
+    REQUIRE(sampler.last_sample().open_file_descriptors ==
+            first.open_file_descriptors);
+    REQUIRE(!scheduler->cancelled);
+  }
+
+  REQUIRE(scheduler->cancelled);
+}
+
+#endif
@@ -0,0 +1,492 @@
+// These are tests of `AgentEmulator`, and soak tests that run a `Tracer` that
+// sends traces to an `AgentEmulator` configured to misbehave.
+//
+// The soak tests run for one second per transport by default.  Set the
+// environment variable `DD_TEST_SOAK_SECONDS` to run them for longer.
+
+#include <datadog/curl.h>
+#include <datadog/dict_writer.h>
+#include <datadog/http_client.h>
+#include <datadog/logger.h>
+#include <datadog/msgpack.h>
+#include <datadog/span_data.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "agent_emulator.h"
+#include "mocks/loggers.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#define SOAK_TEST(x) TEST_CASE(x, "[soak]")
+
+namespace {
+
+// `CountingLogger` counts errors instead of storing them, so that it doesn't
+// grow during a soak test.
+class CountingLogger : public Logger {
+ public:
+  std::atomic<std::uint64_t> trace_status_errors{0};
+  std::atomic<std::uint64_t> trace_network_errors{0};
+  std::atomic<std::uint64_t> other_errors{0};
+
+  void log_error(const LogFunc& write) override {
+    std::ostringstream stream;
+    write(stream);
+    const std::string message = stream.str();
+    if (message.find("Unexpected response status") != std::string::npos) {
+      ++trace_status_errors;
+    } else if (message.find("submitting traces") != std::string::npos) {
+      ++trace_network_errors;
+    } else {
+      ++other_errors;
+    }
+  }
+
+  void log_startup(const LogFunc&) override {}
+
+  using Logger::log_error;
+};
+
+// `CountingHTTPClient` forwards requests to another `HTTPClient`, and counts
+// trace requests, the trace chunks in them, and their outcomes.
+class CountingHTTPClient : public HTTPClient {
+  // `TraceCountReader` records the "X-Datadog-Trace-Count" request header as
+  // it's forwarded.
+  class TraceCountReader : public DictWriter {
+    DictWriter& next_;
+
+   public:
+    std::uint64_t trace_count = 0;
+
+    explicit TraceCountReader(DictWriter& next) : next_(next) {}
+
+    void set(StringView key, StringView value) override {
+      if (key == "X-Datadog-Trace-Count") {
+        trace_count = std::stoull(std::string(value));
+      }
+      next_.set(key, value);
+    }
+  };
+
+  std::shared_ptr<HTTPClient> next_;
+
+ public:
+  std::mutex mutex;
+  std::uint64_t trace_requests = 0;
+  std::uint64_t trace_chunks = 0;
+  std::uint64_t accepted_trace_chunks = 0;
+  std::uint64_t accepted_requests = 0;
+  std::uint64_t rejected_requests = 0;
+  std::uint64_t failed_requests = 0;
+
+  explicit CountingHTTPClient(std::shared_ptr<HTTPClient> next)
+      : next_(std::move(next)) {}
+
+  Expected<void> post(const URL& url, HeadersSetter set_headers,
+                      std::string body, ResponseHandler on_response,
+                      ErrorHandler on_error,
+                      std::chrono::steady_clock::time_point deadline) override {
+    if (url.path.find("/traces") == std::string::npos) {
+      return next_->post(url, std::move(set_headers), std::move(body),
+                         std::move(on_response), std::move(on_error),
+                         deadline);
+    }
+
+    auto chunks = std::make_shared<std::uint64_t>(0);
+    auto counting_set_headers = [set_headers = std::move(set_headers),
+                                 chunks](DictWriter& headers) {
+      TraceCountReader reader{headers};
+      set_headers(reader);
+      *chunks = reader.trace_count;
+    };
+    auto counting_on_response = [this, on_response = std::move(on_response),
+                                 chunks](int status, const DictReader& headers,
+                                         std::string body) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (status == 200) {
+          ++accepted_requests;
+          accepted_trace_chunks += *chunks;
+        } else {
+          ++rejected_requests;
+        }
+      }
+      on_response(status, headers, std::move(body));
+    };
+    auto counting_on_error = [this,
+                              on_error = std::move(on_error)](Error error) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++failed_requests;
+      }
+      on_error(std::move(error));
+    };
+
+    auto result = next_->post(url, std::move(counting_set_headers),
+                              std::move(body), std::move(counting_on_response),
+                              std::move(counting_on_error), deadline);
+    std::lock_guard<std::mutex> lock(mutex);
+    ++trace_requests;
+    trace_chunks += *chunks;
+    return result;
+  }
+
+  Expected<void> get(const URL& url, HeadersSetter set_headers,
+                     ResponseHandler on_response, ErrorHandler on_error,
+                     std::chrono::steady_clock::time_point deadline) override {
+    return next_->get(url, std::move(set_headers), std::move(on_response),
+                      std::move(on_error), deadline);
+  }
+
+  void drain(std::chrono::steady_clock::time_point deadline) override {
+    next_->drain(deadline);
+  }
+
+  std::string config() const override { return next_->config(); }
+};
+
+// Return the resident set size of this process in bytes, or zero if it's not
+// known.
+std::uint64_t resident_bytes() {
+  std::ifstream statm{"/proc/self/statm"};
+  std::uint64_t total_pages = 0;
+  std::uint64_t resident_pages = 0;
+  if (!(statm >> total_pages >> resident_pages)) {
+    return 0;
+  }
+  return resident_pages * static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+}
+
+std::chrono::seconds soak_duration() {
+  if (const char* seconds = std::getenv("DD_TEST_SOAK_SECONDS")) {
+    return std::chrono::seconds(std::atoi(seconds));
+  }
+  return 1s;
+}
+
+std::string socket_path(StringView name) {
+  std::string path = "/tmp/dd-trace-cpp-";
+  append(path, name);
+  path += '-';
+  path += std::to_string(::getpid());
+  path += ".socket";
+  return path;
+}
+
+struct Response {
+  int status = 0;
+  std::string body;
+  bool failed = false;
+};
+
+// Send a request to the specified `path` at the specified `emulator` using
+// `Curl`, and wait for the response.  Send a POST request having the
+// specified `body` if there is one, or a GET request otherwise.
+Response request(const AgentEmulator& emulator, StringView path,
+                 Optional<std::string> body = nullopt) {
+  const auto logger = std::make_shared<MockLogger>();
+  Curl client{logger, default_clock};
+  auto url = HTTPClient::URL::parse(emulator.url());
+  REQUIRE(url);
+  append(url->path, path);
+
+  Response response;
+  const auto on_response = [&](int status, const DictReader&,
+                               std::string response_body) {
+    response.status = status;
+    response.body = std::move(response_body);
+  };
+  const auto on_error = [&](Error) { response.failed = true; };
+  const auto deadline = std::chrono::steady_clock::now() + 5s;
+  if (body) {
+    REQUIRE(client.post(*url, [](DictWriter&) {}, std::move(*body),
+                        on_response, on_error, deadline));
+  } else {
+    REQUIRE(client.get(*url, [](DictWriter&) {}, on_response, on_error,
+                       deadline));
+  }
+  client.drain(deadline);
+  return response;
+}
+
+// Return the version 0.4 MessagePack encoding of the specified number of trace
+// chunks, each containing two spans.
+std::string encode_traces(int chunk_count) {
+  std::vector<std::vector<std::unique_ptr<SpanData>>> chunks(chunk_count);
+  for (auto& chunk : chunks) {
+    for (int i = 0; i < 2; ++i) {
+      auto span = std::make_unique<SpanData>();
+      span->service = "testsvc";
+      span->name = "test.op";
+      span->tags["foo"] = "bar";
+      span->numeric_tags["baz"] = 1.5;
+      chunk.push_back(std::move(span));
+    }
+  }
+  std::string body;
+  REQUIRE(msgpack::pack_array(
+      body, chunks, [](std::string& destination, const auto& chunk) {
+        return msgpack_encode(destination, chunk);
+      }));
+  return body;
+}
+
+}  // namespace
+
+SOAK_TEST("agent emulator serves each endpoint") {
+  AgentEmulatorConfig config;
+  SECTION("over TCP") {}
+  SECTION("over a Unix domain socket") {
+    config.unix_socket = socket_path("emulator");
+  }
+  AgentEmulator emulator{config};
+
+  SECTION("info") {
+    const auto response = request(emulator, "/info");
+    REQUIRE(response.status == 200);
+    REQUIRE(response.body.find("/v0.5/traces") != std::string::npos);
+    REQUIRE(emulator.report().info_requests == 1);
+  }
+
+  SECTION("traces") {
+    const auto response = request(emulator, "/v0.4/traces", encode_traces(3));
+    REQUIRE(response.status == 200);
+    REQUIRE(response.body.find("rate_by_service") != std::string::npos);
+    const auto report = emulator.report();
+    REQUIRE(report.trace_requests == 1);
+    REQUIRE(report.trace_chunks == 3);
+    REQUIRE(report.spans == 6);
+    REQUIRE(report.accepted_trace_chunks == 3);
+    REQUIRE(report.trace_responses.at(200) == 1);
+  }
+
+  SECTION("malformed traces") {
+    std::string body = encode_traces(3);
+    body.pop_back();
+    REQUIRE(request(emulator, "/v0.4/traces", body).status == 400);
+    REQUIRE(request(emulator, "/v0.5/traces", encode_traces(3)).status == 400);
+    REQUIRE(emulator.report().bad_requests == 2);
+  }
+
+  SECTION("telemetry") {
+    const std::string message = R"({
+      "request_type": "message-batch",
+      "payload": [{"request_type": "app-heartbeat"},
+                  {"request_type": "generate-metrics"}]
+    })";
+    const auto response =
+        request(emulator, "/telemetry/proxy/api/v2/apmtelemetry", message);
+    REQUIRE(response.status == 200);
+    const auto report = emulator.report();
+    REQUIRE(report.telemetry_requests == 1);
+    REQUIRE(report.telemetry_messages.at("message-batch") == 1);
+    REQUIRE(report.telemetry_messages.at("app-heartbeat") == 1);
+    REQUIRE(report.telemetry_messages.at("generate-metrics") == 1);
+  }
+
+  SECTION("unknown endpoint") {
+    REQUIRE(request(emulator, "/v0.1/nope").status == 404);
+    REQUIRE(emulator.report().bad_requests == 1);
+  }
+}
+
+SOAK_TEST("agent emulator scripts Remote Configuration responses") {
+  AgentEmulatorConfig config;
+  config.remote_config_responses = {R"({"first": 1})", R"({"second": 2})"};
+  AgentEmulator emulator{config};
+
+  REQUIRE(request(emulator, "/v0.7/config", "{}").body == R"({"first": 1})");
+  REQUIRE(request(emulator, "/v0.7/config", "{}").body == R"({"second": 2})");
+  REQUIRE(request(emulator, "/v0.7/config", "{}").body == "{}");
+  REQUIRE(emulator.report().remote_config_requests == 3);
+}
+
+SOAK_TEST("agent emulator injects faults") {
+  AgentEmulatorConfig config;
+  int expected_status = 0;
+  auto expected_duration = 0ms;
+  SECTION("server error") {
+    config.error_rate = 1;
+    expected_status = 500;
+  }
+  SECTION("payload too large") {
+    config.request_too_large_rate = 1;
+    expected_status = 413;
+  }
+  SECTION("request larger than the limit") {
+    config.max_request_bytes = 10;
+    expected_status = 413;
+  }
+  SECTION("too many requests") {
+    config.too_many_requests_rate = 1;
+    expected_status = 429;
+  }
+  SECTION("connection reset") { config.reset_rate = 1; }
+  SECTION("latency") {
+    config.latency = 100ms;
+    expected_status = 200;
+    expected_duration = 100ms;
+  }
+  SECTION("slow reads") {
+    config.read_bytes_per_second = 20 * 1024;
+    expected_status = 200;
+    expected_duration = 100ms;
+  }
+
+  AgentEmulator emulator{config};
+  const auto before = std::chrono::steady_clock::now();
+  // Make the body big enough that libcurl might send it in more than one
+  // piece.
+  const auto response = request(emulator, "/v0.4/traces", encode_traces(50));
+  const auto elapsed = std::chrono::steady_clock::now() - before;
+  const auto report = emulator.report();
+  REQUIRE(report.trace_chunks == 50);
+
+  if (expected_status == 0) {
+    REQUIRE(response.failed);
+    REQUIRE(report.connection_resets >= 1);
+    REQUIRE(report.trace_responses.empty());
+    REQUIRE(report.accepted_trace_chunks == 0);
+    return;
+  }
+
+  REQUIRE_FALSE(response.failed);
+  REQUIRE(response.status == expected_status);
+  REQUIRE(report.trace_responses.at(expected_status) == 1);
+  if (expected_status == 200) {
+    REQUIRE(report.accepted_trace_chunks == 50);
+    REQUIRE(elapsed >= expected_duration);
+  } else {
+    REQUIRE(report.accepted_trace_chunks == 0);
+  }
+}
+
+SOAK_TEST("tracer delivering to a misbehaving agent") {
+  AgentEmulatorConfig emulator_config;
+  emulator_config.latency = 5ms;
+  emulator_config.read_bytes_per_second = 16 * 1024 * 1024;
+  emulator_config.error_rate = 0.05;
+  emulator_config.request_too_large_rate = 0.05;
+  emulator_config.too_many_requests_rate = 0.05;
+  emulator_config.reset_rate = 0.05;
+  // The tracer learns of this limit from "/info", and splits its requests
+  // accordingly.
+  emulator_config.max_request_bytes = 64 * 1024;
+  emulator_config.seed = 1234;
+  SECTION("over TCP") {}
+  SECTION("over a Unix domain socket") {
+    emulator_config.unix_socket = socket_path("soak");
+  }
+  AgentEmulator emulator{emulator_config};
+
+  const auto logger = std::make_shared<CountingLogger>();
+  const auto client = std::make_shared<CountingHTTPClient>(
+      std::make_shared<Curl>(logger, default_clock));
+
+  TracerConfig config;
+  config.service = "soak";
+  config.logger = logger;
+  config.agent.url = emulator.url();
+  config.agent.http_client = client;
+  config.agent.flush_interval_milliseconds = 20;
+  config.agent.remote_configuration_poll_interval_seconds = 0.1;
+  config.telemetry.heartbeat_interval_seconds = 0.2;
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+
+  const auto duration = soak_duration();
+  std::uint64_t traces_created = 0;
+  std::uint64_t baseline_bytes = 0;
+  std::uint64_t peak_bytes = 0;
+  {
+    Tracer tracer{*finalized};
+    const auto start = std::chrono::steady_clock::now();
+    for (auto now = start; now - start < duration;
+         now = std::chrono::steady_clock::now()) {
+      for (int i = 0; i < 20; ++i) {
+        auto root = tracer.create_span();
+        root.set_name("soak.request");
+        root.set_resource_name("GET /soak/" + std::to_string(i % 10));
+        root.set_tag("http.method", "GET");
+        for (int j = 0; j < 4; ++j) {
+          auto child = root.create_child();
+          child.set_name("soak.child");
+          child.set_tag("iteration", std::to_string(traces_created));
+        }
+        ++traces_created;
+      }
+      std::this_thread::sleep_for(2ms);
+
+      // Let the tracer reach a steady state before measuring memory.
+      if (now - start >= duration / 4) {
+        const std::uint64_t bytes = resident_bytes();
+        if (baseline_bytes == 0) {
+          baseline_bytes = bytes;
+        }
+        peak_bytes = std::max(peak_bytes, bytes);
+      }
+    }
+    // Destroying the tracer flushes the remaining traces and waits for the
+    // requests to finish.
+  }
+
+  std::lock_guard<std::mutex> lock(client->mutex);
+  const auto report = emulator.report();
+  CAPTURE(traces_created);
+  CAPTURE(report.to_json());
+
+  // Every trace reached the network, in requests that each ended exactly once.
+  REQUIRE(client->trace_chunks == traces_created);
+  REQUIRE(client->accepted_requests + client->rejected_requests +
+              client->failed_requests ==
+          client->trace_requests);
+  // The tracer and the Agent agree about which traces were delivered, and
+  // about which requests were rejected.
+  REQUIRE(report.accepted_trace_chunks == client->accepted_trace_chunks);
+  std::uint64_t rejections = 0;
+  for (const auto& [status, count] : report.trace_responses) {
+    if (status != 200) {
+      rejections += count;
+    }
+  }
+  REQUIRE(client->rejected_requests == rejections);
+  // libcurl might retry a request whose connection was reset, so there can be
+  // fewer failures than resets.
+  REQUIRE(client->failed_requests <= report.connection_resets);
+  // The faults were injected, and every dropped request was reported.
+  REQUIRE(client->accepted_trace_chunks > 0);
+  REQUIRE(client->accepted_trace_chunks < traces_created);
+  REQUIRE(logger->trace_status_errors == client->rejected_requests);
+  REQUIRE(logger->trace_network_errors == client->failed_requests);
+  REQUIRE(logger->other_errors == 0);
+  // The tracer learned of the request size limit, so every request fit.
+  REQUIRE(report.bad_requests == 0);
+  REQUIRE(report.trace_bytes <= report.trace_requests * (64 * 1024));
+
+  // The other endpoints were used, too.
+  REQUIRE(report.info_requests >= 1);
+  REQUIRE(report.remote_config_requests >= 1);
+  REQUIRE(report.telemetry_messages.count("app-started"));
+
+  // Memory use didn't grow with the number of traces.
+  if (baseline_bytes) {
+    REQUIRE(peak_bytes - baseline_bytes < 32 * 1024 * 1024);
+  }
+}
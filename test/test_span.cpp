@@ -9,6 +9,8 @@
 #include <datadog/optional.h>
 #include <datadog/span.h>
 #include <datadog/span_config.h>
+#include <datadog/span_prototype.h>
+#include <datadog/stack_trace.h>
 #include <datadog/tag_propagation.h>
 #include <datadog/trace_segment.h>
 #include <datadog/tracer.h>
@@ -17,6 +19,7 @@
 #include <cstdint>
 #include <functional>
 #include <string>
+#include <unordered_map>
 
 #include "catch.hpp"
 #include "datadog/sampling_mechanism.h"
@@ -31,7 +34,7 @@
 using namespace datadog::tracing;
 
 TEST_CASE("set_tag") {
-  TracerConfig config;
+  TracerConfig config{};
   config.service = "testsvc";
   const auto collector = std::make_shared<MockCollector>();
   config.collector = collector;
@@ -167,7 +170,7 @@ TEST_CASE("remove_tag") {
 }
 
 TEST_CASE("set_metric") {
-  TracerConfig config;
+  TracerConfig config{};
   config.service = "testsvc";
   const auto collector = std::make_shared<MockCollector>();
   config.collector = collector;
@@ -408,6 +411,64 @@ TEST_CASE(".error() and .set_error*()") {
   }
 }
 
+TEST_CASE("capture_error_stack") {
+  TracerConfig config;
+  config.service = "testsvc";
+  auto collector = std::make_shared<MockCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<MockLogger>();
+
+  SECTION("the captured stack is sent to the collector") {
+    auto finalized_config = finalize_config(config);
+    REQUIRE(finalized_config);
+    Tracer tracer{*finalized_config};
+    {
+      auto span = tracer.create_span();
+      span.set_error_stack("replaced by the captured stack");
+      span.capture_error_stack();
+      REQUIRE(span.error());
+    }
+
+    REQUIRE(collector->chunks.size() == 1);
+    const auto& span = collector->first_span();
+    REQUIRE(span.error);
+    REQUIRE(span.error_stack);
+    REQUIRE(span.tags.count("error.stack") == 0);
+    // A collector other than `DatadogAgent` describes the stack itself.
+    REQUIRE(!StackSymbolizer{}.symbolize(*span.error_stack).empty());
+  }
+
+  SECTION("set_error_stack replaces the captured stack") {
+    auto finalized_config = finalize_config(config);
+    REQUIRE(finalized_config);
+    Tracer tracer{*finalized_config};
+    {
+      auto span = tracer.create_span();
+      span.capture_error_stack();
+      span.set_error_stack("this is C++, fool");
+    }
+
+    const auto& span = collector->first_span();
+    REQUIRE(!span.error_stack);
+    REQUIRE(span.tags.at("error.stack") == "this is C++, fool");
+  }
+
+  SECTION("the captured stack of a dropped span is discarded") {
+    config.trace_sampler.sample_rate = 0.0;
+    auto finalized_config = finalize_config(config);
+    REQUIRE(finalized_config);
+    Tracer tracer{*finalized_config};
+    {
+      auto span = tracer.create_span();
+      span.capture_error_stack();
+    }
+
+    const auto& span = collector->first_span();
+    REQUIRE(span.error);
+    REQUIRE(!span.error_stack);
+  }
+}
+
 TEST_CASE("property setters and getters") {
   // Verify that modifications made by `Span::set_...` are visible both in the
   // corresponding getter method and in the resulting span data sent to the
@@ -466,7 +527,7 @@ TEST_CASE("property setters and getters") {
 // Trace context injection is implemented in `TraceSegment`, but it's part of
 // the interface of `Span`, so the test is here.
 TEST_CASE("injection") {
-  TracerConfig config;
+  TracerConfig config{};
   config.service = "testsvc";
   config.collector = std::make_shared<MockCollector>();
   config.logger = std::make_shared<MockLogger>();
@@ -548,6 +609,89 @@ TEST_CASE("injection") {
   }
 }
 
+TEST_CASE("injection in the B3 single-header style") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.collector = std::make_shared<MockCollector>();
+  config.logger = std::make_shared<MockLogger>();
+  config.extraction_styles = {PropagationStyle::B3_SINGLE};
+  config.injection_styles = {PropagationStyle::B3_SINGLE};
+
+  auto finalized_config = finalize_config(config);
+  REQUIRE(finalized_config);
+  Tracer tracer{*finalized_config};
+
+  struct TestCase {
+    int line;
+    std::string name;
+    std::string extracted_b3;
+    std::string expected_trace_id;
+    std::string expected_sampled;
+  };
+
+  auto test_case = GENERATE(values<TestCase>({
+      {__LINE__, "64-bit trace ID", "2a-4d2-1", "000000000000002a", "1"},
+      {__LINE__, "128-bit trace ID",
+       "640cfd8d0000000064fe8b2a57d3eff7-4d2-0",
+       "640cfd8d0000000064fe8b2a57d3eff7", "0"},
+      {__LINE__, "debug", "2a-4d2-d", "000000000000002a", "1"},
+  }));
+
+  CAPTURE(test_case.line);
+  CAPTURE(test_case.name);
+
+  const std::unordered_map<std::string, std::string> headers{
+      {"b3", test_case.extracted_b3}};
+  MockDictReader reader{headers};
+  auto span = tracer.extract_span(reader);
+  REQUIRE(span);
+  MockDictWriter writer;
+  span->inject(writer);
+
+  std::string expected = test_case.expected_trace_id;
+  expected += '-';
+  expected += hex_padded(span->id());
+  expected += '-';
+  expected += test_case.expected_sampled;
+  REQUIRE(writer.items.at("b3") == expected);
+  REQUIRE(writer.items.count("x-b3-traceid") == 0);
+}
+
+TEST_CASE("injection delivers all headers in one call to set_all") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.collector = std::make_shared<MockCollector>();
+  config.logger = std::make_shared<MockLogger>();
+  config.injection_styles = {PropagationStyle::DATADOG, PropagationStyle::B3,
+                             PropagationStyle::B3_SINGLE,
+                             PropagationStyle::W3C};
+
+  auto finalized_config = finalize_config(config);
+  REQUIRE(finalized_config);
+  Tracer tracer{*finalized_config};
+
+  struct BulkDictWriter : public MockDictWriter {
+    int set_all_calls = 0;
+
+    void set_all(const std::pair<StringView, StringView>* entries,
+                 std::size_t count) override {
+      ++set_all_calls;
+      MockDictWriter::set_all(entries, count);
+    }
+  };
+
+  auto span = tracer.create_span();
+  BulkDictWriter writer;
+  span.inject(writer);
+
+  REQUIRE(writer.set_all_calls == 1);
+  REQUIRE(writer.items.count("x-datadog-trace-id") == 1);
+  REQUIRE(writer.items.count("x-b3-traceid") == 1);
+  REQUIRE(writer.items.count("b3") == 1);
+  REQUIRE(writer.items.count("traceparent") == 1);
+  REQUIRE(writer.items.count("tracestate") == 1);
+}
+
 TEST_CASE("injection can be disabled using the \"none\" style") {
   TracerConfig config;
   config.service = "testsvc";
@@ -860,3 +1004,92 @@ TEST_CASE("128-bit trace ID injection") {
   REQUIRE(found != writer.items.end());
   REQUIRE(found->second == "deadbeefdeadbeefcafebabecafebabe");
 }
+
+TEST_CASE("spans created from a prototype") {
+  TracerConfig config{};
+  config.service = "testsvc";
+  config.environment = "test";
+  config.tags = std::unordered_map<std::string, std::string>{
+      {"team", "tracing"}, {"component", "default"}};
+  const auto collector = std::make_shared<MockCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<NullLogger>();
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  Tracer tracer{*finalized};
+
+  SpanConfig span_config;
+  span_config.service = "rpc-client";
+  span_config.service_type = "rpc";
+  span_config.name = "rpc.call";
+  span_config.version = "1.2.3";
+  span_config.tags = {{"component", "rpc"}, {"span.kind", "client"}};
+  // A prototype's spans start when they're created.
+  span_config.start = default_clock() - std::chrono::hours(1);
+  const SpanPrototype prototype = tracer.create_span_prototype(span_config);
+
+  // Spans created from the prototype are the same as spans created from the
+  // prototype's config, apart from their IDs and start times.
+  const auto require_same = [&](const SpanData& from_prototype,
+                                const SpanData& from_config) {
+    REQUIRE(from_prototype.service == from_config.service);
+    REQUIRE(from_prototype.service_type == from_config.service_type);
+    REQUIRE(from_prototype.name == from_config.name);
+    REQUIRE(from_prototype.resource == from_config.resource);
+    // The high bits of the trace ID are the start time.
+    auto prototype_tags = from_prototype.tags;
+    auto config_tags = from_config.tags;
+    prototype_tags.erase("_dd.p.tid");
+    config_tags.erase("_dd.p.tid");
+    REQUIRE(prototype_tags == config_tags);
+    REQUIRE(from_prototype.start.wall >
+            default_clock().wall - std::chrono::minutes(1));
+  };
+
+  SECTION("root and child spans") {
+    const auto before = default_clock();
+    {
+      auto root = tracer.create_span(prototype);
+      auto child = root.create_child(prototype);
+      REQUIRE(child.parent_id() == root.id());
+      REQUIRE(child.trace_id() == root.trace_id());
+      REQUIRE(root.start_time().wall >= before.wall);
+      REQUIRE(child.start_time().wall >= before.wall);
+    }
+    span_config.start = nullopt;
+    {
+      auto root = tracer.create_span(span_config);
+      auto child = root.create_child(span_config);
+    }
+
+    REQUIRE(collector->chunks.size() == 2);
+    const auto& from_prototype = collector->chunks[0];
+    const auto& from_config = collector->chunks[1];
+    REQUIRE(from_prototype.size() == 2);
+    REQUIRE(from_prototype[0]->tags.at("team") == "tracing");
+    REQUIRE(from_prototype[0]->tags.at("component") == "rpc");
+    REQUIRE(from_prototype[0]->tags.at("env") == "test");
+    REQUIRE(from_prototype[0]->tags.at("version") == "1.2.3");
+    require_same(*from_prototype[0], *from_config[0]);
+    require_same(*from_prototype[1], *from_config[1]);
+  }
+
+  SECTION("a prototype follows the defaults of a different tracer") {
+    TracerConfig other_config = config;
+    other_config.environment = "staging";
+    other_config.tags =
+        std::unordered_map<std::string, std::string>{{"team", "other"}};
+    auto other_finalized = finalize_config(other_config);
+    REQUIRE(other_finalized);
+    Tracer other_tracer{*other_finalized};
+    { auto root = other_tracer.create_span(prototype); }
+    span_config.start = nullopt;
+    { auto root = other_tracer.create_span(span_config); }
+
+    REQUIRE(collector->chunks.size() == 2);
+    const auto& span = *collector->chunks[0].front();
+    REQUIRE(span.tags.at("env") == "staging");
+    REQUIRE(span.tags.at("team") == "other");
+    require_same(span, *collector->chunks[1].front());
+  }
+}
@@ -0,0 +1,133 @@
+// These are tests for `SpanColumns`, which stores spans as a structure of
+// arrays, and for its MessagePack encoding, which must be the same as that of
+// the original `SpanData` objects.
+
+#include <datadog/msgpack.h>
+#include <datadog/span_columns.h>
+#include <datadog/span_data.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+#define COLUMNS_TEST(x) TEST_CASE(x, "[span_columns]")
+
+namespace {
+
+using Chunk = std::vector<std::unique_ptr<SpanData>>;
+
+std::unique_ptr<SpanData> make_span(int i) {
+  auto span = std::make_unique<SpanData>();
+  span->service = "testsvc";
+  span->service_type = i % 2 ? "web" : "sql";
+  span->name = "op" + std::to_string(i % 3);
+  span->resource = "resource number " + std::to_string(i);
+  span->trace_id = TraceID{0x1234567890ABCDEFULL + i, 7};
+  span->span_id = 1000 + i;
+  span->parent_id = i ? 1000 : 0;
+  span->start.wall =
+      std::chrono::system_clock::time_point{std::chrono::seconds(i)};
+  span->duration = std::chrono::microseconds(17 * i);
+  span->error = i % 5 == 0;
+  span->tags["env"] = "prod";
+  span->tags["request.id"] = "request " + std::to_string(i);
+  if (i % 4 == 0) {
+    // invalid UTF-8, which is replaced when encoded
+    span->tags["bytes"] = "\xC3\x28";
+  }
+  span->numeric_tags["_dd.measured"] = 1;
+  span->numeric_tags["value"] = i * 0.5;
+  return span;
+}
+
+// Return the MessagePack encoding of the specified `chunks` using the
+// `SpanData` encoder.
+std::string encode_rows(const std::vector<Chunk>& chunks) {
+  std::string encoded;
+  const auto result = msgpack::pack_array(
+      encoded, chunks, [](std::string& destination, const Chunk& chunk) {
+        return msgpack_encode(destination, chunk);
+      });
+  REQUIRE(result);
+  return encoded;
+}
+
+}  // namespace
+
+COLUMNS_TEST("strings are pooled") {
+  SpanColumns columns;
+  const auto foo = columns.intern("foo");
+  const auto bar = columns.intern("bar");
+  REQUIRE(foo != bar);
+  REQUIRE(columns.intern("foo") == foo);
+  REQUIRE(columns.intern(std::string("bar")) == bar);
+  REQUIRE(columns.string(foo) == "foo");
+  REQUIRE(columns.string(bar) == "bar");
+  REQUIRE(columns.string_count() == 2);
+
+  // Handles and strings survive growth of the pool.
+  for (int i = 0; i < 1000; ++i) {
+    columns.intern("string " + std::to_string(i));
+  }
+  REQUIRE(columns.intern("foo") == foo);
+  REQUIRE(columns.string(foo) == "foo");
+  REQUIRE(columns.string_count() == 1002);
+
+  SECTION("and survive a move") {
+    SpanColumns moved = std::move(columns);
+    REQUIRE(moved.intern("bar") == bar);
+    REQUIRE(moved.string(bar) == "bar");
+  }
+}
+
+COLUMNS_TEST("chunks are stored as columns") {
+  Chunk chunk;
+  chunk.push_back(make_span(1));
+  chunk.push_back(make_span(2));
+  chunk.push_back(make_span(3));
+
+  SpanColumns columns;
+  columns.append_chunk(chunk);
+  REQUIRE(columns.chunk_count() == 1);
+  REQUIRE(columns.span_count() == 3);
+  REQUIRE(columns.span_ids == std::vector<std::uint64_t>{1001, 1002, 1003});
+  REQUIRE(columns.durations == std::vector<std::uint64_t>{17000, 34000, 51000});
+  REQUIRE(columns.tag_offsets == std::vector<std::uint32_t>{0, 2, 4, 6});
+  REQUIRE(columns.metric_offsets == std::vector<std::uint32_t>{0, 2, 4, 6});
+  // All three spans have the same service.
+  REQUIRE(columns.services[0] == columns.services[1]);
+  REQUIRE(columns.services[1] == columns.services[2]);
+  REQUIRE(columns.string(columns.services[0]) == "testsvc");
+  REQUIRE(columns.string(columns.resources[2]) == "resource number 3");
+}
+
+COLUMNS_TEST("encoding is the same as encoding SpanData") {
+  std::vector<Chunk> chunks;
+  SECTION("no chunks") {}
+
+  SECTION("one empty chunk") { chunks.emplace_back(); }
+
+  SECTION("several chunks") {
+    int i = 0;
+    for (const int size : {1, 10, 0, 100}) {
+      Chunk chunk;
+      for (int j = 0; j < size; ++j) {
+        chunk.push_back(make_span(i++));
+      }
+      chunks.push_back(std::move(chunk));
+    }
+  }
+
+  SpanColumns columns;
+  for (const auto& chunk : chunks) {
+    columns.append_chunk(chunk);
+  }
+  std::string encoded;
+  REQUIRE(msgpack_encode(encoded, columns));
+  REQUIRE(encoded == encode_rows(chunks));
+}
@@ -0,0 +1,111 @@
+// These are tests for `capture_stack` and `StackSymbolizer`, which capture the
+// return addresses of a call stack and later describe them in text.
+
+#include <cstddef>
+#include <string>
+
+#include "catch.hpp"
+#include "stack_trace.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+
+namespace {
+
+#if defined(__GNUC__)
+#  define TEST_NOINLINE __attribute__((noinline))
+#else
+#  define TEST_NOINLINE
+#endif
+
+TEST_NOINLINE void capture_at_depth(CapturedStack& stack, int depth) {
+  if (depth > 0) {
+    capture_at_depth(stack, depth - 1);
+  } else {
+    capture_stack(stack);
+  }
+  // Prevent the recursive call from being a tail call, whose frame would
+  // replace this one.
+  volatile int keep_frame = depth;
+  (void)keep_frame;
+}
+
+std::size_t count_lines(const std::string& text) {
+  std::size_t lines = text.empty() ? 0 : 1;
+  for (const char ch : text) {
+    lines += ch == '\n';
+  }
+  return lines;
+}
+
+}  // namespace
+
+TEST_CASE("stack capture", "[stack_trace]") {
+  SECTION("captures the caller's frames") {
+    CapturedStack shallow;
+    capture_at_depth(shallow, 0);
+    CapturedStack deep;
+    capture_at_depth(deep, 5);
+#if defined(__APPLE__) || defined(__linux__) || defined(__unix__)
+    REQUIRE(shallow.size > 0);
+    REQUIRE(deep.size == shallow.size + 5);
+    // The frames outside of this function are the same.
+    for (std::size_t i = 1; i + 1 < shallow.size; ++i) {
+      REQUIRE(deep.frames[deep.size - i] == shallow.frames[shallow.size - i]);
+    }
+#endif
+  }
+
+  SECTION("skipped frames are omitted") {
+    CapturedStack skipped;
+    capture_stack(skipped, 0);
+    CapturedStack skipped_more;
+    capture_stack(skipped_more, 1);
+#if defined(__APPLE__) || defined(__linux__) || defined(__unix__)
+    REQUIRE(skipped_more.size + 1 == skipped.size);
+    REQUIRE(skipped_more.frames[0] == skipped.frames[1]);
+#endif
+  }
+
+  SECTION("deep stacks are truncated") {
+    CapturedStack stack;
+    capture_at_depth(stack, 2 * CapturedStack::max_frames);
+#if defined(__APPLE__) || defined(__linux__) || defined(__unix__)
+    REQUIRE(stack.size == CapturedStack::max_frames);
+#endif
+  }
+}
+
+TEST_CASE("stack symbolization", "[stack_trace]") {
+  CapturedStack stack;
+  capture_at_depth(stack, 2);
+  StackSymbolizer symbolizer;
+
+  const std::string description = symbolizer.symbolize(stack);
+  REQUIRE(count_lines(description) == stack.size);
+  if (stack.size > 0) {
+    REQUIRE(description.substr(0, 5) == "#0 0x");
+  }
+
+  SECTION("cached descriptions are the same") {
+    REQUIRE(symbolizer.symbolize(stack) == description);
+  }
+
+  SECTION("a full cache is cleared") {
+    CapturedStack fake;
+    fake.size = CapturedStack::max_frames;
+    for (std::size_t i = 0; i < 2 * StackSymbolizer::max_cache_size;
+         i += fake.size) {
+      for (std::size_t j = 0; j < fake.size; ++j) {
+        fake.frames[j] = reinterpret_cast<void*>(0x1000 + i + j);
+      }
+      REQUIRE(count_lines(symbolizer.symbolize(fake)) == fake.size);
+    }
+    REQUIRE(symbolizer.symbolize(stack) == description);
+  }
+
+  SECTION("an empty stack is empty") {
+    CapturedStack empty;
+    REQUIRE(symbolizer.symbolize(empty).empty());
+  }
+}
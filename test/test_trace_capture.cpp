@@ -0,0 +1,235 @@
+// These are tests for `TraceCapture`, which records extracted trace context
+// and finished spans to a file, and for `RecordingCollector`.
+
+#include <datadog/error.h>
+#include <datadog/span_config.h>
+#include <datadog/trace_capture.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <variant>
+
+#include "mocks/collectors.h"
+#include "mocks/dict_readers.h"
+#include "mocks/loggers.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+
+#define TRACE_CAPTURE_TEST(x) TEST_CASE(x, "[trace_capture]")
+
+namespace {
+
+std::string capture_path() {
+  return (std::filesystem::temp_directory_path() /
+          "dd-trace-cpp-test-trace-capture.bin")
+      .string();
+}
+
+}  // namespace
+
+TRACE_CAPTURE_TEST("capture and read back a tracer's traces") {
+  const auto path = capture_path();
+  auto capture = TraceCapture::create(path);
+  REQUIRE(capture);
+
+  const auto collector = std::make_shared<MockCollector>();
+  TracerConfig config;
+  config.service = "testsvc";
+  config.collector = collector;
+  config.logger = std::make_shared<MockLogger>();
+  config.trace_capture = *capture;
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+
+  {
+    Tracer tracer{*finalized};
+    {
+      SpanConfig root_config;
+      root_config.resource = "GET /users";
+      auto root = tracer.create_span(root_config);
+      root.set_tag("http.status_code", "200");
+      root.set_metric("rows", 42.5);
+      for (int i = 0; i < 3; ++i) {
+        SpanConfig child_config;
+        child_config.name = "db.query";
+        child_config.resource = "select * from users";
+        auto child = root.create_child(child_config);
+        child.set_error_message("timeout");
+      }
+    }
+    {
+      const std::unordered_map<std::string, std::string> headers{
+          {"x-datadog-trace-id", "123"},
+          {"x-datadog-parent-id", "456"},
+          {"x-datadog-sampling-priority", "2"},
+          {"user-agent", "not captured"},
+      };
+      MockDictReader reader{headers};
+      auto span = tracer.extract_span(reader);
+      REQUIRE(span);
+    }
+    // The recording collector forwards to the configured collector.
+    REQUIRE(collector->chunks.size() == 2);
+    REQUIRE(collector->span_count() == 5);
+  }
+
+  (*capture)->flush();
+  auto records = TraceCapture::read(path);
+  REQUIRE(records);
+  REQUIRE(records->size() == 3);
+
+  // The first trace was created, not extracted, so it's just a chunk.
+  auto* chunk = std::get_if<TraceCapture::Chunk>(&(*records)[0]);
+  REQUIRE(chunk);
+  REQUIRE(chunk->size() == 4);
+  const auto& original = collector->chunks[0];
+  for (std::size_t i = 0; i < chunk->size(); ++i) {
+    const SpanData& expected = *original[i];
+    const SpanData& actual = *(*chunk)[i];
+    REQUIRE(actual.service == expected.service);
+    REQUIRE(actual.name == expected.name);
+    REQUIRE(actual.resource == expected.resource);
+    REQUIRE(actual.trace_id == expected.trace_id);
+    REQUIRE(actual.span_id == expected.span_id);
+    REQUIRE(actual.parent_id == expected.parent_id);
+    REQUIRE(actual.start.wall == expected.start.wall);
+    REQUIRE(actual.duration == expected.duration);
+    REQUIRE(actual.error == expected.error);
+    REQUIRE(actual.tags == expected.tags);
+    REQUIRE(actual.numeric_tags == expected.numeric_tags);
+  }
+
+  // The second trace was extracted, so the headers that were examined come
+  // first.
+  auto* headers = std::get_if<TraceCapture::Headers>(&(*records)[1]);
+  REQUIRE(headers);
+  REQUIRE(headers->trace_id == 123);
+  REQUIRE(headers->headers.size() == 3);
+  for (const auto& [key, value] : headers->headers) {
+    REQUIRE(key != "user-agent");
+  }
+  chunk = std::get_if<TraceCapture::Chunk>(&(*records)[2]);
+  REQUIRE(chunk);
+  REQUIRE(chunk->size() == 1);
+  REQUIRE(chunk->front()->trace_id == 123);
+  REQUIRE(chunk->front()->parent_id == 456);
+
+  std::filesystem::remove(path);
+}
+
+TRACE_CAPTURE_TEST("repeated strings are written once") {
+  const auto path = capture_path();
+  auto capture = TraceCapture::create(path);
+  REQUIRE(capture);
+
+  const std::string value(1000, 'x');
+  for (int i = 0; i < 100; ++i) {
+    (*capture)->record_headers(TraceID{std::uint64_t(i)},
+                               {{"x-datadog-tags", value}});
+  }
+  (*capture)->flush();
+  REQUIRE(std::filesystem::file_size(path) < 2 * value.size());
+
+  auto records = TraceCapture::read(path);
+  REQUIRE(records);
+  REQUIRE(records->size() == 100);
+  const auto& last = std::get<TraceCapture::Headers>(records->back());
+  REQUIRE(last.trace_id == 99);
+  REQUIRE(last.headers.front().second == value);
+
+  std::filesystem::remove(path);
+}
+
+TRACE_CAPTURE_TEST("the table of strings is reset when it grows too large") {
+  const auto path = capture_path();
+  auto capture = TraceCapture::create(path);
+  REQUIRE(capture);
+
+  // Each record has two new strings, and each record after the reset also
+  // refers to a string written before the reset.
+  const std::size_t num_records = TraceCapture::max_strings / 2 + 10;
+  for (std::size_t i = 0; i < num_records; ++i) {
+    REQUIRE((*capture)->record_headers(
+        TraceID{i}, {{"key-" + std::to_string(i), "value-" + std::to_string(i)},
+                     {"shared", "value-0"}}));
+  }
+  REQUIRE((*capture)->flush());
+
+  auto records = TraceCapture::read(path);
+  REQUIRE(records);
+  REQUIRE(records->size() == num_records);
+  for (std::size_t i = 0; i < num_records; ++i) {
+    const auto& headers = std::get<TraceCapture::Headers>((*records)[i]);
+    REQUIRE(headers.trace_id == i);
+    REQUIRE(headers.headers.size() == 2);
+    REQUIRE(headers.headers[0].first == "key-" + std::to_string(i));
+    REQUIRE(headers.headers[0].second == "value-" + std::to_string(i));
+    REQUIRE(headers.headers[1].first == "shared");
+    REQUIRE(headers.headers[1].second == "value-0");
+  }
+
+  std::filesystem::remove(path);
+}
+
+#if defined(__linux__)
+TRACE_CAPTURE_TEST("a write error stops the capture") {
+  // Writes to "/dev/full" fail with `ENOSPC`.
+  auto capture = TraceCapture::create("/dev/full");
+  REQUIRE(capture);
+  REQUIRE(!(*capture)->error());
+
+  REQUIRE((*capture)->record_headers(TraceID{1}, {{"key", "value"}}));
+  const auto flushed = (*capture)->flush();
+  REQUIRE(!flushed);
+  REQUIRE(flushed.error().code == Error::TRACE_CAPTURE_IO_ERROR);
+  REQUIRE((*capture)->error());
+  REQUIRE((*capture)->error()->code == Error::TRACE_CAPTURE_IO_ERROR);
+
+  // The error is reported once.  Later records are discarded.
+  REQUIRE((*capture)->record_headers(TraceID{2}, {{"key", "value"}}));
+  REQUIRE((*capture)->flush());
+}
+#endif
+
+TRACE_CAPTURE_TEST("invalid capture files") {
+  const auto path = capture_path();
+
+  SECTION("missing file") {
+    std::filesystem::remove(path);
+    auto records = TraceCapture::read(path);
+    REQUIRE(!records);
+    REQUIRE(records.error().code == Error::TRACE_CAPTURE_IO_ERROR);
+  }
+
+  SECTION("not a capture file") {
+    std::ofstream{path} << "hello, world";
+    auto records = TraceCapture::read(path);
+    REQUIRE(!records);
+    REQUIRE(records.error().code == Error::TRACE_CAPTURE_MALFORMED);
+  }
+
+  SECTION("truncated") {
+    {
+      auto capture = TraceCapture::create(path);
+      REQUIRE(capture);
+      (*capture)->record_headers(TraceID{1}, {{"key", "value"}});
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 2);
+    auto records = TraceCapture::read(path);
+    REQUIRE(!records);
+    REQUIRE(records.error().code == Error::TRACE_CAPTURE_MALFORMED);
+  }
+
+  SECTION("unwritable path") {
+    auto capture = TraceCapture::create("/nonexistent-directory/capture.bin");
+    REQUIRE(!capture);
+    REQUIRE(capture.error().code == Error::TRACE_CAPTURE_IO_ERROR);
+  }
+
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,244 @@
+// These are tests for trace filtering.  A trace whose local root span matches
+// a trace filter rule is neither finalized nor sent to the collector.  See
+// `trace_filter_config.h`.
+
+#include <datadog/error.h>
+#include <datadog/glob.h>
+#include <datadog/span.h>
+#include <datadog/span_config.h>
+#include <datadog/span_data.h>
+#include <datadog/trace_filter.h>
+#include <datadog/trace_filter_config.h>
+#include <datadog/trace_segment.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+#include <datadog/tracer_telemetry.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/environment.h"
+#include "mocks/collectors.h"
+#include "mocks/dict_readers.h"
+#include "mocks/dict_writers.h"
+#include "mocks/loggers.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace datadog::test;
+
+#define TRACE_FILTER_TEST(x) TEST_CASE(x, "[trace_filter]")
+
+TRACE_FILTER_TEST("compiled patterns match like glob_match") {
+  const std::vector<std::string> patterns{
+      "*",      "**",     "",     "GET /health", "GET /health*", "*/metrics",
+      "*probe", "h?alth", "*a*b", "**ready**",   "GET*health",   "?"};
+  const std::vector<std::string> subjects{
+      "",          "GET /health",        "get /HEALTH",     "GET /healthz",
+      "/metrics",  "GET /api/v1/metrics", "readiness-probe", "health",
+      "heALTH",    "ab",                 "xaxbx",           "ready",
+      "not ready", "GET /",              "a"};
+
+  for (const auto& pattern : patterns) {
+    SpanMatcher matcher;
+    matcher.resource = pattern;
+    const TraceFilter filter{{matcher}};
+    for (const auto& subject : subjects) {
+      CAPTURE(pattern, subject);
+      SpanData span;
+      span.resource = subject;
+      REQUIRE(filter.match(span) == glob_match(pattern, subject));
+    }
+  }
+}
+
+TRACE_FILTER_TEST("a trace matches if its root matches any rule") {
+  SpanMatcher health;
+  health.resource = "GET /health*";
+  SpanMatcher scrape;
+  scrape.service = "metrics-*";
+  scrape.tags = {{"http.url", "*/metrics"}};
+  const TraceFilter filter{{health, scrape}};
+  REQUIRE(!filter.empty());
+
+  SpanData span;
+  span.service = "api";
+  span.resource = "GET /healthz";
+  REQUIRE(filter.match(span));
+
+  span.resource = "GET /users";
+  REQUIRE(!filter.match(span));
+
+  span.service = "metrics-exporter";
+  REQUIRE(!filter.match(span));
+  span.tags["http.url"] = "http://localhost:9090/metrics";
+  REQUIRE(filter.match(span));
+
+  REQUIRE(TraceFilter{{}}.empty());
+}
+
+TRACE_FILTER_TEST("tracer filters matching traces") {
+  TracerConfig config;
+  config.service = "testsvc";
+  const auto collector = std::make_shared<MockCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<MockLogger>();
+  SpanMatcher health;
+  health.resource = "GET /health";
+  config.trace_filter.rules.push_back(health);
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  Tracer tracer{*finalized};
+
+  SpanConfig health_check;
+  health_check.resource = "GET /health";
+
+  SECTION("a filtered trace is not sent") {
+    {
+      auto root = tracer.create_span(health_check);
+      REQUIRE(root.trace_segment().filtered());
+      root.set_tag("http.status_code", "200");
+      REQUIRE(!root.lookup_tag("http.status_code"));
+      auto child = root.create_child();
+      REQUIRE(child.trace_segment().filtered());
+      child.set_metric("bytes", 42);
+      REQUIRE(!child.lookup_metric("bytes"));
+      child.set_error_message("oops");
+      child.capture_error_stack();
+      REQUIRE(!child.error());
+      REQUIRE(!child.lookup_tag("error.message"));
+    }
+    REQUIRE(collector->chunks.empty());
+  }
+
+  SECTION("a filtered trace propagates a drop decision") {
+    auto root = tracer.create_span(health_check);
+    const auto decision = root.trace_segment().sampling_decision();
+    REQUIRE(decision);
+    REQUIRE(decision->priority <= 0);
+
+    MockDictWriter writer;
+    root.inject(writer);
+    REQUIRE(writer.items.at("x-datadog-sampling-priority") == "-1");
+  }
+
+  SECTION("other traces are sent") {
+    {
+      SpanConfig request;
+      request.resource = "GET /users";
+      auto root = tracer.create_span(request);
+      REQUIRE(!root.trace_segment().filtered());
+    }
+    REQUIRE(collector->chunks.size() == 1);
+  }
+
+  SECTION("extracted traces are filtered, overriding the upstream decision") {
+    const std::unordered_map<std::string, std::string> headers{
+        {"x-datadog-trace-id", "123"},
+        {"x-datadog-parent-id", "456"},
+        {"x-datadog-sampling-priority", "2"}};
+    MockDictReader reader{headers};
+    {
+      auto span = tracer.extract_span(reader, health_check);
+      REQUIRE(span);
+      REQUIRE(span->trace_segment().filtered());
+
+      MockDictWriter writer;
+      span->inject(writer);
+      REQUIRE(writer.items.at("x-datadog-sampling-priority") == "-1");
+    }
+    REQUIRE(collector->chunks.empty());
+  }
+
+  SECTION("rules match the resource before quantization") {
+    SpanMatcher user;
+    user.resource = "GET /users/123";
+    config.trace_filter.rules = {user};
+    config.resource_quantization.enabled = true;
+    auto quantizing = finalize_config(config);
+    REQUIRE(quantizing);
+    Tracer quantizing_tracer{*quantizing};
+
+    SpanConfig request;
+    request.resource = "GET /users/123";
+    auto root = quantizing_tracer.create_span(request);
+    REQUIRE(root.trace_segment().filtered());
+  }
+}
+
+TRACE_FILTER_TEST("trace filter configuration") {
+  TraceFilterConfig config;
+
+  SECTION("rules from code") {
+    SpanMatcher matcher;
+    matcher.name = "healthcheck";
+    config.rules.push_back(matcher);
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(finalized->rules.size() == 1);
+    REQUIRE(finalized->rules.front() == matcher);
+    REQUIRE(finalized->metadata.at(ConfigName::TRACE_FILTER_RULES).origin ==
+            ConfigMetadata::Origin::CODE);
+  }
+
+  SECTION("DD_TRACE_FILTER_RULES overrides rules from code") {
+    config.rules.emplace_back();
+    const EnvGuard guard{
+        "DD_TRACE_FILTER_RULES",
+        R"([{"resource": "GET /health"}, {"tags": {"probe": "ready*"}}])"};
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(finalized->rules.size() == 2);
+    REQUIRE(finalized->rules[0].resource == "GET /health");
+    REQUIRE(finalized->rules[1].tags.at("probe") == "ready*");
+    REQUIRE(finalized->metadata.at(ConfigName::TRACE_FILTER_RULES).origin ==
+            ConfigMetadata::Origin::ENVIRONMENT_VARIABLE);
+  }
+
+  SECTION("DD_TRACE_FILTER_RULES errors") {
+    struct TestCase {
+      std::string name;
+      std::string env_value;
+      Error::Code expected_error;
+    };
+
+    auto test_case = GENERATE(values<TestCase>({
+        {"invalid JSON", "[{", Error::TRACE_FILTER_RULES_INVALID_JSON},
+        {"not an array", R"({"service": "foo"})",
+         Error::TRACE_FILTER_RULES_WRONG_TYPE},
+        {"unknown property", R"([{"sample_rate": 0.5}])",
+         Error::TRACE_FILTER_RULES_UNKNOWN_PROPERTY},
+        {"rule is not an object", "[42]", Error::RULE_WRONG_TYPE},
+    }));
+
+    CAPTURE(test_case.name);
+    const EnvGuard guard{"DD_TRACE_FILTER_RULES", test_case.env_value};
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    REQUIRE(finalized.error().code == test_case.expected_error);
+  }
+}
+
+TRACE_FILTER_TEST("filtered traces are counted in telemetry") {
+  const TracerSignature signature{RuntimeID::generate(), "testsvc", "test"};
+  auto telemetry = std::make_shared<TracerTelemetry>(
+      true, default_clock, nullptr, signature, "", "");
+  auto& counter = telemetry->metrics().tracer.trace_segments_filtered;
+
+  SECTION("unsharded") {
+    telemetry->count_trace_segment_filtered();
+    telemetry->count_trace_segment_filtered();
+    REQUIRE(counter.value() == 2);
+  }
+
+  SECTION("sharded") {
+    telemetry->use_shards(4);
+    telemetry->count_trace_segment_filtered();
+    REQUIRE(counter.value() == 0);
+    telemetry->merge_shards();
+    REQUIRE(counter.value() == 1);
+  }
+}
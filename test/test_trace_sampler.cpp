@@ -2,6 +2,7 @@
 #include <datadog/id_generator.h>
 #include <datadog/rate.h>
 #include <datadog/sampling_priority.h>
+#include <datadog/shard.h>
 #include <datadog/tracer.h>
 #include <datadog/tracer_config.h>
 
@@ -157,6 +158,59 @@ TEST_CASE("trace sampling rate limiter") {
   REQUIRE(collector->count_of(SamplingPriority::USER_KEEP) == 1);
 }
 
+TEST_CASE("sharded trace sampling rate limiter") {
+  // Verify that the limit is divided among the shards, and then rebalanced
+  // according to each shard's demand.
+  TracerConfig config;
+  config.service = "testsvc";
+  config.trace_sampler.sample_rate = 1.0;
+  config.trace_sampler.max_per_second = 100;
+  config.shards = 4;
+  const auto collector = std::make_shared<PriorityCountingCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<NullLogger>();
+
+  TimePoint current_time = default_clock();
+  // Modify `current_time` to advance the clock.
+  auto clock = [&current_time]() { return current_time; };
+
+  auto finalized = finalize_config(config, clock);
+  REQUIRE(finalized);
+
+  Tracer tracer{*finalized};
+
+  // Create a burst of traces on the specified `shard`, and return how many
+  // were kept.
+  const auto burst = [&](std::size_t shard) {
+    set_current_shard(shard);
+    collector->sampling_priority_count.clear();
+    for (int i = 0; i < 100; ++i) {
+      auto span = tracer.create_span();
+      (void)span;
+    }
+    return collector->count_of(SamplingPriority::USER_KEEP);
+  };
+
+  // Initially, each shard is allowed an even share of the limit.
+  REQUIRE(burst(0) == 25);
+  REQUIRE(burst(1) == 25);
+
+  // Demand was on shards zero and one.  Half of the limit is divided evenly
+  // (12.5 per second), and half according to demand (25 each for shards zero
+  // and one).
+  current_time += std::chrono::seconds(1);
+  REQUIRE(burst(0) > 25);
+  REQUIRE(burst(1) > 25);
+  REQUIRE(burst(2) == 13);
+
+  // Now demand was on shards zero, one, and two.  Shard three had none, and
+  // so is allowed only its part of the even half of the limit.
+  current_time += std::chrono::seconds(1);
+  REQUIRE(burst(3) == 13);
+
+  set_current_shard(0);
+}
+
 TEST_CASE("priority sampling") {
   // Verify that a `TraceSampler` not otherwise configured will use whichever
   // sample rates are sent back to it by the collector (Datadog Agent).
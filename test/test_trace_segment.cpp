@@ -1,3 +1,5 @@
+#include <datadog/hex.h>
+#include <datadog/injection_options.h>
 #include <datadog/null_collector.h>
 #include <datadog/optional.h>
 #include <datadog/platform_util.h>
@@ -8,6 +10,8 @@
 #include <datadog/tracer_config.h>
 
 #include <regex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "matchers.h"
@@ -481,4 +485,207 @@ TEST_CASE("independent of Tracer") {
   Span child = root.create_child();
 
   tracer.reset();
+
+  // The trace segment generates span IDs without the tracer.
+  Span grandchild = child.create_child();
+}
+
+TEST_CASE("injection options") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.collector = std::make_shared<MockCollector>();
+  config.logger = std::make_shared<MockLogger>();
+  config.extraction_styles = {PropagationStyle::W3C};
+  config.injection_styles = {PropagationStyle::DATADOG, PropagationStyle::B3,
+                             PropagationStyle::W3C};
+
+  auto finalized_config = finalize_config(config);
+  REQUIRE(finalized_config);
+  Tracer tracer{*finalized_config};
+
+  const std::unordered_map<std::string, std::string> headers{
+      {"traceparent",
+       "00-00000000000000000000000000000001-0000000000000001-01"},
+      {"tracestate", "dd=s:1;o:synthetics;t.foo:bar,a=1,bb=22,ccc=333"}};
+  MockDictReader reader{headers};
+  auto span = tracer.extract_span(reader);
+  REQUIRE(span);
+
+  SECTION("no options injects every configured style") {
+    MockDictWriter writer;
+    span->inject(writer, InjectionOptions{});
+    REQUIRE(writer.items.count("x-datadog-trace-id") == 1);
+    REQUIRE(writer.items.count("x-b3-traceid") == 1);
+    REQUIRE(writer.items.count("traceparent") == 1);
+  }
+
+  SECTION("Datadog style only") {
+    InjectionOptions options;
+    options.styles = {PropagationStyle::DATADOG};
+    MockDictWriter writer;
+    span->inject(writer, options);
+    REQUIRE(writer.items.count("x-datadog-trace-id") == 1);
+    REQUIRE(writer.items.count("x-b3-traceid") == 0);
+    REQUIRE(writer.items.count("traceparent") == 0);
+    REQUIRE(writer.items.count("tracestate") == 0);
+  }
+
+  SECTION("W3C style only") {
+    InjectionOptions options;
+    options.styles = {PropagationStyle::W3C};
+    MockDictWriter writer;
+    span->inject(writer, options);
+    REQUIRE(writer.items.count("x-datadog-trace-id") == 0);
+    REQUIRE(writer.items.count("x-datadog-tags") == 0);
+    REQUIRE(writer.items.count("x-datadog-origin") == 0);
+    REQUIRE(writer.items.count("x-b3-traceid") == 0);
+    REQUIRE(writer.items.count("traceparent") == 1);
+    REQUIRE(writer.items.count("tracestate") == 1);
+  }
+
+  SECTION("styles that are not configured are ignored") {
+    InjectionOptions options;
+    options.styles = {PropagationStyle::BAGGAGE};
+    MockDictWriter writer;
+    span->inject(writer, options);
+    REQUIRE(writer.items.empty());
+  }
+
+  SECTION("tracestate size cap") {
+    const std::string parent_id = hex_padded(span->id());
+    const std::string full =
+        "dd=s:1;p:" + parent_id + ";o:synthetics;t.foo:bar,a=1,bb=22,ccc=333";
+
+    struct TestCase {
+      int line;
+      std::size_t max_size;
+      std::string expected;
+    };
+
+    const std::vector<TestCase> test_cases{
+        {__LINE__, 1000, full},
+        {__LINE__, full.size(), full},
+        {__LINE__, full.size() - 1,
+         "dd=s:1;p:" + parent_id + ";o:synthetics;t.foo:bar,a=1,bb=22"},
+        {__LINE__, full.size() - 10,
+         "dd=s:1;p:" + parent_id + ";o:synthetics;t.foo:bar,a=1"},
+        {__LINE__, 40, "dd=s:1;p:" + parent_id + ";o:synthetics"},
+        {__LINE__, 0, "dd=s:1;p:" + parent_id},
+    };
+
+    for (const auto& test_case : test_cases) {
+      CAPTURE(test_case.line);
+      InjectionOptions options;
+      options.styles = {PropagationStyle::W3C};
+      options.max_tracestate_size = test_case.max_size;
+      MockDictWriter writer;
+      span->inject(writer, options);
+      REQUIRE(writer.items.at("tracestate") == test_case.expected);
+    }
+  }
+}
+
+TEST_CASE("single-threaded trace segments") {
+  TracerConfig config;
+  config.service = "testsvc";
+  const auto collector = std::make_shared<MockCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<MockLogger>();
+  config.single_threaded = GENERATE(false, true);
+  CAPTURE(*config.single_threaded);
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  REQUIRE(finalized->single_threaded == *config.single_threaded);
+  Tracer tracer{*finalized};
+
+  SECTION("spans are sent once the last of them finishes") {
+    std::vector<Span> spans;
+    {
+      auto root = tracer.create_span();
+      auto child = root.create_child();
+      spans.push_back(child.create_child());
+      spans.push_back(std::move(child));
+      // `root` is finished here, but its descendants are not.
+    }
+    REQUIRE(collector->chunks.empty());
+
+    spans.push_back(spans.front().create_child());
+    spans.pop_back();
+    REQUIRE(collector->chunks.empty());
+
+    spans.clear();
+    REQUIRE(collector->chunks.size() == 1);
+    const auto& chunk = collector->chunks.front();
+    REQUIRE(chunk.size() == 4);
+
+    const auto& root = *chunk.front();
+    std::unordered_map<std::uint64_t, std::uint64_t> parents;
+    for (const auto& span : chunk) {
+      REQUIRE(span->trace_id == root.trace_id);
+      // Span IDs are unique.
+      REQUIRE(parents.emplace(span->span_id, span->parent_id).second);
+    }
+    REQUIRE(parents.at(root.span_id) == 0);
+    for (const auto& span : chunk) {
+      if (span.get() != &root) {
+        REQUIRE(parents.count(span->parent_id));
+      }
+    }
+  }
+
+  SECTION("extracted spans") {
+    const std::unordered_map<std::string, std::string> headers{
+        {"x-datadog-trace-id", "123"}, {"x-datadog-parent-id", "456"}};
+    MockDictReader reader{headers};
+    {
+      auto span = tracer.extract_span(reader);
+      REQUIRE(span);
+      auto child = span->create_child();
+      auto moved = std::move(child);
+    }
+    REQUIRE(collector->chunks.size() == 1);
+    REQUIRE(collector->chunks.front().size() == 2);
+    REQUIRE(collector->chunks.front().front()->parent_id == 456);
+  }
+
+  SECTION("many traces") {
+    for (int i = 0; i < 100; ++i) {
+      auto root = tracer.create_span();
+      auto child = root.create_child();
+      child.trace_segment().override_sampling_priority(1);
+    }
+    REQUIRE(collector->chunks.size() == 100);
+    REQUIRE(collector->span_count() == 200);
+  }
+}
+
+TEST_CASE("the last span of a trace segment can finish on another thread") {
+  TracerConfig config{};
+  config.service = "testsvc";
+  const auto collector = std::make_shared<MockCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<MockLogger>();
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  Tracer tracer{*finalized};
+
+  // The spans of each trace finish concurrently on two threads, so that
+  // either of them might be the last, and the segment must be sent once and
+  // outlive both.
+  const int num_traces = 200;
+  for (int i = 0; i < num_traces; ++i) {
+    auto root = tracer.create_span();
+    auto child = root.create_child();
+    std::thread finisher{[child = std::move(child)]() mutable {
+      auto grandchild = child.create_child();
+    }};
+    {
+      auto moved = std::move(root);
+    }
+    finisher.join();
+  }
+
+  REQUIRE(collector->chunks.size() == num_traces);
+  REQUIRE(collector->span_count() == 3 * num_traces);
 }
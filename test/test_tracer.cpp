@@ -53,7 +53,7 @@ using namespace datadog::tracing;
 // configuration do determine the default properties of spans created by the
 // tracer.
 TEST_CASE("tracer span defaults") {
-  TracerConfig config;
+  TracerConfig config{};
   config.service = "foosvc";
   config.service_type = "crawler";
   config.environment = "swamp";
@@ -308,7 +308,7 @@ TEST_CASE("tracer span defaults") {
 }
 
 TEST_CASE("span extraction") {
-  TracerConfig config;
+  TracerConfig config{};
   config.service = "testsvc";
   const auto collector = std::make_shared<MockCollector>();
   config.collector = collector;
@@ -431,6 +431,36 @@ TEST_CASE("span extraction") {
           {"x-b3-spanid", "def"},
           {"x-b3-sampled", "99999999999999999999999999"}},
          Error::OUT_OF_RANGE_INTEGER},
+        {__LINE__,
+         "bad b3 trace ID",
+         {PropagationStyle::B3_SINGLE},
+         {{"b3", "0xdeadbeef-def-1"}},
+         Error::INVALID_INTEGER},
+        {__LINE__,
+         "bad b3 span ID",
+         {PropagationStyle::B3_SINGLE},
+         {{"b3", "abc-ffffffffffffffffffffffffffffff-1"}},
+         Error::OUT_OF_RANGE_INTEGER},
+        {__LINE__,
+         "bad b3 sampling state",
+         {PropagationStyle::B3_SINGLE},
+         {{"b3", "abc-def-true"}},
+         Error::MALFORMED_B3_HEADER},
+        {__LINE__,
+         "bad b3 sampling state alone",
+         {PropagationStyle::B3_SINGLE},
+         {{"b3", "2"}},
+         Error::MALFORMED_B3_HEADER},
+        {__LINE__,
+         "too many b3 fields",
+         {PropagationStyle::B3_SINGLE},
+         {{"b3", "abc-def-1-123-456"}},
+         Error::MALFORMED_B3_HEADER},
+        {__LINE__,
+         "b3 sampling state alone",
+         {PropagationStyle::B3_SINGLE},
+         {{"b3", "0"}},
+         Error::NO_SPAN_TO_EXTRACT},
         {__LINE__,
          "zero x-datadog-trace-id",
          {PropagationStyle::DATADOG},
@@ -589,6 +619,38 @@ TEST_CASE("span extraction") {
          TraceID(0xfff),
          0xef,
          nullopt},
+        {__LINE__,
+         "B3 single-header style",
+         {PropagationStyle::B3_SINGLE},
+         {{"b3", "80f198ee56343ba864fe8b2a57d3eff7-e457b5a2e4d86bd1-1-"
+                 "05e3ac9a4f6e3b90"}},
+         TraceID(0x64fe8b2a57d3eff7, 0x80f198ee56343ba8),
+         0xe457b5a2e4d86bd1,
+         1},
+        {__LINE__,
+         "B3 single-header style, debug",
+         {PropagationStyle::B3_SINGLE},
+         {{"b3", " abc-def-d "}},
+         TraceID(0xabc),
+         0xdef,
+         2},
+        {__LINE__,
+         "B3 single-header style without sampling state",
+         {PropagationStyle::B3_SINGLE},
+         {{"b3", "abc-def"}},
+         TraceID(0xabc),
+         0xdef,
+         nullopt},
+        {__LINE__,
+         "B3 overriding B3 single-header style",
+         {PropagationStyle::B3, PropagationStyle::B3_SINGLE},
+         {{"x-b3-traceid", "fff"},
+          {"x-b3-spanid", "ef"},
+          {"x-b3-sampled", "0"},
+          {"b3", "abc-def-1"}},
+         TraceID(0xfff),
+         0xef,
+         0},
     }));
 
     CAPTURE(test_case.line);
@@ -1432,6 +1494,26 @@ TEST_CASE("baggage usage") {
     REQUIRE(writer.items.count("baggage") == 1);
     CHECK(writer.items["baggage"] == "data=dog");
   }
+
+  SECTION("injection options can omit baggage") {
+    auto finalized_config = finalize_config(config);
+    REQUIRE(finalized_config);
+
+    Tracer tracer(*finalized_config);
+
+    auto baggage = tracer.create_baggage();
+    baggage.set("data", "dog");
+
+    InjectionOptions options;
+    options.styles = {PropagationStyle::DATADOG, PropagationStyle::W3C};
+    MockDictWriter writer;
+    CHECK(tracer.inject(baggage, writer, options));
+    CHECK(writer.items.count("baggage") == 0);
+
+    options.styles->push_back(PropagationStyle::BAGGAGE);
+    CHECK(tracer.inject(baggage, writer, options));
+    CHECK(writer.items.count("baggage") == 1);
+  }
 }
 
 TEST_CASE("report hostname") {
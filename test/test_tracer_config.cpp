@@ -342,7 +342,7 @@ TRACER_CONFIG_TEST("TracerConfig::report_traces") {
 }
 
 TRACER_CONFIG_TEST("TracerConfig::agent") {
-  TracerConfig config;
+  TracerConfig config{};
   config.service = "testsvc";
 
   SECTION("event_scheduler") {
@@ -429,6 +429,48 @@ TRACER_CONFIG_TEST("TracerConfig::agent") {
     }
   }
 
+  SECTION("agent discovery") {
+    SECTION("defaults") {
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(agent->agent_discovery_enabled);
+      REQUIRE(agent->agent_info_poll_interval == std::chrono::seconds(60));
+      REQUIRE(agent->url_is_default);
+    }
+
+    SECTION("environment variable overrides") {
+      const EnvGuard env_guard{"DD_TRACE_AGENT_DISCOVERY_ENABLED", "false"};
+      config.agent.agent_discovery_enabled = true;
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(!agent->agent_discovery_enabled);
+    }
+
+    SECTION("poll interval must be positive") {
+      config.agent.agent_info_poll_interval_seconds = 0;
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_INFO_POLL_INTERVAL);
+    }
+
+    SECTION("configured url") {
+      config.agent.url = "http://localhost:8126";
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(!agent->url_is_default);
+    }
+  }
+
   SECTION("url") {
     SECTION("parsing") {
       struct TestCase {
@@ -532,7 +574,7 @@ TRACER_CONFIG_TEST("TracerConfig::agent") {
 }
 
 TRACER_CONFIG_TEST("TracerConfig::trace_sampler") {
-  TracerConfig config;
+  TracerConfig config{};
   config.service = "testsvc";
 
   SECTION("default is no rules") {
@@ -801,7 +843,7 @@ TRACER_CONFIG_TEST("TracerConfig::trace_sampler") {
 }
 
 TRACER_CONFIG_TEST("TracerConfig::span_sampler") {
-  TracerConfig config;
+  TracerConfig config{};
   config.service = "testsvc";
 
   SECTION("default is no rules") {
@@ -1035,7 +1077,7 @@ TRACER_CONFIG_TEST("TracerConfig::span_sampler") {
 }
 
 TRACER_CONFIG_TEST("TracerConfig propagation styles") {
-  TracerConfig config;
+  TracerConfig config{};
   config.service = "testsvc";
 
   SECTION("default style is [Datadog, W3C, Baggage]") {
@@ -1114,6 +1156,7 @@ TRACER_CONFIG_TEST("TracerConfig propagation styles") {
         static const auto x = nullopt;
         static const auto datadog = PropagationStyle::DATADOG,
                           b3 = PropagationStyle::B3,
+                          b3_single = PropagationStyle::B3_SINGLE,
                           none = PropagationStyle::NONE,
                           baggage = PropagationStyle::BAGGAGE;
 
@@ -1125,6 +1168,8 @@ TRACER_CONFIG_TEST("TracerConfig propagation styles") {
           {__LINE__, "b3", x, {b3}},
           {__LINE__, "b3MULTI", x, {b3}},
           {__LINE__, "b3, b3multi", Error::DUPLICATE_PROPAGATION_STYLE  },
+          {__LINE__, "B3single", x, {b3_single}},
+          {__LINE__, "b3 b3single", x, {b3, b3_single}},
           {__LINE__, "Datadog B3", x, {datadog, b3}},
           {__LINE__, "Datadog B3 none", x, {datadog, b3, none}},
           {__LINE__, "NONE", x, {none}},
@@ -2,11 +2,14 @@
 // activity in other parts of the tracer implementation, and construct messages
 // that are sent to the datadog agent.
 
+#include <datadog/shard.h>
 #include <datadog/span_defaults.h>
 #include <datadog/tracer_telemetry.h>
 
 #include <datadog/json.hpp>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 
 #include "datadog/runtime_id.h"
 #include "mocks/loggers.h"
@@ -225,3 +228,53 @@ TEST_CASE("Tracer telemetry", "[telemetry]") {
     REQUIRE(heartbeat["request_type"] == "app-closing");
   }
 }
+
+TEST_CASE("sharded tracer telemetry", "[telemetry]") {
+  const TracerSignature tracer_signature{RuntimeID::generate(), "testsvc",
+                                         "test"};
+  TracerTelemetry tracer_telemetry{
+      true, default_clock, std::make_shared<MockLogger>(), tracer_signature,
+      "", ""};
+  tracer_telemetry.use_shards(4);
+  auto& open = tracer_telemetry.metrics().tracer.trace_segments_open;
+
+  SECTION("segments can close on a different shard") {
+    std::thread{[&]() {
+      set_current_shard(1);
+      for (int i = 0; i < 3; ++i) {
+        tracer_telemetry.count_trace_segment_created(false);
+      }
+    }}.join();
+    std::thread{[&]() {
+      set_current_shard(2);
+      tracer_telemetry.count_trace_segment_closed(1);
+      tracer_telemetry.count_trace_segment_closed(1);
+    }}.join();
+
+    tracer_telemetry.merge_shards();
+    REQUIRE(open.value() == 1);
+    // Merging again doesn't change the number of open segments.
+    tracer_telemetry.merge_shards();
+    REQUIRE(open.value() == 1);
+  }
+
+  SECTION("concurrent merges don't make the open segment gauge drift") {
+    std::vector<std::thread> threads;
+    for (std::size_t shard = 0; shard < 4; ++shard) {
+      threads.emplace_back([&, shard]() {
+        set_current_shard(shard);
+        for (int i = 0; i < 10000; ++i) {
+          tracer_telemetry.count_trace_segment_created(false);
+          tracer_telemetry.count_trace_segment_closed(1);
+          tracer_telemetry.merge_shards();
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    tracer_telemetry.merge_shards();
+    REQUIRE(open.value() == 0);
+  }
+}
@@ -0,0 +1,93 @@
+// These are tests for the USDT probes defined in "usdt.h".  The probes are
+// only compiled when the library is built with the CMake option
+// `DD_TRACE_ENABLE_USDT`, and so this file is part of the test executable only
+// then.  The test reads the ".note.stapsdt" section of the test executable,
+// which is statically linked with the library, and checks that each of the
+// probes is present.
+
+#include <elf.h>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+// Return the names of the probes of the specified `provider` that are listed
+// in the ".note.stapsdt" section of the ELF64 file at the specified `path`.
+std::set<std::string> list_probes(const char* path,
+                                  const std::string& provider) {
+  std::ifstream file{path, std::ios::binary};
+  const std::vector<char> image{std::istreambuf_iterator<char>{file},
+                                std::istreambuf_iterator<char>{}};
+  REQUIRE(image.size() >= sizeof(Elf64_Ehdr));
+  REQUIRE(std::memcmp(image.data(), ELFMAG, SELFMAG) == 0);
+  REQUIRE(image[EI_CLASS] == ELFCLASS64);
+
+  Elf64_Ehdr header;
+  std::memcpy(&header, image.data(), sizeof header);
+  const auto section_header = [&](std::size_t index) {
+    Elf64_Shdr section;
+    const std::size_t offset = header.e_shoff + index * header.e_shentsize;
+    REQUIRE(offset + sizeof section <= image.size());
+    std::memcpy(&section, image.data() + offset, sizeof section);
+    return section;
+  };
+
+  const Elf64_Shdr names = section_header(header.e_shstrndx);
+  std::set<std::string> probes;
+  for (std::size_t i = 0; i < header.e_shnum; ++i) {
+    const Elf64_Shdr section = section_header(i);
+    if (section.sh_type != SHT_NOTE ||
+        std::strcmp(image.data() + names.sh_offset + section.sh_name,
+                    ".note.stapsdt") != 0) {
+      continue;
+    }
+    // Each note is a header, the owner name "stapsdt", and a descriptor
+    // containing three addresses followed by the null-terminated provider
+    // name, probe name, and argument description.
+    const auto align = [](std::size_t n) { return (n + 3) & ~std::size_t(3); };
+    std::size_t offset = section.sh_offset;
+    const std::size_t end = section.sh_offset + section.sh_size;
+    while (offset + sizeof(Elf64_Nhdr) <= end) {
+      Elf64_Nhdr note;
+      std::memcpy(&note, image.data() + offset, sizeof note);
+      const char* owner = image.data() + offset + sizeof note;
+      const char* descriptor = owner + align(note.n_namesz);
+      if (note.n_type == 3 && std::strcmp(owner, "stapsdt") == 0) {
+        const char* note_provider = descriptor + 3 * sizeof(Elf64_Addr);
+        const char* name = note_provider + std::strlen(note_provider) + 1;
+        if (note_provider == provider) {
+          probes.insert(name);
+        }
+      }
+      offset += sizeof note + align(note.n_namesz) + align(note.n_descsz);
+    }
+  }
+  return probes;
+}
+
+}  // namespace
+
+TEST_CASE("USDT probes are listed in the ELF notes", "[usdt]") {
+  const auto probes = list_probes("/proc/self/exe", "dd_trace_cpp");
+  CAPTURE(probes);
+
+  const auto expected = GENERATE(values<std::string>({
+      "span_create",
+      "span_finish",
+      "sampling_decision",
+      "segment_finalize",
+      "agent_send",
+      "flush_start",
+      "flush_end",
+      "http_complete",
+  }));
+  CAPTURE(expected);
+  REQUIRE(probes.count(expected) == 1);
+}
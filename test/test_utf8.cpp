@@ -0,0 +1,169 @@
+// These are tests for UTF-8 validation and sanitization.
+
+#include <datadog/utf8.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+#define UTF8_TEST(x) TEST_CASE(x, "[utf8]")
+
+namespace {
+
+// Return whether `input` is valid UTF-8, by decoding each code point and
+// checking its value, rather than by checking byte ranges as `utf8.cpp` does.
+bool reference_is_valid_utf8(const std::string& input) {
+  std::size_t i = 0;
+  while (i < input.size()) {
+    const auto lead = static_cast<unsigned char>(input[i]);
+    std::size_t length;
+    std::uint32_t code_point;
+    if (lead < 0x80) {
+      length = 1;
+      code_point = lead;
+    } else if ((lead & 0xE0) == 0xC0) {
+      length = 2;
+      code_point = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+      length = 3;
+      code_point = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+      length = 4;
+      code_point = lead & 0x07;
+    } else {
+      return false;
+    }
+    if (i + length > input.size()) {
+      return false;
+    }
+    for (std::size_t j = 1; j < length; ++j) {
+      const auto byte = static_cast<unsigned char>(input[i + j]);
+      if ((byte & 0xC0) != 0x80) {
+        return false;
+      }
+      code_point = code_point << 6 | (byte & 0x3F);
+    }
+    const std::uint32_t min_code_point[] = {0, 0, 0x80, 0x800, 0x10000};
+    if (code_point < min_code_point[length] || code_point > 0x10FFFF ||
+        (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+      return false;
+    }
+    i += length;
+  }
+  return true;
+}
+
+}  // namespace
+
+UTF8_TEST("valid UTF-8") {
+  auto input = GENERATE(values<std::string>({
+      "",
+      "hello",
+      "GET /api/v1/users?id=123 HTTP/1.1",
+      "caf\xC3\xA9",
+      // U+0800, U+FFFF, U+10000, U+10FFFF
+      "\xE0\xA0\x80 \xEF\xBF\xBF \xF0\x90\x80\x80 \xF4\x8F\xBF\xBF",
+      // U+D7FF and U+E000, either side of the surrogates
+      "\xED\x9F\xBF\xEE\x80\x80",
+      std::string("nul\0byte", 8),
+  }));
+  CAPTURE(input);
+
+  REQUIRE(is_valid_utf8(input));
+  REQUIRE(utf8_valid_prefix(input) == input.size());
+  std::string sanitized;
+  REQUIRE(append_sanitized_utf8(sanitized, input) == 0);
+  REQUIRE(sanitized == input);
+}
+
+UTF8_TEST("invalid UTF-8 is replaced by maximal subpart") {
+  struct TestCase {
+    std::string name;
+    std::string input;
+    std::size_t valid_prefix;
+    std::string expected;
+  };
+
+  const std::string r{utf8_replacement_character};
+
+  auto test_case = GENERATE_COPY(values<TestCase>({
+      {"lone continuation byte", "a\x80z", 1, "a" + r + "z"},
+      {"two continuation bytes", "\x80\xBF", 0, r + r},
+      {"overlong two byte", "\xC0\xAF", 0, r + r},
+      {"overlong three byte", "\xE0\x80\xAF", 0, r + r + r},
+      {"overlong four byte", "\xF0\x80\x80\xAF", 0, r + r + r + r},
+      {"surrogate", "\xED\xA0\x80", 0, r + r + r},
+      {"beyond U+10FFFF", "\xF4\x90\x80\x80", 0, r + r + r + r},
+      {"invalid lead bytes", "\xF5\xFF", 0, r + r},
+      {"truncated at end", "ok\xE2\x82", 2, "ok" + r},
+      {"truncated four byte", "\xF0\x9F\x98x", 0, r + "x"},
+      // This is the example of table 3-8 of the Unicode Standard.
+      {"Unicode example",
+       "\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64", 1,
+       "a" + r + r + r + "b" + r + "c" + r + r + "d"},
+  }));
+  CAPTURE(test_case.name);
+
+  REQUIRE(!is_valid_utf8(test_case.input));
+  REQUIRE(utf8_valid_prefix(test_case.input) == test_case.valid_prefix);
+  std::string sanitized = "prefix:";
+  append_sanitized_utf8(sanitized, test_case.input);
+  REQUIRE(sanitized == "prefix:" + test_case.expected);
+  REQUIRE(is_valid_utf8(sanitized));
+}
+
+UTF8_TEST("invalid bytes are found in every position of a block") {
+  // The validators work on blocks of sixty-four, sixteen, and eight bytes, so
+  // put an invalid byte, a truncated character, and a valid multibyte
+  // character at each offset.
+  for (std::size_t offset = 0; offset < 140; ++offset) {
+    CAPTURE(offset);
+    std::string input(140, 'x');
+    input[offset] = '\xFF';
+    REQUIRE(!is_valid_utf8(input));
+    REQUIRE(utf8_valid_prefix(input) == offset);
+
+    std::string truncated(140, 'x');
+    truncated.insert(offset, "\xF0\x9F\x98");
+    REQUIRE(!is_valid_utf8(truncated));
+    REQUIRE(!is_valid_utf8(truncated.substr(0, offset + 2)));
+
+    std::string valid(140, 'x');
+    valid.insert(offset, "\xF0\x9F\x98\x80");
+    REQUIRE(is_valid_utf8(valid));
+    REQUIRE(is_valid_utf8(valid.substr(0, offset + 4)));
+  }
+}
+
+UTF8_TEST("validation agrees with a decoding reference") {
+  std::mt19937 generator{42};
+  // Bias the bytes towards ASCII, continuation bytes, and lead bytes, so that
+  // many inputs are valid and the invalid ones are subtly invalid.
+  const unsigned char interesting[] = {'a',  0x7F, 0x80, 0x8F, 0x90, 0x9F,
+                                       0xA0, 0xBF, 0xC1, 0xC2, 0xDF, 0xE0,
+                                       0xE1, 0xED, 0xEF, 0xF0, 0xF4, 0xF5};
+  for (int i = 0; i < 100000; ++i) {
+    std::string input(generator() % 80, 'a');
+    for (char& c : input) {
+      c = static_cast<char>(interesting[generator() % sizeof interesting]);
+    }
+    CAPTURE(input);
+    const bool valid = reference_is_valid_utf8(input);
+    REQUIRE(is_valid_utf8(input) == valid);
+    REQUIRE(reference_is_valid_utf8(
+                input.substr(0, utf8_valid_prefix(input))));
+
+    std::string sanitized;
+    const std::size_t replacements = append_sanitized_utf8(sanitized, input);
+    REQUIRE(reference_is_valid_utf8(sanitized));
+    REQUIRE((replacements == 0) == valid);
+    if (valid) {
+      REQUIRE(sanitized == input);
+    }
+  }
+}